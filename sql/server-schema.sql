@@ -55,6 +55,12 @@ CREATE TABLE choices(
  log BLOB NOT NULL,
  PRIMARY KEY (gid, uid));
  
+# Game state at the start of the latest round of unfinished games
+CREATE TABLE checkpoints(
+ gid INT NOT NULL PRIMARY KEY,
+ rand_pos INT NOT NULL,
+ state BLOB NOT NULL);
+
 # This table is only used from version 0.8.1k
 CREATE TABLE messages(
  mid INT NOT NULL AUTO_INCREMENT PRIMARY KEY,
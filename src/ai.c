@@ -24,31 +24,189 @@
 #include "rftg.h"
 #include "net.h"
 
+#ifndef WIN32
+#include <sys/time.h>
+#endif
+
+#ifdef AI_THREADS
+#include <pthread.h>
+
+/*
+ * AI state kept separately by each thread playing games.
+ */
+#define AI_LOCAL __thread
+#else
+#define AI_LOCAL
+#endif
+
 /* #define DEBUG */
 
 /*
  * Track number of times neural net is computed.
  */
-static int num_computes;
+static AI_LOCAL int num_computes;
 
 
 /*
  * A neural net for evaluating hand and active cards.
  */
-static net eval;
+static AI_LOCAL net eval;
 
 /*
  * A neural net for predicting role choices.
  */
-static net role;
+static AI_LOCAL net role;
 
 /*
  * Counters for tracking usefulness of role prediction.
  */
-static int role_hit, role_miss;
-static double role_avg;
+static AI_LOCAL int role_hit, role_miss;
+static AI_LOCAL double role_avg;
+
+static AI_LOCAL int eval_cache_hit, eval_cache_miss;
+
+/*
+ * Names of the parts of a game that decision time is reported for.
+ */
+char *stat_name[MAX_STAT] =
+{
+	"start",
+	"action",
+	"explore",
+	"develop",
+	"settle",
+	"consume",
+	"produce",
+	"discard",
+};
+
+/*
+ * Seconds spent choosing during each part of real games.
+ */
+static AI_LOCAL double phase_time[MAX_STAT];
+
+/*
+ * Counters as of the last time statistics were collected.
+ */
+static AI_LOCAL unsigned int last_computes, last_cache_hit, last_cache_miss;
+static AI_LOCAL unsigned int last_role_hit, last_role_miss;
+static AI_LOCAL double last_eval_error, last_eval_num_error;
+static AI_LOCAL double last_role_error, last_role_num_error;
+
+/*
+ * File receiving eval network inputs and game outcomes, if any.
+ *
+ * While experience is captured, the eval network is not trained.
+ */
+static FILE *experience_file;
+
+/*
+ * Eval network inputs of the current game.
+ */
+static AI_LOCAL experience eval_experience;
+
+/*
+ * File receiving role network inputs and the roles chosen, if any.
+ */
+static FILE *role_experience_file;
+
+/*
+ * Role network inputs of the current game.
+ */
+static AI_LOCAL experience role_experience;
+
+/*
+ * First role network input set whose chosen roles are not known yet.
+ */
+static AI_LOCAL int role_pending;
+
+/*
+ * Most network sets loaded at once.
+ */
+#define MAX_NETWORK_SET 8
+
+/*
+ * Loaded network sets, for games between players using different networks.
+ *
+ * Set 0 holds the networks loaded by ai_initialize() while another set is
+ * active.
+ */
+static net set_eval[MAX_NETWORK_SET], set_role[MAX_NETWORK_SET];
+static int num_network_set = 1;
+
+/*
+ * Network set used by each player, and set currently in eval and role.
+ */
+static int player_set[MAX_PLAYER];
+static int active_set;
+
+/*
+ * Configuration of the networks in eval and role.
+ */
+static AI_LOCAL int loaded_p, loaded_e, loaded_a;
+
+/*
+ * Networks of other configurations loaded earlier, kept in memory while
+ * they are not used.
+ */
+static AI_LOCAL net config_eval[MAX_EXPANSION][MAX_PLAYER + 1][2];
+static AI_LOCAL net config_role[MAX_EXPANSION][MAX_PLAYER + 1][2];
+static AI_LOCAL int config_kept[MAX_EXPANSION][MAX_PLAYER + 1][2];
+
+/*
+ * Directory holding binary checkpoints of the networks, if any.
+ */
+static char *checkpoint_dir;
+
+/*
+ * Number of older checkpoints kept besides the newest one.
+ */
+static int checkpoint_keep;
+
+/*
+ * Forward declaration.
+ */
+static void checkpoint_name(char *buf, char *kind, int expanded,
+                            int num_players, int advanced, int age);
+
+#ifdef AI_THREADS
+/*
+ * Networks loaded by the first thread, whose weights other threads share.
+ */
+static net *master_eval, *master_role;
 
-static int eval_cache_hit, eval_cache_miss;
+/*
+ * Networks of each configuration loaded so far, whose weights threads
+ * playing games of that configuration share.
+ */
+static net shared_eval[MAX_EXPANSION][MAX_PLAYER + 1][2];
+static net shared_role[MAX_EXPANSION][MAX_PLAYER + 1][2];
+static int shared_loaded[MAX_EXPANSION][MAX_PLAYER + 1][2];
+
+/*
+ * Lock serializing loading of networks.
+ */
+static pthread_mutex_t load_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Training counters and statistics of finished threads.
+ */
+static int done_eval_training, done_role_training;
+static double done_eval_error, done_eval_num_error;
+static double done_role_error, done_role_num_error;
+static int done_role_hit, done_role_miss;
+static double done_role_avg;
+
+/*
+ * Lock serializing updates to the shared weights.
+ */
+static pthread_mutex_t train_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Lock serializing writes to the experience files.
+ */
+static pthread_mutex_t experience_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
 
 /*
  * Size of evaluator neural net.
@@ -90,41 +248,57 @@ static int eval_cache_hit, eval_cache_miss;
  * Forward declaration.
  */
 static void initial_training(game *g);
+static void setup_inputs(game *g);
 static void setup_nets(game *g);
+static void clear_eval_cache(void);
+static void clear_opp_place_cache(void);
 static void fill_adv_combo(void);
 
 
 /*
- * Initialize AI.
+ * Set learning rates of the networks.
  */
-static void ai_initialize(game *g, int who, double factor)
+static void set_learning_rate(double factor)
+{
+	/* Set learning rates */
+	eval.alpha = 0.0001 * factor;
+	role.alpha = 0.0005 * factor;
+#ifdef DEBUG
+	eval.alpha = role.alpha = 0.0;
+#endif
+}
+
+/*
+ * Create networks for the game's configuration and load their weights.
+ */
+static void load_nets(game *g, double factor)
 {
 	char fname[1024], msg[1024];
-	static int loaded_p, loaded_e, loaded_a;
+	int i;
 
-	/* Create table of advanced action combinations */
-	fill_adv_combo();
+	/* Compute size and input names of networks */
+	setup_nets(g);
 
-	/* Do nothing if correct networks already loaded */
-	if (loaded_p == g->num_players && loaded_e == g->expanded &&
-	    loaded_a == g->advanced) return;
+	/* Set learning rates */
+	set_learning_rate(factor);
 
-	/* Free old networks if some already loaded */
-	if (loaded_p > 0)
+	/* Loop over checkpoints to resume from, newest first */
+	for (i = 0; checkpoint_dir && i <= checkpoint_keep; i++)
 	{
-		/* Free old networks */
-		free_net(&eval);
-		free_net(&role);
-	}
+		/* Create evaluator checkpoint filename */
+		checkpoint_name(fname, "eval", g->expanded, g->num_players,
+		                g->advanced, i);
 
-	/* Compute size and input names of networks */
-	setup_nets(g);
+		/* Skip checkpoint if evaluator cannot be loaded */
+		if (load_net_binary(&eval, fname)) continue;
 
-	/* Set learning rate */
-	eval.alpha = 0.0001 * factor;
-#ifdef DEBUG
-	eval.alpha = 0.0;
-#endif
+		/* Create predictor checkpoint filename */
+		checkpoint_name(fname, "role", g->expanded, g->num_players,
+		                g->advanced, i);
+
+		/* Done if predictor loaded as well */
+		if (!load_net_binary(&role, fname)) return;
+	}
 
 	/* Create evaluator filename */
 	sprintf(fname, RFTGDIR "/network/rftg.eval.%d.%d%s.net", g->expanded,
@@ -149,12 +323,6 @@ static void ai_initialize(game *g, int who, double factor)
 		}
 	}
 
-	/* Set learning rate */
-	role.alpha = 0.0005 * factor;
-#ifdef DEBUG
-	role.alpha = 0.0;
-#endif
-
 	/* Create predictor filename */
 	sprintf(fname, RFTGDIR "/network/rftg.role.%d.%d%s.net", g->expanded,
 	        g->num_players, g->advanced ? "a" : "");
@@ -174,11 +342,109 @@ static void ai_initialize(game *g, int who, double factor)
 			display_error(msg);
 		}
 	}
+}
+
+/*
+ * Initialize AI.
+ */
+static void ai_initialize(game *g, int who, double factor)
+{
+	int e = g->expanded, p = g->num_players, a = g->advanced;
+
+	/* Create table of advanced action combinations */
+	fill_adv_combo();
+
+	/* Check for correct networks already loaded */
+	if (loaded_p == p && loaded_e == e && loaded_a == a)
+	{
+#ifdef AI_THREADS
+		/* Shared networks keep the learning rates of their owner */
+		if (eval.shared) return;
+#endif
+
+		/* Use given learning rates */
+		set_learning_rate(factor);
+		return;
+	}
+
+	/* Check for networks of another configuration loaded */
+	if (loaded_p > 0)
+	{
+		/* Keep them in memory */
+		config_eval[loaded_e][loaded_p][loaded_a] = eval;
+		config_role[loaded_e][loaded_p][loaded_a] = role;
+		config_kept[loaded_e][loaded_p][loaded_a] = 1;
+	}
+
+	/* Check for networks of this configuration kept earlier */
+	if (config_kept[e][p][a])
+	{
+		/* Use them again */
+		eval = config_eval[e][p][a];
+		role = config_role[e][p][a];
+		config_kept[e][p][a] = 0;
+
+		/* Compute network inputs of this configuration */
+		setup_inputs(g);
+
+		/* Cached results came from other networks */
+		clear_eval_cache();
+		clear_opp_place_cache();
+
+		/* Use given learning rates */
+		set_learning_rate(factor);
+	}
+	else
+	{
+#ifdef AI_THREADS
+		/* Keep other threads from loading the same networks */
+		pthread_mutex_lock(&load_mutex);
+
+		/* Check for networks loaded by another thread */
+		if (shared_loaded[e][p][a])
+		{
+			/* Create networks using shared weights */
+			share_net(&eval, &shared_eval[e][p][a]);
+			share_net(&role, &shared_role[e][p][a]);
+
+			/* Compute network inputs of this configuration */
+			setup_inputs(g);
+
+			/* Cached results came from other networks */
+			clear_eval_cache();
+			clear_opp_place_cache();
+		}
+		else
+		{
+			/* Create and load networks */
+			load_nets(g, factor);
+
+			/* Let other threads share these networks */
+			shared_eval[e][p][a] = eval;
+			shared_role[e][p][a] = role;
+			shared_loaded[e][p][a] = 1;
+
+			/* Check for first networks loaded */
+			if (!master_eval)
+			{
+				/* Remember networks to save */
+				master_eval = &eval;
+				master_role = &role;
+			}
+		}
+
+		/* Allow other loads */
+		pthread_mutex_unlock(&load_mutex);
+#else
+		/* Create and load networks */
+		load_nets(g, factor);
+#endif
+	}
 
 	/* Mark network as loaded */
-	loaded_p = g->num_players;
-	loaded_e = g->expanded;
-	loaded_a = g->advanced;
+	loaded_p = p;
+	loaded_e = e;
+	loaded_a = a;
 }
 
 /*
@@ -198,7 +464,7 @@ static void simulate_game(game *sim, game *orig, int who)
 	int i;
 
 	/* Copy game */
-	memcpy(sim, orig, sizeof(game));
+	copy_game(sim, orig);
 
 	/* Loop over players */
 	for (i = 0; i < sim->num_players; i++)
@@ -248,7 +514,7 @@ typedef struct quick_discard
 /*
  * List of most discardable cards (per player).
  */
-quick_discard discard_list[MAX_PLAYER][MAX_DECK];
+AI_LOCAL quick_discard discard_list[MAX_PLAYER][MAX_DECK];
 
 /*
  * Compare two quick discard entries.
@@ -572,7 +838,7 @@ static int consume_ability(game *g, int who, int produce)
 		c_ptr = &g->deck[x];
 
 		/* Get design pointer */
-		d_ptr = c_ptr->d_ptr;
+		d_ptr = &library[c_ptr->d_idx];
 
 		/* Check for windfall world */
 		if (d_ptr->flags & FLAG_WINDFALL)
@@ -1017,20 +1283,16 @@ static int role_out[ROLE_OUT_EXP3] =
 /*
  * Mapping from card indices to neural network inputs.
  */
-static int card_input[MAX_DESIGN], num_c_input;
-static int good_input[MAX_DESIGN], num_g_input;
+static AI_LOCAL int card_input[MAX_DESIGN], num_c_input;
+static AI_LOCAL int good_input[MAX_DESIGN], num_g_input;
 
 /*
  * Setup mappings of card indices to neural net inputs.
- *
- * Also create network input names.
  */
-static void setup_nets(game *g)
+static void setup_inputs(game *g)
 {
 	design *d_ptr;
-	int i, j, k, n;
-	int outputs;
-	char buf[1024], name[1024], *input_name[5000];
+	int i;
 
 	/* Reset input numbers */
 	num_c_input = num_g_input = 0;
@@ -1056,6 +1318,21 @@ static void setup_nets(game *g)
 		/* Add mapping of this good-holding card */
 		good_input[i] = num_g_input++;
 	}
+}
+
+/*
+ * Setup mappings of card indices to neural net inputs.
+ *
+ * Also create network input names.
+ */
+static void setup_nets(game *g)
+{
+	int i, j, k, n;
+	int outputs;
+	char buf[1024], name[1024], *input_name[5000];
+
+	/* Compute input mappings */
+	setup_inputs(g);
 
 	/* Start at first input */
 	n = 0;
@@ -1603,12 +1880,12 @@ typedef struct eval_cache
 /*
  * Hash table for cached evaluation results.
  */
-static eval_cache *eval_hash[65536];
+static AI_LOCAL eval_cache *eval_hash[65536];
 
 /*
  * Hash table for cached opponent placement results.
  */
-static eval_cache *opp_place_hash[65536];
+static AI_LOCAL eval_cache *opp_place_hash[65536];
 
 /*
  * Generic hash mixer.
@@ -1968,13 +2245,13 @@ static int eval_game_player(game *g, int who, int n, int *leader)
 		c_ptr = &g->deck[x];
 
 		/* Set input for active card */
-		eval.input_value[n + card_input[c_ptr->d_ptr->index]] = 1;
+		eval.input_value[n + card_input[c_ptr->d_idx]] = 1;
 
 		/* Loop over card powers */
-		for (i = 0; i < c_ptr->d_ptr->num_power; i++)
+		for (i = 0; i < library[c_ptr->d_idx].num_power; i++)
 		{
 			/* Get power pointer */
-			o_ptr = &c_ptr->d_ptr->powers[i];
+			o_ptr = &library[c_ptr->d_idx].powers[i];
 
 			/* Check for Explore power */
 			if (o_ptr->phase == PHASE_EXPLORE)
@@ -2031,10 +2308,10 @@ static int eval_game_player(game *g, int who, int n, int *leader)
 		count += c_ptr->num_goods;
 
 		/* Track type of good */
-		good[c_ptr->d_ptr->good_type] = 1;
+		good[library[c_ptr->d_idx].good_type] = 1;
 
 		/* Set input for card with good */
-		eval.input_value[n + good_input[c_ptr->d_ptr->index]] =
+		eval.input_value[n + good_input[c_ptr->d_idx]] =
 			c_ptr->num_goods;
 	}
 
@@ -2095,13 +2372,13 @@ static int eval_game_player(game *g, int who, int n, int *leader)
 		c_ptr = &g->deck[x];
 
 		/* Skip non-developments */
-		if (c_ptr->d_ptr->type != TYPE_DEVELOPMENT) continue;
+		if (library[c_ptr->d_idx].type != TYPE_DEVELOPMENT) continue;
 
 		/* Count card */
 		count++;
 
 		/* Check for six-cost development */
-		if (c_ptr->d_ptr->cost == 6) count_six++;
+		if (library[c_ptr->d_idx].cost == 6) count_six++;
 	}
 
 	/* Set inputs for number of active developments */
@@ -2127,7 +2404,7 @@ static int eval_game_player(game *g, int who, int n, int *leader)
 		c_ptr = &g->deck[x];
 
 		/* Skip non-worlds */
-		if (c_ptr->d_ptr->type != TYPE_WORLD) continue;
+		if (library[c_ptr->d_idx].type != TYPE_WORLD) continue;
 
 		/* Count card */
 		count++;
@@ -2278,41 +2555,19 @@ static int eval_game_leader(game *g, int who, int n, int leader[][MAX_LEADER],
 }
 
 /*
- * Evaluate the given game state from the point of view of the given
- * player.
+ * Set the eval network inputs for the given (already scored) game state
+ * from the point of view of the given player.
+ *
+ * Returns the player's hand size, including simulated draws.
  */
-static double eval_game(game *g, int who)
+static int eval_inputs(game *g, int who)
 {
 	player *p_ptr;
 	card *c_ptr;
-	eval_cache *e_ptr;
 	int i, x, count, n = 0, hand = 0;
 	int build_dev = 0, build_world = 0;
 	int max = 0, max_build = 0, clock;
 	int leader[MAX_PLAYER][MAX_LEADER];
-	double score;
-
-	/* Lookup game state in cached results */
-	e_ptr = lookup_eval(g, who);
-
-#ifndef DEBUG
-	/* Check for valid result */
-	if (e_ptr->score > -1)
-	{
-		eval_cache_hit++;
-		return e_ptr->score;
-	}
-	else
-	{
-		eval_cache_miss++;
-	}
-#endif
-
-	/* Get end-of-game score */
-	score_game(g);
-
-	/* Declare winner if game over */
-	if (g->game_over) declare_winner(g);
 
 	/* Clear inputs */
 	for (i = 0; i < eval.num_inputs; i++) eval.input_value[i] = -1;
@@ -2408,7 +2663,7 @@ static double eval_game(game *g, int who)
 		if (g->simulation && g->sim_who != who) continue;
 
 		/* Set input for card in hand */
-		eval.input_value[n + card_input[c_ptr->d_ptr->index]] = 1;
+		eval.input_value[n + card_input[c_ptr->d_idx]] = 1;
 	}
 
 	/* Start at first saved card */
@@ -2427,7 +2682,7 @@ static double eval_game(game *g, int who)
 		c_ptr = &g->deck[x];
 
 		/* Set input for saved card */
-		eval.input_value[n + card_input[c_ptr->d_ptr->index]] = 0.5;
+		eval.input_value[n + card_input[c_ptr->d_idx]] = 0.5;
 	}
 
 	/* Add simulated drawn cards to handsize */
@@ -2455,10 +2710,10 @@ static double eval_game(game *g, int who)
 		c_ptr = &g->deck[x];
 
 		/* Check for development */
-		if (c_ptr->d_ptr->type == TYPE_DEVELOPMENT)
+		if (library[c_ptr->d_idx].type == TYPE_DEVELOPMENT)
 		{
 			/* Check cost against hand size */
-			if (c_ptr->d_ptr->cost > max) continue;
+			if (library[c_ptr->d_idx].cost > max) continue;
 
 			/* One more buildable development */
 			build_dev++;
@@ -2531,6 +2786,49 @@ static double eval_game(game *g, int who)
 		abort();
 	}
 
+	/* Return hand size */
+	return hand;
+}
+
+/*
+ * Evaluate the given game state from the point of view of the given
+ * player.
+ */
+static double eval_game(game *g, int who)
+{
+	player *p_ptr;
+	eval_cache *e_ptr;
+	int hand;
+	double score;
+
+	/* Lookup game state in cached results */
+	e_ptr = lookup_eval(g, who);
+
+#ifndef DEBUG
+	/* Check for valid result */
+	if (e_ptr->score > -1)
+	{
+		eval_cache_hit++;
+		return e_ptr->score;
+	}
+	else
+	{
+		eval_cache_miss++;
+	}
+#endif
+
+	/* Get end-of-game score */
+	score_game(g);
+
+	/* Declare winner if game over */
+	if (g->game_over) declare_winner(g);
+
+	/* Set network inputs */
+	hand = eval_inputs(g, who);
+
+	/* Get player pointer */
+	p_ptr = &g->p[who];
+
 	/* Compute network */
 	compute_net(&eval);
 
@@ -2559,14 +2857,38 @@ static double eval_game(game *g, int who)
 	return e_ptr->score;
 }
 
+/*
+ * Apply accumulated training to a network's weights.
+ *
+ * When several threads train the same weights, their updates are applied
+ * one at a time.  Other threads keep reading the weights meanwhile, which
+ * at worst mixes old and new values in a single evaluation.
+ */
+static void update_weights(net *learn)
+{
+#ifdef AI_THREADS
+	/* Wait for other threads to finish their updates */
+	pthread_mutex_lock(&train_mutex);
+#endif
+
+	/* Apply training */
+	apply_training(learn);
+
+#ifdef AI_THREADS
+	/* Allow other updates */
+	pthread_mutex_unlock(&train_mutex);
+#endif
+}
+
 /*
  * Perform a training iteration on the eval network.
  */
 static void perform_training(game *g, int who, double *desired)
 {
 	double target[MAX_PLAYER];
+	double *input[PAST_MAX], *set_desired[PAST_MAX], set_lambda[PAST_MAX];
 	double lambda = 1.0;
-	int i;
+	int i, n = 0;
 
 	/* Clear cached results of eval network */
 	clear_eval_cache();
@@ -2574,17 +2896,39 @@ static void perform_training(game *g, int who, double *desired)
 	/* Get current state */
 	eval_game(g, who);
 
-	/* Store current inputs */
-	store_net(&eval, who);
+	/* Check for capturing experience */
+	if (experience_file)
+	{
+		/* Add current inputs to game's experience */
+		add_experience(&eval_experience, &eval, who);
 
-	/* Check for passed in results */
+		/* Check for passed in results */
+		if (desired)
+		{
+			/* Remember outcome */
+			set_experience_outcome(&eval_experience, &eval, who,
+			                       desired);
+		}
+
+		/* Leave training to offline trainer */
+		return;
+	}
+
+	/* Check for network not learning */
+	if (eval.alpha == 0.0) return;
+
+	/* Store current inputs */
+	store_net(&eval, who);
+
+	/* Check for passed in results */
 	if (desired)
 	{
 		/* Copy results to target array */
 		for (i = 0; i < g->num_players; i++) target[i] = desired[i];
 
-		/* Train current inputs with desired outputs */
-		train_net(&eval, 1.0, target);
+		/* Train current (just stored) inputs with desired outputs */
+		input[n] = eval.past_input[eval.num_past - 1];
+		set_lambda[n++] = 1.0;
 
 		/* Reduce lambda for further training */
 		lambda *= 0.7;
@@ -2605,22 +2949,69 @@ static void perform_training(game *g, int who, double *desired)
 		/* Skip input sets that do not belong to us */
 		if (eval.past_input_player[i] != who) continue;
 
-		/* Copy past inputs to network */
-		memcpy(eval.input_value, eval.past_input[i],
-		       sizeof(double) * (eval.num_inputs + 1));
-
-		/* Compute network */
-		compute_net(&eval);
-
-		/* Train */
-		train_net(&eval, lambda, target);
+		/* Train past inputs */
+		input[n] = eval.past_input[i];
+		set_lambda[n++] = lambda;
 
 		/* Reduce training amount as we go back in time */
 		lambda *= 0.7;
 	}
 
+	/* Train every input set towards the same target */
+	for (i = 0; i < n; i++) set_desired[i] = target;
+
+	/* Train input sets together */
+	if (n) train_net_batch(&eval, input, set_lambda, set_desired, n);
+
 	/* Apply accumulated training */
-	apply_training(&eval);
+	update_weights(&eval);
+}
+
+/*
+ * Append the current game's network inputs to the experience files.
+ */
+static void save_experience(void)
+{
+	char msg[1024];
+	int result = 0;
+
+#ifdef AI_THREADS
+	/* Wait for other threads to finish writing */
+	pthread_mutex_lock(&experience_mutex);
+#endif
+
+	/* Check for eval experience wanted */
+	if (experience_file)
+	{
+		/* Write eval experience */
+		result |= write_experience(experience_file, &eval_experience);
+	}
+
+	/* Check for role experience wanted */
+	if (role_experience_file && role_experience.num_states)
+	{
+		/* Write role experience */
+		result |= write_experience(role_experience_file,
+		                           &role_experience);
+	}
+
+#ifdef AI_THREADS
+	/* Allow other writes */
+	pthread_mutex_unlock(&experience_mutex);
+#endif
+
+	/* Check for failure */
+	if (result < 0)
+	{
+		/* Print error */
+		sprintf(msg, "Error writing experience file.\n");
+		display_error(msg);
+	}
+
+	/* Start next game with no experience */
+	clear_experience(&eval_experience);
+	clear_experience(&role_experience);
+	role_pending = 0;
 }
 
 /*
@@ -2652,10 +3043,10 @@ static int predict_action_player(game *g, int who, int n, int *leader)
 		c_ptr = &g->deck[x];
 
 		/* Set input for active card */
-		role.input_value[n + card_input[c_ptr->d_ptr->index]] = 1;
+		role.input_value[n + card_input[c_ptr->d_idx]] = 1;
 
 		/* Count active developments */
-		if (c_ptr->d_ptr->type == TYPE_DEVELOPMENT)
+		if (library[c_ptr->d_idx].type == TYPE_DEVELOPMENT)
 		{
 			/* Count active developments */
 			count_dev++;
@@ -2667,10 +3058,10 @@ static int predict_action_player(game *g, int who, int n, int *leader)
 		}
 
 		/* Loop over powers on card */
-		for (i = 0; i < c_ptr->d_ptr->num_power; i++)
+		for (i = 0; i < library[c_ptr->d_idx].num_power; i++)
 		{
 			/* Get power pointer */
-			o_ptr = &c_ptr->d_ptr->powers[i];
+			o_ptr = &library[c_ptr->d_idx].powers[i];
 
 			/* Skip non-Explore powers */
 			if (o_ptr->phase != PHASE_EXPLORE) continue;
@@ -2719,10 +3110,10 @@ static int predict_action_player(game *g, int who, int n, int *leader)
 		count++;
 
 		/* Track good type */
-		good[c_ptr->d_ptr->good_type] = 1;
+		good[library[c_ptr->d_idx].good_type] = 1;
 
 		/* Set input for card with good */
-		role.input_value[n + good_input[c_ptr->d_ptr->index]] = 1;
+		role.input_value[n + good_input[c_ptr->d_idx]] = 1;
 	}
 
 	/* Advance input index */
@@ -3271,7 +3662,7 @@ static int claim_card(game *g, int who, int which)
 /*
  * Explore samples we've seen this turn.
  */
-static struct sample_score explore_seen[MAX_EXPLORE_SAMPLE];
+static AI_LOCAL struct sample_score explore_seen[MAX_EXPLORE_SAMPLE];
 
 /*
  * Clear sample results.
@@ -3774,11 +4165,15 @@ static void ai_choose_action_advanced(game *g, int who, int action[2], int one)
 		desired[i] = exp(20 * (scores[i] / b_s)) / sum;
 	}
 
-	/* Train network */
-	train_net(&role, 1.0, desired);
+	/* Check for network learning */
+	if (role.alpha != 0.0)
+	{
+		/* Train network */
+		train_net(&role, 1.0, desired);
 
-	/* Apply training */
-	apply_training(&role);
+		/* Apply training */
+		update_weights(&role);
+	}
 
 	/* Clear placement cache */
 	clear_opp_place_cache();
@@ -3799,8 +4194,8 @@ struct opponent_act
 /*
  * List of action choice combinations.
  */
-struct opponent_act *opponent_combos;
-int opponent_combo_len, opponent_combo_size;
+AI_LOCAL struct opponent_act *opponent_combos;
+AI_LOCAL int opponent_combo_len, opponent_combo_size;
 
 /*
  * Compare two opponent action choice combinations by probability.
@@ -4253,11 +4648,15 @@ static void ai_choose_action(game *g, int who, int action[2], int one)
 		desired[i] = exp(20 * (scores[i] / b_s)) / sum;
 	}
 
-	/* Train network */
-	train_net(&role, 1.0, desired);
+	/* Check for network learning */
+	if (role.alpha != 0.0)
+	{
+		/* Train network */
+		train_net(&role, 1.0, desired);
 
-	/* Apply training */
-	apply_training(&role);
+		/* Apply training */
+		update_weights(&role);
+	}
 
 	/* Clear placement cache */
 	clear_opp_place_cache();
@@ -5321,10 +5720,10 @@ static int ai_choose_place_opp(game *g, int who, int phase, int special)
 	if (special != -1)
 	{
 		/* Loop over powers on card */
-		for (i = 0; i < g->deck[special].d_ptr->num_power; i++)
+		for (i = 0; i < library[g->deck[special].d_idx].num_power; i++)
 		{
 			/* Get power pointer */
-			o_ptr = &g->deck[special].d_ptr->powers[i];
+			o_ptr = &library[g->deck[special].d_idx].powers[i];
 
 			/* Skip non-settle powers */
 			if (o_ptr->phase != PHASE_SETTLE) continue;
@@ -5363,10 +5762,10 @@ static int ai_choose_place_opp(game *g, int who, int phase, int special)
 		if (c_ptr->misc & (1 << g->sim_who)) continue;
 
 		/* Check for incorrect type */
-		if (c_ptr->d_ptr->type != type) continue;
+		if (library[c_ptr->d_idx].type != type) continue;
 
 		/* Check for only windfall worlds */
-		if (windfall_only && !(c_ptr->d_ptr->flags & FLAG_WINDFALL))
+		if (windfall_only && !(library[c_ptr->d_idx].flags & FLAG_WINDFALL))
 			continue;
 
 		/* Add card to unknown list */
@@ -5420,10 +5819,10 @@ static int ai_choose_place_opp(game *g, int who, int phase, int special)
 		if (phase == PHASE_DEVELOP)
 		{
 			/* Check for too expensive */
-			if (c_ptr->d_ptr->cost > max) continue;
+			if (library[c_ptr->d_idx].cost > max) continue;
 
 			/* Check for duplicate development */
-			if (player_has(g, who, c_ptr->d_ptr)) continue;
+			if (player_has(g, who, &library[c_ptr->d_idx])) continue;
 		}
 
 		/* Check for world */
@@ -5847,8 +6246,8 @@ struct legal_payment
 /*
  * List of legal payments.
  */
-static struct legal_payment payment_list[100];
-int num_legal_payment;
+static AI_LOCAL struct legal_payment payment_list[100];
+AI_LOCAL int num_legal_payment;
 
 /*
  * Helper function for "ai_choose_pay" below.
@@ -5941,7 +6340,7 @@ static void ai_choose_pay_aux1(game *g, int who, int which, int list[], int num,
 			if (g->p[i].placing == -1) continue;
 
 			/* Check for develop phase */
-			if (g->deck[which].d_ptr->type == TYPE_DEVELOPMENT)
+			if (library[g->deck[which].d_idx].type == TYPE_DEVELOPMENT)
 			{
 				/* Ask for development payment */
 				develop_action(&sim, i, g->p[i].placing);
@@ -6621,17 +7020,17 @@ static int good_better(game *g, int good1, int good2)
 	c_ptr2 = &g->deck[good2];
 
 	/* Check for different good type */
-	if (c_ptr1->d_ptr->good_type != c_ptr2->d_ptr->good_type) return 0;
+	if (library[c_ptr1->d_idx].good_type != library[c_ptr2->d_idx].good_type) return 0;
 
 	/* Get windfall status */
-	w1 = c_ptr1->d_ptr->flags & FLAG_WINDFALL;
-	w2 = c_ptr2->d_ptr->flags & FLAG_WINDFALL;
+	w1 = library[c_ptr1->d_idx].flags & FLAG_WINDFALL;
+	w2 = library[c_ptr2->d_idx].flags & FLAG_WINDFALL;
 
 	/* Loop over powers on first card */
-	for (i = 0; i < c_ptr1->d_ptr->num_power; i++)
+	for (i = 0; i < library[c_ptr1->d_idx].num_power; i++)
 	{
 		/* Get power pointer */
-		o_ptr = &c_ptr1->d_ptr->powers[i];
+		o_ptr = &library[c_ptr1->d_idx].powers[i];
 
 		/* Look for "trade this good" power */
 		if (o_ptr->phase == PHASE_CONSUME &&
@@ -6651,10 +7050,10 @@ static int good_better(game *g, int good1, int good2)
 	}
 
 	/* Loop over powers on second card */
-	for (i = 0; i < c_ptr2->d_ptr->num_power; i++)
+	for (i = 0; i < library[c_ptr2->d_idx].num_power; i++)
 	{
 		/* Get power pointer */
-		o_ptr = &c_ptr2->d_ptr->powers[i];
+		o_ptr = &library[c_ptr2->d_idx].powers[i];
 
 		/* Look for "trade this good" power */
 		if (o_ptr->phase == PHASE_CONSUME &&
@@ -6823,7 +7222,7 @@ static int score_consume(game *g, int who, int c_idx, int o_idx)
 	c_ptr = &g->deck[c_idx];
 
 	/* Get power pointer */
-	o_ptr = &c_ptr->d_ptr->powers[o_idx];
+	o_ptr = &library[c_ptr->d_idx].powers[o_idx];
 
 	/* Always discard from hand last */
 	if (o_ptr->code & P4_DISCARD_HAND) return 0;
@@ -6900,7 +7299,7 @@ static void ai_choose_consume(game *g, int who, int cidx[], int oidx[],
 		c_ptr = &g->deck[cidx[i]];
 
 		/* Get power pointer */
-		o_ptr = &c_ptr->d_ptr->powers[oidx[i]];
+		o_ptr = &library[c_ptr->d_idx].powers[oidx[i]];
 
 		/* Check for powers that should always be used first */
 		if ((o_ptr->code & P4_DRAW) ||
@@ -6958,7 +7357,7 @@ static void ai_choose_consume(game *g, int who, int cidx[], int oidx[],
 		c_ptr = &g->deck[cidx[i]];
 
 		/* Get power pointer */
-		o_ptr = &c_ptr->d_ptr->powers[oidx[i]];
+		o_ptr = &library[c_ptr->d_idx].powers[oidx[i]];
 
 		/* Do not compare unusual powers */
 		if (o_ptr->code & (P4_DISCARD_HAND | P4_ANTE_CARD |
@@ -6985,7 +7384,7 @@ static void ai_choose_consume(game *g, int who, int cidx[], int oidx[],
 			b_ptr = &g->deck[cidx[j]];
 
 			/* Get power pointer */
-			n_ptr = &b_ptr->d_ptr->powers[oidx[j]];
+			n_ptr = &library[b_ptr->d_idx].powers[oidx[j]];
 
 			/* Do not compare unusual powers */
 			if (n_ptr->code & (P4_DISCARD_HAND | P4_ANTE_CARD |
@@ -7112,7 +7511,7 @@ static void ai_choose_consume(game *g, int who, int cidx[], int oidx[],
 		c_ptr = &g->deck[cidx[i]];
 
 		/* Get power pointer */
-		o_ptr = &c_ptr->d_ptr->powers[oidx[i]];
+		o_ptr = &library[c_ptr->d_idx].powers[oidx[i]];
 
 		/* Save optional powers for last */
 		if (o_ptr->code & P4_DISCARD_HAND) continue;
@@ -7313,7 +7712,7 @@ static void ai_choose_consume_hand(game *g, int who, int c_idx, int o_idx,
 		c_ptr = &g->deck[c_idx];
 
 		/* Get power pointer */
-		o_ptr = &c_ptr->d_ptr->powers[o_idx];
+		o_ptr = &library[c_ptr->d_idx].powers[o_idx];
 	}
 
 	/* Check for simulation */
@@ -7564,7 +7963,7 @@ static int ai_choose_lucky(game *g, int who)
 			if (c_ptr->misc & (1 << who)) continue;
 
 			/* Check for wrong cost */
-			if (c_ptr->d_ptr->cost != i)
+			if (library[c_ptr->d_idx].cost != i)
 			{
 				/* Add base score */
 				score += base / count;
@@ -7655,7 +8054,7 @@ static int ai_choose_ante(game *g, int who, int list[], int num)
 	for (i = 0; i < num; i++)
 	{
 		/* Get card cost */
-		cost = g->deck[list[i]].d_ptr->cost;
+		cost = library[g->deck[list[i]].d_idx].cost;
 
 		/* Assume no more expensive cards available */
 		num_win = 0;
@@ -7670,7 +8069,7 @@ static int ai_choose_ante(game *g, int who, int list[], int num)
 			if (c_ptr->misc & (1 << who)) continue;
 
 			/* Check for more expensive card */
-			if (c_ptr->d_ptr->cost > cost) num_win++;
+			if (library[c_ptr->d_idx].cost > cost) num_win++;
 		}
 
 		/* Get chance of losing */
@@ -7823,7 +8222,7 @@ static void ai_choose_produce(game *g, int who, int cidx[], int oidx[], int num)
 		c_ptr = &g->deck[cidx[i]];
 
 		/* Get power pointer */
-		o_ptr = &c_ptr->d_ptr->powers[oidx[i]];
+		o_ptr = &library[c_ptr->d_idx].powers[oidx[i]];
 
 		/* Skip powers needing discard */
 		if (o_ptr->code & P5_DISCARD) continue;
@@ -7855,7 +8254,7 @@ static void ai_choose_produce(game *g, int who, int cidx[], int oidx[], int num)
 		c_ptr = &g->deck[cidx[i]];
 
 		/* Get power pointer */
-		o_ptr = &c_ptr->d_ptr->powers[oidx[i]];
+		o_ptr = &library[c_ptr->d_idx].powers[oidx[i]];
 
 		/* Skip powers needing discard */
 		if (o_ptr->code & P5_DISCARD) continue;
@@ -8193,6 +8592,131 @@ static int ai_choose_oort_kind(game *g, int who)
 }
 
 
+/*
+ * Make the given player's network set the active one.
+ */
+static void select_networks(int who)
+{
+	int set = player_set[who];
+
+	/* Do nothing if set already active */
+	if (set == active_set) return;
+
+	/* Save active networks */
+	set_eval[active_set] = eval;
+	set_role[active_set] = role;
+
+	/* Activate player's networks */
+	eval = set_eval[set];
+	role = set_role[set];
+	active_set = set;
+
+	/* Cached results came from other networks */
+	clear_eval_cache();
+	clear_opp_place_cache();
+}
+
+/*
+ * Return the current wall clock time in seconds.
+ */
+static double wall_time(void)
+{
+#ifdef WIN32
+	/* Use processor clock */
+	return (double)clock() / CLOCKS_PER_SEC;
+#else
+	struct timeval tv;
+
+	/* Get time of day */
+	gettimeofday(&tv, NULL);
+
+	/* Convert to seconds */
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+#endif
+}
+
+/*
+ * Return the part of the game that the current action belongs to.
+ */
+static int stat_phase(game *g)
+{
+	/* Check current action */
+	switch (g->cur_action)
+	{
+		/* Start of game */
+		case ACT_GAME_START: return STAT_START;
+
+		/* Action selection */
+		case ACT_ROUND_START: return STAT_ACTION;
+
+		/* Search and explore */
+		case ACT_SEARCH:
+		case ACT_EXPLORE_5_0:
+		case ACT_EXPLORE_1_1: return STAT_EXPLORE;
+
+		/* Develop */
+		case ACT_DEVELOP:
+		case ACT_DEVELOP2: return STAT_DEVELOP;
+
+		/* Settle */
+		case ACT_SETTLE:
+		case ACT_SETTLE2: return STAT_SETTLE;
+
+		/* Consume */
+		case ACT_CONSUME_TRADE:
+		case ACT_CONSUME_X2: return STAT_CONSUME;
+
+		/* Produce */
+		case ACT_PRODUCE: return STAT_PRODUCE;
+
+		/* End of round discards */
+		default: return STAT_DISCARD;
+	}
+}
+
+/*
+ * Add the AI work done by this thread since the last call to the given
+ * statistics.
+ */
+void ai_collect_stats(ai_stats *s)
+{
+	int i;
+
+	/* Add counts since last collection, allowing for wrap around */
+	s->computes += (unsigned int)num_computes - last_computes;
+	s->cache_hit += (unsigned int)eval_cache_hit - last_cache_hit;
+	s->cache_miss += (unsigned int)eval_cache_miss - last_cache_miss;
+	s->role_hit += (unsigned int)role_hit - last_role_hit;
+	s->role_miss += (unsigned int)role_miss - last_role_miss;
+
+	/* Add training errors since last collection */
+	s->eval_error += eval.error - last_eval_error;
+	s->eval_num_error += eval.num_error - last_eval_num_error;
+	s->role_error += role.error - last_role_error;
+	s->role_num_error += role.num_error - last_role_num_error;
+
+	/* Remember counters */
+	last_computes = num_computes;
+	last_cache_hit = eval_cache_hit;
+	last_cache_miss = eval_cache_miss;
+	last_role_hit = role_hit;
+	last_role_miss = role_miss;
+	last_eval_error = eval.error;
+	last_eval_num_error = eval.num_error;
+	last_role_error = role.error;
+	last_role_num_error = role.num_error;
+
+	/* Loop over parts of game */
+	for (i = 0; i < MAX_STAT; i++)
+	{
+		/* Add time spent choosing */
+		s->phase_time[i] += phase_time[i];
+
+		/* Clear time */
+		phase_time[i] = 0;
+	}
+}
+
 /*
  * Make a choice of the given type.
  */
@@ -8202,10 +8726,17 @@ static void ai_make_choice(game *g, int who, int type, int list[], int *nl,
 	player *p_ptr;
 	int i, rv;
 	int *l_ptr;
+	double start = 0.0;
 
 	/* Check for real game */
 	if (!g->simulation)
 	{
+		/* Start timing choice */
+		start = wall_time();
+
+		/* Use player's networks */
+		select_networks(who);
+
 		/* Prepare quick discard list */
 		ai_prepare_discard(g, who);
 
@@ -8422,8 +8953,8 @@ static void ai_make_choice(game *g, int who, int type, int list[], int *nl,
 	/* Get player pointer */
 	p_ptr = &g->p[who];
 
-	/* Get pointer to end of choice log */
-	l_ptr = &p_ptr->choice_log[p_ptr->choice_size];
+	/* Make room for choice and get pointer to end of choice log */
+	l_ptr = reserve_choice_log(p_ptr, 4 + (nl ? *nl : 0) + (ns ? *ns : 0));
 
 	/* Add choice type to log */
 	*l_ptr++ = type;
@@ -8470,38 +9001,27 @@ static void ai_make_choice(game *g, int who, int type, int list[], int *nl,
 	}
 
 	/* Mark new size of choice log */
-	p_ptr->choice_size = l_ptr - p_ptr->choice_log;
+	p_ptr->choice_size = l_ptr - p_ptr->choice_log->data;
+
+	/* Check for real game */
+	if (!g->simulation)
+	{
+		/* Add time spent choosing */
+		phase_time[stat_phase(g)] += wall_time() - start;
+	}
 }
 
 /*
- * Game over.
+ * Compute the eval network results a finished game should have had, as
+ * seen by the given player.
  */
-static void ai_game_over(game *g, int who)
+static void game_result(game *g, int who, double result[MAX_PLAYER])
 {
 	player *p_ptr;
-	double result[MAX_PLAYER], sum = 0.0;
+	double sum = 0.0;
 	int scores[MAX_PLAYER];
 	int max = 0, i, n;
 
-#if 0
-	if (who == 0)
-	{
-		printf("Most expensive choice: %d\n", most_computes);
-		printf("Choice tree: ");
-		for (i = 0; i < most_depth; i++)
-		{
-			printf("(%d %d %d %d %d %d) ", most_args[i].type, most_args[i].num, most_args[i].num_special, most_args[i].arg1, most_args[i].arg2, most_args[i].arg3);
-		}
-		printf("\n");
-		most_computes = 0;
-
-		printf("Duplicated computes: %d/%d\n", dup_computes, num_computes);
-		num_computes = dup_computes = 0;
-
-		report_dups();
-	}
-#endif
-
 	/* Find maximum score */
 	for (i = 0; i < g->num_players; i++)
 	{
@@ -8543,6 +9063,39 @@ static void ai_game_over(game *g, int who)
 		/* Go to next player */
 		i = (i + 1) % g->num_players;
 	}
+}
+
+/*
+ * Game over.
+ */
+static void ai_game_over(game *g, int who)
+{
+	double result[MAX_PLAYER];
+
+#if 0
+	if (who == 0)
+	{
+		printf("Most expensive choice: %d\n", most_computes);
+		printf("Choice tree: ");
+		for (i = 0; i < most_depth; i++)
+		{
+			printf("(%d %d %d %d %d %d) ", most_args[i].type, most_args[i].num, most_args[i].num_special, most_args[i].arg1, most_args[i].arg2, most_args[i].arg3);
+		}
+		printf("\n");
+		most_computes = 0;
+
+		printf("Duplicated computes: %d/%d\n", dup_computes, num_computes);
+		num_computes = dup_computes = 0;
+
+		report_dups();
+	}
+#endif
+
+	/* Use player's networks */
+	select_networks(who);
+
+	/* Compute desired eval results */
+	game_result(g, who, result);
 
 	/* Perform final training */
 	perform_training(g, who, result);
@@ -8550,6 +9103,13 @@ static void ai_game_over(game *g, int who)
 	/* Check for training done for all players */
 	if (who == g->num_players - 1)
 	{
+		/* Check for capturing experience */
+		if (experience_file)
+		{
+			/* Write game's experience */
+			save_experience();
+		}
+
 		/* Clear stored past inputs */
 		clear_store(&eval);
 		clear_store(&role);
@@ -8560,40 +9120,595 @@ static void ai_game_over(game *g, int who)
 	}
 }
 
+/*
+ * Save the networks of one configuration to disk.
+ */
+static void save_nets(net *e, net *r, int expanded, int num_players,
+                      int advanced)
+{
+	char fname[1024];
+
+	/* Create evaluator filename */
+	sprintf(fname, RFTGDIR "/network/rftg.eval.%d.%d%s.net", expanded,
+	        num_players, advanced ? "a" : "");
+
+	/* Save weights to disk unless training was left to the trainer */
+	if (!experience_file) save_net(e, fname);
+
+	/* Create predictor filename */
+	sprintf(fname, RFTGDIR "/network/rftg.role.%d.%d%s.net", expanded,
+	        num_players, advanced ? "a" : "");
+
+	/* Save weights to disk */
+	save_net(r, fname);
+}
+
 /*
  * Shutdown.
  */
 static void ai_shutdown(game *g, int who)
 {
-	char fname[1024];
 	static int saved;
+	int e, p, a;
 
 	/* Check for already saved */
 	if (saved) return;
 
-	/* Create evaluator filename */
-	sprintf(fname, RFTGDIR "/network/rftg.eval.%d.%d%s.net", g->expanded,
-	        g->num_players, g->advanced ? "a" : "");
+#ifdef AI_THREADS
+	/* Add training counts and errors from other threads */
+	eval.num_training += done_eval_training;
+	eval.error += done_eval_error;
+	eval.num_error += done_eval_num_error;
+	role.num_training += done_role_training;
+	role.error += done_role_error;
+	role.num_error += done_role_num_error;
+
+	/* Add counters from other threads */
+	role_hit += done_role_hit;
+	role_miss += done_role_miss;
+	role_avg += done_role_avg;
+#endif
 
-	/* Save weights to disk */
-	save_net(&eval, fname);
+	/* Save current networks */
+	save_nets(&eval, &role, g->expanded, g->num_players, g->advanced);
 
-	/* Create predictor filename */
-	sprintf(fname, RFTGDIR "/network/rftg.role.%d.%d%s.net", g->expanded,
-	        g->num_players, g->advanced ? "a" : "");
+	/* Loop over configurations */
+	for (e = 0; e < MAX_EXPANSION; e++)
+	{
+		for (p = 0; p <= MAX_PLAYER; p++)
+		{
+			for (a = 0; a < 2; a++)
+			{
+				/* Skip configurations not kept */
+				if (!config_kept[e][p][a]) continue;
 
-	/* Save weights to disk */
-	save_net(&role, fname);
+				/* Save networks kept in memory */
+				save_nets(&config_eval[e][p][a],
+				          &config_role[e][p][a], e, p, a);
+			}
+		}
+	}
 
 	printf("Role hit: %d, Role miss: %d\n", role_hit, role_miss);
 	printf("Role avg: %f\n", role_avg / (role_hit + role_miss));
 	printf("Role error: %f\n", role.error / role.num_error);
-	printf("Eval error: %f\n", eval.error / eval.num_error);
+
+	/* Check for eval network trained */
+	if (eval.num_error)
+	{
+		printf("Eval error: %f\n", eval.error / eval.num_error);
+	}
+
+	/* Close experience files */
+	ai_close_experience();
 
 	/* Mark weights as saved */
 	saved = 1;
 }
 
+#ifdef AI_THREADS
+/*
+ * Called when a thread will play no more games.
+ *
+ * Statistics of the thread's networks are kept until the networks are saved,
+ * and the thread's private networks and caches are released.
+ */
+void ai_thread_done(void)
+{
+	/* Check for main thread or no networks */
+	if (&eval == master_eval || !eval.hidden_weight) return;
+
+	/* Lock statistics */
+	pthread_mutex_lock(&train_mutex);
+
+	/* Add training counts and errors */
+	done_eval_training += eval.num_training;
+	done_eval_error += eval.error;
+	done_eval_num_error += eval.num_error;
+	done_role_training += role.num_training;
+	done_role_error += role.error;
+	done_role_num_error += role.num_error;
+
+	/* Add role prediction counters */
+	done_role_hit += role_hit;
+	done_role_miss += role_miss;
+	done_role_avg += role_avg;
+
+	/* Unlock statistics */
+	pthread_mutex_unlock(&train_mutex);
+
+	/* Clear caches */
+	clear_eval_cache();
+	clear_opp_place_cache();
+
+	/* Free combination list */
+	free(opponent_combos);
+
+	/* Free experience of unfinished game */
+	free_experience(&eval_experience);
+	free_experience(&role_experience);
+
+	/* Free private parts of networks */
+	free_net(&eval);
+	free_net(&role);
+}
+#endif
+
+/*
+ * Capture network inputs of finished games to the given files.
+ *
+ * Eval network inputs are saved with the game outcomes, role network inputs
+ * with the roles chosen.  Either filename may be NULL.  Each finished game
+ * is appended as one record, for offline training.  The eval network is
+ * not trained while its inputs are captured.
+ */
+int ai_open_experience(char *eval_fname, char *role_fname)
+{
+	/* Check for eval experience wanted */
+	if (eval_fname)
+	{
+		/* Open file for appending */
+		experience_file = fopen(eval_fname, "ab");
+
+		/* Check for failure */
+		if (!experience_file) return -1;
+	}
+
+	/* Check for role experience wanted */
+	if (role_fname)
+	{
+		/* Open file for appending */
+		role_experience_file = fopen(role_fname, "ab");
+
+		/* Check for failure */
+		if (!role_experience_file) return -1;
+	}
+
+	/* Success */
+	return 0;
+}
+
+/*
+ * Close experience files.
+ */
+void ai_close_experience(void)
+{
+	/* Check for eval experience file */
+	if (experience_file)
+	{
+		/* Close file */
+		fclose(experience_file);
+		experience_file = NULL;
+	}
+
+	/* Check for role experience file */
+	if (role_experience_file)
+	{
+		/* Close file */
+		fclose(role_experience_file);
+		role_experience_file = NULL;
+	}
+}
+
+/*
+ * Capture network inputs at a player's role choice in a replayed game.
+ *
+ * The AI does not need to control the player.  This is used to learn from
+ * archived games.
+ */
+void ai_capture_choice(game *g, int who)
+{
+	double prob[ROLE_OUT_ADV_EXP3];
+
+	/* Prepare quick discard list */
+	ai_prepare_discard(g, who);
+
+	/* Set current hand size as low */
+	g->p[who].low_hand = count_player_area(g, who, WHERE_HAND);
+
+	/* Clear sample results */
+	ai_sample_clear();
+
+	/* Clear placement cache */
+	clear_opp_place_cache();
+
+	/* Check for eval experience wanted */
+	if (experience_file)
+	{
+		/* Clear cached results of eval network */
+		clear_eval_cache();
+
+		/* Get current state */
+		eval_game(g, who);
+
+		/* Add current inputs to game's experience */
+		add_experience(&eval_experience, &eval, who);
+	}
+
+	/* Check for role experience wanted */
+	if (role_experience_file)
+	{
+		/* Compute role inputs */
+		predict_action(g, who, prob, who);
+
+		/* Add current inputs to game's experience */
+		add_experience(&role_experience, &role, who);
+	}
+}
+
+/*
+ * Return the role network output for the given chosen roles, or -1.
+ */
+static int role_output(game *g, int a0, int a1)
+{
+	int i;
+
+	/* Loop over outputs */
+	for (i = 0; i < role.num_output; i++)
+	{
+		/* Check for advanced game */
+		if (g->advanced)
+		{
+			/* Check for match in either order */
+			if ((adv_combo[i][0] == a0 && adv_combo[i][1] == a1) ||
+			    (adv_combo[i][0] == a1 && adv_combo[i][1] == a0))
+			{
+				/* Found */
+				return i;
+			}
+		}
+
+		/* Check for matching role */
+		else if (role_out[i] == a0) return i;
+	}
+
+	/* No match */
+	return -1;
+}
+
+/*
+ * Set the roles chosen for role network inputs captured this round.
+ *
+ * Must be called after each round of a replayed game.  Input sets of
+ * players whose roles cannot be matched to an output are dropped.
+ */
+void ai_capture_round(game *g)
+{
+	experience *x = &role_experience;
+	double desired[ROLE_OUT_ADV_EXP3], *row;
+	int i, j, n, out, who;
+
+	/* Start at first input set without chosen roles */
+	n = role_pending;
+
+	/* Loop over input sets captured this round */
+	for (i = role_pending; i < x->num_states; i++)
+	{
+		/* Get player who chose */
+		who = x->player[i];
+
+		/* Find output of chosen roles */
+		out = role_output(g, g->p[who].prev_action[0],
+		                  g->p[who].prev_action[1]);
+
+		/* Skip unknown choices */
+		if (out < 0) continue;
+
+		/* Check for earlier input sets dropped */
+		if (i != n)
+		{
+			/* Move input set down */
+			row = x->input[n];
+			x->input[n] = x->input[i];
+			x->input[i] = row;
+			x->player[n] = who;
+		}
+
+		/* Desire only the chosen output */
+		for (j = 0; j < x->num_output; j++) desired[j] = 0.0;
+		desired[out] = 1.0;
+
+		/* Set desired outputs */
+		set_experience_desired(x, n, desired);
+
+		/* Input set is kept */
+		n++;
+	}
+
+	/* Forget dropped input sets */
+	x->num_states = n;
+
+	/* All roles so far are known */
+	role_pending = n;
+}
+
+/*
+ * Capture the final state and outcome of a replayed game, and write its
+ * experience.
+ */
+void ai_capture_end(game *g)
+{
+	double result[MAX_PLAYER];
+	int i;
+
+	/* Check for eval experience wanted */
+	if (experience_file)
+	{
+		/* Loop over players */
+		for (i = 0; i < g->num_players; i++)
+		{
+			/* Compute desired eval results */
+			game_result(g, i, result);
+
+			/* Clear cached results of eval network */
+			clear_eval_cache();
+
+			/* Get final state */
+			eval_game(g, i);
+
+			/* Add final inputs and outcome */
+			add_experience(&eval_experience, &eval, i);
+			set_experience_outcome(&eval_experience, &eval, i,
+			                       result);
+		}
+	}
+
+	/* Write game's experience */
+	save_experience();
+}
+
+/*
+ * Forget experience captured from a game that could not be finished.
+ */
+void ai_capture_discard(void)
+{
+	/* Forget experience */
+	clear_experience(&eval_experience);
+	clear_experience(&role_experience);
+	role_pending = 0;
+}
+
+/*
+ * Resume from binary checkpoints in the given directory when networks are
+ * loaded, and write checkpoints there with ai_checkpoint().
+ *
+ * The given number of older checkpoints is kept as well.  When resuming,
+ * the newest checkpoint that can be loaded is used.
+ */
+void ai_set_checkpoint_dir(char *dir, int keep)
+{
+	/* Remember directory */
+	checkpoint_dir = dir;
+
+	/* Remember number of older checkpoints */
+	checkpoint_keep = keep;
+}
+
+/*
+ * Create the name of a checkpoint file.
+ *
+ * Age 0 is the newest checkpoint, and older ones have the age appended.
+ */
+static void checkpoint_name(char *buf, char *kind, int expanded,
+                            int num_players, int advanced, int age)
+{
+	/* Create filename */
+	sprintf(buf, "%s/rftg.%s.%d.%d%s.bin", checkpoint_dir, kind, expanded,
+	        num_players, advanced ? "a" : "");
+
+	/* Add age of older checkpoints */
+	if (age) sprintf(buf + strlen(buf), ".%d", age);
+}
+
+/*
+ * Write binary checkpoints of one configuration's networks.
+ *
+ * Existing checkpoints are moved back in the history first.
+ */
+static int checkpoint_nets(net *e, net *r, int expanded, int num_players,
+                           int advanced)
+{
+	char fname[1024], older[1024];
+	int i;
+
+	/* Loop over older checkpoints, oldest first */
+	for (i = checkpoint_keep; i > 0; i--)
+	{
+		/* Move evaluator back one place */
+		checkpoint_name(fname, "eval", expanded, num_players, advanced,
+		                i - 1);
+		checkpoint_name(older, "eval", expanded, num_players, advanced,
+		                i);
+		replace_file(fname, older);
+
+		/* Move predictor back one place */
+		checkpoint_name(fname, "role", expanded, num_players, advanced,
+		                i - 1);
+		checkpoint_name(older, "role", expanded, num_players, advanced,
+		                i);
+		replace_file(fname, older);
+	}
+
+	/* Create evaluator checkpoint filename */
+	checkpoint_name(fname, "eval", expanded, num_players, advanced, 0);
+
+	/* Save evaluator */
+	if (save_net_binary(e, fname)) return -1;
+
+	/* Create predictor checkpoint filename */
+	checkpoint_name(fname, "role", expanded, num_players, advanced, 0);
+
+	/* Save predictor */
+	return save_net_binary(r, fname);
+}
+
+/*
+ * Write binary checkpoints of the networks of every configuration in
+ * memory.
+ *
+ * Returns -1 if some could not be written.
+ */
+int ai_checkpoint(void)
+{
+	net *cur_eval = &eval, *cur_role = &role;
+	int e, p, a, result = 0;
+
+	/* Check for no checkpoint directory or networks */
+	if (!checkpoint_dir || !loaded_p) return -1;
+
+#ifdef AI_THREADS
+	/* Use networks holding the shared weights */
+	cur_eval = master_eval;
+	cur_role = master_role;
+
+	/* Keep weights from changing while they are saved */
+	pthread_mutex_lock(&train_mutex);
+#endif
+
+	/* Save current networks */
+	if (checkpoint_nets(cur_eval, cur_role, loaded_e, loaded_p, loaded_a))
+	{
+		/* Failure */
+		result = -1;
+	}
+
+	/* Loop over configurations */
+	for (e = 0; e < MAX_EXPANSION; e++)
+	{
+		for (p = 0; p <= MAX_PLAYER; p++)
+		{
+			for (a = 0; a < 2; a++)
+			{
+				/* Skip configurations not kept */
+				if (!config_kept[e][p][a]) continue;
+
+				/* Save networks kept in memory */
+				if (checkpoint_nets(&config_eval[e][p][a],
+				                    &config_role[e][p][a],
+				                    e, p, a))
+				{
+					/* Failure */
+					result = -1;
+				}
+			}
+		}
+	}
+
+#ifdef AI_THREADS
+	/* Allow training again */
+	pthread_mutex_unlock(&train_mutex);
+#endif
+
+	/* Return result */
+	return result;
+}
+
+/*
+ * Load a set of networks from the given directory, for games with the
+ * current configuration.
+ *
+ * Must be called after the AI has been initialized for the game.  Returns
+ * the set number to pass to ai_use_networks(), or -1 on error.
+ */
+int ai_load_networks(game *g, char *dir)
+{
+	char fname[1024];
+	int n;
+
+	/* Check for too many sets */
+	if (num_network_set == MAX_NETWORK_SET) return -1;
+
+	/* Get new set number */
+	n = num_network_set;
+
+	/* Save active networks */
+	set_eval[active_set] = eval;
+	set_role[active_set] = role;
+
+	/* Create networks of the right size */
+	setup_nets(g);
+
+	/* Do not train loaded networks */
+	eval.alpha = role.alpha = 0.0;
+
+	/* Create evaluator filename */
+	sprintf(fname, "%s/rftg.eval.%d.%d%s.net", dir, g->expanded,
+	        g->num_players, g->advanced ? "a" : "");
+
+	/* Load evaluator weights */
+	if (load_net(&eval, fname))
+	{
+		/* Free new networks */
+		free_net(&eval);
+		free_net(&role);
+
+		/* Restore active networks */
+		eval = set_eval[active_set];
+		role = set_role[active_set];
+		return -1;
+	}
+
+	/* Create predictor filename */
+	sprintf(fname, "%s/rftg.role.%d.%d%s.net", dir, g->expanded,
+	        g->num_players, g->advanced ? "a" : "");
+
+	/* Load predictor weights */
+	if (load_net(&role, fname))
+	{
+		/* Free new networks */
+		free_net(&eval);
+		free_net(&role);
+
+		/* Restore active networks */
+		eval = set_eval[active_set];
+		role = set_role[active_set];
+		return -1;
+	}
+
+	/* Store new set */
+	set_eval[n] = eval;
+	set_role[n] = role;
+	num_network_set++;
+
+	/* Restore active networks */
+	eval = set_eval[active_set];
+	role = set_role[active_set];
+
+	/* Return set number */
+	return n;
+}
+
+/*
+ * Have a player use the given network set from now on.
+ *
+ * Set 0 is the networks loaded by ai_initialize().
+ */
+void ai_use_networks(int who, int set)
+{
+	/* Remember player's set */
+	player_set[who] = set;
+}
+
 /*
  * Set of AI functions.
  */
@@ -8808,6 +9923,11 @@ void ai_debug(game *g, double win_prob[MAX_PLAYER][MAX_PLAYER],
 	}
 }
 
+/*
+ * Number of positions trained together during pre-training.
+ */
+#define INITIAL_BATCH 64
+
 /*
  * Perform simple pre-training on a new neural net.
  *
@@ -8816,11 +9936,15 @@ void ai_debug(game *g, double win_prob[MAX_PLAYER][MAX_PLAYER],
  * desirable things.  This makes the initial training games much more
  * productive, since the network will already make basic decisions to
  * place cards or consume for points.
+ *
+ * The end-game positions differ only in scores, so their inputs are set
+ * directly on one copy of the game and trained in minibatches.
  */
 static void initial_training(game *g)
 {
 	game sim;
-	int i, j, n, most;
+	double *input[INITIAL_BATCH], *desired[INITIAL_BATCH];
+	int i, j, n, most, num = 0;
 
 	/* Increase learning rate */
 	eval.alpha *= 10;
@@ -8831,14 +9955,14 @@ static void initial_training(game *g)
 	g->deck_size = 0;
 	g->cur_action = 0;
 	memset(g->deck, 0, sizeof(card) * MAX_DECK);
-	memset(g->goal_active, 0, sizeof(int) * MAX_GOAL);
-	memset(g->goal_avail, 0, sizeof(int) * MAX_GOAL);
+	memset(g->goal_active, 0, sizeof(int8_t) * MAX_GOAL);
+	memset(g->goal_avail, 0, sizeof(int8_t) * MAX_GOAL);
 
 	/* Clear some uninitialized player information */
 	for (i = 0; i < g->num_players; i++)
 	{
 		/* Clear player's card counts and winner flag */
-		memset(g->p[i].goal_claimed, 0, sizeof(int) * MAX_GOAL);
+		memset(g->p[i].goal_claimed, 0, sizeof(int8_t) * MAX_GOAL);
 		g->p[i].fake_hand = 0;
 		g->p[i].drawn_round = 0;
 		g->p[i].fake_discards = 0;
@@ -8852,21 +9976,33 @@ static void initial_training(game *g)
 		for (j = 0; j < MAX_WHERE; j++) g->p[i].start_head[j] = -1;
 	}
 
-	/* Perform several training iterations */
-	for (n = 0; n < 5000; n++)
+	/* Create minibatch of input sets and desired outputs */
+	for (i = 0; i < INITIAL_BATCH; i++)
 	{
-		/* Simulate end-game */
-		simulate_game(&sim, g, 0);
+		/* Create arrays */
+		input[i] = (double *)malloc(sizeof(double) *
+		                            (eval.num_inputs + 1));
+		desired[i] = (double *)malloc(sizeof(double) * MAX_PLAYER);
+	}
 
-		/* Make game as over */
-		sim.game_over = 1;
+	/* Simulate end-game */
+	simulate_game(&sim, g, 0);
 
+	/* Make game as over */
+	sim.game_over = 1;
+
+	/* Perform several training iterations */
+	for (n = 0; n < 5000; n++)
+	{
 		/* Create random scores for players */
 		for (i = 0; i < g->num_players; i++)
 		{
 			/* Create random score */
 			sim.p[i].vp = rand() % 50;
 			sim.p[i].end_vp = sim.p[i].vp;
+
+			/* Clear winner flag */
+			sim.p[i].winner = 0;
 		}
 
 		/* Clear best score */
@@ -8886,12 +10022,56 @@ static void initial_training(game *g)
 			if (sim.p[i].vp == most) sim.p[i].winner = 1;
 		}
 
-		/* Train network for each player */
+		/* Get end-of-game score */
+		score_game(&sim);
+
+		/* Declare winner */
+		declare_winner(&sim);
+
+		/* Add position of each player to minibatch */
 		for (i = 0; i < g->num_players; i++)
 		{
-			/* Train network */
-			ai_game_over(&sim, i);
+			/* Compute desired eval results */
+			game_result(&sim, i, desired[num]);
+
+			/* Set network inputs */
+			eval_inputs(&sim, i);
+
+			/* Copy inputs to minibatch */
+			memcpy(input[num], eval.input_value,
+			       sizeof(double) * (eval.num_inputs + 1));
+
+			/* Check for full minibatch */
+			if (++num == INITIAL_BATCH)
+			{
+				/* Train and apply minibatch */
+				train_net_batch(&eval, input, NULL, desired, num);
+				update_weights(&eval);
+
+				/* Start next minibatch */
+				num = 0;
+			}
 		}
+
+		/* Mark training iteration */
+		eval.num_training++;
+		role.num_training++;
+	}
+
+	/* Check for partial minibatch */
+	if (num)
+	{
+		/* Train and apply last minibatch */
+		train_net_batch(&eval, input, NULL, desired, num);
+		update_weights(&eval);
+	}
+
+	/* Destroy minibatch */
+	for (i = 0; i < INITIAL_BATCH; i++)
+	{
+		/* Free arrays */
+		free(input[i]);
+		free(desired[i]);
 	}
 
 	/* Reset learning rate */
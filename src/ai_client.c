@@ -456,7 +456,7 @@ format_error:
 	for (i = p_ptr->choice_pos; i < p_ptr->choice_size; i++)
 	{
 		/* Copy entry */
-		put_integer(p_ptr->choice_log[i], &ptr);
+		put_integer(p_ptr->choice_log->data[i], &ptr);
 	}
 
 	/* Move current position to end of choice log */
@@ -712,7 +712,7 @@ int main(int argc, char *argv[])
 	for (i = 0; i < MAX_PLAYER; i++)
 	{
 		/* Create choice log for player */
-		real_game.p[i].choice_log = (int *)malloc(sizeof(int) * 4096);
+		real_game.p[i].choice_log = new_choice_log();
 	}
 
 	/* Loop forever */
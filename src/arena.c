@@ -0,0 +1,557 @@
+/*
+ * Race for the Galaxy AI
+ *
+ * Copyright (C) 2009-2015 Keldon Jones
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "rftg.h"
+#include <math.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*
+ * Most network sets to compare.
+ */
+#define MAX_ENTRANT 7
+
+/*
+ * Print messages?
+ */
+static int verbose = 0;
+
+/*
+ * Game configuration to play.
+ */
+static int num_players = 3;
+static int expansion_level, advanced, promo;
+
+/*
+ * Directories holding the network sets being compared.
+ */
+static char *entrant_dir[MAX_ENTRANT];
+static int num_entrant;
+
+/*
+ * Outcome of one arena game.
+ */
+typedef struct arena_result
+{
+	/* Game number */
+	int game;
+
+	/* Entrant playing each seat */
+	int entrant[MAX_PLAYER];
+
+	/* Final score of each seat */
+	int vp[MAX_PLAYER];
+
+	/* Whether each seat won */
+	int winner[MAX_PLAYER];
+
+} arena_result;
+
+/*
+ * Print errors to standard error.
+ */
+void display_error(char *msg)
+{
+	/* Forward message */
+	fprintf(stderr, "%s", msg);
+}
+
+/*
+ * Print messages to standard output.
+ */
+void message_add(game *g, char *msg)
+{
+	/* Print if verbose flag set */
+	if (verbose > 1) printf("%s", msg);
+}
+
+/*
+ * Print messages to standard output.
+ */
+void message_add_formatted(game *g, char *msg, char *tag)
+{
+	/* Print without formatting */
+	message_add(g, msg);
+}
+
+/*
+ * Use simple random number generator.
+ */
+int game_rand(game *g)
+{
+	/* Call simple random number generator */
+	return simple_rand(&g->random_seed);
+}
+
+/*
+ * Set up a game and load every entrant's networks.
+ *
+ * Returns -1 if some networks could not be loaded.
+ */
+static int setup_game(game *g, int set[MAX_ENTRANT])
+{
+	char buf[1024];
+	int i;
+
+	/* Set game configuration */
+	g->num_players = num_players;
+	g->expanded = expansion_level;
+	g->advanced = advanced;
+	g->promo = promo;
+
+	/* Assume no options disabled */
+	g->goal_disabled = 0;
+	g->takeover_disabled = 0;
+
+	/* No campaign selected */
+	g->camp = NULL;
+
+	/* Loop over players */
+	for (i = 0; i < num_players; i++)
+	{
+		/* Create player name */
+		sprintf(buf, "Player %d", i);
+
+		/* Set player name */
+		g->p[i].name = strdup(buf);
+
+		/* Set player interfaces to AI functions */
+		g->p[i].control = &ai_func;
+
+		/* Initialize AI without learning */
+		g->p[i].control->init(g, i, 0.0);
+
+		/* Create choice log for player */
+		g->p[i].choice_log = new_choice_log();
+	}
+
+	/* Loop over entrants */
+	for (i = 0; i < num_entrant; i++)
+	{
+		/* Load entrant's networks */
+		set[i] = ai_load_networks(g, entrant_dir[i]);
+
+		/* Check for failure */
+		if (set[i] < 0)
+		{
+			/* Error */
+			fprintf(stderr, "Could not load networks from %s\n",
+			        entrant_dir[i]);
+			return -1;
+		}
+	}
+
+	/* Success */
+	return 0;
+}
+
+/*
+ * Play one arena game.
+ *
+ * Each seed is played once per entrant, with the entrants rotated one seat
+ * further each time, so that every entrant plays every seat once.
+ */
+static void play_game(game *g, int set[MAX_ENTRANT], int k, unsigned int seed,
+                      arena_result *r)
+{
+	int i, rotation;
+
+	/* Get rotation of entrants */
+	rotation = k % num_entrant;
+
+	/* Clear result */
+	memset(r, 0, sizeof(arena_result));
+
+	/* Set game number */
+	r->game = k;
+
+	/* Loop over seats */
+	for (i = 0; i < num_players; i++)
+	{
+		/* Assign entrant to seat */
+		r->entrant[i] = (i + rotation) % num_entrant;
+
+		/* Use entrant's networks */
+		ai_use_networks(i, set[r->entrant[i]]);
+
+		/* Clear choice log */
+		g->p[i].choice_size = 0;
+		g->p[i].choice_pos = 0;
+	}
+
+	/* Start from this game's seed */
+	g->random_seed = seed + k / num_entrant;
+
+	/* Initialize game */
+	init_game(g);
+
+	/* Game is learning game */
+	g->session_id = -2;
+
+	/* Begin game */
+	begin_game(g);
+
+	/* Play game rounds until finished */
+	while (game_round(g));
+
+	/* Score game */
+	score_game(g);
+
+	/* Declare winner */
+	declare_winner(g);
+
+	/* Loop over seats */
+	for (i = 0; i < num_players; i++)
+	{
+		/* Save score and winner flag */
+		r->vp[i] = g->p[i].end_vp;
+		r->winner[i] = g->p[i].winner;
+	}
+}
+
+/*
+ * Play every num_workers'th game, starting with the given one, and write
+ * the results to the given file descriptor.
+ */
+static int run_worker(int worker, int num_workers, int num_games,
+                      unsigned int seed, int fd)
+{
+	game my_game;
+	arena_result r;
+	int set[MAX_ENTRANT];
+	int k;
+
+	/* Set up game and networks */
+	if (setup_game(&my_game, set) < 0) return 1;
+
+	/* Loop over this worker's games */
+	for (k = worker; k < num_games; k += num_workers)
+	{
+		/* Play game */
+		play_game(&my_game, set, k, seed, &r);
+
+		/* Send result */
+		if (write(fd, &r, sizeof(arena_result)) != sizeof(arena_result))
+		{
+			/* Error */
+			perror("write");
+			return 1;
+		}
+	}
+
+	/* Done */
+	return 0;
+}
+
+/*
+ * Print the results of every entrant, and return the lower end of the
+ * confidence interval of the first entrant's win rate.
+ */
+static double report(arena_result *results, int num_games)
+{
+	arena_result *r;
+	double seats[MAX_ENTRANT], wins[MAX_ENTRANT];
+	double margin[MAX_ENTRANT], margin_sq[MAX_ENTRANT];
+	double share, others, m, p, dev, mean, sd, low = 0.0;
+	int i, j, k, num_winners;
+
+	/* Clear totals */
+	for (i = 0; i < num_entrant; i++)
+	{
+		/* Clear entrant's totals */
+		seats[i] = wins[i] = margin[i] = margin_sq[i] = 0.0;
+	}
+
+	/* Loop over games in order */
+	for (k = 0; k < num_games; k++)
+	{
+		/* Get game result */
+		r = &results[k];
+
+		/* Count winners */
+		for (i = num_winners = 0; i < num_players; i++)
+		{
+			/* Check for winner */
+			if (r->winner[i]) num_winners++;
+		}
+
+		/* Loop over seats */
+		for (i = 0; i < num_players; i++)
+		{
+			/* Split win between tied winners */
+			share = r->winner[i] ? 1.0 / num_winners : 0.0;
+
+			/* Total scores of other seats */
+			for (j = 0, others = 0.0; j < num_players; j++)
+			{
+				/* Add other seat's score */
+				if (j != i) others += r->vp[j];
+			}
+
+			/* Compute margin over average opponent */
+			m = r->vp[i] - others / (num_players - 1);
+
+			/* Add to entrant's totals */
+			seats[r->entrant[i]] += 1.0;
+			wins[r->entrant[i]] += share;
+			margin[r->entrant[i]] += m;
+			margin_sq[r->entrant[i]] += m * m;
+		}
+
+		/* Check for verbose output */
+		if (verbose)
+		{
+			printf("Game %d:", k);
+
+			/* Print each seat */
+			for (i = 0; i < num_players; i++)
+			{
+				printf(" %d:%d%s", r->entrant[i], r->vp[i],
+				       r->winner[i] ? "*" : "");
+			}
+
+			printf("\n");
+		}
+	}
+
+	printf("%d games, %d players, expected win rate %.3f\n", num_games,
+	       num_players, 1.0 / num_players);
+
+	/* Loop over entrants */
+	for (i = 0; i < num_entrant; i++)
+	{
+		/* Compute win rate and 95% confidence interval */
+		p = wins[i] / seats[i];
+		dev = 1.96 * sqrt(p * (1.0 - p) / seats[i]);
+
+		/* Compute average margin and 95% confidence interval */
+		mean = margin[i] / seats[i];
+		sd = sqrt(margin_sq[i] / seats[i] - mean * mean);
+
+		printf("%d %s: %.0f seats, win rate %.3f +/- %.3f, "
+		       "VP margin %+.2f +/- %.2f\n", i, entrant_dir[i],
+		       seats[i], p, dev, mean, 1.96 * sd / sqrt(seats[i]));
+
+		/* Remember first entrant's lower bound */
+		if (i == 0) low = p - dev;
+	}
+
+	/* Return lower bound */
+	return low;
+}
+
+/*
+ * Play games between several sets of networks and report their results.
+ */
+int main(int argc, char *argv[])
+{
+	arena_result r, *results;
+	unsigned int seed = 1;
+	double low;
+	int *have;
+	int i, w, status, fds[2], num_workers = 1, num_seeds = 100;
+	int num_games, received = 0, gate = 0, result = 0;
+	FILE *fff;
+
+	/* Read card database */
+	if (read_cards(NULL) < 0)
+	{
+		/* Exit */
+		exit(1);
+	}
+
+	/* Parse arguments */
+	for (i = 1; i < argc; i++)
+	{
+		/* Check for verbosity */
+		if (!strcmp(argv[i], "-v"))
+		{
+			/* Set verbose flag */
+			verbose++;
+		}
+
+		/* Check for number of players */
+		else if (!strcmp(argv[i], "-p"))
+		{
+			/* Set number of players */
+			num_players = atoi(argv[++i]);
+		}
+
+		/* Check for advanced game */
+		else if (!strcmp(argv[i], "-a"))
+		{
+			/* Set advanced flag */
+			advanced = 1;
+		}
+
+		/* Check for expansion level */
+		else if (!strcmp(argv[i], "-e"))
+		{
+			/* Set expansion level */
+			expansion_level = atoi(argv[++i]);
+		}
+
+		/* Check for promo cards */
+		else if (!strcmp(argv[i], "-o"))
+		{
+			/* Set promo cards */
+			promo = 1;
+		}
+
+		/* Check for number of seeds */
+		else if (!strcmp(argv[i], "-n"))
+		{
+			/* Set number of seeds */
+			num_seeds = atoi(argv[++i]);
+		}
+
+		/* Check for first random seed */
+		else if (!strcmp(argv[i], "-r"))
+		{
+			/* Set random seed */
+			seed = atoi(argv[++i]);
+		}
+
+		/* Check for number of workers */
+		else if (!strcmp(argv[i], "-j"))
+		{
+			/* Set number of worker processes */
+			num_workers = atoi(argv[++i]);
+
+			/* Use at least one worker */
+			if (num_workers < 1) num_workers = 1;
+		}
+
+		/* Check for gating on first entrant */
+		else if (!strcmp(argv[i], "-g"))
+		{
+			/* Set gate flag */
+			gate = 1;
+		}
+
+		/* Stop at first non-option */
+		else break;
+	}
+
+	/* Loop over remaining arguments */
+	for ( ; i < argc && num_entrant < MAX_ENTRANT; i++)
+	{
+		/* Add entrant */
+		entrant_dir[num_entrant++] = argv[i];
+	}
+
+	/* Check for too few entrants or bad configuration */
+	if (num_entrant < 2 || i < argc || num_players < 2 ||
+	    num_players > MAX_PLAYER || num_seeds < 1)
+	{
+		/* Print usage */
+		fprintf(stderr, "Usage: %s [-p players] [-e expansion] [-a] [-o] "
+		                "[-n seeds] [-r seed] [-j workers] [-g] [-v] "
+		                "netdir netdir...\n", argv[0]);
+		exit(1);
+	}
+
+	/* Play each seed once per rotation of entrants */
+	num_games = num_seeds * num_entrant;
+
+	/* Create result storage */
+	results = (arena_result *)malloc(sizeof(arena_result) * num_games);
+	have = (int *)calloc(num_games, sizeof(int));
+
+	/* Create pipe for results */
+	if (pipe(fds) < 0)
+	{
+		/* Error */
+		perror("pipe");
+		exit(1);
+	}
+
+	/* Start workers */
+	for (w = 0; w < num_workers; w++)
+	{
+		/* Create worker process */
+		switch (fork())
+		{
+			/* Error */
+			case -1:
+				perror("fork");
+				exit(1);
+
+			/* Worker */
+			case 0:
+				close(fds[0]);
+				exit(run_worker(w, num_workers, num_games, seed,
+				                fds[1]));
+		}
+	}
+
+	/* Close our copy of write end */
+	close(fds[1]);
+
+	/* Read results as they arrive */
+	fff = fdopen(fds[0], "rb");
+
+	/* Loop until all workers have closed the pipe */
+	while (fread(&r, sizeof(arena_result), 1, fff) == 1)
+	{
+		/* Skip bad game numbers */
+		if (r.game < 0 || r.game >= num_games || have[r.game]) continue;
+
+		/* Store result */
+		results[r.game] = r;
+		have[r.game] = 1;
+		received++;
+	}
+
+	/* Done with pipe */
+	fclose(fff);
+
+	/* Wait for workers */
+	for (w = 0; w < num_workers; w++)
+	{
+		/* Wait for any worker */
+		if (wait(&status) < 0) break;
+
+		/* Check for failed worker */
+		if (!WIFEXITED(status) || WEXITSTATUS(status)) result = 1;
+	}
+
+	/* Check for missing games */
+	if (result || received != num_games)
+	{
+		/* Error */
+		fprintf(stderr, "Only %d of %d games finished\n", received,
+		        num_games);
+		exit(1);
+	}
+
+	/* Report results */
+	low = report(results, num_games);
+
+	/* Check for first entrant required to beat its expected share */
+	if (gate && low <= 1.0 / num_players)
+	{
+		/* Not significantly better */
+		return 2;
+	}
+
+	/* Done */
+	return 0;
+}
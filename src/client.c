@@ -784,78 +784,87 @@ format_error:
 }
 
 /*
- * Handle a status update about a player.
+ * Update a player from the fields of a player status (in the order of
+ * get_player_status).
  */
-static void handle_status_player(char *ptr, int size)
+static void set_player(int x, int *f)
 {
 	player *p_ptr;
-	char *msg_buf = ptr;
-	int i, x;
-
-	/* Skip header */
-	ptr += HEADER_LEN;
-
-	/* Get player index */
-	if (!get_integer(&x, msg_buf, size, &ptr)) goto format_error;
+	int i;
 
 	/* Get player pointer */
 	p_ptr = &real_game.p[x];
 
-	/* Read actions */
-	if (!get_integer(&x, msg_buf, size, &ptr)) goto format_error;
-	p_ptr->action[0] = x;
-	if (!get_integer(&x, msg_buf, size, &ptr)) goto format_error;
-	p_ptr->action[1] = x;
+	/* Copy actions */
+	p_ptr->action[0] = f[0];
+	p_ptr->action[1] = f[1];
 
-	/* Read prestige action used flag */
-	if (!get_integer(&x, msg_buf, size, &ptr)) goto format_error;
-	p_ptr->prestige_action_used = x;
+	/* Copy prestige action used flag */
+	p_ptr->prestige_action_used = f[2];
 
 	/* Loop over goals */
 	for (i = 0; i < MAX_GOAL; i++)
 	{
-		/* Read goal claimed */
-		if (!get_integer(&x, msg_buf, size, &ptr)) goto format_error;
-		p_ptr->goal_claimed[i] = x;
-
-		/* Real goal progress */
-		if (!get_integer(&x, msg_buf, size, &ptr)) goto format_error;
-		p_ptr->goal_progress[i] = x;
+		/* Copy goal claimed and goal progress */
+		p_ptr->goal_claimed[i] = f[PLAYER_GOALS + 2 * i];
+		p_ptr->goal_progress[i] = f[PLAYER_GOALS + 2 * i + 1];
 	}
 
-	/* Read player's prestige count */
-	if (!get_integer(&x, msg_buf, size, &ptr)) goto format_error;
-	p_ptr->prestige = x;
+	/* Point past goals */
+	f += PLAYER_GOALS + 2 * MAX_GOAL;
 
-	/* Read player's VP count */
-	if (!get_integer(&x, msg_buf, size, &ptr)) goto format_error;
-	p_ptr->vp = x;
+	/* Copy player's prestige and VP counts */
+	p_ptr->prestige = f[0];
+	p_ptr->vp = f[1];
 
-	/* Read player's phase bonuses */
-	if (!get_integer(&x, msg_buf, size, &ptr)) goto format_error;
-	p_ptr->phase_bonus_used = x;
+	/* Copy player's phase bonuses */
+	p_ptr->phase_bonus_used = f[2];
+	p_ptr->bonus_military = f[3];
+	p_ptr->bonus_military_xeno = f[4];
+	p_ptr->bonus_reduce = f[5];
 
-	/* Read player's bonus military */
-	if (!get_integer(&x, msg_buf, size, &ptr)) goto format_error;
-	p_ptr->bonus_military = x;
+	/* Copy prestige information */
+	p_ptr->prestige_turn = f[6];
 
-	/* Read player's Xeno military bonus (only for XI games) */
-	if (real_game.expanded == EXP_XI)
-	{
-		if (!get_integer(&x, msg_buf, size, &ptr)) goto format_error;
-		p_ptr->bonus_military_xeno = x;
-	}
+	/* Redraw status information later */
+	status_updated = 1;
+}
 
-	/* Read player's reduce bonus */
-	if (!get_integer(&x, msg_buf, size, &ptr)) goto format_error;
-	p_ptr->bonus_reduce = x;
+/*
+ * Handle a status update about a player.
+ */
+static void handle_status_player(char *ptr, int size)
+{
+	char *msg_buf = ptr;
+	int f[PLAYER_FIELDS];
+	int i, x;
 
-	/* Copy prestige information */
+	/* Skip header */
+	ptr += HEADER_LEN;
+
+	/* Get player index */
 	if (!get_integer(&x, msg_buf, size, &ptr)) goto format_error;
-	p_ptr->prestige_turn = x;
 
-	/* Redraw status information later */
-	status_updated = 1;
+	/* Check for bad player */
+	if (x < 0 || x >= real_game.num_players) goto format_error;
+
+	/* Loop over fields */
+	for (i = 0; i < PLAYER_FIELDS; i++)
+	{
+		/* Xeno military bonus is only sent for XI games */
+		if (i == PLAYER_FIELDS - 3 && real_game.expanded != EXP_XI)
+		{
+			/* Keep current bonus */
+			f[i] = real_game.p[x].bonus_military_xeno;
+			continue;
+		}
+
+		/* Read field */
+		if (!get_integer(&f[i], msg_buf, size, &ptr)) goto format_error;
+	}
+
+	/* Update player */
+	set_player(x, f);
 
 	/*
 	 * Process badly formatted message, missing \0 in a string or with a
@@ -871,53 +880,68 @@ format_error:
 }
 
 /*
- * Handle a status update about a card.
+ * Handle a batch of status updates about players.
  */
-static void handle_status_card(char *ptr, int size)
+static void handle_status_players(char *ptr, int size)
 {
-	card *c_ptr;
-	int x;
-	int owner, where, start_owner, start_where;
 	char *msg_buf = ptr;
+	int f[PLAYER_FIELDS];
+	int x;
 
 	/* Skip header */
 	ptr += HEADER_LEN;
 
-	/* Read card index */
-	if (!get_integer(&x, msg_buf, size, &ptr)) goto format_error;
+	/* Loop until end of message */
+	while (ptr - msg_buf < size)
+	{
+		/* Get player index */
+		if (!get_varint(&x, msg_buf, size, &ptr)) goto format_error;
 
-	/* Get card pointer */
-	c_ptr = &real_game.deck[x];
+		/* Check for bad player */
+		if (x < 0 || x >= real_game.num_players) goto format_error;
 
-	/* Read card owner */
-	if (!get_integer(&owner, msg_buf, size, &ptr)) goto format_error;
-	if (!get_integer(&start_owner, msg_buf, size, &ptr)) goto format_error;
+		/* Read player status */
+		if (!get_player_status(f, msg_buf, size, &ptr)) goto format_error;
 
-	/* Read card location */
-	if (!get_integer(&where, msg_buf, size, &ptr)) goto format_error;
-	if (!get_integer(&start_where, msg_buf, size, &ptr)) goto format_error;
+		/* Update player */
+		set_player(x, f);
+	}
 
-	/* Move card to current location */
-	move_card(&real_game, x, owner, where);
+	/*
+	 * Process badly formatted message, missing \0 in a string or with a
+	 * format leading to read beyond the message length.
+	 */
+	if (0)
+	{
+format_error:
+		/* Print error */
+		display_error("Message format error");
+		disconnect();
+	}
+}
 
-	/* Move "start of phase" location */
-	move_start(&real_game, x, start_owner, start_where);
+/*
+ * Update a card from the fields of a card status (in the order of
+ * card_default).
+ */
+static void set_card(int x, int *f)
+{
+	card *c_ptr;
 
-	/* Read card flags */
-	if (!get_integer(&x, msg_buf, size, &ptr)) goto format_error;
-	c_ptr->misc = x;
+	/* Get card pointer */
+	c_ptr = &real_game.deck[x];
 
-	/* Read order played */
-	if (!get_integer(&x, msg_buf, size, &ptr)) goto format_error;
-	c_ptr->order = x;
+	/* Move card to current location */
+	move_card(&real_game, x, f[0], f[2]);
 
-	/* Read number of goods */
-	if (!get_integer(&x, msg_buf, size, &ptr)) goto format_error;
-	c_ptr->num_goods = x;
+	/* Move "start of phase" location */
+	move_start(&real_game, x, f[1], f[3]);
 
-	/* Read covered card */
-	if (!get_integer(&x, msg_buf, size, &ptr)) goto format_error;
-	c_ptr->covering = x;
+	/* Copy card flags, order played, goods and covered card */
+	c_ptr->misc = f[4];
+	c_ptr->order = f[5];
+	c_ptr->num_goods = f[6];
+	c_ptr->covering = f[7];
 
 	/* Card locations have been updated */
 	cards_updated = 1;
@@ -930,6 +954,111 @@ static void handle_status_card(char *ptr, int size)
 		/* Update order */
 		real_game.p[c_ptr->owner].table_order = c_ptr->order;
 	}
+}
+
+/*
+ * Check that a card status can be applied to the current game.
+ */
+static int valid_card(int x, int *f)
+{
+	/* Check card index */
+	if (x < 0 || x >= real_game.deck_size) return 0;
+
+	/* Check owners */
+	if (f[0] < -1 || f[0] >= real_game.num_players) return 0;
+	if (f[1] < -1 || f[1] >= real_game.num_players) return 0;
+
+	/* Check locations */
+	if (f[2] < 0 || f[2] >= MAX_WHERE) return 0;
+	if (f[3] < 0 || f[3] >= MAX_WHERE) return 0;
+
+	/* Valid */
+	return 1;
+}
+
+/*
+ * Handle a status update about a card.
+ */
+static void handle_status_card(char *ptr, int size)
+{
+	int x, i;
+	int f[CARD_FIELDS];
+	char *msg_buf = ptr;
+
+	/* Skip header */
+	ptr += HEADER_LEN;
+
+	/* Read card index */
+	if (!get_integer(&x, msg_buf, size, &ptr)) goto format_error;
+
+	/* Loop over fields */
+	for (i = 0; i < CARD_FIELDS; i++)
+	{
+		/* Read field */
+		if (!get_integer(&f[i], msg_buf, size, &ptr)) goto format_error;
+	}
+
+	/* Check for bad card */
+	if (!valid_card(x, f)) goto format_error;
+
+	/* Update card */
+	set_card(x, f);
+
+	/*
+	 * Process badly formatted message, missing \0 in a string or with a
+	 * format leading to read beyond the message length.
+	 */
+	if (0)
+	{
+format_error:
+		/* Print error */
+		display_error("Message format error");
+		disconnect();
+	}
+}
+
+/*
+ * Handle a batch of status updates about cards.
+ *
+ * A snapshot first returns every card to the draw pile, and then lists only
+ * the cards elsewhere.
+ */
+static void handle_status_cards(char *ptr, int size)
+{
+	int x = -1, i, snapshot;
+	int f[CARD_FIELDS];
+	char *msg_buf = ptr;
+
+	/* Skip header */
+	ptr += HEADER_LEN;
+
+	/* Read snapshot flag */
+	if (!get_varint(&snapshot, msg_buf, size, &ptr)) goto format_error;
+
+	/* Check for snapshot */
+	if (snapshot)
+	{
+		/* Loop over cards */
+		for (i = 0; i < real_game.deck_size; i++)
+		{
+			/* Return card to draw pile */
+			set_card(i, card_default);
+		}
+	}
+
+	/* Loop until end of message */
+	while (ptr - msg_buf < size)
+	{
+		/* Read next card */
+		if (!get_card_status(&x, f, msg_buf, size, &ptr))
+			goto format_error;
+
+		/* Check for bad card */
+		if (!valid_card(x, f)) goto format_error;
+
+		/* Update card */
+		set_card(x, f);
+	}
 
 	/*
 	 * Process badly formatted message, missing \0 in a string or with a
@@ -1235,7 +1364,7 @@ static void handle_choose(char *ptr, int size)
 	for (i = p_ptr->choice_pos; i < p_ptr->choice_size; i++)
 	{
 		/* Copy entry */
-		put_integer(p_ptr->choice_log[i], &ptr);
+		put_integer(p_ptr->choice_log->data[i], &ptr);
 	}
 
 	/* Move current position to end of choice log */
@@ -1305,7 +1434,7 @@ static void prepare_make_choice(game *g, int who, int type, int list[], int *nl,
 	for (i = p_ptr->choice_pos; i < p_ptr->choice_size; i++)
 	{
 		/* Copy entry */
-		put_integer(p_ptr->choice_log[i], &ptr);
+		put_integer(p_ptr->choice_log->data[i], &ptr);
 	}
 
 	/* Finish message */
@@ -1886,6 +2015,20 @@ static gboolean message_read(gpointer data)
 			handle_status_card(msg_buf, size);
 			break;
 
+		/* Batch of player status updates */
+		case MSG_STATUS_PLAYERS:
+
+			/* Handle message */
+			handle_status_players(msg_buf, size);
+			break;
+
+		/* Batch of card status updates */
+		case MSG_STATUS_CARDS:
+
+			/* Handle message */
+			handle_status_cards(msg_buf, size);
+			break;
+
 		/* Goal status update */
 		case MSG_STATUS_GOAL:
 
@@ -2571,10 +2714,13 @@ with the password you enter.");
 		 * poses as a 0.9.4 version client.
 		 * We do not fake the RELEASE, the new server uses this information to
 		 * determine clients allowed to join a XI session.
+		 * The newest protocol revision we understand is appended,
+		 * servers not knowing about revisions ignore it.
 		 */
-		send_msgf(server_fd, MSG_LOGIN, "ssss",
+		send_msgf(server_fd, MSG_LOGIN, "ssssd",
 		          gtk_entry_get_text(GTK_ENTRY(user)),
-		          gtk_entry_get_text(GTK_ENTRY(pass)), COMM_VERSION, RELEASE);
+		          gtk_entry_get_text(GTK_ENTRY(pass)), COMM_VERSION, RELEASE,
+		          COMM_PROTOCOL);
 
 
 		/* Enter main loop to wait for response */
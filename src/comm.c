@@ -132,6 +132,262 @@ void put_integer(int x, char **msg)
 	(*msg) += 4;
 }
 
+/*
+ * Read a zigzag varint located at msg_ptr from a message buffer of length
+ * msg_len to a destination integer.
+ *
+ * Values are stored seven bits at a time, lowest first, with the high bit
+ * of each byte set when more follow.  Small negative numbers are mapped to
+ * small positive ones first, so that -1 also takes a single byte.
+ *
+ * Returns 1 if integer could be read without reading overflow, 0 otherwise.
+ * When 1 is returned, the integer is copied and the msg_ptr has
+ * advanced past the end of the read integer.
+ * When 0 is returned, the effect on dest, msg and msg_ptr is undefined.
+ */
+int get_varint(int *dest, char *msg, unsigned int msg_len, char **msg_ptr)
+{
+	unsigned char *ptr = (unsigned char *)*msg_ptr;
+	unsigned char *end = (unsigned char *)msg + msg_len;
+	unsigned int x = 0;
+	int shift = 0;
+
+	/* Check pointer consistency */
+	if (ptr < (unsigned char *)msg) return 0;
+
+	/* Read seven bits at a time */
+	do
+	{
+		/* Check for truncated or overlong value */
+		if (ptr >= end || shift > 28) return 0;
+
+		/* Add bits */
+		x |= (unsigned int)(*ptr & 0x7f) << shift;
+		shift += 7;
+
+	} while (*ptr++ & 0x80);
+
+	/* Undo zigzag mapping */
+	*dest = (int)(x >> 1) ^ -(int)(x & 1);
+
+	/* Advance message pointer */
+	*msg_ptr = (char *)ptr;
+	return 1;
+}
+
+/*
+ * Copy a zigzag varint to a message.
+ *
+ * We advance the message pointer past the end of the integer.
+ */
+void put_varint(int x, char **msg)
+{
+	unsigned int y;
+
+	/* Map small negative values to small positive ones */
+	y = ((unsigned int)x << 1) ^ (unsigned int)(x >> 31);
+
+	/* Write seven bits at a time */
+	while (y >= 0x80)
+	{
+		/* Write low bits with continuation flag */
+		*(*msg)++ = (y & 0x7f) | 0x80;
+		y >>= 7;
+	}
+
+	/* Write last byte */
+	*(*msg)++ = y;
+}
+
+/*
+ * Status of a card in the draw pile at the start of a game: no owner, in
+ * the draw pile, no flags, not played, no goods and not covering anything.
+ *
+ * Fields are, in order: owner, start of phase owner, location, start of
+ * phase location, misc flags, order played, number of goods and covered
+ * card.
+ */
+int card_default[CARD_FIELDS] = { -1, -1, WHERE_DECK, WHERE_DECK,
+                                   0, 0, 0, -1 };
+
+/*
+ * Read one card from a batch of card updates.
+ *
+ * The card index is read relative to the previous index, given in x (-1
+ * for the first card of a message).  Fields not present are set to their
+ * default.  The caller must check that the resulting index is valid.
+ *
+ * Returns 1 if the card could be read without reading overflow, 0 otherwise
+ * (or if the index is more than MAX_DECK past the previous one).
+ */
+int get_card_status(int *x, int *f,
+                    char *msg, unsigned int msg_len, char **msg_ptr)
+{
+	int i, delta, mask;
+
+	/* Read distance from previous card */
+	if (!get_varint(&delta, msg, msg_len, msg_ptr)) return 0;
+
+	/* Check for cards out of order or impossibly far apart */
+	if (delta < 0 || delta > MAX_DECK) return 0;
+
+	/* Compute card index */
+	*x += delta + 1;
+
+	/* Check for room for mask */
+	if (*msg_ptr - msg >= msg_len) return 0;
+
+	/* Read mask of fields present (one bit per field) */
+	mask = (unsigned char)*(*msg_ptr)++;
+
+	/* Loop over fields */
+	for (i = 0; i < CARD_FIELDS; i++)
+	{
+		/* Check for field present */
+		if (mask & (1 << i))
+		{
+			/* Read field */
+			if (!get_varint(&f[i], msg, msg_len, msg_ptr)) return 0;
+		}
+		else
+		{
+			/* Use default */
+			f[i] = card_default[i];
+		}
+	}
+
+	/* Success */
+	return 1;
+}
+
+/*
+ * Copy one card to a batch of card updates.
+ *
+ * Cards must be added in increasing order of index, and the index of the
+ * card added before (or -1) is given in last.  Only fields differing from
+ * their default are written, which takes at most CARD_STATUS_MAX bytes.
+ */
+void put_card_status(int x, int last, int *f, char **msg)
+{
+	int i, mask = 0;
+
+	/* Loop over fields */
+	for (i = 0; i < CARD_FIELDS; i++)
+	{
+		/* Mark fields differing from default */
+		if (f[i] != card_default[i]) mask |= 1 << i;
+	}
+
+	/* Add distance from previous card */
+	put_varint(x - last - 1, msg);
+
+	/* Add mask of fields present (one bit per field) */
+	*(*msg)++ = mask;
+
+	/* Loop over fields */
+	for (i = 0; i < CARD_FIELDS; i++)
+	{
+		/* Add fields present */
+		if (mask & (1 << i)) put_varint(f[i], msg);
+	}
+}
+
+/*
+ * Read one player from a batch of player updates.
+ *
+ * Fields are, in order: both actions, prestige action used flag, claimed
+ * flag and progress of each goal, prestige, VP, phase bonus used, military
+ * bonus, Xeno military bonus, reduce bonus and prestige on the tile.
+ *
+ * Returns 1 if the player could be read without reading overflow, 0
+ * otherwise.
+ */
+int get_player_status(int *f, char *msg, unsigned int msg_len, char **msg_ptr)
+{
+	int i, mask;
+
+	/* Read actions and prestige action used flag */
+	for (i = 0; i < PLAYER_GOALS; i++)
+	{
+		/* Read field */
+		if (!get_varint(&f[i], msg, msg_len, msg_ptr)) return 0;
+	}
+
+	/* Read mask of goals listed */
+	if (!get_varint(&mask, msg, msg_len, msg_ptr)) return 0;
+
+	/* Loop over goals */
+	for (i = 0; i < MAX_GOAL; i++)
+	{
+		/* Check for goal listed */
+		if (mask & (1 << i))
+		{
+			/* Read claimed flag and progress */
+			if (!get_varint(&f[PLAYER_GOALS + 2 * i], msg, msg_len,
+			                msg_ptr)) return 0;
+			if (!get_varint(&f[PLAYER_GOALS + 2 * i + 1], msg, msg_len,
+			                msg_ptr)) return 0;
+		}
+		else
+		{
+			/* Goal not claimed and no progress */
+			f[PLAYER_GOALS + 2 * i] = 0;
+			f[PLAYER_GOALS + 2 * i + 1] = 0;
+		}
+	}
+
+	/* Read remaining fields */
+	for (i = PLAYER_GOALS + 2 * MAX_GOAL; i < PLAYER_FIELDS; i++)
+	{
+		/* Read field */
+		if (!get_varint(&f[i], msg, msg_len, msg_ptr)) return 0;
+	}
+
+	/* Success */
+	return 1;
+}
+
+/*
+ * Copy one player to a batch of player updates.
+ *
+ * Only goals the player has claimed or made progress toward are written,
+ * which takes at most PLAYER_STATUS_MAX bytes (counting the player index
+ * added by the caller).
+ */
+void put_player_status(int *f, char **msg)
+{
+	int i, mask = 0;
+
+	/* Add actions and prestige action used flag */
+	for (i = 0; i < PLAYER_GOALS; i++) put_varint(f[i], msg);
+
+	/* Loop over goals */
+	for (i = 0; i < MAX_GOAL; i++)
+	{
+		/* Mark goals claimed or with progress */
+		if (f[PLAYER_GOALS + 2 * i] || f[PLAYER_GOALS + 2 * i + 1])
+			mask |= 1 << i;
+	}
+
+	/* Add mask of goals listed */
+	put_varint(mask, msg);
+
+	/* Loop over goals */
+	for (i = 0; i < MAX_GOAL; i++)
+	{
+		/* Skip goals not listed */
+		if (!(mask & (1 << i))) continue;
+
+		/* Add claimed flag and progress */
+		put_varint(f[PLAYER_GOALS + 2 * i], msg);
+		put_varint(f[PLAYER_GOALS + 2 * i + 1], msg);
+	}
+
+	/* Add remaining fields */
+	for (i = PLAYER_GOALS + 2 * MAX_GOAL; i < PLAYER_FIELDS; i++)
+		put_varint(f[i], msg);
+}
+
 /*
  * Start creating a message with the given type.
  *
@@ -164,19 +420,15 @@ void finish_msg(char *start, char *end)
 }
 
 /*
- * Send a formatted message.
+ * Build a formatted message from a list of arguments.
  */
-void send_msgf(int fd, int type, char *fmt, ...)
+void format_msgv(char *msg, int type, char *fmt, va_list ap)
 {
-	char msg[BUF_LEN], *ptr = msg;
-	va_list ap;
+	char *ptr = msg;
 
 	/* Start message */
 	start_msg(&ptr, type);
 
-	/* Start processing variable arguments */
-	va_start(ap, fmt);
-
 	/* Loop over format characters */
 	while (*fmt)
 	{
@@ -199,11 +451,26 @@ void send_msgf(int fd, int type, char *fmt, ...)
 		}
 	}
 
-	/* Stop processing arguments */
-	va_end(ap);
-
 	/* Finish message */
 	finish_msg(msg, ptr);
+}
+
+/*
+ * Send a formatted message.
+ */
+void send_msgf(int fd, int type, char *fmt, ...)
+{
+	char msg[BUF_LEN];
+	va_list ap;
+
+	/* Start processing variable arguments */
+	va_start(ap, fmt);
+
+	/* Build message */
+	format_msgv(msg, type, fmt, ap);
+
+	/* Stop processing arguments */
+	va_end(ap);
 
 	/* Send message */
 	send_msg(fd, msg);
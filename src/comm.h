@@ -49,6 +49,37 @@
  */
 #define HEADER_LEN 8
 
+/*
+ * Newest protocol revision understood.
+ *
+ * Revision 2 adds varint-encoded batches of player and card updates
+ * (MSG_STATUS_PLAYERS and MSG_STATUS_CARDS), and is used only when the
+ * client asks for it at login.
+ */
+#define COMM_PROTOCOL 2
+
+/*
+ * Number of fields describing a card's status.
+ */
+#define CARD_FIELDS 8
+
+/*
+ * Most bytes taken by one card in a batch of card updates.
+ */
+#define CARD_STATUS_MAX (5 + 1 + CARD_FIELDS * 5)
+
+/*
+ * Number of fields describing a player's status, and position of the
+ * first goal field.
+ */
+#define PLAYER_FIELDS (3 + 2 * MAX_GOAL + 7)
+#define PLAYER_GOALS  3
+
+/*
+ * Most bytes taken by one player in a batch of player updates.
+ */
+#define PLAYER_STATUS_MAX (5 + 5 + PLAYER_FIELDS * 5)
+
 /*
  * Message types.
  */
@@ -85,6 +116,8 @@
 #define MSG_SEAT              48
 #define MSG_GAMECHAT          49
 #define MSG_LOG_FORMAT        50
+#define MSG_STATUS_CARDS      51
+#define MSG_STATUS_PLAYERS    52
 
 #define MSG_CHOOSE            60
 #define MSG_PREPARE           61
@@ -115,7 +148,18 @@ extern int get_integer(int *dest,
                        char *msg, unsigned int msg_len, char **msg_ptr);
 extern void put_string(char *ptr, char **msg);
 extern void put_integer(int x, char **msg);
+extern int get_varint(int *dest,
+                      char *msg, unsigned int msg_len, char **msg_ptr);
+extern void put_varint(int x, char **msg);
+extern int card_default[CARD_FIELDS];
+extern int get_card_status(int *x, int *f,
+                           char *msg, unsigned int msg_len, char **msg_ptr);
+extern void put_card_status(int x, int last, int *f, char **msg);
+extern int get_player_status(int *f,
+                             char *msg, unsigned int msg_len, char **msg_ptr);
+extern void put_player_status(int *f, char **msg);
 extern void start_msg(char **msg, int type);
 extern void finish_msg(char *start, char *end);
 extern void send_msg(int fd, char *msg);
+extern void format_msgv(char *msg, int type, char *fmt, va_list ap);
 extern void send_msgf(int fd, int type, char *fmt, ...);
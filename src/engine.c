@@ -114,7 +114,7 @@ void dump_hand(game *g, int who)
 		/* Skip cards in wrong area */
 		if (c_ptr->where != WHERE_HAND) continue;
 
-		printf("%s\n", c_ptr->d_ptr->name);
+		printf("%s\n", library[c_ptr->d_idx].name);
 	}
 }
 
@@ -129,7 +129,7 @@ void dump_hand_new(game *g, int who)
 	for ( ; x != -1; x = g->deck[x].next)
 	{
 		/* Print name */
-		printf("%s\n", g->deck[x].d_ptr->name);
+		printf("%s\n", library[g->deck[x].d_idx].name);
 	}
 }
 
@@ -150,7 +150,7 @@ void dump_active(game *g, int who)
 		/* Skip cards in wrong area */
 		if (c_ptr->where != WHERE_ACTIVE) continue;
 
-		printf("%s\n", c_ptr->d_ptr->name);
+		printf("%s\n", library[c_ptr->d_idx].name);
 	}
 }
 void dump_active_new(game *g, int who)
@@ -164,7 +164,7 @@ void dump_active_new(game *g, int who)
 	for ( ; x != -1; x = g->deck[x].next)
 	{
 		/* Print name */
-		printf("%s\n", g->deck[x].d_ptr->name);
+		printf("%s\n", library[g->deck[x].d_idx].name);
 	}
 }
 
@@ -177,6 +177,416 @@ int simple_rand(unsigned int *seed)
 	return ((unsigned)(*seed/65536) % 32768);
 }
 
+/*
+ * Return whether game messages should be generated.
+ *
+ * Simulated games and fast replays skip formatting messages altogether.
+ */
+static int show_messages(game *g)
+{
+	/* No messages in simulations or fast replays */
+	return !g->simulation && !g->fast_replay;
+}
+
+/*
+ * Return whether a fast replay is still under way for the given player.
+ *
+ * A fast replay ends as soon as a player has no more logged choices, after
+ * which messages and player callbacks resume as normal.
+ */
+static int fast_replaying(game *g, int who)
+{
+	/* Check for no fast replay */
+	if (!g->fast_replay) return 0;
+
+	/* Check for logged choices remaining */
+	if (g->p[who].choice_pos < g->p[who].choice_size) return 1;
+
+	/* Replay is over */
+	g->fast_replay = 0;
+	return 0;
+}
+
+/*
+ * Copy a game state.
+ *
+ * The deck is the last member of the game structure, so only the cards
+ * actually in use need to be copied.
+ */
+void copy_game(game *dst, game *src)
+{
+	/* Copy everything up to the end of the cards in use */
+	memcpy(dst, src, offsetof(game, deck) + sizeof(card) * src->deck_size);
+}
+
+/*
+ * Mark every card, player and goal as changed.
+ */
+void mark_all(game *g)
+{
+	/* Set every dirty flag */
+	memset(g->dirty_card, 0xff, sizeof(g->dirty_card));
+	g->dirty_player = (1 << MAX_PLAYER) - 1;
+	g->dirty_goal = 1;
+}
+
+/*
+ * Forget which cards, players and goals have changed.
+ */
+void clear_dirty(game *g)
+{
+	/* Clear every dirty flag */
+	memset(g->dirty_card, 0, sizeof(g->dirty_card));
+	g->dirty_player = 0;
+	g->dirty_goal = 0;
+}
+
+/*
+ * Return the number of bytes needed to hold a snapshot of the game.
+ */
+int snapshot_size(game *g)
+{
+	int size;
+
+	/* Header and game state up to the end of the cards in use */
+	size = sizeof(snapshot_header) + offsetof(game, deck) +
+	       sizeof(card) * g->deck_size;
+
+	/* Add campaign status if needed */
+	if (g->camp) size += sizeof(campaign_status);
+
+	/* Return size */
+	return size;
+}
+
+/*
+ * Write a position-independent snapshot of the game state to the given
+ * buffer, which must hold at least snapshot_size() bytes.
+ *
+ * Returns the number of bytes written.
+ */
+int save_snapshot(game *g, char *buf)
+{
+	snapshot_header header;
+	game *s_ptr;
+	int i, len;
+
+	/* Size of game state */
+	len = offsetof(game, deck) + sizeof(card) * g->deck_size;
+
+	/* Fill in header */
+	memset(&header, 0, sizeof(snapshot_header));
+	header.magic = SNAPSHOT_MAGIC;
+	header.game_size = sizeof(game);
+	header.card_size = sizeof(card);
+	header.length = snapshot_size(g);
+	header.deck_size = g->deck_size;
+
+	/* Store campaign as index into library */
+	header.camp = g->camp ? g->camp - camp_library : -1;
+
+	/* Copy header */
+	memcpy(buf, &header, sizeof(snapshot_header));
+
+	/* Copy game state after header */
+	s_ptr = (game *)(buf + sizeof(snapshot_header));
+	copy_game(s_ptr, g);
+
+	/* Clear pointers */
+	s_ptr->camp = NULL;
+	s_ptr->camp_status = NULL;
+	s_ptr->human_name = NULL;
+
+	/* Loop over players */
+	for (i = 0; i < MAX_PLAYER; i++)
+	{
+		/* Clear player pointers */
+		s_ptr->p[i].name = NULL;
+		s_ptr->p[i].control = NULL;
+		s_ptr->p[i].choice_log = NULL;
+		s_ptr->p[i].choice_history = NULL;
+	}
+
+	/* Copy campaign status after game state */
+	if (g->camp)
+	{
+		/* Copy status */
+		memcpy(buf + sizeof(snapshot_header) + len, g->camp_status,
+		       sizeof(campaign_status));
+	}
+
+	/* Return length */
+	return header.length;
+}
+
+/*
+ * Restore the game state from a snapshot.
+ *
+ * Player names, controls, choice logs and the session ID are local to
+ * the process, so the ones already in the given game are kept.  The
+ * choice log positions are taken from the snapshot, but the log sizes are
+ * not.
+ *
+ * Returns -1 if the snapshot was not made by a compatible build.
+ */
+int load_snapshot(game *g, char *buf, int len)
+{
+	snapshot_header header;
+	player saved[MAX_PLAYER];
+	campaign_status *cs_ptr;
+	char *human_name;
+	int session_id, fast_replay;
+	int i, size;
+
+	/* Check for truncated header */
+	if (len < (int)sizeof(snapshot_header)) return -1;
+
+	/* Copy header */
+	memcpy(&header, buf, sizeof(snapshot_header));
+
+	/* Check format and layout */
+	if (header.magic != SNAPSHOT_MAGIC ||
+	    header.game_size != sizeof(game) ||
+	    header.card_size != sizeof(card) ||
+	    header.length != len ||
+	    header.deck_size < 0 || header.deck_size > MAX_DECK ||
+	    header.camp >= num_campaign) return -1;
+
+	/* Size of game state */
+	size = offsetof(game, deck) + sizeof(card) * header.deck_size;
+
+	/* Check length */
+	if (len != sizeof(snapshot_header) + size +
+	           (header.camp >= 0 ? sizeof(campaign_status) : 0)) return -1;
+
+	/* Remember process-local information */
+	memcpy(saved, g->p, sizeof(player) * MAX_PLAYER);
+	cs_ptr = g->camp_status;
+	human_name = g->human_name;
+	session_id = g->session_id;
+	fast_replay = g->fast_replay;
+
+	/* Copy game state */
+	memcpy(g, buf + sizeof(snapshot_header), size);
+
+	/* Restore pointers */
+	g->camp_status = cs_ptr;
+	g->human_name = human_name;
+	g->session_id = session_id;
+	g->fast_replay = fast_replay;
+
+	/* Loop over players */
+	for (i = 0; i < MAX_PLAYER; i++)
+	{
+		/* Restore player information */
+		g->p[i].name = saved[i].name;
+		g->p[i].control = saved[i].control;
+		g->p[i].choice_log = saved[i].choice_log;
+		g->p[i].choice_size = saved[i].choice_size;
+		g->p[i].choice_history = saved[i].choice_history;
+	}
+
+	/* Check for no campaign */
+	if (header.camp < 0)
+	{
+		/* Clear campaign */
+		g->camp = NULL;
+
+		/* Success */
+		return 0;
+	}
+
+	/* Look up campaign */
+	g->camp = &camp_library[header.camp];
+
+	/* Check for pre-existing campaign status */
+	if (!g->camp_status)
+	{
+		/* Make a status structure */
+		g->camp_status = (campaign_status *)
+		                               malloc(sizeof(campaign_status));
+	}
+
+	/* Copy campaign status */
+	memcpy(g->camp_status, buf + sizeof(snapshot_header) + size,
+	       sizeof(campaign_status));
+
+	/* Success */
+	return 0;
+}
+
+/*
+ * Save a checkpoint of the game state at the start of a round.
+ *
+ * An existing checkpoint for the same round is replaced, since it was
+ * made from the same (or an older) choice log.
+ */
+checkpoint *save_checkpoint(checkpoint_list *cl, game *g)
+{
+	checkpoint *cp_ptr;
+	int i, j;
+
+	/* Do not save checkpoints of simulated or aborted games */
+	if (g->simulation || g->game_over) return NULL;
+
+	/* Find position of round in list */
+	for (i = 0; i < cl->num; i++)
+	{
+		/* Stop at this round or a later one */
+		if (cl->list[i].round >= g->round) break;
+	}
+
+	/* Check for new round */
+	if (i == cl->num || cl->list[i].round != g->round)
+	{
+		/* Check for full list */
+		if (cl->num == MAX_CHECKPOINT) return NULL;
+
+		/* Make room for new checkpoint */
+		memmove(&cl->list[i + 1], &cl->list[i],
+		        sizeof(checkpoint) * (cl->num - i));
+
+		/* One more checkpoint */
+		cl->num++;
+
+		/* No snapshot yet */
+		cl->list[i].snap = NULL;
+	}
+
+	/* Get checkpoint pointer */
+	cp_ptr = &cl->list[i];
+
+	/* Remember round */
+	cp_ptr->round = g->round;
+
+	/* Loop over players */
+	for (j = 0; j < MAX_PLAYER; j++)
+	{
+		/* Remember log position */
+		cp_ptr->pos[j] = j < g->num_players ? g->p[j].choice_pos : 0;
+	}
+
+	/* No message log length known */
+	cp_ptr->log_len = 0;
+
+	/* Make room for snapshot */
+	cp_ptr->snap = (char *)realloc(cp_ptr->snap, snapshot_size(g));
+
+	/* Save game state */
+	cp_ptr->len = save_snapshot(g, cp_ptr->snap);
+
+	/* Return checkpoint */
+	return cp_ptr;
+}
+
+/*
+ * Find the latest checkpoint that the current choice logs still reach.
+ */
+checkpoint *find_checkpoint(checkpoint_list *cl, game *g)
+{
+	int i, j;
+
+	/* Loop over checkpoints, latest first */
+	for (i = cl->num - 1; i >= 0; i--)
+	{
+		/* Loop over players */
+		for (j = 0; j < g->num_players; j++)
+		{
+			/* Stop if log is too short */
+			if (cl->list[i].pos[j] > g->p[j].choice_size) break;
+		}
+
+		/* Check for all logs long enough */
+		if (j == g->num_players) return &cl->list[i];
+	}
+
+	/* No checkpoint available */
+	return NULL;
+}
+
+/*
+ * Restore a game from a checkpoint snapshot, if the choice logs of the
+ * given game still reach the positions recorded in it.
+ *
+ * Returns -1 if the checkpoint cannot be used.
+ */
+int load_checkpoint(game *g, char *buf, int len)
+{
+	int i, pos;
+
+	/* Check for truncated snapshot */
+	if (len < (int)(sizeof(snapshot_header) + offsetof(game, deck)))
+		return -1;
+
+	/* Loop over players */
+	for (i = 0; i < g->num_players; i++)
+	{
+		/* Get log position stored in snapshot */
+		memcpy(&pos, buf + sizeof(snapshot_header) + offsetof(game, p) +
+		       sizeof(player) * i + offsetof(player, choice_pos),
+		       sizeof(int));
+
+		/* Check for log too short */
+		if (pos > g->p[i].choice_size) return -1;
+	}
+
+	/* Restore game state */
+	return load_snapshot(g, buf, len);
+}
+
+/*
+ * Remove checkpoints past the current choice log positions.
+ *
+ * This should be called whenever the logs are about to be rewritten from
+ * the current position.
+ */
+void trim_checkpoints(checkpoint_list *cl, game *g)
+{
+	int i, j;
+
+	/* Loop over checkpoints */
+	for (i = 0; i < cl->num; i++)
+	{
+		/* Loop over players */
+		for (j = 0; j < g->num_players; j++)
+		{
+			/* Stop if checkpoint is past current position */
+			if (cl->list[i].pos[j] > g->p[j].choice_pos) break;
+		}
+
+		/* Stop at first checkpoint past current position */
+		if (j < g->num_players) break;
+	}
+
+	/* Loop over removed checkpoints */
+	for (j = i; j < cl->num; j++)
+	{
+		/* Free snapshot */
+		free(cl->list[j].snap);
+	}
+
+	/* Keep earlier checkpoints */
+	cl->num = i;
+}
+
+/*
+ * Remove all checkpoints.
+ */
+void clear_checkpoints(checkpoint_list *cl)
+{
+	int i;
+
+	/* Loop over checkpoints */
+	for (i = 0; i < cl->num; i++)
+	{
+		/* Free snapshot */
+		free(cl->list[i].snap);
+	}
+
+	/* Clear list */
+	cl->num = 0;
+}
+
 /*
  * Return whether goals are enabled in this game.
  */
@@ -272,7 +682,7 @@ int player_has(game *g, int who, design *d_ptr)
 	for ( ; x != -1; x = g->deck[x].next)
 	{
 		/* Check for matching type */
-		if (g->deck[x].d_ptr == d_ptr) return 1;
+		if (g->deck[x].d_idx == d_ptr->index) return 1;
 	}
 
 	/* Assume not */
@@ -295,7 +705,7 @@ int count_active_flags(game *g, int who, int flags)
 	for ( ; x != -1; x = g->deck[x].start_next)
 	{
 		/* Check for correct flags */
-		if ((g->deck[x].d_ptr->flags & flags) == flags) count++;
+		if ((library[g->deck[x].d_idx].flags & flags) == flags) count++;
 	}
 
 	/* Return count */
@@ -370,7 +780,7 @@ static void refresh_draw(game *g)
 	int i;
 
 	/* Message */
-	if (!g->simulation)
+	if (show_messages(g))
 	{
 		/* Send message */
 		message_add_formatted(g, "Refreshing draw deck.\n", FORMAT_EM);
@@ -390,6 +800,7 @@ static void refresh_draw(game *g)
 
 		/* Card's location is no longer known to anyone */
 		c_ptr->misc &= ~MISC_KNOWN_MASK;
+		MARK_CARD(g, i);
 	}
 }
 
@@ -440,6 +851,7 @@ static int random_draw(game *g)
 
 	/* Clear chosen card's location */
 	c_ptr->where = -1;
+	MARK_CARD(g, i);
 
 	/* Return chosen card */
 	return i;
@@ -524,6 +936,7 @@ int first_draw(game *g)
 
 	/* Clear chosen card's location */
 	c_ptr->where = -1;
+	MARK_CARD(g, i);
 
 	/* Check for just-emptied draw pile */
 	if (draw_empty(g)) refresh_draw(g);
@@ -591,6 +1004,7 @@ void move_card(game *g, int which, int owner, int where)
 	/* Adjust location */
 	c_ptr->owner = owner;
 	c_ptr->where = where;
+	MARK_CARD(g, which);
 }
 
 /*
@@ -654,6 +1068,7 @@ void move_start(game *g, int which, int owner, int where)
 	/* Adjust location */
 	c_ptr->start_owner = owner;
 	c_ptr->start_where = where;
+	MARK_CARD(g, which);
 }
 
 /*
@@ -693,6 +1108,7 @@ int draw_card(game *g, int who, char *reason)
 
 		/* Move card to discard to simulate deck cycling */
 		c_ptr->where = WHERE_DISCARD;
+		MARK_CARD(g, which);
 
 		/* Done */
 		return which;
@@ -714,8 +1130,8 @@ int draw_card(game *g, int who, char *reason)
 	c_ptr->misc &= ~MISC_KNOWN_MASK;
 	c_ptr->misc |= 1 << who;
 
-	/* Check for real game and reason */
-	if (!g->simulation)
+	/* Check for messages and reason */
+	if (show_messages(g))
 	{
 		if (reason)
 		{
@@ -731,7 +1147,7 @@ int draw_card(game *g, int who, char *reason)
 		if (g->p[who].control->private_message)
 		{
 			/* Format draw message */
-			sprintf(msg, "%s draws %s.\n", p_ptr->name, c_ptr->d_ptr->name);
+			sprintf(msg, "%s draws %s.\n", p_ptr->name, library[c_ptr->d_idx].name);
 
 			/* Add message */
 			g->p[who].control->private_message(g, who, msg, FORMAT_DRAW);
@@ -752,8 +1168,8 @@ void draw_cards(game *g, int who, int num, char *reason)
 	int i;
 	char msg[1024];
 
-	/* Check for real game and reason */
-	if (!g->simulation && reason)
+	/* Check for messages and reason */
+	if (show_messages(g) && reason)
 	{
 		/* Format message */
 		sprintf(msg, "%s receives %d card%s from %s.\n",
@@ -780,9 +1196,10 @@ void gain_prestige(game *g, int who, int num, char *reason)
 
 	/* Add to prestige */
 	p_ptr->prestige += num;
+	MARK_PLAYER(g, who);
 
-	/* Check for real game and reason */
-	if (!g->simulation && reason)
+	/* Check for messages and reason */
+	if (show_messages(g) && reason)
 	{
 		/* Format message */
 		sprintf(msg, "%s receives %d prestige from %s.\n",
@@ -806,12 +1223,13 @@ static void gain_vps(game *g, int who, int num, char *reason)
 
 	/* Award VPs */
 	p_ptr->vp += num;
+	MARK_PLAYER(g, who);
 
 	/* Remove from pool */
 	g->vp_pool -= num;
 
-	/* Check for simulated game and reason */
-	if (!g->simulation && reason)
+	/* Check for messages and reason */
+	if (show_messages(g) && reason)
 	{
 		sprintf(msg, "%s receives %d VP%s from %s.\n",
 		        g->p[who].name, num, PLURAL(num), reason);
@@ -833,6 +1251,7 @@ void spend_prestige(game *g, int who, int num)
 
 	/* Decrease prestige */
 	p_ptr->prestige -= num;
+	MARK_PLAYER(g, who);
 
 	/* Check goal losses */
 	check_goal_loss(g, who, GOAL_MOST_PRESTIGE);
@@ -878,11 +1297,13 @@ void check_prestige(game *g)
 		/* Get player pointer */
 		p_ptr = &g->p[i];
 
-		/* Check for less than most */
-		if (p_ptr->prestige < max) p_ptr->prestige_turn = 0;
-
-		/* Check for tie for most */
-		if (num > 1) p_ptr->prestige_turn = 0;
+		/* Check for less than most or tie for most */
+		if (p_ptr->prestige_turn && (p_ptr->prestige < max || num > 1))
+		{
+			/* Clear prestige earned this turn mark */
+			p_ptr->prestige_turn = 0;
+			MARK_PLAYER(g, i);
+		}
 	}
 }
 
@@ -932,12 +1353,13 @@ void start_prestige(game *g)
 		{
 			/* Award VP */
 			p_ptr->vp++;
+			MARK_PLAYER(g, i);
 
 			/* Remove from pool */
 			g->vp_pool--;
 
 			/* Start message */
-			if (!g->simulation)
+			if (show_messages(g))
 			{
 				/* Format message */
 				sprintf(msg, "%s earns VP", p_ptr->name);
@@ -950,7 +1372,7 @@ void start_prestige(game *g)
 				card_bonus = i;
 
 				/* Message */
-				if (!g->simulation)
+				if (show_messages(g))
 				{
 					/* Add to message */
 					strcat(msg, " and card");
@@ -958,7 +1380,7 @@ void start_prestige(game *g)
 			}
 
 			/* Finish message */
-			if (!g->simulation)
+			if (show_messages(g))
 			{
 				/* Complete message */
 				strcat(msg, " for Prestige Leader.\n");
@@ -975,8 +1397,13 @@ void start_prestige(game *g)
 			draw_card(g, i, NULL);
 		}
 
-		/* Clear prestige earned this turn mark */
-		p_ptr->prestige_turn = 0;
+		/* Check for prestige earned this turn */
+		if (p_ptr->prestige_turn)
+		{
+			/* Clear prestige earned this turn mark */
+			p_ptr->prestige_turn = 0;
+			MARK_PLAYER(g, i);
+		}
 	}
 
 	/* Clear temp flags on card just drawn */
@@ -1001,6 +1428,15 @@ void clear_temp(game *g)
 		/* Get card pointer */
 		c_ptr = &g->deck[i];
 
+		/* Check for change in start location or temp flags */
+		if (c_ptr->start_owner != c_ptr->owner ||
+		    c_ptr->start_where != c_ptr->where ||
+		    (c_ptr->misc & ~MISC_TEMP_MASK))
+		{
+			/* Mark card changed */
+			MARK_CARD(g, i);
+		}
+
 		/* Copy current location */
 		c_ptr->start_owner = c_ptr->owner;
 		c_ptr->start_where = c_ptr->where;
@@ -1018,6 +1454,14 @@ void clear_temp(game *g)
 		/* Get player pointer */
 		p_ptr = &g->p[i];
 
+		/* Check for bonuses to clear */
+		if (p_ptr->phase_bonus_used || p_ptr->bonus_military ||
+		    p_ptr->bonus_military_xeno || p_ptr->bonus_reduce)
+		{
+			/* Mark player changed */
+			MARK_PLAYER(g, i);
+		}
+
 		/* Clear bonus used flag */
 		p_ptr->phase_bonus_used = 0;
 
@@ -1043,6 +1487,179 @@ void clear_temp(game *g)
 	}
 }
 
+/*
+ * Allocate an empty choice log.
+ */
+choice_buffer *new_choice_log(void)
+{
+	choice_buffer *b;
+
+	/* Allocate log */
+	b = (choice_buffer *)malloc(sizeof(choice_buffer));
+
+	/* Allocate initial entries */
+	b->data = (int *)malloc(sizeof(int) * CHOICE_LOG_INIT);
+	b->size = CHOICE_LOG_INIT;
+
+	/* Return new log */
+	return b;
+}
+
+/*
+ * Make room for at least the given number of entries in a choice log.
+ */
+void grow_choice_log(choice_buffer *b, int size)
+{
+	/* Check for enough room already */
+	if (size <= b->size) return;
+
+	/* Double allocation until large enough */
+	while (b->size < size) b->size *= 2;
+
+	/* Reallocate entries */
+	b->data = (int *)realloc(b->data, sizeof(int) * b->size);
+}
+
+/*
+ * Make room for a number of entries at the end of a player's choice log.
+ *
+ * Return a pointer to the first free entry.
+ */
+int *reserve_choice_log(player *p_ptr, int num)
+{
+	/* Grow log if needed */
+	grow_choice_log(p_ptr->choice_log, p_ptr->choice_size + num);
+
+	/* Return end of log */
+	return &p_ptr->choice_log->data[p_ptr->choice_size];
+}
+
+/*
+ * Encode a choice log for storage.
+ *
+ * The log is written as a tag followed by one zigzag varint per entry, so
+ * that the small values making up most of a log take a single byte.  The
+ * buffer must hold CHOICE_ENCODED_MAX(num) bytes.
+ *
+ * Return number of bytes written.
+ */
+int encode_choice_log(unsigned char *buf, int *log, int num)
+{
+	unsigned char *ptr = buf;
+	unsigned int x;
+	int i;
+
+	/* Write tag */
+	memcpy(ptr, CHOICE_LOG_MAGIC, 4);
+	ptr += 4;
+
+	/* Loop over entries */
+	for (i = 0; i < num; i++)
+	{
+		/* Map small negative values to small positive ones */
+		x = ((unsigned int)log[i] << 1) ^ (unsigned int)(log[i] >> 31);
+
+		/* Write seven bits at a time */
+		while (x >= 0x80)
+		{
+			/* Write low bits with continuation flag */
+			*ptr++ = (x & 0x7f) | 0x80;
+			x >>= 7;
+		}
+
+		/* Write last byte */
+		*ptr++ = x;
+	}
+
+	/* Return length */
+	return ptr - buf;
+}
+
+/*
+ * Decode a stored choice log.
+ *
+ * Logs saved before the encoding was introduced are raw arrays of native
+ * integers, and are still accepted.
+ *
+ * Return number of entries, or -1 if the data is malformed.
+ */
+int decode_choice_log(choice_buffer *b, unsigned char *buf, int len)
+{
+	unsigned char *ptr = buf, *end = buf + len;
+	unsigned int x;
+	int num = 0, shift;
+
+	/* Check for old raw format */
+	if (len < 4 || memcmp(buf, CHOICE_LOG_MAGIC, 4))
+	{
+		/* Check for partial entry */
+		if (len % sizeof(int)) return -1;
+
+		/* Copy entries */
+		grow_choice_log(b, len / sizeof(int));
+		memcpy(b->data, buf, len);
+
+		/* Return number of entries */
+		return len / sizeof(int);
+	}
+
+	/* Skip tag */
+	ptr += 4;
+
+	/* Each entry takes at least one byte */
+	grow_choice_log(b, len - 4);
+
+	/* Loop until end of data */
+	while (ptr < end)
+	{
+		/* Start new value */
+		x = 0;
+		shift = 0;
+
+		/* Read seven bits at a time */
+		do
+		{
+			/* Check for truncated or overlong value */
+			if (ptr == end || shift > 28) return -1;
+
+			/* Add bits */
+			x |= (unsigned int)(*ptr & 0x7f) << shift;
+			shift += 7;
+
+		} while (*ptr++ & 0x80);
+
+		/* Undo zigzag mapping */
+		b->data[num++] = (int)(x >> 1) ^ -(int)(x & 1);
+	}
+
+	/* Return number of entries */
+	return num;
+}
+
+/*
+ * Check that the choice at the given position lies within the log.
+ */
+static int choice_in_log(int *log, int pos, int size)
+{
+	/* Check for type, return value and list size */
+	if (pos + 3 > size) return 0;
+
+	/* Step over the type and the return value */
+	pos += 2;
+
+	/* Check list and special size */
+	if (log[pos] < 0 || pos + log[pos] + 2 > size) return 0;
+
+	/* Step over the list size and the list itself */
+	pos += log[pos] + 1;
+
+	/* Check special list */
+	if (log[pos] < 0 || pos + log[pos] + 1 > size) return 0;
+
+	/* Choice is complete */
+	return 1;
+}
+
 /*
  * Find the next choice in a log after the current position.
  */
@@ -1075,11 +1692,20 @@ static void perform_debug_moves(game *g, int who)
 	p_ptr = &g->p[who];
 
 	/* Get current position in log */
-	l_ptr = &p_ptr->choice_log[p_ptr->choice_pos];
+	l_ptr = &p_ptr->choice_log->data[p_ptr->choice_pos];
 
 	/* Loop for debug choices */
 	while (p_ptr->choice_pos < p_ptr->choice_size)
 	{
+		/* Check for truncated choice */
+		if (!choice_in_log(p_ptr->choice_log->data, p_ptr->choice_pos,
+		                   p_ptr->choice_size))
+		{
+			/* Error */
+			display_error("Truncated choice in choice log!\n");
+			abort();
+		}
+
 		/* Read next choice type */
 		switch (*l_ptr)
 		{
@@ -1104,14 +1730,19 @@ static void perform_debug_moves(game *g, int who)
 				/* Advance pointer to next choice */
 				l_ptr++;
 
-				/* Format message */
-				sprintf(msg, "%s moved %s to (%s, %s).\n", g->p[who].name,
-				        g->deck[c].d_ptr->name,
-				        owner == -1 ? "None" : g->p[owner].name,
-				        location_names[where]);
-
-				/* Add message */
-				message_add_formatted(g, msg, FORMAT_DEBUG);
+				/* Check for messages */
+				if (show_messages(g))
+				{
+					/* Format message */
+					sprintf(msg, "%s moved %s to (%s, %s).\n",
+					        g->p[who].name,
+					        library[g->deck[c].d_idx].name,
+					        owner == -1 ? "None" : g->p[owner].name,
+					        location_names[where]);
+
+					/* Add message */
+					message_add_formatted(g, msg, FORMAT_DEBUG);
+				}
 
 				/* Move card */
 				move_card(g, c, owner, where);
@@ -1152,12 +1783,16 @@ static void perform_debug_moves(game *g, int who)
 				/* Ignore all data in choice */
 				l_ptr += 4;
 
-				/* Format message */
-				sprintf(msg, "%s shuffles the draw deck.\n",
-				        g->p[who].name);
+				/* Check for messages */
+				if (show_messages(g))
+				{
+					/* Format message */
+					sprintf(msg, "%s shuffles the draw deck.\n",
+					        g->p[who].name);
 
-				/* Add message */
-				message_add_formatted(g, msg, FORMAT_DEBUG);
+					/* Add message */
+					message_add_formatted(g, msg, FORMAT_DEBUG);
+				}
 
 				/* Move to next random number */
 				game_rand(g);
@@ -1169,11 +1804,16 @@ static void perform_debug_moves(game *g, int who)
 				/* Ignore all data in choice */
 				l_ptr += 4;
 
-				/* Format message */
-				sprintf(msg, "%s takes a card.\n", g->p[who].name);
+				/* Check for messages */
+				if (show_messages(g))
+				{
+					/* Format message */
+					sprintf(msg, "%s takes a card.\n",
+					        g->p[who].name);
 
-				/* Add message */
-				message_add_formatted(g, msg, FORMAT_DEBUG);
+					/* Add message */
+					message_add_formatted(g, msg, FORMAT_DEBUG);
+				}
 
 				/* Shuffle the deck to avoid peeking */
 				game_rand(g);
@@ -1188,11 +1828,16 @@ static void perform_debug_moves(game *g, int who)
 				/* Ignore all data in choice */
 				l_ptr += 4;
 
-				/* Format message */
-				sprintf(msg, "%s takes a VP.\n", g->p[who].name);
+				/* Check for messages */
+				if (show_messages(g))
+				{
+					/* Format message */
+					sprintf(msg, "%s takes a VP.\n",
+					        g->p[who].name);
 
-				/* Add message */
-				message_add_formatted(g, msg, FORMAT_DEBUG);
+					/* Add message */
+					message_add_formatted(g, msg, FORMAT_DEBUG);
+				}
 
 				/* Give player a VP */
 				gain_vps(g, who, 1, NULL);
@@ -1207,11 +1852,16 @@ static void perform_debug_moves(game *g, int who)
 				/* Don't do anything if expansion does not have prestige */
 				if (!exp_info[g->expanded].has_prestige) break;
 
-				/* Format message */
-				sprintf(msg, "%s takes a prestige.\n", g->p[who].name);
+				/* Check for messages */
+				if (show_messages(g))
+				{
+					/* Format message */
+					sprintf(msg, "%s takes a prestige.\n",
+					        g->p[who].name);
 
-				/* Add message */
-				message_add_formatted(g, msg, FORMAT_DEBUG);
+					/* Add message */
+					message_add_formatted(g, msg, FORMAT_DEBUG);
+				}
 
 				/* Give player a prestige */
 				gain_prestige(g, who, 1, NULL);
@@ -1226,11 +1876,16 @@ static void perform_debug_moves(game *g, int who)
 				/* Don't do anything if game has not started */
 				if (g->cur_action <= ACT_GAME_START) break;
 
-				/* Format message */
-				sprintf(msg, "%s changes the first player.\n", g->p[who].name);
+				/* Check for messages */
+				if (show_messages(g))
+				{
+					/* Format message */
+					sprintf(msg, "%s changes the first player.\n",
+					        g->p[who].name);
 
-				/* Add message */
-				message_add_formatted(g, msg, FORMAT_DEBUG);
+					/* Add message */
+					message_add_formatted(g, msg, FORMAT_DEBUG);
+				}
 
 				/* Remember to rotate players one step */
 				++g->debug_rotate;
@@ -1242,7 +1897,7 @@ static void perform_debug_moves(game *g, int who)
 		}
 
 		/* Set log position to current */
-		p_ptr->choice_pos = l_ptr - p_ptr->choice_log;
+		p_ptr->choice_pos = l_ptr - p_ptr->choice_log->data;
 
 		/* Update unread position */
 		p_ptr->choice_unread_pos = p_ptr->choice_pos;
@@ -1277,8 +1932,17 @@ static int extract_choice(game *g, int who, int type, int list[], int *nl,
 	/* Look for and execute any debug choices in the log */
 	perform_debug_moves(g, who);
 
+	/* Check for truncated choice */
+	if (!choice_in_log(p_ptr->choice_log->data, p_ptr->choice_pos,
+	                   p_ptr->choice_size))
+	{
+		/* Error */
+		display_error("Truncated choice in choice log!\n");
+		abort();
+	}
+
 	/* Get current position in log */
-	l_ptr = &p_ptr->choice_log[p_ptr->choice_pos];
+	l_ptr = &p_ptr->choice_log->data[p_ptr->choice_pos];
 
 	/* Check for correct type of answer */
 	if (*l_ptr != type)
@@ -1351,7 +2015,7 @@ static int extract_choice(game *g, int who, int type, int list[], int *nl,
 	}
 
 	/* Set log position to current */
-	p_ptr->choice_pos = l_ptr - p_ptr->choice_log;
+	p_ptr->choice_pos = l_ptr - p_ptr->choice_log->data;
 
 	/* Update unread position */
 	p_ptr->choice_unread_pos = p_ptr->choice_pos;
@@ -1388,6 +2052,9 @@ static int ask_player(game *g, int who, int type, int list[], int *nl,
 		return extract_choice(g, who, type, list, nl, special, ns);
 	}
 
+	/* Any fast replay ends once the log is used up */
+	g->fast_replay = 0;
+
 	/* Ask player for answer */
 	p_ptr->control->make_choice(g, who, type, list, nl, special, ns,
 	                            arg1, arg2, arg3);
@@ -1427,11 +2094,14 @@ static void send_choice(game *g, int who, int type, int list[], int *nl,
 	if (p_ptr->choice_pos < p_ptr->choice_size)
 	{
 		/* Update unread pos */
-		p_ptr->choice_unread_pos = next_choice(p_ptr->choice_log,
+		p_ptr->choice_unread_pos = next_choice(p_ptr->choice_log->data,
 		                                       p_ptr->choice_pos);
 		return;
 	}
 
+	/* Any fast replay ends once the log is used up */
+	g->fast_replay = 0;
+
 	/* Ask player for answer */
 	p_ptr->control->make_choice(g, who, type, list, nl, special, ns,
 	                            arg1, arg2, arg3);
@@ -1505,8 +2175,8 @@ int has_good(game *g, int who, int type)
 		if (!c_ptr->num_goods) continue;
 
 		/* Skip cards with wrong good type */
-		if (c_ptr->d_ptr->good_type != GOOD_ANY &&
-		    c_ptr->d_ptr->good_type != type) continue;
+		if (library[c_ptr->d_idx].good_type != GOOD_ANY &&
+		    library[c_ptr->d_idx].good_type != type) continue;
 
 		/* Skip cards that are newly-placed */
 		if (c_ptr->misc & MISC_UNPAID) continue;
@@ -1537,8 +2207,8 @@ int count_goods(game *g, int who, int type)
 		c_ptr = &g->deck[x];
 
 		/* Skip cards with wrong good type */
-		if (c_ptr->d_ptr->good_type != GOOD_ANY &&
-		    c_ptr->d_ptr->good_type != type) continue;
+		if (library[c_ptr->d_idx].good_type != GOOD_ANY &&
+		    library[c_ptr->d_idx].good_type != type) continue;
 
 		/* Skip cards that are newly-placed */
 		if (c_ptr->misc & MISC_UNPAID) continue;
@@ -1572,8 +2242,8 @@ int get_goods(game *g, int who, int goods[], int type)
 		if (!c_ptr->num_goods) continue;
 
 		/* Skip cards with wrong good type */
-		if (c_ptr->d_ptr->good_type != GOOD_ANY &&
-		    c_ptr->d_ptr->good_type != type) continue;
+		if (library[c_ptr->d_idx].good_type != GOOD_ANY &&
+		    library[c_ptr->d_idx].good_type != type) continue;
 
 		/* Skip cards that are newly-placed */
 		if (c_ptr->misc & MISC_UNPAID) continue;
@@ -1609,12 +2279,12 @@ void discard_callback(game *g, int who, int list[], int num)
 		move_card(g, list[i], -1, WHERE_DISCARD);
 
 		/* Message */
-		if (!g->simulation && g->p[who].control->private_message)
+		if (show_messages(g) && g->p[who].control->private_message)
 		{
 			/* Format message */
 			sprintf(msg, "%s discards %s.\n",
 			        p_ptr->name,
-			        g->deck[list[i]].d_ptr->name);
+			        library[g->deck[list[i]].d_idx].name);
 
 			/* Send message */
 			g->p[who].control->private_message(g, who, msg, FORMAT_DISCARD);
@@ -1680,10 +2350,10 @@ int get_powers(game *g, int who, int phase, power_where *w_list)
 		c_ptr = &g->deck[x];
 
 		/* Loop over card's powers */
-		for (i = 0; i < c_ptr->d_ptr->num_power; i++)
+		for (i = 0; i < library[c_ptr->d_idx].num_power; i++)
 		{
 			/* Get power pointer */
-			o_ptr = &c_ptr->d_ptr->powers[i];
+			o_ptr = &library[c_ptr->d_idx].powers[i];
 
 			/* Skip used powers */
 			if (c_ptr->misc & (1 << (MISC_USED_SHIFT + i)))
@@ -1747,6 +2417,7 @@ void add_good(game *g, int which)
 
 	/* Mark covered card */
 	c_ptr->num_goods++;
+	MARK_CARD(g, which);
 }
 
 /*
@@ -1770,13 +2441,13 @@ void discard_produce_chosen(game *g, int who, int world, int discard,
 	move_card(g, discard, -1, WHERE_DISCARD);
 
 	/* Message */
-	if (!g->simulation)
+	if (show_messages(g))
 	{
 		/* Private message */
 		if (g->p[who].control->private_message)
 		{
 			/* Format message */
-			sprintf(msg, "%s discards %s.\n", p_ptr->name, c_ptr->d_ptr->name);
+			sprintf(msg, "%s discards %s.\n", p_ptr->name, library[c_ptr->d_idx].name);
 
 			/* Send message */
 			g->p[who].control->private_message(g, who, msg, FORMAT_DISCARD);
@@ -1787,7 +2458,7 @@ void discard_produce_chosen(game *g, int who, int world, int discard,
 
 		/* Format message */
 		sprintf(msg, "%s discards to produce on %s.\n", p_ptr->name,
-		        c_ptr->d_ptr->name);
+		        library[c_ptr->d_idx].name);
 
 		/* Send message */
 		message_add(g, msg);
@@ -1933,7 +2604,7 @@ int search_match(game *g, int which, int category)
 	c_ptr = &g->deck[which];
 
 	/* Get card design */
-	d_ptr = c_ptr->d_ptr;
+	d_ptr = &library[c_ptr->d_idx];
 
 	/* Switch on category */
 	switch (category)
@@ -2160,7 +2831,7 @@ void phase_search(game *g)
 		second = third = 0;
 
 		/* Message */
-		if (!g->simulation)
+		if (show_messages(g))
 		{
 			/* Format message */
 			sprintf(msg, "%s searches for %s.\n", p_ptr->name,
@@ -2180,7 +2851,7 @@ void phase_search(game *g)
 			if (which == -1)
 			{
 				/* Message */
-				if (!g->simulation)
+				if (show_messages(g))
 				{
 					/* Format message */
 					sprintf(msg, "Search fails for %s.\n",
@@ -2192,6 +2863,7 @@ void phase_search(game *g)
 
 				/* Restore prestige/search action to player */
 				p_ptr->prestige_action_used = 0;
+				MARK_PLAYER(g, i);
 
 				/* Done */
 				break;
@@ -2210,14 +2882,14 @@ void phase_search(game *g)
 			match = search_match(g, which, category);
 
 			/* Message */
-			if (!g->simulation)
+			if (show_messages(g))
 			{
 				/* Check for match */
 				if (match)
 				{
 					/* Format message */
 					sprintf(msg, "%s reveals %s (match).\n",
-					        p_ptr->name, c_ptr->d_ptr->name);
+					        p_ptr->name, library[c_ptr->d_idx].name);
 
 					/* Send formatted message */
 					message_add_formatted(g, msg, FORMAT_PRESTIGE);
@@ -2226,7 +2898,7 @@ void phase_search(game *g)
 				{
 					/* Format message */
 					sprintf(msg, "%s reveals %s (no match).\n",
-					        p_ptr->name, c_ptr->d_ptr->name);
+					        p_ptr->name, library[c_ptr->d_idx].name);
 
 					/* Send message */
 					message_add(g, msg);
@@ -2240,7 +2912,7 @@ void phase_search(game *g)
 			if (!match) continue;
 
 			/* XXX Check for any good type and Alien category */
-			if (second && c_ptr->d_ptr->good_type == GOOD_ANY &&
+			if (second && library[c_ptr->d_idx].good_type == GOOD_ANY &&
 			    category == SEARCH_ALIEN_WORLD)
 			{
 				/* Clear second chance flag */
@@ -2265,13 +2937,13 @@ void phase_search(game *g)
 				if (!keep)
 				{
 					/* Message */
-					if (!g->simulation)
+					if (show_messages(g))
 					{
 						/* Format message */
 						sprintf(msg,
 						        "%s declines %s.\n",
 						        p_ptr->name,
-						        c_ptr->d_ptr->name);
+						        library[c_ptr->d_idx].name);
 
 						/* Send message */
 						message_add(g, msg);
@@ -2282,7 +2954,7 @@ void phase_search(game *g)
 
 					/* XXX Check for any good type */
 					if (!third &&
-					  c_ptr->d_ptr->good_type == GOOD_ANY &&
+					  library[c_ptr->d_idx].good_type == GOOD_ANY &&
 					  category == SEARCH_ALIEN_WORLD)
 					{
 						/* Clear second chance flag */
@@ -2302,11 +2974,11 @@ void phase_search(game *g)
 			c_ptr->misc |= 1 << i;
 
 			/* Message */
-			if (!g->simulation)
+			if (show_messages(g))
 			{
 				/* Format message */
 				sprintf(msg, "%s takes %s.\n", p_ptr->name,
-				        c_ptr->d_ptr->name);
+				        library[c_ptr->d_idx].name);
 
 				/* Add message */
 				message_add(g, msg);
@@ -2401,11 +3073,11 @@ void phase_explore(game *g)
 			gain_prestige(g, i, o_ptr->value, NULL);
 
 			/* Message */
-			if (!g->simulation)
+			if (show_messages(g))
 			{
 				/* Format message */
 				sprintf(msg, "%s discards to gain prestige from %s.\n",
-				        g->p[i].name, g->deck[w_list[j].c_idx].d_ptr->name);
+				        g->p[i].name, library[g->deck[w_list[j].c_idx].d_idx].name);
 
 				/* Send message */
 				message_add(g, msg);
@@ -2570,7 +3242,7 @@ void phase_explore(game *g)
 		}
 
 		/* Message */
-		if (!g->simulation)
+		if (show_messages(g))
 		{
 			/* Check for discarding any */
 			if (any[i])
@@ -2638,16 +3310,16 @@ void place_card(game *g, int who, int which)
 	c_ptr->order = p_ptr->table_order++;
 
 	/* Add a good to windfall worlds */
-	if (c_ptr->d_ptr->flags & FLAG_WINDFALL) add_good(g, which);
+	if (library[c_ptr->d_idx].flags & FLAG_WINDFALL) add_good(g, which);
 
 	/* Check for third expansion */
 	if (exp_info[g->expanded].has_prestige)
 	{
 		/* Check for prestige from card */
-		if (c_ptr->d_ptr->flags & FLAG_PRESTIGE)
+		if (library[c_ptr->d_idx].flags & FLAG_PRESTIGE)
 		{
 			/* Format reason */
-			sprintf(reason, "placing %s", c_ptr->d_ptr->name);
+			sprintf(reason, "placing %s", library[c_ptr->d_idx].name);
 
 			/* Add prestige to player */
 			gain_prestige(g, who, 1, reason);
@@ -2678,7 +3350,7 @@ int develop_needed(game *g, int who, int which, int special[], int num_special)
 	c_ptr = &g->deck[which];
 
 	/* Get card cost */
-	cost = c_ptr->d_ptr->cost;
+	cost = library[c_ptr->d_idx].cost;
 
 	/* Get list of develop powers */
 	n = get_powers(g, who, PHASE_DEVELOP, w_list);
@@ -2706,10 +3378,10 @@ int develop_needed(game *g, int who, int which, int special[], int num_special)
 		c_ptr = &g->deck[special[i]];
 
 		/* Loop over card's powers */
-		for (j = 0; j < c_ptr->d_ptr->num_power; j++)
+		for (j = 0; j < library[c_ptr->d_idx].num_power; j++)
 		{
 			/* Get power pointer */
-			o_ptr = &c_ptr->d_ptr->powers[j];
+			o_ptr = &library[c_ptr->d_idx].powers[j];
 
 			/* Skip non-Develop power */
 			if (o_ptr->phase != PHASE_DEVELOP) continue;
@@ -2758,7 +3430,7 @@ int devel_cost(game *g, int who, int which)
 	c_ptr = &g->deck[which];
 
 	/* Start with card cost */
-	cost = c_ptr->d_ptr->cost;
+	cost = library[c_ptr->d_idx].cost;
 
 	/* Check for develop action chosen */
 	if (player_chose(g, who, g->cur_action)) cost -= 1;
@@ -2817,10 +3489,10 @@ int devel_callback(game *g, int who, int which, int list[], int num,
 		c_ptr = &g->deck[special[i]];
 
 		/* Loop over card's powers */
-		for (j = 0; j < c_ptr->d_ptr->num_power; j++)
+		for (j = 0; j < library[c_ptr->d_idx].num_power; j++)
 		{
 			/* Get power pointer */
-			o_ptr = &c_ptr->d_ptr->powers[j];
+			o_ptr = &library[c_ptr->d_idx].powers[j];
 
 			/* Skip non-Develop power */
 			if (o_ptr->phase != PHASE_DEVELOP) continue;
@@ -2832,12 +3504,12 @@ int devel_callback(game *g, int who, int which, int list[], int num,
 				move_card(g, special[i], -1, WHERE_DISCARD);
 
 				/* Message */
-				if (!g->simulation)
+				if (show_messages(g))
 				{
 					/* Format message */
 					sprintf(msg, "%s discards %s.\n",
 					        p_ptr->name,
-					        c_ptr->d_ptr->name);
+					        library[c_ptr->d_idx].name);
 
 					/* Send message */
 					message_add(g, msg);
@@ -2865,7 +3537,7 @@ int devel_callback(game *g, int who, int which, int list[], int num,
 				num_consume_special = 2;
 
 				/* Message */
-				if (!g->simulation)
+				if (show_messages(g))
 				{
 					/* Format message */
 					sprintf(msg, "%s discards a Rare good to "
@@ -2911,7 +3583,7 @@ int devel_callback(game *g, int who, int which, int list[], int num,
 	}
 
 	/* Message */
-	if (!g->simulation)
+	if (show_messages(g))
 	{
 		/* Private message */
 		if (g->p[who].control->private_message)
@@ -2921,7 +3593,7 @@ int devel_callback(game *g, int who, int which, int list[], int num,
 			{
 				/* Format message */
 				sprintf(msg, "%s discards %s.\n", p_ptr->name,
-				        g->deck[list[i]].d_ptr->name);
+				        library[g->deck[list[i]].d_idx].name);
 
 				/* Send message */
 				g->p[who].control->private_message(g, who, msg, FORMAT_DISCARD);
@@ -2930,7 +3602,7 @@ int devel_callback(game *g, int who, int which, int list[], int num,
 
 		/* Format message */
 		sprintf(msg, "%s pays %d for %s.\n", p_ptr->name, num,
-		        c_ptr->d_ptr->name);
+		        library[c_ptr->d_idx].name);
 
 		/* Send message */
 		message_add(g, msg);
@@ -2991,7 +3663,7 @@ int devel_callback(game *g, int who, int which, int list[], int num,
 			move_card(g, list[0], who, WHERE_SAVED);
 
 			/* Message */
-			if (!g->simulation)
+			if (show_messages(g))
 			{
 				/* Format message */
 				sprintf(msg, "%s saves 1 card under Galactic Scavengers.\n",
@@ -3005,7 +3677,7 @@ int devel_callback(game *g, int who, int which, int list[], int num,
 				{
 					/* Format message */
 					sprintf(msg, "%s saves %s.\n", p_ptr->name,
-					        g->deck[list[0]].d_ptr->name);
+					        library[g->deck[list[0]].d_idx].name);
 
 					/* Send message */
 					g->p[who].control->private_message(g, who, msg,
@@ -3017,6 +3689,7 @@ int devel_callback(game *g, int who, int which, int list[], int num,
 
 	/* Card is now paid for */
 	g->deck[which].misc &= ~MISC_UNPAID;
+	MARK_CARD(g, which);
 
 	/* Payment is good */
 	return 1;
@@ -3086,11 +3759,11 @@ static void pay_devel(game *g, int who, int cost)
 	if (cost == 0 && !num_special)
 	{
 		/* Message */
-		if (!g->simulation)
+		if (show_messages(g))
 		{
 			/* Format message */
 			sprintf(msg, "%s pays 0 for %s.\n",
-			        p_ptr->name, g->deck[p_ptr->placing].d_ptr->name);
+			        p_ptr->name, library[g->deck[p_ptr->placing].d_idx].name);
 
 			/* Send message */
 			message_add(g, msg);
@@ -3125,7 +3798,7 @@ void develop_action(game *g, int who, int placing)
 	c_ptr = &g->deck[placing];
 
 	/* Get cost */
-	cost = c_ptr->d_ptr->cost;
+	cost = library[c_ptr->d_idx].cost;
 
 	/* Get list of develop powers */
 	n = get_powers(g, who, PHASE_DEVELOP, w_list);
@@ -3162,7 +3835,7 @@ void develop_action(game *g, int who, int placing)
 		o_ptr = w_list[i].o_ptr;
 
 		/* Get name of card with power */
-		name = g->deck[w_list[i].c_idx].d_ptr->name;
+		name = library[g->deck[w_list[i].c_idx].d_idx].name;
 
 		/* Check for "draw after developing" power */
 		if (o_ptr->code & P2_DRAW_AFTER)
@@ -3175,7 +3848,7 @@ void develop_action(game *g, int who, int placing)
 		if (o_ptr->code & P2_PRESTIGE_REBEL)
 		{
 			/* Check for Rebel flag on played card */
-			if (c_ptr->d_ptr->flags & FLAG_REBEL)
+			if (library[c_ptr->d_idx].flags & FLAG_REBEL)
 			{
 				/* Reward prestige */
 				gain_prestige(g, who, o_ptr->value, name);
@@ -3186,7 +3859,7 @@ void develop_action(game *g, int who, int placing)
 		if (o_ptr->code & P2_PRESTIGE_SIX)
 		{
 			/* Check for six-cost development */
-			if (c_ptr->d_ptr->cost == 6)
+			if (library[c_ptr->d_idx].cost == 6)
 			{
 				/* Reward prestige */
 				gain_prestige(g, who, o_ptr->value, name);
@@ -3298,7 +3971,7 @@ void phase_develop(game *g)
 			o_ptr = w_list[j].o_ptr;
 
 			/* Get name of card with power */
-			name = g->deck[w_list[j].c_idx].d_ptr->name;
+			name = library[g->deck[w_list[j].c_idx].d_idx].name;
 
 			/* Check for draw */
 			if (o_ptr->code & P2_DRAW)
@@ -3331,7 +4004,7 @@ void phase_develop(game *g)
 			player_discard(g, i, explore);
 
 			/* Message */
-			if (!g->simulation)
+			if (show_messages(g))
 			{
 				/* Format message */
 				sprintf(msg, "%s discards %d card%s.\n", g->p[i].name,
@@ -3436,13 +4109,13 @@ void phase_develop(game *g)
 			c_ptr = &g->deck[x];
 
 			/* Skip non-developments */
-			if (c_ptr->d_ptr->type != TYPE_DEVELOPMENT) continue;
+			if (library[c_ptr->d_idx].type != TYPE_DEVELOPMENT) continue;
 
 			/* Skip too-expensive cards */
-			if (c_ptr->d_ptr->cost > max) continue;
+			if (library[c_ptr->d_idx].cost > max) continue;
 
 			/* Skip duplicate card designs */
-			if (player_has(g, i, c_ptr->d_ptr)) continue;
+			if (player_has(g, i, &library[c_ptr->d_idx])) continue;
 
 			/* Add card to list */
 			list[n++] = x;
@@ -3475,7 +4148,7 @@ void phase_develop(game *g)
 		if (!asked[i])
 		{
 			/* Message */
-			if (!g->simulation)
+			if (show_messages(g))
 			{
 				/* Format message */
 				sprintf(msg, "%s does not place a development.\n",
@@ -3506,7 +4179,7 @@ void phase_develop(game *g)
 			p_ptr->skip_develop = 1;
 
 			/* Message */
-			if (!g->simulation)
+			if (show_messages(g))
 			{
 				/* Format message */
 				sprintf(msg, "%s does not place a development.\n",
@@ -3520,11 +4193,11 @@ void phase_develop(game *g)
 		}
 
 		/* Message */
-		if (!g->simulation)
+		if (show_messages(g))
 		{
 			/* Format message */
 			sprintf(msg, "%s places %s.\n", p_ptr->name,
-			        g->deck[p_ptr->placing].d_ptr->name);
+			        library[g->deck[p_ptr->placing].d_idx].name);
 
 			/* Send message */
 			message_add(g, msg);
@@ -3547,8 +4220,8 @@ void phase_develop(game *g)
 		/* Skip players who are not placing anything */
 		if (p_ptr->placing == -1) continue;
 
-		/* Check for prepare function */
-		if (p_ptr->control->prepare_phase)
+		/* Check for prepare function (not needed in fast replays) */
+		if (p_ptr->control->prepare_phase && !fast_replaying(g, i))
 		{
 			/* Ask player to prepare answers for payment */
 			p_ptr->control->prepare_phase(g, i, PHASE_DEVELOP,
@@ -3605,7 +4278,7 @@ int strength_against(game *g, int who, int world, int attack, int defend)
 	c_ptr = &g->deck[world];
 
 	/* Get world's good type */
-	good = c_ptr->d_ptr->good_type;
+	good = library[c_ptr->d_idx].good_type;
 
 	/* Get Settle phase powers */
 	n = get_powers(g, who, PHASE_SETTLE, w_list);
@@ -3635,7 +4308,7 @@ int strength_against(game *g, int who, int world, int attack, int defend)
 
 			/* Check for against rebels */
 			if ((o_ptr->code & P3_AGAINST_REBEL) &&
-			    (c_ptr->d_ptr->flags & FLAG_REBEL))
+			    (library[c_ptr->d_idx].flags & FLAG_REBEL))
 			{
 				/* Add value */
 				military += o_ptr->value;
@@ -3644,7 +4317,7 @@ int strength_against(game *g, int who, int world, int attack, int defend)
 
 			/* Check for against xeno */
 			if ((o_ptr->code & P3_XENO) &&
-			    (c_ptr->d_ptr->flags & FLAG_XENO))
+			    (library[c_ptr->d_idx].flags & FLAG_XENO))
 			{
 				/* If power requires payment, skip power */
 				if (o_ptr->code & P3_CONSUME_ALIEN) continue;
@@ -3684,10 +4357,10 @@ int strength_against(game *g, int who, int world, int attack, int defend)
 		c_ptr = &g->deck[attack];
 
 		/* Loop over powers */
-		for (i = 0; i < c_ptr->d_ptr->num_power; ++i)
+		for (i = 0; i < library[c_ptr->d_idx].num_power; ++i)
 		{
 			/* Get power */
-			o_ptr = &c_ptr->d_ptr->powers[i];
+			o_ptr = &library[c_ptr->d_idx].powers[i];
 
 			/* Skip non-Settle powers */
 			if (o_ptr->phase != PHASE_SETTLE) continue;
@@ -3707,14 +4380,14 @@ int strength_against(game *g, int who, int world, int attack, int defend)
 	if (defend)
 	{
 		/* Add cost of world */
-		military += c_ptr->d_ptr->cost;
+		military += library[c_ptr->d_idx].cost;
 	}
 
 	/* Add in bonus temporary military strength */
 	military += p_ptr->bonus_military;
 
 	/* Add in bonus temporary military strength against Xeno */
-	if (c_ptr->d_ptr->flags & FLAG_XENO)
+	if (library[c_ptr->d_idx].flags & FLAG_XENO)
 	{
 	    military += p_ptr->bonus_military_xeno;
 	}
@@ -3740,10 +4413,10 @@ int strength_first(game *g, int who, int w1, int w2)
 	c_ptr2 = &g->deck[w2];
 
 	/* Check for differing good types */
-	if (c_ptr1->d_ptr->good_type != c_ptr2->d_ptr->good_type)
+	if (library[c_ptr1->d_idx].good_type != library[c_ptr2->d_idx].good_type)
 	{
 		/* Use good type */
-		good = c_ptr1->d_ptr->good_type;
+		good = library[c_ptr1->d_idx].good_type;
 	}
 	else
 	{
@@ -3776,8 +4449,8 @@ int strength_first(game *g, int who, int w1, int w2)
 
 			/* Check for against rebels */
 			if ((o_ptr->code & P3_AGAINST_REBEL) &&
-			    (c_ptr1->d_ptr->flags & FLAG_REBEL) &&
-			    !(c_ptr2->d_ptr->flags & FLAG_REBEL))
+			    (library[c_ptr1->d_idx].flags & FLAG_REBEL) &&
+			    !(library[c_ptr2->d_idx].flags & FLAG_REBEL))
 			{
 				/* Add value */
 				military += o_ptr->value;
@@ -3817,16 +4490,16 @@ int settle_legal(game *g, int who, int world, int mil_bonus, int mil_only,
 	n = get_powers(g, who, PHASE_SETTLE, w_list);
 
 	/* Get initial cost/defense */
-	cost = defense = c_ptr->d_ptr->cost;
+	cost = defense = library[c_ptr->d_idx].cost;
 
 	/* Check for military world */
-	conquer = c_ptr->d_ptr->flags & FLAG_MILITARY;
+	conquer = library[c_ptr->d_idx].flags & FLAG_MILITARY;
 
 	/* Get good type of world to be settled (if any) */
-	good = c_ptr->d_ptr->good_type;
+	good = library[c_ptr->d_idx].good_type;
 
 	/* Check for Xeno world */
-	xeno_world = c_ptr->d_ptr->flags & FLAG_XENO;
+	xeno_world = library[c_ptr->d_idx].flags & FLAG_XENO;
 
 	/* Start with basic military strength */
 	military = total_military(g, who);
@@ -3922,7 +4595,7 @@ int settle_legal(game *g, int who, int world, int mil_bonus, int mil_only,
 
 			/* Check for against rebels */
 			if ((o_ptr->code & P3_AGAINST_REBEL) &&
-			    !(c_ptr->d_ptr->flags & FLAG_REBEL))
+			    !(library[c_ptr->d_idx].flags & FLAG_REBEL))
 			{
 				/* Skip power */
 				continue;
@@ -4040,7 +4713,7 @@ int settle_legal(game *g, int who, int world, int mil_bonus, int mil_only,
 
 			/* Check for against rebels */
 			if ((o_ptr->code & P3_AGAINST_REBEL) &&
-			    !(c_ptr->d_ptr->flags & FLAG_REBEL))
+			    !(library[c_ptr->d_idx].flags & FLAG_REBEL))
 			{
 				/* Skip power */
 				continue;
@@ -4048,7 +4721,7 @@ int settle_legal(game *g, int who, int world, int mil_bonus, int mil_only,
 
 			/* Check for against chromo */
 			if ((o_ptr->code & P3_AGAINST_CHROMO) &&
-			    !(c_ptr->d_ptr->flags & FLAG_CHROMO))
+			    !(library[c_ptr->d_idx].flags & FLAG_CHROMO))
 			{
 				/* Skip power */
 				continue;
@@ -4187,13 +4860,13 @@ int settle_needed(game *g, int who, int which, int special[], int num_special,
 	takeover = (t_ptr->owner != who);
 
 	/* Get card cost */
-	cost = t_ptr->d_ptr->cost;
+	cost = library[t_ptr->d_idx].cost;
 
 	/* Get card's good type */
-	good = t_ptr->d_ptr->good_type;
+	good = library[t_ptr->d_idx].good_type;
 
 	/* Check for military world */
-	conquer = t_ptr->d_ptr->flags & FLAG_MILITARY;
+	conquer = library[t_ptr->d_idx].flags & FLAG_MILITARY;
 
 	/* Count basic military strength */
 	military = total_military(g, who);
@@ -4202,7 +4875,7 @@ int settle_needed(game *g, int who, int which, int special[], int num_special,
 	military += p_ptr->bonus_military + mil_bonus;
 
 	/* Add Xeno specific bonuses from earlier in the phase */
-	if (t_ptr->d_ptr->flags & FLAG_XENO) military += p_ptr->bonus_military_xeno;
+	if (library[t_ptr->d_idx].flags & FLAG_XENO) military += p_ptr->bonus_military_xeno;
 
 	/* Reduce cost by bonus reductions from earlier in the phase */
 	cost -= p_ptr->bonus_reduce;
@@ -4220,10 +4893,10 @@ int settle_needed(game *g, int who, int which, int special[], int num_special,
 		c_ptr = &g->deck[special[i]];
 
 		/* Loop over card's powers */
-		for (j = 0; j < c_ptr->d_ptr->num_power; j++)
+		for (j = 0; j < library[c_ptr->d_idx].num_power; j++)
 		{
 			/* Get power pointer */
-			o_ptr = &c_ptr->d_ptr->powers[j];
+			o_ptr = &library[c_ptr->d_idx].powers[j];
 
 			/* Skip non-settle phase power */
 			if (o_ptr->phase != PHASE_SETTLE) continue;
@@ -4235,7 +4908,7 @@ int settle_needed(game *g, int who, int which, int special[], int num_special,
 				if (pay_military) return -1;
 
 				/* Check for non-Xeno world */
-				if (t_ptr->d_ptr->flags & FLAG_XENO) return -1;
+				if (library[t_ptr->d_idx].flags & FLAG_XENO) return -1;
 
 				/* Check for correct alien-ness */
 				if (((o_ptr->code & P3_ALIEN) &&
@@ -4247,11 +4920,11 @@ int settle_needed(game *g, int who, int which, int special[], int num_special,
 
 				/* Check for correct chromo */
 				if ((o_ptr->code & P3_AGAINST_CHROMO) &&
-				    !(t_ptr->d_ptr->flags & FLAG_CHROMO)) return -1;
+				    !(library[t_ptr->d_idx].flags & FLAG_CHROMO)) return -1;
 
 				/* Check for correct rebel */
 				if ((o_ptr->code & P3_AGAINST_REBEL) &&
-				    !(t_ptr->d_ptr->flags & FLAG_REBEL)) return -1;
+				    !(library[t_ptr->d_idx].flags & FLAG_REBEL)) return -1;
 
 				/* Mark ability */
 				pay_military = 1;
@@ -4362,7 +5035,7 @@ int settle_needed(game *g, int who, int which, int special[], int num_special,
 				/* Check Xeno specific military */
 				if (o_ptr->code & P3_XENO)
 				{
-					if (t_ptr->d_ptr->flags & FLAG_XENO)
+					if (library[t_ptr->d_idx].flags & FLAG_XENO)
 					{
 						/* Add extra military */
 						military += o_ptr->value;
@@ -4479,7 +5152,7 @@ int settle_needed(game *g, int who, int which, int special[], int num_special,
 
 			/* Check for against rebels */
 			if ((o_ptr->code & P3_AGAINST_REBEL) &&
-			    !(t_ptr->d_ptr->flags & FLAG_REBEL))
+			    !(library[t_ptr->d_idx].flags & FLAG_REBEL))
 			{
 				/* Skip power */
 				continue;
@@ -4487,7 +5160,7 @@ int settle_needed(game *g, int who, int which, int special[], int num_special,
 
 			/* Check for against Xeno */
 			if ((o_ptr->code & P3_XENO) &&
-			    !(t_ptr->d_ptr->flags & FLAG_XENO))
+			    !(library[t_ptr->d_idx].flags & FLAG_XENO))
 			{
 				/* Skip power */
 				continue;
@@ -4521,7 +5194,7 @@ int settle_needed(game *g, int who, int which, int special[], int num_special,
 
 	/* Check for insufficient military strength (except for takeovers) */
 	if (!takeover && conquer && !pay_military &&
-	    military + hand_military < t_ptr->d_ptr->cost)
+	    military + hand_military < library[t_ptr->d_idx].cost)
 	{
 		/* Illegal payment */
 		return -1;
@@ -4549,10 +5222,10 @@ int settle_needed(game *g, int who, int which, int special[], int num_special,
 	}
 
 	/* Check for extra military needed */
-	if (!takeover && t_ptr->d_ptr->cost > military)
+	if (!takeover && library[t_ptr->d_idx].cost > military)
 	{
 		/* Return amount of extra military needed */
-		return t_ptr->d_ptr->cost - military;
+		return library[t_ptr->d_idx].cost - military;
 	}
 
 	/* No cards needed */
@@ -4595,13 +5268,13 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 	takeover = (t_ptr->owner != who);
 
 	/* Get card cost */
-	cost = t_ptr->d_ptr->cost;
+	cost = library[t_ptr->d_idx].cost;
 
 	/* Get card's good type */
-	good = t_ptr->d_ptr->good_type;
+	good = library[t_ptr->d_idx].good_type;
 
 	/* Check for military world */
-	conquer = t_ptr->d_ptr->flags & FLAG_MILITARY;
+	conquer = library[t_ptr->d_idx].flags & FLAG_MILITARY;
 
 	/* Count basic military strength */
 	military = total_military(g, who);
@@ -4610,7 +5283,7 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 	military += p_ptr->bonus_military + mil_bonus;
 
 	/* Add Xeno specific bonuses from earlier in the phase */
-	if (t_ptr->d_ptr->flags & FLAG_XENO) military += p_ptr->bonus_military_xeno;
+	if (library[t_ptr->d_idx].flags & FLAG_XENO) military += p_ptr->bonus_military_xeno;
 
 	/* Reduce cost by bonus reductions from earlier in the phase */
 	cost -= p_ptr->bonus_reduce;
@@ -4628,10 +5301,10 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 		c_ptr = &g->deck[special[i]];
 
 		/* Loop over card's powers */
-		for (j = 0; j < c_ptr->d_ptr->num_power; j++)
+		for (j = 0; j < library[c_ptr->d_idx].num_power; j++)
 		{
 			/* Get power pointer */
-			o_ptr = &c_ptr->d_ptr->powers[j];
+			o_ptr = &library[c_ptr->d_idx].powers[j];
 
 			/* Skip non-settle phase power */
 			if (o_ptr->phase != PHASE_SETTLE) continue;
@@ -4643,7 +5316,7 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 				if (pay_military) return 0;
 
 				/* Check for non-Xeno world */
-				if (t_ptr->d_ptr->flags & FLAG_XENO) return 0;
+				if (library[t_ptr->d_idx].flags & FLAG_XENO) return 0;
 
 				/* Check for correct alien-ness */
 				if ((o_ptr->code & P3_ALIEN) &&
@@ -4655,11 +5328,11 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 
 				/* Check for correct chromo */
 				if ((o_ptr->code & P3_AGAINST_CHROMO) &&
-				    !(t_ptr->d_ptr->flags & FLAG_CHROMO)) return 0;
+				    !(library[t_ptr->d_idx].flags & FLAG_CHROMO)) return 0;
 
 				/* Check for correct rebel */
 				if ((o_ptr->code & P3_AGAINST_REBEL) &&
-				    !(t_ptr->d_ptr->flags & FLAG_REBEL)) return 0;
+				    !(library[t_ptr->d_idx].flags & FLAG_REBEL)) return 0;
 
 				/* Mark ability */
 				pay_military = 1;
@@ -4671,11 +5344,11 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 				if (cost < 0) cost = 0;
 
 				/* Message */
-				if (!g->simulation)
+				if (show_messages(g))
 				{
 					/* Format message */
 					sprintf(msg, "%s uses %s.\n", p_ptr->name,
-					                              c_ptr->d_ptr->name);
+					                              library[c_ptr->d_idx].name);
 
 					/* Send message */
 					message_add(g, msg);
@@ -4689,11 +5362,11 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 				move_card(g, special[i], -1, WHERE_DISCARD);
 
 				/* Message */
-				if (!g->simulation)
+				if (show_messages(g))
 				{
 					/* Format message */
 					sprintf(msg, "%s discards %s.\n", p_ptr->name,
-					                                  c_ptr->d_ptr->name);
+					                                  library[c_ptr->d_idx].name);
 
 					/* Send message */
 					message_add(g, msg);
@@ -4721,6 +5394,7 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 
 					/* Remember bonus for later */
 					p_ptr->bonus_military += o_ptr->value;
+					MARK_PLAYER(g, who);
 				}
 
 				/* Check for conquer peaceful world */
@@ -4740,7 +5414,7 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 					    !takeover)
 					{
 						/* Award prestige */
-						gain_prestige(g, who, 2, c_ptr->d_ptr->name);
+						gain_prestige(g, who, 2, library[c_ptr->d_idx].name);
 					}
 				}
 
@@ -4763,6 +5437,7 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 
 				/* Mark power as used */
 				c_ptr->misc |= 1 << (MISC_USED_SHIFT + j);
+				MARK_CARD(g, special[i]);
 
 				/* Assume cards are for military strength */
 				hand_military += o_ptr->value;
@@ -4774,6 +5449,7 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 			{
 				/* Mark power as used */
 				c_ptr->misc |= 1 << (MISC_USED_SHIFT + j);
+				MARK_CARD(g, special[i]);
 
 				/* Remember power is used */
 				consume_reduce++;
@@ -4789,9 +5465,10 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 
 				/* Remember discount for later settles */
 				p_ptr->bonus_reduce += o_ptr->value;
+				MARK_PLAYER(g, who);
 
 				/* Message */
-				if (!g->simulation)
+				if (show_messages(g))
 				{
 					/* Format message */
 					sprintf(msg, "%s discards a Genes good to "
@@ -4807,6 +5484,7 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 			{
 				/* Mark power as used */
 				c_ptr->misc |= 1 << (MISC_USED_SHIFT + j);
+				MARK_CARD(g, special[i]);
 
 				/* Ask for goods to consume later */
 				consume_military++;
@@ -4816,9 +5494,10 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 
 				/* Remember bonus for later */
 				p_ptr->bonus_military += o_ptr->value;
+				MARK_PLAYER(g, who);
 
 				/* Message */
-				if (!g->simulation)
+				if (show_messages(g))
 				{
 					/* Format message */
 					sprintf(msg, "%s discards a Novelty good for "
@@ -4837,6 +5516,7 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 			{
 				/* Mark power as used */
 				c_ptr->misc |= 1 << (MISC_USED_SHIFT + j);
+				MARK_CARD(g, special[i]);
 
 				/* Ask for goods to consume later */
 				consume_military++;
@@ -4846,9 +5526,10 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 
 				/* Remember bonus for later */
 				p_ptr->bonus_military += o_ptr->value;
+				MARK_PLAYER(g, who);
 
 				/* Message */
-				if (!g->simulation)
+				if (show_messages(g))
 				{
 					/* Format message */
 					sprintf(msg, "%s discards a Rare good for "
@@ -4867,6 +5548,7 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 			{
 				/* Mark power as used */
 				c_ptr->misc |= 1 << (MISC_USED_SHIFT + j);
+				MARK_CARD(g, special[i]);
 
 				/* Ask for goods to consume later */
 				consume_military++;
@@ -4876,7 +5558,7 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 
 				if (o_ptr->code & P3_XENO)
 				{
-					if (t_ptr->d_ptr->flags & FLAG_XENO)
+					if (library[t_ptr->d_idx].flags & FLAG_XENO)
 					{
 						/* Add extra military */
 						military += o_ptr->value;
@@ -4884,6 +5566,7 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 
 					/* Remember bonus for later */
 					p_ptr->bonus_military_xeno += o_ptr->value;
+					MARK_PLAYER(g, who);
 
 					/* Remember that power applies against Xenos */
 					against_xeno = 1;
@@ -4895,10 +5578,11 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 
 					/* Remember bonus for later */
 					p_ptr->bonus_military += o_ptr->value;
+					MARK_PLAYER(g, who);
 				}
 
 				/* Message */
-				if (!g->simulation)
+				if (show_messages(g))
 				{
 					/* Format message */
 					sprintf(msg, "%s discards an Alien good for "
@@ -4918,6 +5602,7 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 			{
 				/* Mark power as used */
 				c_ptr->misc |= 1 << (MISC_USED_SHIFT + j);
+				MARK_CARD(g, special[i]);
 
 				/* Spend prestige */
 				spend_prestige(g, who, 1);
@@ -4927,9 +5612,10 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 
 				/* Remember bonus for later */
 				p_ptr->bonus_military += o_ptr->value;
+				MARK_PLAYER(g, who);
 
 				/* Message */
-				if (!g->simulation)
+				if (show_messages(g))
 				{
 					/* Format message */
 					sprintf(msg, "%s spends prestige for "
@@ -4953,6 +5639,7 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 
 		/* Remember bonus military for later */
 		p_ptr->bonus_military += num;
+		MARK_PLAYER(g, who);
 
 		/* Remember amount of partially used hand military */
 		p_ptr->hand_military_spent = hand_military_given;
@@ -4996,7 +5683,7 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 		o_ptr = w_list[i].o_ptr;
 
 		/* Get name of card with power */
-		name = g->deck[w_list[i].c_idx].d_ptr->name;
+		name = library[g->deck[w_list[i].c_idx].d_idx].name;
 
 		/* Check for reduce cost power */
 		if (o_ptr->code & P3_REDUCE)
@@ -5049,7 +5736,7 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 
 			/* Check for against rebels */
 			if ((o_ptr->code & P3_AGAINST_REBEL) &&
-			    !(t_ptr->d_ptr->flags & FLAG_REBEL))
+			    !(library[t_ptr->d_idx].flags & FLAG_REBEL))
 			{
 				/* Skip power */
 				continue;
@@ -5057,7 +5744,7 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 
 			/* Check for against Xeno */
 			if ((o_ptr->code & P3_XENO) &&
-			    !(t_ptr->d_ptr->flags & FLAG_XENO))
+			    !(library[t_ptr->d_idx].flags & FLAG_XENO))
 			{
 				/* Skip power */
 				continue;
@@ -5098,7 +5785,7 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 
 	/* Check for insufficient military strength (except for takeovers) */
 	if (!takeover && conquer && !pay_military &&
-	    military + hand_military < t_ptr->d_ptr->cost)
+	    military + hand_military < library[t_ptr->d_idx].cost)
 	{
 		/* Illegal payment */
 		return 0;
@@ -5155,10 +5842,10 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 		c_ptr = &g->deck[special[i]];
 
 		/* Loop over card's powers */
-		for (j = 0; j < c_ptr->d_ptr->num_power; j++)
+		for (j = 0; j < library[c_ptr->d_idx].num_power; j++)
 		{
 			/* Get power pointer */
-			o_ptr = &c_ptr->d_ptr->powers[j];
+			o_ptr = &library[c_ptr->d_idx].powers[j];
 
 			/* Skip non-settle phase power */
 			if (o_ptr->phase != PHASE_SETTLE) continue;
@@ -5222,7 +5909,7 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 
 	/* Track military spent */
 	if (conquer && !pay_military)
-		p_ptr->military_spent += t_ptr->d_ptr->cost;
+		p_ptr->military_spent += library[t_ptr->d_idx].cost;
 
 	/* Loop over cards chosen as payment */
 	for (i = 0; i < num; i++)
@@ -5236,11 +5923,11 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 		}
 
 		/* Private message */
-		if (!g->simulation && g->p[who].control->private_message)
+		if (show_messages(g) && g->p[who].control->private_message)
 		{
 			/* Format message */
 			sprintf(msg, "%s discards %s.\n", p_ptr->name,
-			        g->deck[list[i]].d_ptr->name);
+			        library[g->deck[list[i]].d_idx].name);
 
 			/* Send message */
 			g->p[who].control->private_message(g, who, msg, FORMAT_DISCARD);
@@ -5258,7 +5945,7 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 	if (i < p_ptr->low_hand) p_ptr->low_hand = i;
 
 	/* Message */
-	if (!g->simulation)
+	if (show_messages(g))
 	{
 		/* Check for takeover attempt and payment for extra military */
 		if (takeover && hand_military > 0)
@@ -5280,14 +5967,14 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 		{
 			/* Format message */
 			sprintf(msg, "%s pays %d to conquer %s.\n",
-			              p_ptr->name, num, t_ptr->d_ptr->name);
+			              p_ptr->name, num, library[t_ptr->d_idx].name);
 		}
 
 		/* Check for normal conquer */
 		else if (conquer && !pay_military)
 		{
 			/* Format message */
-			sprintf(msg, "%s conquers %s.\n", p_ptr->name, t_ptr->d_ptr->name);
+			sprintf(msg, "%s conquers %s.\n", p_ptr->name, library[t_ptr->d_idx].name);
 		}
 
 		/* Check for payment */
@@ -5306,7 +5993,7 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 
 			/* Format message */
 			sprintf(msg, "%s pays %d for %s.\n", p_ptr->name, num,
-			                                     t_ptr->d_ptr->name);
+			                                     library[t_ptr->d_idx].name);
 		}
 
 		/* Send message */
@@ -5346,7 +6033,7 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 			move_card(g, list[0], who, WHERE_SAVED);
 
 			/* Message */
-			if (!g->simulation)
+			if (show_messages(g))
 			{
 				/* Format message */
 				sprintf(msg, "%s saves 1 card under Galactic Scavengers.\n",
@@ -5360,7 +6047,7 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 				{
 					/* Format message */
 					sprintf(msg, "%s saves %s.\n", p_ptr->name,
-					        g->deck[list[0]].d_ptr->name);
+					        library[g->deck[list[0]].d_idx].name);
 
 					/* Send message */
 					g->p[who].control->private_message(g, who, msg,
@@ -5372,6 +6059,7 @@ int settle_callback(game *g, int who, int which, int list[], int num,
 
 	/* Card is now paid for */
 	g->deck[which].misc &= ~MISC_UNPAID;
+	MARK_CARD(g, which);
 
 	/* Payment is good */
 	return 1;
@@ -5406,16 +6094,16 @@ static void pay_settle(game *g, int who, int world, int mil_only, int mil_bonus)
 	takeover = (c_ptr->owner != who);
 
 	/* Set flag if world is conquerable */
-	conquer = (c_ptr->d_ptr->flags & FLAG_MILITARY) > 0;
+	conquer = (library[c_ptr->d_idx].flags & FLAG_MILITARY) > 0;
 
 	/* Get good type of world to be settled (if any) */
-	good = c_ptr->d_ptr->good_type;
+	good = library[c_ptr->d_idx].good_type;
 
 	/* Get cost or defense of world */
-	cost = c_ptr->d_ptr->cost;
+	cost = library[c_ptr->d_idx].cost;
 
 	/* Get flags for world to be settled */
-	flags = c_ptr->d_ptr->flags;
+	flags = library[c_ptr->d_idx].flags;
 
 	/* Count basic military strength */
 	military = total_military(g, who) + mil_bonus;
@@ -5446,7 +6134,7 @@ static void pay_settle(game *g, int who, int world, int mil_only, int mil_bonus)
 
 			/* Check for against rebels */
 			if ((o_ptr->code & P3_AGAINST_REBEL) &&
-			    !(c_ptr->d_ptr->flags & FLAG_REBEL))
+			    !(library[c_ptr->d_idx].flags & FLAG_REBEL))
 			{
 				/* Skip power */
 				continue;
@@ -5454,7 +6142,7 @@ static void pay_settle(game *g, int who, int world, int mil_only, int mil_bonus)
 
 			/* Check for against Xeno */
 			if ((o_ptr->code & P3_XENO) && !(o_ptr->code & P3_CONSUME_ALIEN) &&
-			     !(c_ptr->d_ptr->flags & FLAG_XENO))
+			     !(library[c_ptr->d_idx].flags & FLAG_XENO))
 			{
 				/* Skip power */
 				continue;
@@ -5532,7 +6220,7 @@ static void pay_settle(game *g, int who, int world, int mil_only, int mil_bonus)
 		    (o_ptr->code & P3_PAY_MILITARY))
 		{
 			/* Check for Xeno flag */
-			if (c_ptr->d_ptr->flags & FLAG_XENO)
+			if (library[c_ptr->d_idx].flags & FLAG_XENO)
 			{
 				/* Cannot pay for world */
 				continue;
@@ -5617,11 +6305,11 @@ static void pay_settle(game *g, int who, int world, int mil_only, int mil_bonus)
 		p_ptr->military_spent += cost;
 
 		/* Message */
-		if (!g->simulation)
+		if (show_messages(g))
 		{
 			/* Format message */
 			sprintf(msg, "%s conquers %s.\n", p_ptr->name,
-			                                  c_ptr->d_ptr->name);
+			                                  library[c_ptr->d_idx].name);
 
 			/* Send message */
 			message_add(g, msg);
@@ -5691,16 +6379,16 @@ int takeover_callback(game *g, int special, int world)
 	owner = c_ptr->owner;
 
 	/* Check for target world having rebel flag */
-	rebel = c_ptr->d_ptr->flags & FLAG_REBEL;
+	rebel = library[c_ptr->d_idx].flags & FLAG_REBEL;
 
 	/* Get special card */
 	c_ptr = &g->deck[special];
 
 	/* Loop over powers */
-	for (i = 0; i < c_ptr->d_ptr->num_power; i++)
+	for (i = 0; i < library[c_ptr->d_idx].num_power; i++)
 	{
 		/* Get power pointer */
-		o_ptr = &c_ptr->d_ptr->powers[i];
+		o_ptr = &library[c_ptr->d_idx].powers[i];
 
 		/* Skip non-Settle powers */
 		if (o_ptr->phase != PHASE_SETTLE) continue;
@@ -5725,6 +6413,7 @@ int takeover_callback(game *g, int special, int world)
 		{
 			/* Mark power as used */
 			c_ptr->misc |= 1 << (MISC_USED_SHIFT + i);
+			MARK_CARD(g, special);
 		}
 
 		/* Check for takeover rebel power */
@@ -5755,11 +6444,11 @@ int takeover_callback(game *g, int special, int world)
 			spend_prestige(g, c_ptr->owner, 1);
 
 			/* Message */
-			if (!g->simulation)
+			if (show_messages(g))
 			{
 				/* Format message */
 				sprintf(msg, "%s spends 1 prestige on %s.\n",
-				        g->p[c_ptr->owner].name, c_ptr->d_ptr->name);
+				        g->p[c_ptr->owner].name, library[c_ptr->d_idx].name);
 
 				/* Send message */
 				message_add(g, msg);
@@ -5958,14 +6647,14 @@ int settle_check_takeover(game *g, int who, card *extra, int no_ask)
 			if (c_ptr->start_where != WHERE_ACTIVE) continue;
 
 			/* Skip developments */
-			if (c_ptr->d_ptr->type != TYPE_WORLD) continue;
+			if (library[c_ptr->d_idx].type != TYPE_WORLD) continue;
 
 			/* Skip non-military worlds unless convertable */
-			if (!(c_ptr->d_ptr->flags & FLAG_MILITARY) &&
+			if (!(library[c_ptr->d_idx].flags & FLAG_MILITARY) &&
 			    !conquer_peaceful) continue;
 
 			/* Skip non-Rebel worlds unless completely vulnerable */
-			if (!all_vuln && !(c_ptr->d_ptr->flags & FLAG_REBEL))
+			if (!all_vuln && !(library[c_ptr->d_idx].flags & FLAG_REBEL))
 				continue;
 
 			/* Check for sufficient military strength */
@@ -6005,14 +6694,14 @@ int settle_check_takeover(game *g, int who, card *extra, int no_ask)
 	c_ptr = &g->deck[special[0]];
 
 	/* Message */
-	if (!g->simulation)
+	if (show_messages(g))
 	{
 		/* Check for card used for extra placement */
 		if (extra)
 		{
 			/* Format message */
 			sprintf(msg, "%s uses %s to attempt to take over a world.\n",
-			        p_ptr->name, extra->d_ptr->name);
+			        p_ptr->name, library[extra->d_idx].name);
 
 			/* Add message */
 			message_add(g, msg);
@@ -6020,8 +6709,8 @@ int settle_check_takeover(game *g, int who, card *extra, int no_ask)
 
 		/* Format message */
 		sprintf(msg, "%s uses %s to attempt takeover of %s.\n",
-		        p_ptr->name, c_ptr->d_ptr->name,
-		        g->deck[target].d_ptr->name);
+		        p_ptr->name, library[c_ptr->d_idx].name,
+		        library[g->deck[target].d_idx].name);
 
 		/* Send message */
 		message_add_formatted(g, msg, FORMAT_TAKEOVER);
@@ -6046,28 +6735,28 @@ static int upgrade_legal(game *g, int replacement, int old)
 	b_ptr = &g->deck[replacement];
 
 	/* Ensure both cards are worlds */
-	if (c_ptr->d_ptr->type != TYPE_WORLD) return 0;
-	if (b_ptr->d_ptr->type != TYPE_WORLD) return 0;
+	if (library[c_ptr->d_idx].type != TYPE_WORLD) return 0;
+	if (library[b_ptr->d_idx].type != TYPE_WORLD) return 0;
 
 	/* Ensure both cards are non-military */
-	if (c_ptr->d_ptr->flags & FLAG_MILITARY) return 0;
-	if (b_ptr->d_ptr->flags & FLAG_MILITARY) return 0;
+	if (library[c_ptr->d_idx].flags & FLAG_MILITARY) return 0;
+	if (library[b_ptr->d_idx].flags & FLAG_MILITARY) return 0;
 
 	/* Check for illegal types */
-	if (c_ptr->d_ptr->good_type != GOOD_ANY &&
-	    b_ptr->d_ptr->good_type != GOOD_ANY &&
-	    (c_ptr->d_ptr->good_type != b_ptr->d_ptr->good_type)) return 0;
+	if (library[c_ptr->d_idx].good_type != GOOD_ANY &&
+	    library[b_ptr->d_idx].good_type != GOOD_ANY &&
+	    (library[c_ptr->d_idx].good_type != library[b_ptr->d_idx].good_type)) return 0;
 
 	/* Worlds without goods can't match "any" */
-	if ((!c_ptr->d_ptr->good_type ||
-	     !b_ptr->d_ptr->good_type) &&
-	    (c_ptr->d_ptr->good_type != b_ptr->d_ptr->good_type)) return 0;
+	if ((!library[c_ptr->d_idx].good_type ||
+	     !library[b_ptr->d_idx].good_type) &&
+	    (library[c_ptr->d_idx].good_type != library[b_ptr->d_idx].good_type)) return 0;
 
 	/* Check for card in hand too cheap */
-	if (b_ptr->d_ptr->cost < c_ptr->d_ptr->cost) return 0;
+	if (library[b_ptr->d_idx].cost < library[c_ptr->d_idx].cost) return 0;
 
 	/* Check for card in hand too expensive */
-	if (b_ptr->d_ptr->cost > c_ptr->d_ptr->cost + 3) return 0;
+	if (library[b_ptr->d_idx].cost > library[c_ptr->d_idx].cost + 3) return 0;
 
 	/* Upgrade is legal */
 	return 1;
@@ -6096,11 +6785,11 @@ int upgrade_chosen(game *g, int who, int replacement, int old)
 	if (!upgrade_legal(g, replacement, old)) return 0;
 
 	/* Message */
-	if (!g->simulation)
+	if (show_messages(g))
 	{
 		/* Format message */
 		sprintf(msg, "%s uses Terraforming Engineers to replace %s with %s.\n",
-		        p_ptr->name, c_ptr->d_ptr->name, b_ptr->d_ptr->name);
+		        p_ptr->name, library[c_ptr->d_idx].name, library[b_ptr->d_idx].name);
 
 		/* Send message */
 		message_add(g, msg);
@@ -6125,10 +6814,11 @@ int upgrade_chosen(game *g, int who, int replacement, int old)
 
 		/* No more goods */
 		c_ptr->num_goods = 0;
+		MARK_CARD(g, old);
 	}
 
 	/* Check for cards saved underneath world */
-	if (c_ptr->d_ptr->flags & FLAG_START_SAVE)
+	if (library[c_ptr->d_idx].flags & FLAG_START_SAVE)
 	{
 		/* Loop over cards in deck */
 		for (i = 0; i < g->deck_size; i++)
@@ -6177,10 +6867,10 @@ static int upgrade_available(game *g, int who)
 		c_ptr = &g->deck[x];
 
 		/* Skip non-worlds */
-		if (c_ptr->d_ptr->type != TYPE_WORLD) continue;
+		if (library[c_ptr->d_idx].type != TYPE_WORLD) continue;
 
 		/* Skip military worlds */
-		if (c_ptr->d_ptr->flags & FLAG_MILITARY) continue;
+		if (library[c_ptr->d_idx].flags & FLAG_MILITARY) continue;
 
 		/* Start at first active card */
 		y = g->p[who].head[WHERE_ACTIVE];
@@ -6195,10 +6885,10 @@ static int upgrade_available(game *g, int who)
 			if (b_ptr->start_where != WHERE_ACTIVE) continue;
 
 			/* Skip non-worlds */
-			if (b_ptr->d_ptr->type != TYPE_WORLD) continue;
+			if (library[b_ptr->d_idx].type != TYPE_WORLD) continue;
 
 			/* Skip military worlds */
-			if (b_ptr->d_ptr->flags & FLAG_MILITARY) continue;
+			if (library[b_ptr->d_idx].flags & FLAG_MILITARY) continue;
 
 			/* Check for legal upgrade */
 			if (upgrade_legal(g, x, y))
@@ -6237,10 +6927,10 @@ static int upgrade_world(game *g, int who)
 		c_ptr = &g->deck[x];
 
 		/* Skip non-worlds */
-		if (c_ptr->d_ptr->type != TYPE_WORLD) continue;
+		if (library[c_ptr->d_idx].type != TYPE_WORLD) continue;
 
 		/* Skip military worlds */
-		if (c_ptr->d_ptr->flags & FLAG_MILITARY) continue;
+		if (library[c_ptr->d_idx].flags & FLAG_MILITARY) continue;
 
 		/* Start at first active card */
 		y = g->p[who].head[WHERE_ACTIVE];
@@ -6255,10 +6945,10 @@ static int upgrade_world(game *g, int who)
 			if (b_ptr->start_where != WHERE_ACTIVE) continue;
 
 			/* Skip non-worlds */
-			if (b_ptr->d_ptr->type != TYPE_WORLD) continue;
+			if (library[b_ptr->d_idx].type != TYPE_WORLD) continue;
 
 			/* Skip military worlds */
-			if (b_ptr->d_ptr->flags & FLAG_MILITARY) continue;
+			if (library[b_ptr->d_idx].flags & FLAG_MILITARY) continue;
 
 			/* Check for legal upgrade */
 			if (upgrade_legal(g, x, y))
@@ -6335,7 +7025,7 @@ static void settle_bonus(game *g, int who, int world, int takeover,
 	c_ptr = &g->deck[world];
 
 	/* Check for "discard to produce on placement" flag */
-	if (c_ptr->d_ptr->flags & FLAG_DISCARD_PRODUCE)
+	if (library[c_ptr->d_idx].flags & FLAG_DISCARD_PRODUCE)
 	{
 		/* Ask player to discard */
 		discard_produce(g, who, world, -1, 0);
@@ -6355,6 +7045,7 @@ static void settle_bonus(game *g, int who, int world, int takeover,
 
 		/* Mark bonus as used */
 		p_ptr->phase_bonus_used = 1;
+		MARK_PLAYER(g, who);
 	}
 
 	/* Loop over pre-existing powers */
@@ -6364,7 +7055,7 @@ static void settle_bonus(game *g, int who, int world, int takeover,
 		o_ptr = w_list[i].o_ptr;
 
 		/* Get name of card with power */
-		name = g->deck[w_list[i].c_idx].d_ptr->name;
+		name = library[g->deck[w_list[i].c_idx].d_idx].name;
 
 		/* Check for draw power */
 		if (o_ptr->code & P3_DRAW_AFTER)
@@ -6377,8 +7068,8 @@ static void settle_bonus(game *g, int who, int world, int takeover,
 		if (o_ptr->code & P3_PRESTIGE_REBEL)
 		{
 			/* Check for rebel military world placed */
-			if ((c_ptr->d_ptr->flags & FLAG_REBEL) &&
-			    (c_ptr->d_ptr->flags & FLAG_MILITARY))
+			if ((library[c_ptr->d_idx].flags & FLAG_REBEL) &&
+			    (library[c_ptr->d_idx].flags & FLAG_MILITARY))
 			{
 				/* Award prestige */
 				gain_prestige(g, who, o_ptr->value, name);
@@ -6389,8 +7080,8 @@ static void settle_bonus(game *g, int who, int world, int takeover,
 		if (o_ptr->code & P3_PRODUCE_PRESTIGE)
 		{
 			/* Check for production world */
-			if (c_ptr->d_ptr->good_type > 0 &&
-			    !(c_ptr->d_ptr->flags & FLAG_WINDFALL))
+			if (library[c_ptr->d_idx].good_type > 0 &&
+			    !(library[c_ptr->d_idx].flags & FLAG_WINDFALL))
 			{
 				/* Award prestige */
 				gain_prestige(g, who, o_ptr->value, name);
@@ -6411,8 +7102,8 @@ static void settle_bonus(game *g, int who, int world, int takeover,
 		if (!takeover && (o_ptr->code & P3_AUTO_PRODUCE))
 		{
 			/* Check for production world placed */
-			if (c_ptr->d_ptr->good_type > 0 &&
-			    !(c_ptr->d_ptr->flags & FLAG_WINDFALL))
+			if (library[c_ptr->d_idx].good_type > 0 &&
+			    !(library[c_ptr->d_idx].flags & FLAG_WINDFALL))
 			{
 				/* Add good to world */
 				add_good(g, world);
@@ -6427,7 +7118,7 @@ static void settle_bonus(game *g, int who, int world, int takeover,
 		player_discard(g, who, explore);
 
 		/* Message */
-		if (!g->simulation)
+		if (show_messages(g))
 		{
 			/* Format message */
 			sprintf(msg, "%s discards %d card%s.\n", g->p[who].name,
@@ -6475,10 +7166,10 @@ static void flip_world(game *g, int who)
 	c_ptr = &g->deck[which];
 
 	/* Message */
-	if (!g->simulation)
+	if (show_messages(g))
 	{
 		/* Format message */
-		sprintf(msg, "%s flips %s.\n", p_ptr->name, c_ptr->d_ptr->name);
+		sprintf(msg, "%s flips %s.\n", p_ptr->name, library[c_ptr->d_idx].name);
 
 		/* Add message */
 		message_add(g, msg);
@@ -6488,8 +7179,8 @@ static void flip_world(game *g, int who)
 	if (draw_empty(g)) refresh_draw(g);
 
 	/* Check for non-military world */
-	if (c_ptr->d_ptr->type == TYPE_WORLD &&
-	    !(c_ptr->d_ptr->flags & FLAG_MILITARY))
+	if (library[c_ptr->d_idx].type == TYPE_WORLD &&
+	    !(library[c_ptr->d_idx].flags & FLAG_MILITARY))
 	{
 		/* Place world */
 		place_card(g, who, which);
@@ -6501,11 +7192,11 @@ static void flip_world(game *g, int who)
 		if (g->game_over) return;
 
 		/* Message */
-		if (!g->simulation)
+		if (show_messages(g))
 		{
 			/* Format message */
 			sprintf(msg, "%s places %s at zero cost.\n", p_ptr->name,
-			                                             c_ptr->d_ptr->name);
+			                                             library[c_ptr->d_idx].name);
 
 			/* Add message */
 			message_add(g, msg);
@@ -6513,6 +7204,7 @@ static void flip_world(game *g, int who)
 
 		/* Clear unpaid flag on placed world */
 		g->deck[which].misc &= ~MISC_UNPAID;
+		MARK_CARD(g, which);
 	}
 	else
 	{
@@ -6524,11 +7216,11 @@ static void flip_world(game *g, int who)
 		c_ptr->misc |= 1 << who;
 
 		/* Message */
-		if (!g->simulation)
+		if (show_messages(g))
 		{
 			/* Format message */
 			sprintf(msg, "%s takes %s into hand.\n", p_ptr->name,
-			                                         c_ptr->d_ptr->name);
+			                                         library[c_ptr->d_idx].name);
 
 			/* Add message */
 			message_add(g, msg);
@@ -6569,10 +7261,10 @@ void settle_finish(game *g, int who, int world, int mil_only, int special,
 		c_ptr = &g->deck[special];
 
 		/* Loop over powers on card used for extra placement */
-		for (i = 0; i < c_ptr->d_ptr->num_power; i++)
+		for (i = 0; i < library[c_ptr->d_idx].num_power; i++)
 		{
 			/* Get power pointer */
-			o_ptr = &c_ptr->d_ptr->powers[i];
+			o_ptr = &library[c_ptr->d_idx].powers[i];
 
 			/* Skip non-settle powers */
 			if (o_ptr->phase != PHASE_SETTLE) continue;
@@ -6598,13 +7290,14 @@ void settle_finish(game *g, int who, int world, int mil_only, int special,
 		{
 			/* Clear unpaid flag */
 			g->deck[world].misc &= ~MISC_UNPAID;
+			MARK_CARD(g, world);
 
 			/* Message */
-			if (!g->simulation)
+			if (show_messages(g))
 			{
 				/* Format message */
 				sprintf(msg, "%s places %s at zero cost.\n",
-				             p_ptr->name, g->deck[world].d_ptr->name);
+				             p_ptr->name, library[g->deck[world].d_idx].name);
 
 				/* Add message */
 				message_add(g, msg);
@@ -6632,11 +7325,11 @@ void settle_finish(game *g, int who, int world, int mil_only, int special,
 		move_card(g, special, -1, WHERE_DISCARD);
 
 		/* Message */
-		if (!g->simulation)
+		if (show_messages(g))
 		{
 			/* Format message */
 			sprintf(msg, "%s discards %s.\n", p_ptr->name,
-			        c_ptr->d_ptr->name);
+			        library[c_ptr->d_idx].name);
 
 			/* Send message */
 			message_add(g, msg);
@@ -6664,10 +7357,11 @@ void settle_chosen(game *g, int who, int first, int c_idx, int o_idx)
 	p_ptr = &g->p[who];
 
 	/* Get power pointer */
-	o_ptr = &g->deck[c_idx].d_ptr->powers[o_idx];
+	o_ptr = &library[g->deck[c_idx].d_idx].powers[o_idx];
 
 	/* Mark power as used */
 	g->deck[c_idx].misc |= 1 << (MISC_USED_SHIFT + o_idx);
+	MARK_CARD(g, c_idx);
 
 	/* Check for place second world power */
 	if (o_ptr->code & P3_PLACE_TWO)
@@ -6688,7 +7382,7 @@ void settle_chosen(game *g, int who, int first, int c_idx, int o_idx)
 			c_ptr = &g->deck[x];
 
 			/* Skip developments */
-			if (c_ptr->d_ptr->type != TYPE_WORLD) continue;
+			if (library[c_ptr->d_idx].type != TYPE_WORLD) continue;
 
 			/* Skip cards that cannot be settled */
 			if (!settle_legal(g, who, x, 0, 0, 0, 0)) continue;
@@ -6757,7 +7451,7 @@ void settle_chosen(game *g, int who, int first, int c_idx, int o_idx)
 			c_ptr = &g->deck[x];
 
 			/* Skip developments */
-			if (c_ptr->d_ptr->type != TYPE_WORLD) continue;
+			if (library[c_ptr->d_idx].type != TYPE_WORLD) continue;
 
 			/* Skip cards that cannot be settled */
 			if (!settle_legal(g, who, x, 0, 1, 0, 0)) continue;
@@ -6782,14 +7476,14 @@ void settle_chosen(game *g, int who, int first, int c_idx, int o_idx)
 		if (p_ptr->placing != -1)
 		{
 			/* Message */
-			if (!g->simulation)
+			if (show_messages(g))
 			{
 				/* Get card used to place world */
 				c_ptr = &g->deck[c_idx];
 
 				/* Format message */
 				sprintf(msg, "%s uses %s to place an additional world.\n",
-				        p_ptr->name, c_ptr->d_ptr->name);
+				        p_ptr->name, library[c_ptr->d_idx].name);
 
 				/* Add message */
 				message_add(g, msg);
@@ -6810,7 +7504,7 @@ void settle_chosen(game *g, int who, int first, int c_idx, int o_idx)
 	if (o_ptr->code & P3_PLACE_LEFTOVER)
 	{
 		/* Determine military spent on first world */
-		mil_spent = g->deck[first].d_ptr->cost;
+		mil_spent = library[g->deck[first].d_idx].cost;
 
 		/* Clear placing selection */
 		p_ptr->placing = -1;
@@ -6828,10 +7522,10 @@ void settle_chosen(game *g, int who, int first, int c_idx, int o_idx)
 			c_ptr = &g->deck[x];
 
 			/* Skip developments */
-			if (c_ptr->d_ptr->type != TYPE_WORLD) continue;
+			if (library[c_ptr->d_idx].type != TYPE_WORLD) continue;
 
 			/* Skip non-military worlds */
-			if (!(c_ptr->d_ptr->flags & FLAG_MILITARY)) continue;
+			if (!(library[c_ptr->d_idx].flags & FLAG_MILITARY)) continue;
 
 			/* Determine amount of military that cannot be reused */
 			mil_spent_spec = strength_first(g, who, first, x);
@@ -6866,14 +7560,14 @@ void settle_chosen(game *g, int who, int first, int c_idx, int o_idx)
 		if (p_ptr->placing != -1)
 		{
 			/* Message */
-			if (!g->simulation)
+			if (show_messages(g))
 			{
 				/* Get card used to place world */
 				c_ptr = &g->deck[c_idx];
 
 				/* Format message */
 				sprintf(msg, "%s uses %s to place an additional world.\n",
-				        p_ptr->name, c_ptr->d_ptr->name);
+				        p_ptr->name, library[c_ptr->d_idx].name);
 
 				/* Add message */
 				message_add(g, msg);
@@ -6920,10 +7614,10 @@ void settle_chosen(game *g, int who, int first, int c_idx, int o_idx)
 			c_ptr = &g->deck[x];
 
 			/* Skip developments */
-			if (c_ptr->d_ptr->type != TYPE_WORLD) continue;
+			if (library[c_ptr->d_idx].type != TYPE_WORLD) continue;
 
 			/* Skip Alien worlds */
-			if (c_ptr->d_ptr->good_type == GOOD_ALIEN) continue;
+			if (library[c_ptr->d_idx].good_type == GOOD_ALIEN) continue;
 
 			/* Skip cards that cannot be settled */
 			if (!settle_legal(g, who, x, 0, 0, 1, 0)) continue;
@@ -6951,14 +7645,14 @@ void settle_chosen(game *g, int who, int first, int c_idx, int o_idx)
 			place_card(g, who, p_ptr->placing);
 
 			/* Message */
-			if (!g->simulation)
+			if (show_messages(g))
 			{
 				/* Get card used to place world */
 				c_ptr = &g->deck[c_idx];
 
 				/* Format message */
 				sprintf(msg, "%s uses %s to place an additional world.\n",
-				        p_ptr->name, c_ptr->d_ptr->name);
+				        p_ptr->name, library[c_ptr->d_idx].name);
 
 				/* Add message */
 				message_add(g, msg);
@@ -7061,7 +7755,7 @@ static int settle_action(game *g, int who, int world)
 				c_ptr = &g->deck[x];
 
 				/* Skip developments */
-				if (c_ptr->d_ptr->type != TYPE_WORLD) continue;
+				if (library[c_ptr->d_idx].type != TYPE_WORLD) continue;
 
 				/* Skip cards that cannot be settled */
 				if (!settle_legal(g, who, x, 0, 0, 0, 0))
@@ -7093,7 +7787,7 @@ static int settle_action(game *g, int who, int world)
 				c_ptr = &g->deck[x];
 
 				/* Skip developments */
-				if (c_ptr->d_ptr->type != TYPE_WORLD) continue;
+				if (library[c_ptr->d_idx].type != TYPE_WORLD) continue;
 
 				/* Skip cards that cannot be settled */
 				if (!settle_legal(g, who, x, 0, 1, 0, 0))
@@ -7111,14 +7805,14 @@ static int settle_action(game *g, int who, int world)
 
 		/* Check for place with leftover military power */
 		if (world != -1 && p_ptr->military_spent > 0 &&
-		    (g->deck[world].d_ptr->flags & FLAG_MILITARY) &&
+		    (library[g->deck[world].d_idx].flags & FLAG_MILITARY) &&
 		    (o_ptr->code & P3_PLACE_LEFTOVER))
 		{
 			/* Check for no cards in hand */
 			if (!handsize) continue;
 
 			/* Determine military spent on first world */
-			mil_spent = g->deck[world].d_ptr->cost;
+			mil_spent = library[g->deck[world].d_idx].cost;
 
 			/* Start at first card in hand */
 			x = g->p[who].head[WHERE_HAND];
@@ -7130,10 +7824,10 @@ static int settle_action(game *g, int who, int world)
 				c_ptr = &g->deck[x];
 
 				/* Skip developments */
-				if (c_ptr->d_ptr->type != TYPE_WORLD) continue;
+				if (library[c_ptr->d_idx].type != TYPE_WORLD) continue;
 
 				/* Skip non-military worlds */
-				if (!(c_ptr->d_ptr->flags & FLAG_MILITARY))
+				if (!(library[c_ptr->d_idx].flags & FLAG_MILITARY))
 					continue;
 
 				/* Determine amount of unreusable military */
@@ -7184,14 +7878,14 @@ static int settle_action(game *g, int who, int world)
 				c_ptr = &g->deck[x];
 
 				/* Skip developments */
-				if (c_ptr->d_ptr->type != TYPE_WORLD) continue;
+				if (library[c_ptr->d_idx].type != TYPE_WORLD) continue;
 
 				/* Skip cards that cannot be settled */
 				if (!settle_legal(g, who, x, 0, 0, 1, 0))
 					continue;
 
 				/* Skip Alien worlds */
-				if (c_ptr->d_ptr->good_type == GOOD_ALIEN)
+				if (library[c_ptr->d_idx].good_type == GOOD_ALIEN)
 					continue;
 
 				/* Add power to list */
@@ -7275,10 +7969,10 @@ int defend_callback(game *g, int who, int deficit, int list[], int num,
 		c_ptr = &g->deck[special[i]];
 
 		/* Loop over card's powers */
-		for (j = 0; j < c_ptr->d_ptr->num_power; j++)
+		for (j = 0; j < library[c_ptr->d_idx].num_power; j++)
 		{
 			/* Get power pointer */
-			o_ptr = &c_ptr->d_ptr->powers[j];
+			o_ptr = &library[c_ptr->d_idx].powers[j];
 
 			/* Skip non-Settle power */
 			if (o_ptr->phase != PHASE_SETTLE) continue;
@@ -7290,12 +7984,12 @@ int defend_callback(game *g, int who, int deficit, int list[], int num,
 				move_card(g, special[i], -1, WHERE_DISCARD);
 
 				/* Message */
-				if (!g->simulation)
+				if (show_messages(g))
 				{
 					/* Format message */
 					sprintf(msg, "%s discards %s for extra military.\n",
 					        p_ptr->name,
-					        c_ptr->d_ptr->name);
+					        library[c_ptr->d_idx].name);
 
 					/* Send message */
 					message_add(g, msg);
@@ -7309,6 +8003,7 @@ int defend_callback(game *g, int who, int deficit, int list[], int num,
 
 				/* Remember bonus for later */
 				p_ptr->bonus_military += o_ptr->value;
+				MARK_PLAYER(g, who);
 			}
 
 			/* Check for hand cards for military */
@@ -7316,6 +8011,7 @@ int defend_callback(game *g, int who, int deficit, int list[], int num,
 			{
 				/* Mark power as used */
 				c_ptr->misc |= 1 << (MISC_USED_SHIFT + j);
+				MARK_CARD(g, special[i]);
 
 				/* Assume cards are for military strength */
 				hand_military += o_ptr->value;
@@ -7326,12 +8022,14 @@ int defend_callback(game *g, int who, int deficit, int list[], int num,
 			{
 				/* Mark power as used */
 				c_ptr->misc |= 1 << (MISC_USED_SHIFT + j);
+				MARK_CARD(g, special[i]);
 
 				/* Add extra military */
 				military += o_ptr->value;
 
 				/* Remember bonus for later */
 				p_ptr->bonus_military += o_ptr->value;
+				MARK_PLAYER(g, who);
 			}
 
 			/* Check for consume to increase military */
@@ -7339,15 +8037,17 @@ int defend_callback(game *g, int who, int deficit, int list[], int num,
 			{
 				/* Mark power as used */
 				c_ptr->misc |= 1 << (MISC_USED_SHIFT + j);
+				MARK_CARD(g, special[i]);
 
 				/* Add extra military */
 				military += o_ptr->value;
 
 				/* Remember bonus for later */
 				p_ptr->bonus_military += o_ptr->value;
+				MARK_PLAYER(g, who);
 
 				/* Message */
-				if (!g->simulation)
+				if (show_messages(g))
 				{
 					/* Format message */
 					sprintf(msg, "%s discards a Rare good for "
@@ -7363,6 +8063,7 @@ int defend_callback(game *g, int who, int deficit, int list[], int num,
 			{
 				/* Mark power as used */
 				c_ptr->misc |= 1 << (MISC_USED_SHIFT + j);
+				MARK_CARD(g, special[i]);
 
 				/* Spend prestige */
 				spend_prestige(g, who, 1);
@@ -7372,9 +8073,10 @@ int defend_callback(game *g, int who, int deficit, int list[], int num,
 
 				/* Remember bonus for later */
 				p_ptr->bonus_military += o_ptr->value;
+				MARK_PLAYER(g, who);
 
 				/* Message */
-				if (!g->simulation)
+				if (show_messages(g))
 				{
 					/* Format message */
 					sprintf(msg, "%s spends prestige for "
@@ -7396,10 +8098,11 @@ int defend_callback(game *g, int who, int deficit, int list[], int num,
 
 	/* Use cards passed as military strength */
 	p_ptr->bonus_military += num;
+	MARK_PLAYER(g, who);
 	military += num;
 
 	/* Message */
-	if (!g->simulation && num > 0)
+	if (show_messages(g) && num > 0)
 	{
 		/* Private message */
 		if (g->p[who].control->private_message)
@@ -7409,7 +8112,7 @@ int defend_callback(game *g, int who, int deficit, int list[], int num,
 			{
 				/* Format message */
 				sprintf(msg, "%s discards %s.\n", p_ptr->name,
-				        g->deck[list[i]].d_ptr->name);
+				        library[g->deck[list[i]].d_idx].name);
 
 				/* Send message */
 				g->p[who].control->private_message(g, who, msg, FORMAT_DISCARD);
@@ -7446,10 +8149,10 @@ int defend_callback(game *g, int who, int deficit, int list[], int num,
 		c_ptr = &g->deck[special[i]];
 
 		/* Loop over card's powers */
-		for (j = 0; j < c_ptr->d_ptr->num_power; j++)
+		for (j = 0; j < library[c_ptr->d_idx].num_power; j++)
 		{
 			/* Get power pointer */
-			o_ptr = &c_ptr->d_ptr->powers[j];
+			o_ptr = &library[c_ptr->d_idx].powers[j];
 
 			/* Skip non-settle phase power */
 			if (o_ptr->phase != PHASE_SETTLE) continue;
@@ -7536,10 +8239,10 @@ static void defend_takeover(game *g, int who, int world, int attacker,
 		c_ptr = &g->deck[x];
 
 		/* Loop over powers on card */
-		for (i = 0; i < c_ptr->d_ptr->num_power; i++)
+		for (i = 0; i < library[c_ptr->d_idx].num_power; i++)
 		{
 			/* Get power pointer */
-			o_ptr = &c_ptr->d_ptr->powers[i];
+			o_ptr = &library[c_ptr->d_idx].powers[i];
 
 			/* Skip non-settle powers */
 			if (o_ptr->phase != PHASE_SETTLE) continue;
@@ -7557,6 +8260,7 @@ static void defend_takeover(game *g, int who, int world, int attacker,
 					/* Remove used flag */
 					c_ptr->misc &= ~(1 <<
 					                 (MISC_USED_SHIFT + i));
+					MARK_CARD(g, x);
 
 					/* Done looking */
 					break;
@@ -7710,13 +8414,13 @@ int resolve_takeover(game *g, int who, int world, int special,
 	c_ptr = &g->deck[special];
 
 	/* Loop over powers */
-	for (i = 0; i < c_ptr->d_ptr->num_power; i++)
+	for (i = 0; i < library[c_ptr->d_idx].num_power; i++)
 	{
 		/* Get power pointer */
-		o_ptr = &c_ptr->d_ptr->powers[i];
+		o_ptr = &library[c_ptr->d_idx].powers[i];
 
 		/* Get name of card with power */
-		name = c_ptr->d_ptr->name;
+		name = library[c_ptr->d_idx].name;
 
 		/* Skip non-Settle powers */
 		if (o_ptr->phase != PHASE_SETTLE) continue;
@@ -7769,11 +8473,11 @@ int resolve_takeover(game *g, int who, int world, int special,
 		defeated = 1;
 
 		/* Message */
-		if (!g->simulation)
+		if (show_messages(g))
 		{
 			/* Format message */
 			sprintf(msg, "Takeover of %s is defeated because the world has been moved.\n",
-			              c_ptr->d_ptr->name);
+			              library[c_ptr->d_idx].name);
 
 			/* Send message */
 			message_add_formatted(g, msg, FORMAT_TAKEOVER);
@@ -7787,12 +8491,12 @@ int resolve_takeover(game *g, int who, int world, int special,
 	if (!defeated) attack = strength_against(g, who, world, special, 0);
 
 	/* Message */
-	if (!g->simulation && !defeated)
+	if (show_messages(g) && !defeated)
 	{
 		/* Format attack message */
 		sprintf(msg, "%s attacks %s with %d military.\n",
 		             g->p[who].name,
-		             c_ptr->d_ptr->name,
+		             library[c_ptr->d_idx].name,
 		             attack);
 
 		/* Send attack message */
@@ -7813,7 +8517,7 @@ int resolve_takeover(game *g, int who, int world, int special,
 	if (!defeated) defense = strength_against(g, c_ptr->owner, world, -1, 1);
 
 	/* Check for non-military target */
-	if (!(c_ptr->d_ptr->flags & FLAG_MILITARY))
+	if (!(library[c_ptr->d_idx].flags & FLAG_MILITARY))
 	{
 		/* Check for previously awarded prestige */
 		if (prestige)
@@ -7832,12 +8536,12 @@ int resolve_takeover(game *g, int who, int world, int special,
 	}
 
 	/* Message */
-	if (!g->simulation && !defeated)
+	if (show_messages(g) && !defeated)
 	{
 		/* Format defense message */
 		sprintf(msg, "%s defends %s with %d military.\n",
 		        g->p[c_ptr->owner].name,
-		        c_ptr->d_ptr->name,
+		        library[c_ptr->d_idx].name,
 		        defense);
 
 		/* Send defense message */
@@ -7848,11 +8552,11 @@ int resolve_takeover(game *g, int who, int world, int special,
 	if (defeated || attack < defense)
 	{
 		/* Message */
-		if (!g->simulation)
+		if (show_messages(g))
 		{
 			/* Format message */
 			sprintf(msg, "%s fails to takeover %s.\n", p_ptr->name,
-			        c_ptr->d_ptr->name);
+			        library[c_ptr->d_idx].name);
 
 			/* Send message */
 			message_add_formatted(g, msg, FORMAT_TAKEOVER);
@@ -7866,11 +8570,11 @@ int resolve_takeover(game *g, int who, int world, int special,
 	if (o_ptr->code & P3_DESTROY)
 	{
 		/* Message */
-		if (!g->simulation)
+		if (show_messages(g))
 		{
 			/* Format message */
 			sprintf(msg, "%s destroys %s.\n", p_ptr->name,
-			        c_ptr->d_ptr->name);
+			        library[c_ptr->d_idx].name);
 
 			/* Send message */
 			message_add_formatted(g, msg, FORMAT_TAKEOVER);
@@ -7889,7 +8593,7 @@ int resolve_takeover(game *g, int who, int world, int special,
 		if (g->game_over) return 0;
 
 		/* Check for cards saved underneath world */
-		if (c_ptr->d_ptr->flags & FLAG_START_SAVE)
+		if (library[c_ptr->d_idx].flags & FLAG_START_SAVE)
 		{
 			/* Loop over cards in deck */
 			for (i = 0; i < g->deck_size; i++)
@@ -7921,6 +8625,7 @@ int resolve_takeover(game *g, int who, int world, int special,
 
 			/* World has no more goods */
 			c_ptr->num_goods = 0;
+			MARK_CARD(g, world);
 		}
 
 		/* Success */
@@ -7934,11 +8639,11 @@ int resolve_takeover(game *g, int who, int world, int special,
 	c_ptr->order = p_ptr->table_order++;
 
 	/* Message */
-	if (!g->simulation)
+	if (show_messages(g))
 	{
 		/* Format message */
 		sprintf(msg, "%s takes over %s.\n", p_ptr->name,
-		        c_ptr->d_ptr->name);
+		        library[c_ptr->d_idx].name);
 
 		/* Send message */
 		message_add_formatted(g, msg, FORMAT_TAKEOVER);
@@ -7962,7 +8667,7 @@ int resolve_takeover(game *g, int who, int world, int special,
 	}
 
 	/* Check for cards saved underneath world */
-	if (c_ptr->d_ptr->flags & FLAG_START_SAVE)
+	if (library[c_ptr->d_idx].flags & FLAG_START_SAVE)
 	{
 		/* Loop over cards in deck */
 		for (i = 0; i < g->deck_size; i++)
@@ -8046,6 +8751,7 @@ void resolve_takeovers(game *g)
 
 			/* Mark power as used */
 			c_ptr->misc |= 1 << (MISC_USED_SHIFT + w_list[j].o_idx);
+			MARK_CARD(g, w_list[j].c_idx);
 
 			/* Ask player which takeover (if any) to defeat */
 			ask_player(g, i, CHOICE_TAKEOVER_PREVENT,
@@ -8072,12 +8778,12 @@ void resolve_takeovers(game *g)
 			}
 
 			/* Message */
-			if (!g->simulation)
+			if (show_messages(g))
 			{
 				/* Format message */
 				sprintf(msg, "%s spends prestige to defeat "
 				        "takeover of %s.\n",
-				        p_ptr->name, g->deck[list[0]].d_ptr->name);
+				        p_ptr->name, library[g->deck[list[0]].d_idx].name);
 
 				/* Send message */
 				message_add_formatted(g, msg, FORMAT_TAKEOVER);
@@ -8105,13 +8811,13 @@ void resolve_takeovers(game *g)
 					g->takeover_defeated[j] = 1;
 
 					/* Message */
-					if (!g->simulation)
+					if (show_messages(g))
 					{
 						/* Format message */
 						sprintf(msg, "Takeover of %s is defeated because "
 						        "takeover of %s failed.\n",
-						        g->deck[list[j]].d_ptr->name,
-						        g->deck[list[i]].d_ptr->name);
+						        library[g->deck[list[j]].d_idx].name,
+						        library[g->deck[list[i]].d_idx].name);
 
 						/* Send message */
 						message_add_formatted(g, msg, FORMAT_TAKEOVER);
@@ -8157,6 +8863,7 @@ void phase_settle(game *g)
 		{
 			/* Add bonus military for this phase */
 			p_ptr->bonus_military += 2;
+			MARK_PLAYER(g, i);
 		}
 	}
 
@@ -8208,7 +8915,7 @@ void phase_settle(game *g)
 			c_ptr = &g->deck[x];
 
 			/* Skip developments */
-			if (c_ptr->d_ptr->type != TYPE_WORLD) continue;
+			if (library[c_ptr->d_idx].type != TYPE_WORLD) continue;
 
 			/* Skip cards that cannot be settled */
 			if (!settle_legal(g, i, x, 0, 0, 0, 0)) continue;
@@ -8244,7 +8951,7 @@ void phase_settle(game *g)
 		if (!asked[i])
 		{
 			/* Message */
-			if (!g->simulation)
+			if (show_messages(g))
 			{
 				/* Format message */
 				sprintf(msg, "%s does not place a world.\n",
@@ -8272,7 +8979,7 @@ void phase_settle(game *g)
 		if (p_ptr->placing == -1)
 		{
 			/* Message */
-			if (!g->simulation)
+			if (show_messages(g))
 			{
 				/* Format message */
 				sprintf(msg, "%s does not place a world.\n",
@@ -8288,11 +8995,11 @@ void phase_settle(game *g)
 		}
 
 		/* Message */
-		if (!g->simulation)
+		if (show_messages(g))
 		{
 			/* Format message */
 			sprintf(msg, "%s places %s.\n", p_ptr->name,
-			        g->deck[p_ptr->placing].d_ptr->name);
+			        library[g->deck[p_ptr->placing].d_idx].name);
 
 			/* Send message */
 			message_add(g, msg);
@@ -8311,8 +9018,8 @@ void phase_settle(game *g)
 		/* Get player pointer */
 		p_ptr = &g->p[i];
 
-		/* Check for prepare function */
-		if (p_ptr->control->prepare_phase)
+		/* Check for prepare function (not needed in fast replays) */
+		if (p_ptr->control->prepare_phase && !fast_replaying(g, i))
 		{
 			/* Ask player to prepare answers for payment */
 			p_ptr->control->prepare_phase(g, i, PHASE_SETTLE,
@@ -8384,7 +9091,7 @@ int payment_callback(game *g, int who, int which, int list[], int num,
 	c_ptr = &g->deck[which];
 
 	/* Check for development */
-	if (c_ptr->d_ptr->type == TYPE_DEVELOPMENT)
+	if (library[c_ptr->d_idx].type == TYPE_DEVELOPMENT)
 	{
 		/* Use development callback */
 		return devel_callback(g, who, which, list, num, special,
@@ -8410,7 +9117,7 @@ int needed_callback(game *g, int who, int which, int special[], int num_special,
 	c_ptr = &g->deck[which];
 
 	/* Check for development */
-	if (c_ptr->d_ptr->type == TYPE_DEVELOPMENT)
+	if (library[c_ptr->d_idx].type == TYPE_DEVELOPMENT)
 	{
 		/* Use develop callback */
 		return develop_needed(g, who, which, special, num_special);
@@ -8496,10 +9203,10 @@ int trade_value(game *g, int who, card *c_ptr, int type, int no_bonus)
 	}
 
 	/* Loop over powers on card holding good */
-	for (i = 0; i < c_ptr->d_ptr->num_power; i++)
+	for (i = 0; i < library[c_ptr->d_idx].num_power; i++)
 	{
 		/* Get power pointer */
-		o_ptr = &c_ptr->d_ptr->powers[i];
+		o_ptr = &library[c_ptr->d_idx].powers[i];
 
 		/* Skip non-consume power */
 		if (o_ptr->phase != PHASE_CONSUME) continue;
@@ -8541,9 +9248,10 @@ void trade_chosen(game *g, int who, int which, int no_bonus)
 
 	/* Uncover production card */
 	c_ptr->num_goods--;
+	MARK_CARD(g, which);
 
 	/* Get good type */
-	type = c_ptr->d_ptr->good_type;
+	type = library[c_ptr->d_idx].good_type;
 
 	/* Check for "any" type */
 	if (type == GOOD_ANY)
@@ -8559,7 +9267,7 @@ void trade_chosen(game *g, int who, int which, int no_bonus)
 		g->oort_kind = type;
 
 		/* Message */
-		if (!g->simulation)
+		if (show_messages(g))
 		{
 			/* Format message */
 			sprintf(msg, "%s changes Alien Oort Cloud Refinery's "
@@ -8580,11 +9288,11 @@ void trade_chosen(game *g, int who, int which, int no_bonus)
 	value = trade_value(g, who, c_ptr, type, no_bonus);
 
 	/* Message */
-	if (!g->simulation)
+	if (show_messages(g))
 	{
 		/* Format message */
 		sprintf(msg, "%s trades good from %s for %d.\n", p_ptr->name,
-		        c_ptr->d_ptr->name, value);
+		        library[c_ptr->d_idx].name, value);
 
 		/* Send message */
 		message_add(g, msg);
@@ -8630,10 +9338,10 @@ void trade_action(game *g, int who, int no_bonus, int phase_bonus)
 		trade = 1;
 
 		/* Loop over card powers */
-		for (i = 0; i < c_ptr->d_ptr->num_power; i++)
+		for (i = 0; i < library[c_ptr->d_idx].num_power; i++)
 		{
 			/* Get power pointer */
-			o_ptr = &c_ptr->d_ptr->powers[i];
+			o_ptr = &library[c_ptr->d_idx].powers[i];
 
 			/* Skip non-consume powers */
 			if (o_ptr->phase != PHASE_CONSUME) continue;
@@ -8788,7 +9496,7 @@ int goods_legal(game *g, int who, int c_idx, int o_idx, int min, int max,
 	c_ptr = &g->deck[c_idx];
 
 	/* Get power pointer */
-	o_ptr = &c_ptr->d_ptr->powers[o_idx];
+	o_ptr = &library[c_ptr->d_idx].powers[o_idx];
 
 	/* Check for consume phase power used */
 	if (o_ptr->phase == PHASE_CONSUME)
@@ -8815,7 +9523,7 @@ int goods_legal(game *g, int who, int c_idx, int o_idx, int min, int max,
 					c_ptr = &g->deck[g_list[i]];
 
 					/* Count good type */
-					types[c_ptr->d_ptr->good_type]++;
+					types[library[c_ptr->d_idx].good_type]++;
 				}
 
 				/* Count number of GOOD_ANY required */
@@ -8870,7 +9578,7 @@ int goods_legal(game *g, int who, int c_idx, int o_idx, int min, int max,
 				c_ptr = &g->deck[g_list[i]];
 
 				/* Count good type */
-				types[c_ptr->d_ptr->good_type]++;
+				types[library[c_ptr->d_idx].good_type]++;
 			}
 
 			/* Count good types */
@@ -8907,7 +9615,7 @@ int goods_legal(game *g, int who, int c_idx, int o_idx, int min, int max,
 				c_ptr = &g->deck[g_list[i]];
 
 				/* Count good type */
-				types[c_ptr->d_ptr->good_type]++;
+				types[library[c_ptr->d_idx].good_type]++;
 			}
 
 			/* Count good types */
@@ -8972,10 +9680,10 @@ int good_chosen(game *g, int who, int c_idx, int o_idx,
 	c_ptr = &g->deck[c_idx];
 
 	/* Get power pointer */
-	o_ptr = &c_ptr->d_ptr->powers[o_idx];
+	o_ptr = &library[c_ptr->d_idx].powers[o_idx];
 
 	/* Get name of card with power */
-	name = g->deck[c_idx].d_ptr->name;
+	name = library[g->deck[c_idx].d_idx].name;
 
 	/* Check for illegal payment */
 	if (!goods_legal(g, who, c_idx, o_idx, min, max, g_list, &num))
@@ -8998,13 +9706,14 @@ int good_chosen(game *g, int who, int c_idx, int o_idx,
 
 		/* Uncover production card */
 		c_ptr->num_goods--;
+		MARK_CARD(g, g_list[i]);
 
 		/* Message */
-		if (!g->simulation)
+		if (show_messages(g))
 		{
 			/* Format message */
 			sprintf(msg, "%s consumes good from %s using %s.\n",
-			        p_ptr->name, c_ptr->d_ptr->name, name);
+			        p_ptr->name, library[c_ptr->d_idx].name, name);
 
 			/* Send message */
 			message_add(g, msg);
@@ -9066,8 +9775,8 @@ int good_chosen(game *g, int who, int c_idx, int o_idx,
 		prestige = o_ptr->value * times;
 	}
 
-	/* Check for simulated game */
-	if (!g->simulation)
+	/* Check for messages */
+	if (show_messages(g))
 	{
 		/* Log rewards */
 		log_rewards(g, who, cards, vps, prestige, "from", name, FORMAT_VERBOSE);
@@ -9146,7 +9855,7 @@ static void draw_lucky(game *g, int who)
 	c_ptr = &g->deck[which];
 
 	/* Message */
-	if (!g->simulation)
+	if (show_messages(g))
 	{
 		/* Format message */
 		sprintf(msg, "%s guesses %d.\n", p_ptr->name, cost);
@@ -9156,8 +9865,8 @@ static void draw_lucky(game *g, int who)
 
 		/* Format message */
 		sprintf(msg, "%s flips %s (cost %d).\n", p_ptr->name,
-		                                         c_ptr->d_ptr->name,
-		                                         c_ptr->d_ptr->cost);
+		                                         library[c_ptr->d_idx].name,
+		                                         library[c_ptr->d_idx].cost);
 
 		/* Add message */
 		message_add(g, msg);
@@ -9167,7 +9876,7 @@ static void draw_lucky(game *g, int who)
 	if (draw_empty(g)) refresh_draw(g);
 
 	/* Check for correct guess */
-	if (cost == c_ptr->d_ptr->cost)
+	if (cost == library[c_ptr->d_idx].cost)
 	{
 		/* Move card to player */
 		move_card(g, which, who, WHERE_HAND);
@@ -9177,11 +9886,11 @@ static void draw_lucky(game *g, int who)
 		c_ptr->misc |= 1 << who;
 
 		/* Message */
-		if (!g->simulation)
+		if (show_messages(g))
 		{
 			/* Format message */
 			sprintf(msg, "%s keeps %s.\n", p_ptr->name,
-			                               c_ptr->d_ptr->name);
+			                               library[c_ptr->d_idx].name);
 
 			/* Add message */
 			message_add_formatted(g, msg, FORMAT_VERBOSE);
@@ -9196,11 +9905,11 @@ static void draw_lucky(game *g, int who)
 		c_ptr->misc |= MISC_KNOWN_MASK;
 
 		/* Message */
-		if (!g->simulation)
+		if (show_messages(g))
 		{
 			/* Format message */
 			sprintf(msg, "%s discards %s.\n", p_ptr->name,
-			                                  c_ptr->d_ptr->name);
+			                                  library[c_ptr->d_idx].name);
 
 			/* Add message */
 			message_add_formatted(g, msg, FORMAT_VERBOSE);
@@ -9235,10 +9944,10 @@ static void ante_card(game *g, int who)
 		c_ptr = &g->deck[x];
 
 		/* Skip cards that are too cheap */
-		if (c_ptr->d_ptr->cost < 1) continue;
+		if (library[c_ptr->d_idx].cost < 1) continue;
 
 		/* Skip cards that are too expensive */
-		if (c_ptr->d_ptr->cost > 6) continue;
+		if (library[c_ptr->d_idx].cost > 6) continue;
 
 		/* Add card to list */
 		list[n++] = x;
@@ -9260,13 +9969,13 @@ static void ante_card(game *g, int who)
 	c_ptr = &g->deck[chosen];
 
 	/* Get card cost */
-	cost = c_ptr->d_ptr->cost;
+	cost = library[c_ptr->d_idx].cost;
 
 	/* Message */
-	if (!g->simulation)
+	if (show_messages(g))
 	{
 		/* Format message */
-		sprintf(msg, "%s antes %s.\n", p_ptr->name, c_ptr->d_ptr->name);
+		sprintf(msg, "%s antes %s.\n", p_ptr->name, library[c_ptr->d_idx].name);
 
 		/* Add message */
 		message_add(g, msg);
@@ -9294,14 +10003,14 @@ static void ante_card(game *g, int who)
 		if (drawn[i] == -1) return;
 
 		/* Check for more expensive than ante */
-		if (g->deck[drawn[i]].d_ptr->cost > cost) success = 1;
+		if (library[g->deck[drawn[i]].d_idx].cost > cost) success = 1;
 
 		/* Message */
-		if (!g->simulation)
+		if (show_messages(g))
 		{
 			/* Format message */
 			sprintf(msg, "%s draws %s.\n", p_ptr->name,
-			        g->deck[drawn[i]].d_ptr->name);
+			        library[g->deck[drawn[i]].d_idx].name);
 
 			/* Add message */
 			message_add(g, msg);
@@ -9351,11 +10060,11 @@ static void ante_card(game *g, int who)
 	if (g->game_over) return;
 
 	/* Message */
-	if (!g->simulation)
+	if (show_messages(g))
 	{
 		/* Format message */
 		sprintf(msg, "%s keeps %s.\n", p_ptr->name,
-		        g->deck[chosen].d_ptr->name);
+		        library[g->deck[chosen].d_idx].name);
 
 		/* Add message */
 		message_add(g, msg);
@@ -9421,10 +10130,10 @@ int consume_hand_chosen(game *g, int who, int c_idx, int o_idx,
 		c_ptr = &g->deck[c_idx];
 
 		/* Use card name */
-		power_name = c_ptr->d_ptr->name;
+		power_name = library[c_ptr->d_idx].name;
 
 		/* Get pointer to power used */
-		o_ptr = &c_ptr->d_ptr->powers[o_idx];
+		o_ptr = &library[c_ptr->d_idx].powers[o_idx];
 	}
 
 	/* Check for two cards needed */
@@ -9440,7 +10149,7 @@ int consume_hand_chosen(game *g, int who, int c_idx, int o_idx,
 	}
 
 	/* Message */
-	if (!g->simulation)
+	if (show_messages(g))
 	{
 		/* Private message */
 		if (g->p[who].control->private_message)
@@ -9450,7 +10159,7 @@ int consume_hand_chosen(game *g, int who, int c_idx, int o_idx,
 			{
 				/* Format message */
 				sprintf(msg, "%s discards %s.\n", p_ptr->name,
-				        g->deck[list[i]].d_ptr->name);
+				        library[g->deck[list[i]].d_idx].name);
 
 				/* Send message */
 				g->p[who].control->private_message(g, who, msg, FORMAT_DISCARD);
@@ -9495,8 +10204,8 @@ int consume_hand_chosen(game *g, int who, int c_idx, int o_idx,
 		}
 	}
 
-	/* Check for simulated game */
-	if (!g->simulation)
+	/* Check for messages */
+	if (show_messages(g))
 	{
 		/* Log rewards */
 		log_rewards(g, who, cards, vps, prestige,
@@ -9583,14 +10292,14 @@ void consume_prestige_chosen(game *g, int who, int c_idx, int o_idx)
 	c_ptr = &g->deck[c_idx];
 
 	/* Get power pointer */
-	o_ptr = &c_ptr->d_ptr->powers[o_idx];
+	o_ptr = &library[c_ptr->d_idx].powers[o_idx];
 
 	/* Message */
-	if (!g->simulation)
+	if (show_messages(g))
 	{
 		/* Format message */
 		sprintf(msg, "%s consumes prestige using %s.\n",
-		        p_ptr->name, c_ptr->d_ptr->name);
+		        p_ptr->name, library[c_ptr->d_idx].name);
 
 		/* Send message */
 		message_add(g, msg);
@@ -9633,12 +10342,12 @@ void consume_prestige_chosen(game *g, int who, int c_idx, int o_idx)
 		vps *= vp_mult;
 	}
 
-	/* Check for simulated game */
-	if (!g->simulation)
+	/* Check for messages */
+	if (show_messages(g))
 	{
 		/* Log rewards */
 		log_rewards(g, who, cards, vps, 0,
-		            "from", c_ptr->d_ptr->name, FORMAT_VERBOSE);
+		            "from", library[c_ptr->d_idx].name, FORMAT_VERBOSE);
 	}
 
 	/* Check for any cards awarded */
@@ -9687,6 +10396,7 @@ void consume_chosen(game *g, int who, int c_idx, int o_idx)
 
 		/* Power used */
 		p_ptr->phase_bonus_used = 1;
+		MARK_PLAYER(g, who);
 
 		/* Done */
 		return;
@@ -9696,13 +10406,14 @@ void consume_chosen(game *g, int who, int c_idx, int o_idx)
 	c_ptr = &g->deck[c_idx];
 
 	/* Get name of card with power */
-	name = c_ptr->d_ptr->name;
+	name = library[c_ptr->d_idx].name;
 
 	/* Mark power as used */
 	c_ptr->misc |= 1 << (MISC_USED_SHIFT + o_idx);
+	MARK_CARD(g, c_idx);
 
 	/* Get pointer to power */
-	o_ptr = &c_ptr->d_ptr->powers[o_idx];
+	o_ptr = &library[c_ptr->d_idx].powers[o_idx];
 
 	/* Check for trade action power */
 	if (o_ptr->code & P4_TRADE_ACTION)
@@ -9817,7 +10528,7 @@ void consume_chosen(game *g, int who, int c_idx, int o_idx)
 		if (!c_ptr->num_goods) continue;
 
 		/* Get good type */
-		good = c_ptr->d_ptr->good_type;
+		good = library[c_ptr->d_idx].good_type;
 
 		/* Count good type */
 		types[good] += c_ptr->num_goods;
@@ -9985,7 +10696,7 @@ int consume_action(game *g, int who)
 		goods += c_ptr->num_goods;;
 
 		/* Count good type */
-		types[c_ptr->d_ptr->good_type] += c_ptr->num_goods;
+		types[library[c_ptr->d_idx].good_type] += c_ptr->num_goods;
 	}
 
 	/* Count number of types */
@@ -10249,8 +10960,8 @@ void phase_consume(game *g)
 		/* Get player pointer */
 		p_ptr = &g->p[i];
 
-		/* Check for prepare function */
-		if (p_ptr->control->prepare_phase)
+		/* Check for prepare function (not needed in fast replays) */
+		if (p_ptr->control->prepare_phase && !fast_replaying(g, i))
 		{
 			/* Ask player to prepare answers for consume phase */
 			p_ptr->control->prepare_phase(g, i, PHASE_CONSUME, 0);
@@ -10267,8 +10978,8 @@ void phase_consume(game *g)
 		if (g->game_over) return;
 	}
 
-	/* Check for simulation */
-	if (!g->simulation)
+	/* Check for messages */
+	if (show_messages(g))
 	{
 		/* Loop over players */
 		for (i = 0; i < g->num_players; i++)
@@ -10320,11 +11031,11 @@ void produce_world(game *g, int who, int which, int c_idx, int o_idx)
 	c_ptr = &g->deck[which];
 
 	/* Message */
-	if (!g->simulation)
+	if (show_messages(g))
 	{
 		/* Format message */
 		sprintf(msg, "%s produces on %s.\n", p_ptr->name,
-		        c_ptr->d_ptr->name);
+		        library[c_ptr->d_idx].name);
 
 		/* Send message */
 		message_add(g, msg);
@@ -10334,10 +11045,10 @@ void produce_world(game *g, int who, int which, int c_idx, int o_idx)
 	add_good(g, which);
 
 	/* Mark world as producing */
-	SET_PRODUCED(c_ptr, c_ptr->d_ptr->good_type);
+	SET_PRODUCED(c_ptr, library[c_ptr->d_idx].good_type);
 
 	/* Check for "any" kind world */
-	if (c_ptr->d_ptr->good_type == GOOD_ANY)
+	if (library[c_ptr->d_idx].good_type == GOOD_ANY)
 	{
 		/* Check for no card providing produce power */
 		if (c_idx < 0)
@@ -10350,7 +11061,7 @@ void produce_world(game *g, int who, int which, int c_idx, int o_idx)
 		else
 		{
 			/* Get power used */
-			o_ptr = &g->deck[c_idx].d_ptr->powers[o_idx];
+			o_ptr = &library[g->deck[c_idx].d_idx].powers[o_idx];
 		}
 
 		/* Check for specific kind power used */
@@ -10375,12 +11086,13 @@ void produce_world(game *g, int who, int which, int c_idx, int o_idx)
 
 			/* Set kind on world */
 			SET_PRODUCED(c_ptr, kind);
+			MARK_CARD(g, which);
 
 			/* Set kind */
 			g->oort_kind = kind;
 
 			/* Message */
-			if (!g->simulation)
+			if (show_messages(g))
 			{
 				/* Format message */
 				sprintf(msg, "%s changes Alien Oort Cloud Refinery's "
@@ -10400,13 +11112,13 @@ void produce_world(game *g, int who, int which, int c_idx, int o_idx)
 	}
 
 	/* Loop over card's powers */
-	for (i = 0; i < c_ptr->d_ptr->num_power; i++)
+	for (i = 0; i < library[c_ptr->d_idx].num_power; i++)
 	{
 		/* Get power pointer */
-		o_ptr = &c_ptr->d_ptr->powers[i];
+		o_ptr = &library[c_ptr->d_idx].powers[i];
 
 		/* Get name of card with power */
-		name = c_ptr->d_ptr->name;
+		name = library[c_ptr->d_idx].name;
 
 		/* Skip non-produce powers */
 		if (o_ptr->phase != PHASE_PRODUCE) continue;
@@ -10449,7 +11161,7 @@ static void discard_windfall(game *g, int who, int c_idx, int o_idx)
 	c_ptr = &g->deck[c_idx];
 
 	/* Get power pointer */
-	o_ptr = &c_ptr->d_ptr->powers[o_idx];
+	o_ptr = &library[c_ptr->d_idx].powers[o_idx];
 
 	/* Check for good type restriction */
 	if (o_ptr->code & P5_WINDFALL_NOVELTY) good = GOOD_NOVELTY;
@@ -10470,14 +11182,14 @@ static void discard_windfall(game *g, int who, int c_idx, int o_idx)
 		if (c_ptr->where != WHERE_ACTIVE) continue;
 
 		/* Skip non-windfall worlds */
-		if (!(c_ptr->d_ptr->flags & FLAG_WINDFALL)) continue;
+		if (!(library[c_ptr->d_idx].flags & FLAG_WINDFALL)) continue;
 
 		/* Skip worlds that do not produce goods */
-		if (!c_ptr->d_ptr->good_type) continue;
+		if (!library[c_ptr->d_idx].good_type) continue;
 
 		/* Skip worlds of incorrect type */
-		if (good && c_ptr->d_ptr->good_type != good &&
-		    c_ptr->d_ptr->good_type != GOOD_ANY) continue;
+		if (good && library[c_ptr->d_idx].good_type != good &&
+		    library[c_ptr->d_idx].good_type != GOOD_ANY) continue;
 
 		/* Skip worlds with goods already */
 		if (c_ptr->num_goods) continue;
@@ -10526,7 +11238,7 @@ static void produce_windfall(game *g, int who, int c_idx, int o_idx)
 		c_ptr = &g->deck[c_idx];
 
 		/* Get power pointer */
-		o_ptr = &c_ptr->d_ptr->powers[o_idx];
+		o_ptr = &library[c_ptr->d_idx].powers[o_idx];
 	}
 
 	/* Check for power passed */
@@ -10549,14 +11261,14 @@ static void produce_windfall(game *g, int who, int c_idx, int o_idx)
 		c_ptr = &g->deck[x];
 
 		/* Skip non-windfall worlds */
-		if (!(c_ptr->d_ptr->flags & FLAG_WINDFALL)) continue;
+		if (!(library[c_ptr->d_idx].flags & FLAG_WINDFALL)) continue;
 
 		/* Skip worlds that do not produce goods */
-		if (!c_ptr->d_ptr->good_type) continue;
+		if (!library[c_ptr->d_idx].good_type) continue;
 
 		/* Skip worlds of incorrect type */
-		if (good && c_ptr->d_ptr->good_type != good &&
-		    c_ptr->d_ptr->good_type != GOOD_ANY) continue;
+		if (good && library[c_ptr->d_idx].good_type != good &&
+		    library[c_ptr->d_idx].good_type != GOOD_ANY) continue;
 
 		/* Skip worlds with goods already */
 		if (c_ptr->num_goods) continue;
@@ -10618,12 +11330,13 @@ void produce_chosen(game *g, int who, int c_idx, int o_idx)
 		c_ptr = &g->deck[c_idx];
 
 		/* Get power pointer */
-		o_ptr = &c_ptr->d_ptr->powers[o_idx];
+		o_ptr = &library[c_ptr->d_idx].powers[o_idx];
 	}
 	else
 	{
 		/* Phase bonus is used */
 		p_ptr->phase_bonus_used |= 1 << (0 - c_idx);
+		MARK_PLAYER(g, who);
 
 		/* Determine which bonus to use */
 		if (c_idx == -1 || c_idx == -2)
@@ -10646,9 +11359,10 @@ void produce_chosen(game *g, int who, int c_idx, int o_idx)
 
 	/* Mark power used */
 	c_ptr->misc |= 1 << (MISC_USED_SHIFT + o_idx);
+	MARK_CARD(g, c_idx);
 
 	/* Get name of card with power */
-	name = c_ptr->d_ptr->name;
+	name = library[c_ptr->d_idx].name;
 
 	/* Check for regular produce */
 	if (o_ptr->code == P5_PRODUCE)
@@ -10699,8 +11413,8 @@ void produce_chosen(game *g, int who, int c_idx, int o_idx)
 			c_ptr = &g->deck[x];
 
 			/* Check for rare world */
-			if (c_ptr->d_ptr->good_type == GOOD_RARE ||
-			    c_ptr->d_ptr->good_type == GOOD_ANY) count++;
+			if (library[c_ptr->d_idx].good_type == GOOD_RARE ||
+			    library[c_ptr->d_idx].good_type == GOOD_ANY) count++;
 		}
 
 		/* Draw cards */
@@ -10729,8 +11443,8 @@ void produce_chosen(game *g, int who, int c_idx, int o_idx)
 			c_ptr = &g->deck[x];
 
 			/* Check for gene world */
-			if (c_ptr->d_ptr->good_type == GOOD_GENE ||
-			    c_ptr->d_ptr->good_type == GOOD_ANY) count++;
+			if (library[c_ptr->d_idx].good_type == GOOD_GENE ||
+			    library[c_ptr->d_idx].good_type == GOOD_ANY) count++;
 		}
 
 		/* Draw cards */
@@ -10791,10 +11505,10 @@ void produce_chosen(game *g, int who, int c_idx, int o_idx)
 			c_ptr = &g->deck[x];
 
 			/* Skip developments */
-			if (c_ptr->d_ptr->type == TYPE_DEVELOPMENT) continue;
+			if (library[c_ptr->d_idx].type == TYPE_DEVELOPMENT) continue;
 
 			/* Check for rebel world */
-			if (c_ptr->d_ptr->flags & FLAG_REBEL) count++;
+			if (library[c_ptr->d_idx].flags & FLAG_REBEL) count++;
 		}
 
 		/* Draw cards */
@@ -10823,13 +11537,13 @@ void produce_chosen(game *g, int who, int c_idx, int o_idx)
 			c_ptr = &g->deck[x];
 
 			/* Skip non-worlds */
-			if (c_ptr->d_ptr->type != TYPE_WORLD) continue;
+			if (library[c_ptr->d_idx].type != TYPE_WORLD) continue;
 
 			/* Skip non-military worlds */
-			if (!(c_ptr->d_ptr->flags & FLAG_MILITARY)) continue;
+			if (!(library[c_ptr->d_idx].flags & FLAG_MILITARY)) continue;
 
 			/* Check for rebel world */
-			if (c_ptr->d_ptr->flags & FLAG_REBEL) count++;
+			if (library[c_ptr->d_idx].flags & FLAG_REBEL) count++;
 		}
 
 		/* Draw cards */
@@ -10906,10 +11620,10 @@ void produce_chosen(game *g, int who, int c_idx, int o_idx)
 			c_ptr = &g->deck[x];
 
 			/* Skip worlds */
-			if (c_ptr->d_ptr->type != TYPE_DEVELOPMENT) continue;
+			if (library[c_ptr->d_idx].type != TYPE_DEVELOPMENT) continue;
 
 			/* Check for enough cost */
-			if (c_ptr->d_ptr->cost >= 5) count++;
+			if (library[c_ptr->d_idx].cost >= 5) count++;
 		}
 
 		/* Draw cards */
@@ -10963,11 +11677,11 @@ void produce_chosen(game *g, int who, int c_idx, int o_idx)
 			move_card(g, list[i], who, WHERE_HAND);
 
 			/* Private message */
-			if (g->p[who].control->private_message)
+			if (show_messages(g) && g->p[who].control->private_message)
 			{
 				/* Format message */
 				sprintf(msg, "%s takes %s.\n", p_ptr->name,
-				        g->deck[list[i]].d_ptr->name);
+				        library[g->deck[list[i]].d_idx].name);
 
 				/* Send message */
 				g->p[who].control->private_message(g, who, msg, FORMAT_DISCARD);
@@ -10975,12 +11689,12 @@ void produce_chosen(game *g, int who, int c_idx, int o_idx)
 		}
 
 		/* Message */
-		if (count > 0 && !g->simulation)
+		if (count > 0 && show_messages(g))
 		{
 			/* Format message */
 			sprintf(msg, "%s takes %d card%s from under %s.\n",
 			        p_ptr->name, count, PLURAL(count),
-			        g->deck[c_idx].d_ptr->name);
+			        library[g->deck[c_idx].d_idx].name);
 
 			/* Send message */
 			message_add(g, msg);
@@ -11166,13 +11880,13 @@ int produce_action(game *g, int who)
 		c_ptr = &g->deck[x];
 
 		/* Skip non-windfall worlds */
-		if (!(c_ptr->d_ptr->flags & FLAG_WINDFALL)) continue;
+		if (!(library[c_ptr->d_idx].flags & FLAG_WINDFALL)) continue;
 
 		/* Skip windfalls with goods already */
 		if (c_ptr->num_goods) continue;
 
 		/* Windfall of this color needs production */
-		windfall[c_ptr->d_ptr->good_type] = 1;
+		windfall[library[c_ptr->d_idx].good_type] = 1;
 
 		/* At least one windfall available */
 		windfall_any = 1;
@@ -11362,7 +12076,7 @@ int produce_action(game *g, int who)
 	for (i = 0; i < num; i++)
 	{
 		/* Get power */
-		o_ptr = &g->deck[cidx[i]].d_ptr->powers[oidx[i]];
+		o_ptr = &library[g->deck[cidx[i]].d_idx].powers[oidx[i]];
 
 		/* Check for produce on windfall */
 		if (o_ptr->code == P5_WINDFALL_ANY)
@@ -11467,7 +12181,7 @@ void phase_produce_start(game *g)
 				b_ptr = &g->deck[y];
 
 				/* Skip cards that are not Rare kind */
-				if (b_ptr->d_ptr->good_type != GOOD_RARE)
+				if (library[b_ptr->d_idx].good_type != GOOD_RARE)
 					continue;
 
 				/* Skip card with shift power */
@@ -11475,19 +12189,22 @@ void phase_produce_start(game *g)
 
 				/* Move good to world */
 				b_ptr->num_goods = 0;
+				MARK_CARD(g, y);
 				g->deck[w_list[j].c_idx].num_goods++;
+				MARK_CARD(g, w_list[j].c_idx);
 
 				/* Mark covered world */
 				c_ptr->covering = w_list[j].c_idx;
+				MARK_CARD(g, x);
 
-				/* Check for simulated game */
-				if (!g->simulation)
+				/* Check for messages */
+				if (show_messages(g))
 				{
 					/* Format message */
 					sprintf(msg, "%s shifts good from %s to %s.\n",
 					             p_ptr->name,
-					             b_ptr->d_ptr->name,
-					             g->deck[w_list[j].c_idx].d_ptr->name);
+					             library[b_ptr->d_idx].name,
+					             library[g->deck[w_list[j].c_idx].d_idx].name);
 
 					/* Send message */
 					message_add(g, msg);
@@ -11582,7 +12299,7 @@ void phase_produce_end(game *g)
 				{
 					/* Draw cards */
 					draw_cards(g, i, o_ptr->value,
-					           g->deck[w_list[k].c_idx].d_ptr->name);
+					           library[g->deck[w_list[k].c_idx].d_idx].name);
 
 					/* Count reward */
 					p_ptr->phase_cards += o_ptr->value;
@@ -11594,7 +12311,7 @@ void phase_produce_end(game *g)
 				{
 					/* Draw cards */
 					draw_cards(g, i, o_ptr->value,
-					           g->deck[w_list[k].c_idx].d_ptr->name);
+					           library[g->deck[w_list[k].c_idx].d_idx].name);
 
 					/* Count reward */
 					p_ptr->phase_cards += o_ptr->value;
@@ -11606,7 +12323,7 @@ void phase_produce_end(game *g)
 				{
 					/* Draw cards */
 					draw_cards(g, i, o_ptr->value,
-					           g->deck[w_list[k].c_idx].d_ptr->name);
+					           library[g->deck[w_list[k].c_idx].d_idx].name);
 
 					/* Count reward */
 					p_ptr->phase_cards += o_ptr->value;
@@ -11651,7 +12368,7 @@ void phase_produce_end(game *g)
 			{
 				/* Draw cards */
 				draw_cards(g, i, o_ptr->value,
-				           g->deck[w_list[j].c_idx].d_ptr->name);
+				           library[g->deck[w_list[j].c_idx].d_idx].name);
 
 				/* Count reward */
 				p_ptr->phase_cards += o_ptr->value;
@@ -11695,8 +12412,8 @@ void phase_produce(game *g)
 		/* Get player pointer */
 		p_ptr = &g->p[i];
 
-		/* Check for prepare function */
-		if (p_ptr->control->prepare_phase)
+		/* Check for prepare function (not needed in fast replays) */
+		if (p_ptr->control->prepare_phase && !fast_replaying(g, i))
 		{
 			/* Ask player to prepare answers for produce phase */
 			p_ptr->control->prepare_phase(g, i, PHASE_PRODUCE, 0);
@@ -11716,8 +12433,8 @@ void phase_produce(game *g)
 	/* Handle end of phase powers */
 	phase_produce_end(g);
 
-	/* Check for simulation */
-	if (!g->simulation)
+	/* Check for messages */
+	if (show_messages(g))
 	{
 		/* Loop over players */
 		for (i = 0; i < g->num_players; i++)
@@ -11816,7 +12533,7 @@ void phase_discard(game *g)
 		p_ptr->end_discard = n - target;
 
 		/* Message */
-		if (!g->simulation && !message)
+		if (show_messages(g) && !message)
 		{
 			/* Send formatted message */
 			message_add_formatted(g, "--- End of round ---\n", FORMAT_PHASE);
@@ -11862,7 +12579,7 @@ void phase_discard(game *g)
 		discard_callback(g, i, list, n);
 
 		/* Message */
-		if (!g->simulation)
+		if (show_messages(g))
 		{
 			/* Format message */
 			sprintf(msg, "%s discards %d card%s at end of round.\n",
@@ -11918,7 +12635,7 @@ void phase_discard(game *g)
 				{
 					/* Format message */
 					sprintf(msg, "%s takes %s.\n",
-					        g->p[i].name, c_ptr->d_ptr->name);
+					        g->p[i].name, library[c_ptr->d_idx].name);
 
 					/* Send private message */
 					g->p[i].control->private_message(g, i, msg,
@@ -11940,7 +12657,7 @@ void phase_discard(game *g)
 			if (taken > 0)
 			{
 				/* Message */
-				if (!g->simulation)
+				if (show_messages(g))
 				{
 					/* Format message */
 					sprintf(msg, "%s takes %d discard%s.\n",
@@ -12028,10 +12745,10 @@ static int check_goal_player(game *g, int goal, int who)
 				c_ptr = &g->deck[x];
 
 				/* Skip non-worlds */
-				if (c_ptr->d_ptr->type != TYPE_WORLD) continue;
+				if (library[c_ptr->d_idx].type != TYPE_WORLD) continue;
 
 				/* Mark good type */
-				good[c_ptr->d_ptr->good_type] = 1;
+				good[library[c_ptr->d_idx].good_type] = 1;
 			}
 
 			/* Count types */
@@ -12072,10 +12789,10 @@ static int check_goal_player(game *g, int goal, int who)
 				c_ptr = &g->deck[x];
 
 				/* Loop over card powers */
-				for (i = 0; i < c_ptr->d_ptr->num_power; i++)
+				for (i = 0; i < library[c_ptr->d_idx].num_power; i++)
 				{
 					/* Get power pointer */
-					o_ptr = &c_ptr->d_ptr->powers[i];
+					o_ptr = &library[c_ptr->d_idx].powers[i];
 
 					/* Check for trade power */
 					if (o_ptr->phase == PHASE_CONSUME &&
@@ -12115,13 +12832,13 @@ static int check_goal_player(game *g, int goal, int who)
 				c_ptr = &g->deck[x];
 
 				/* Skip worlds */
-				if (c_ptr->d_ptr->type == TYPE_WORLD) continue;
+				if (library[c_ptr->d_idx].type == TYPE_WORLD) continue;
 
 				/* Skip non-cost-6 cards */
-				if (c_ptr->d_ptr->cost != 6) continue;
+				if (library[c_ptr->d_idx].cost != 6) continue;
 
 				/* Check for variable points */
-				if (c_ptr->d_ptr->num_vp_bonus) return 1;
+				if (library[c_ptr->d_idx].num_vp_bonus) return 1;
 			}
 
 			/* No six-cost developments */
@@ -12146,7 +12863,7 @@ static int check_goal_player(game *g, int goal, int who)
 				c_ptr = &g->deck[x];
 
 				/* Skip non-worlds */
-				if (c_ptr->d_ptr->type != TYPE_WORLD) continue;
+				if (library[c_ptr->d_idx].type != TYPE_WORLD) continue;
 
 				/* Check for good */
 				if (c_ptr->num_goods) count++;
@@ -12174,7 +12891,7 @@ static int check_goal_player(game *g, int goal, int who)
 				c_ptr = &g->deck[x];
 
 				/* Skip non-worlds */
-				if (c_ptr->d_ptr->type != TYPE_WORLD) continue;
+				if (library[c_ptr->d_idx].type != TYPE_WORLD) continue;
 
 				/* Count active worlds */
 				count++;
@@ -12250,18 +12967,18 @@ static int check_goal_player(game *g, int goal, int who)
 				c_ptr = &g->deck[x];
 
 				/* Skip non-worlds */
-				if (c_ptr->d_ptr->type != TYPE_WORLD) continue;
+				if (library[c_ptr->d_idx].type != TYPE_WORLD) continue;
 
 				/* Check for blue or brown */
-				if (c_ptr->d_ptr->good_type == GOOD_NOVELTY ||
-				    c_ptr->d_ptr->good_type == GOOD_RARE)
+				if (library[c_ptr->d_idx].good_type == GOOD_NOVELTY ||
+				    library[c_ptr->d_idx].good_type == GOOD_RARE)
 				{
 					/* Count world */
 					count++;
 				}
 
 				/* Check for "any" kind */
-				if (c_ptr->d_ptr->good_type == GOOD_ANY &&
+				if (library[c_ptr->d_idx].good_type == GOOD_ANY &&
 				    (g->oort_kind == GOOD_ANY ||
 				     g->oort_kind == GOOD_NOVELTY ||
 				     g->oort_kind == GOOD_RARE))
@@ -12287,7 +13004,7 @@ static int check_goal_player(game *g, int goal, int who)
 				c_ptr = &g->deck[x];
 
 				/* Skip worlds */
-				if (c_ptr->d_ptr->type == TYPE_WORLD) continue;
+				if (library[c_ptr->d_idx].type == TYPE_WORLD) continue;
 
 				/* Count developments */
 				count++;
@@ -12309,14 +13026,14 @@ static int check_goal_player(game *g, int goal, int who)
 				c_ptr = &g->deck[x];
 
 				/* Skip non-worlds */
-				if (c_ptr->d_ptr->type != TYPE_WORLD) continue;
+				if (library[c_ptr->d_idx].type != TYPE_WORLD) continue;
 
 				/* Skip windfall worlds */
-				if (c_ptr->d_ptr->flags & FLAG_WINDFALL)
+				if (library[c_ptr->d_idx].flags & FLAG_WINDFALL)
 					continue;
 
 				/* Skip worlds with no good type */
-				if (!c_ptr->d_ptr->good_type) continue;
+				if (!library[c_ptr->d_idx].good_type) continue;
 
 				/* Count world */
 				count++;
@@ -12338,10 +13055,10 @@ static int check_goal_player(game *g, int goal, int who)
 				c_ptr = &g->deck[x];
 
 				/* Loop over card powers */
-				for (i = 0; i < c_ptr->d_ptr->num_power; i++)
+				for (i = 0; i < library[c_ptr->d_idx].num_power; i++)
 				{
 					/* Get power pointer */
-					o_ptr = &c_ptr->d_ptr->powers[i];
+					o_ptr = &library[c_ptr->d_idx].powers[i];
 
 					/* Check for explore phase */
 					if (o_ptr->phase == PHASE_EXPLORE)
@@ -12384,10 +13101,10 @@ static int check_goal_player(game *g, int goal, int who)
 				c_ptr = &g->deck[x];
 
 				/* Loop over card powers */
-				for (i = 0; i < c_ptr->d_ptr->num_power; i++)
+				for (i = 0; i < library[c_ptr->d_idx].num_power; i++)
 				{
 					/* Get power pointer */
-					o_ptr = &c_ptr->d_ptr->powers[i];
+					o_ptr = &library[c_ptr->d_idx].powers[i];
 
 					/* Check for consume phase */
 					if (o_ptr->phase == PHASE_CONSUME)
@@ -12477,8 +13194,13 @@ void check_goal_loss(game *g, int who, int goal)
 	/* Recheck progress */
 	count = check_goal_player(g, goal, who);
 
-	/* Save progress */
-	p_ptr->goal_progress[goal] = count;
+	/* Check for change in progress */
+	if (p_ptr->goal_progress[goal] != count)
+	{
+		/* Save progress */
+		p_ptr->goal_progress[goal] = count;
+		MARK_PLAYER(g, who);
+	}
 
 	/* Check for under the minimum */
 	if (count < goal_minimum(goal)) count = 0;
@@ -12494,8 +13216,13 @@ void check_goal_loss(game *g, int who, int goal)
 		}
 	}
 
-	/* Save new most */
-	g->goal_most[goal] = most;
+	/* Check for change in most */
+	if (g->goal_most[goal] != most)
+	{
+		/* Save new most */
+		g->goal_most[goal] = most;
+		MARK_GOALS(g);
+	}
 
 	/* Check for less than most or less than minimum */
 	if (count < most || count == 0)
@@ -12503,9 +13230,11 @@ void check_goal_loss(game *g, int who, int goal)
 		/* Goal is now unclaimed */
 		p_ptr->goal_claimed[goal] = 0;
 		g->goal_avail[goal] = 1;
+		MARK_PLAYER(g, who);
+		MARK_GOALS(g);
 
 		/* Message */
-		if (!g->simulation)
+		if (show_messages(g))
 		{
 			/* Format message */
 			sprintf(msg, "%s loses %s goal.\n", p_ptr->name,
@@ -12609,20 +13338,27 @@ void check_goals(game *g)
 			/* Get player's progress */
 			count[j] = check_goal_player(g, i, j);
 
-			/* Save progress */
-			g->p[j].goal_progress[i] = count[j];
+			/* Check for change in progress */
+			if (g->p[j].goal_progress[i] != count[j])
+			{
+				/* Save progress */
+				g->p[j].goal_progress[i] = count[j];
+				MARK_PLAYER(g, j);
+			}
 
 			/* Check for player meeting requirement */
 			if (count[j] >= goal_minimum(i))
 			{
 				/* Claim goal */
 				p_ptr->goal_claimed[i] = 1;
+				MARK_PLAYER(g, j);
 
 				/* Remove goal availability */
 				g->goal_avail[i] = 0;
+				MARK_GOALS(g);
 
 				/* Message */
-				if (!g->simulation)
+				if (show_messages(g))
 				{
 					/* Format message */
 					sprintf(msg, "%s claims %s goal.\n",
@@ -12679,6 +13415,9 @@ void check_goals(game *g)
 				break;
 		}
 
+		/* Remember previous most progress */
+		most = g->goal_most[i];
+
 		/* Clear most progress */
 		g->goal_most[i] = 0;
 
@@ -12688,8 +13427,13 @@ void check_goals(game *g)
 			/* Get player's progress */
 			count[j] = check_goal_player(g, i, j);
 
-			/* Save progress */
-			g->p[j].goal_progress[i] = count[j];
+			/* Check for change in progress */
+			if (g->p[j].goal_progress[i] != count[j])
+			{
+				/* Save progress */
+				g->p[j].goal_progress[i] = count[j];
+				MARK_PLAYER(g, j);
+			}
 
 			/* Check for more than most */
 			if (count[j] > g->goal_most[i])
@@ -12702,6 +13446,9 @@ void check_goals(game *g)
 			if (count[j] < goal_minimum(i)) count[j] = 0;
 		}
 
+		/* Check for change in most progress */
+		if (g->goal_most[i] != most) MARK_GOALS(g);
+
 		/* Check for losing goal */
 		for (j = 0; j < g->num_players; j++)
 		{
@@ -12715,9 +13462,11 @@ void check_goals(game *g)
 				/* Lose goal */
 				g->goal_avail[i] = 1;
 				p_ptr->goal_claimed[i] = 0;
+				MARK_PLAYER(g, j);
+				MARK_GOALS(g);
 
 				/* Message */
-				if (!g->simulation)
+				if (show_messages(g))
 				{
 					/* Format message */
 					sprintf(msg, "%s loses %s goal.\n",
@@ -12753,6 +13502,7 @@ void check_goals(game *g)
 			{
 				/* Goal is no longer available */
 				g->goal_avail[i] = 0;
+				MARK_GOALS(g);
 
 				/* Loop over players */
 				for (k = 0; k < g->num_players; k++)
@@ -12762,10 +13512,11 @@ void check_goals(game *g)
 
 					/* Award card to player with most */
 					p_ptr->goal_claimed[i] = (j == k);
+					MARK_PLAYER(g, k);
 				}
 
 				/* Message */
-				if (!g->simulation)
+				if (show_messages(g))
 				{
 					/* Get player pointer */
 					p_ptr = &g->p[j];
@@ -12865,6 +13616,9 @@ static void rotate_players(game *g)
 		if (c_ptr->owner < 0) c_ptr->owner = g->num_players - 1;
 	}
 
+	/* Every card and player has changed */
+	mark_all(g);
+
 	/* Loop over players */
 	for (i = 0; i < g->num_players; i++)
 	{
@@ -12890,11 +13644,15 @@ static void check_debug_rotate(game *g)
 		/* Rotate players */
 		for (i = 0; i < g->debug_rotate; ++i) rotate_players(g);
 
-		/* Format message */
-		sprintf(msg, "%s is now the first player.\n", g->p[0].name);
+		/* Check for messages */
+		if (show_messages(g))
+		{
+			/* Format message */
+			sprintf(msg, "%s is now the first player.\n", g->p[0].name);
 
-		/* Add message */
-		message_add_formatted(g, msg, FORMAT_DEBUG);
+			/* Add message */
+			message_add_formatted(g, msg, FORMAT_DEBUG);
+		}
 
 		/* Clear rotation */
 		g->debug_rotate = 0;
@@ -12919,12 +13677,12 @@ int start_callback(game *g, int who, int list[], int n, int special[], int ns)
 	if (n != 2) return 0;
 
 	/* Message */
-	if (!g->simulation && p_ptr->control->private_message)
+	if (show_messages(g) && p_ptr->control->private_message)
 	{
 		/* Format message */
 		sprintf(msg, "%s discards the start world %s.\n",
 		        p_ptr->name,
-		        g->deck[special[1]].d_ptr->name);
+		        library[g->deck[special[1]].d_idx].name);
 
 		/* Send message */
 		p_ptr->control->private_message(g, who, msg, FORMAT_DISCARD);
@@ -12973,7 +13731,7 @@ void start_chosen(game *g)
 		c_ptr = &g->deck[p_ptr->start];
 
 		/* Check for starting with less */
-		if (c_ptr->d_ptr->flags & FLAG_STARTHAND_3) j = 3;
+		if (library[c_ptr->d_idx].flags & FLAG_STARTHAND_3) j = 3;
 
 		/* Check for nothing to discard */
 		if (n == j) continue;
@@ -13018,7 +13776,7 @@ void start_chosen(game *g)
 		c_ptr = &g->deck[p_ptr->start];
 
 		/* Check for starting with saved card */
-		if (c_ptr->d_ptr->flags & FLAG_START_SAVE)
+		if (library[c_ptr->d_idx].flags & FLAG_START_SAVE)
 		{
 			/* Get cards in hand */
 			n = get_player_area(g, i, hand, WHERE_HAND);
@@ -13037,7 +13795,7 @@ void start_chosen(game *g)
 			move_card(g, hand[0], i, WHERE_SAVED);
 
 			/* Message */
-			if (!g->simulation)
+			if (show_messages(g))
 			{
 				/* Format message */
 				sprintf(msg, "%s saves 1 card under Galactic Scavengers.\n",
@@ -13051,7 +13809,7 @@ void start_chosen(game *g)
 				{
 					/* Format message */
 					sprintf(msg, "%s saves %s.\n", p_ptr->name,
-					        g->deck[hand[0]].d_ptr->name);
+					        library[g->deck[hand[0]].d_idx].name);
 
 					/* Send message */
 					g->p[i].control->private_message(g, i, msg,
@@ -13152,13 +13910,17 @@ void begin_game(game *g)
 	char msg[1024];
 
 	/* Send game information */
-	game_information(g);
+	if (show_messages(g)) game_information(g);
 
 	/* Start game */
 	g->cur_action = ACT_GAME_START;
 
-	/* Send start of game message */
-	message_add_formatted(g, "=== Start of game ===\n", FORMAT_EM);
+	/* Check for messages */
+	if (show_messages(g))
+	{
+		/* Send start of game message */
+		message_add_formatted(g, "=== Start of game ===\n", FORMAT_EM);
+	}
 
 	/* Loop over cards in deck */
 	for (i = 0; i < g->deck_size; i++)
@@ -13170,21 +13932,21 @@ void begin_game(game *g)
 		if (c_ptr->where != WHERE_DECK) continue;
 
 		/* Check for start world */
-		if (c_ptr->d_ptr->flags & FLAG_START)
+		if (library[c_ptr->d_idx].flags & FLAG_START)
 		{
 			/* Add to list */
 			start[num_start++] = i;
 		}
 
 		/* Check for red start world */
-		if (c_ptr->d_ptr->flags & FLAG_START_RED)
+		if (library[c_ptr->d_idx].flags & FLAG_START_RED)
 		{
 			/* Add to list */
 			start_red[num_start_red++] = i;
 		}
 
 		/* Check for blue start world */
-		if (c_ptr->d_ptr->flags & FLAG_START_BLUE)
+		if (library[c_ptr->d_idx].flags & FLAG_START_BLUE)
 		{
 			/* Add to list */
 			start_blue[num_start_blue++] = i;
@@ -13225,17 +13987,18 @@ void begin_game(game *g)
 			/* XXX Move card to discard */
 			c_ptr->owner = -1;
 			c_ptr->where = WHERE_DISCARD;
+			MARK_CARD(g, start_picks[i][0]);
 
 			/* Card is known to player */
 			c_ptr->misc |= (1 << i);
 
 			/* Message */
-			if (g->p[i].control->private_message)
+			if (show_messages(g) && g->p[i].control->private_message)
 			{
 				/* Format message */
 				sprintf(msg, "%s draws the start world %s.\n",
 				        g->p[i].name,
-				        c_ptr->d_ptr->name);
+				        library[c_ptr->d_idx].name);
 
 				/* Send message */
 				g->p[i].control->private_message(g, i, msg, FORMAT_DRAW);
@@ -13247,17 +14010,18 @@ void begin_game(game *g)
 			/* XXX Move card to discard */
 			c_ptr->owner = -1;
 			c_ptr->where = WHERE_DISCARD;
+			MARK_CARD(g, start_picks[i][1]);
 
 			/* Card is known to player */
 			c_ptr->misc |= (1 << i);
 
 			/* Message */
-			if (g->p[i].control->private_message)
+			if (show_messages(g) && g->p[i].control->private_message)
 			{
 				/* Format message */
 				sprintf(msg, "%s draws the start world %s.\n",
 				        g->p[i].name,
-				        c_ptr->d_ptr->name);
+				        library[c_ptr->d_idx].name);
 
 				/* Send message */
 				g->p[i].control->private_message(g, i, msg, FORMAT_DRAW);
@@ -13347,6 +14111,7 @@ void begin_game(game *g)
 
 			/* Temporarily move card to discard pile */
 			c_ptr->where = WHERE_DISCARD;
+			MARK_CARD(g, start[i]);
 		}
 
 		/* Loop over players */
@@ -13392,6 +14157,7 @@ void begin_game(game *g)
 
 			/* Move card back to deck */
 			c_ptr->where = WHERE_DECK;
+			MARK_CARD(g, start[i]);
 		}
 
 		/* Check for "draw four" campaign flag */
@@ -13438,12 +14204,16 @@ void begin_game(game *g)
 		/* Get player's start world */
 		c_ptr = &g->deck[p_ptr->start];
 
-		/* Format message */
-		sprintf(msg, "%s starts with %s.\n", p_ptr->name,
-		        c_ptr->d_ptr->name);
+		/* Check for messages */
+		if (show_messages(g))
+		{
+			/* Format message */
+			sprintf(msg, "%s starts with %s.\n", p_ptr->name,
+			        library[c_ptr->d_idx].name);
 
-		/* Send message */
-		message_add(g, msg);
+			/* Send message */
+			message_add(g, msg);
+		}
 	}
 
 	/* Start worlds are chosen */
@@ -13456,11 +14226,15 @@ void begin_game(game *g)
 	/* Rotate players until player 0 holds lowest start world */
 	for (i = 0; i < low_i; i++) rotate_players(g);
 
-	/* Format message */
-	sprintf(msg, "%s is the first player.\n", g->p[0].name);
+	/* Check for messages */
+	if (show_messages(g))
+	{
+		/* Format message */
+		sprintf(msg, "%s is the first player.\n", g->p[0].name);
 
-	/* Send message */
-	message_add_formatted(g, msg, FORMAT_VERBOSE);
+		/* Send message */
+		message_add_formatted(g, msg, FORMAT_VERBOSE);
+	}
 
 	/* Check for "draw extra" campaign flag */
 	if (g->camp && (g->camp->flags & CAMP_DRAW_EXTRA))
@@ -13471,11 +14245,15 @@ void begin_game(game *g)
 			/* Draw one card */
 			int j = draw_card(g, i, NULL);
 
-			/* Format message */
-			sprintf(msg, "%s is given %s.\n", g->p[i].name, g->deck[j].d_ptr->name);
+			/* Check for messages */
+			if (show_messages(g))
+			{
+				/* Format message */
+				sprintf(msg, "%s is given %s.\n", g->p[i].name, library[g->deck[j].d_idx].name);
 
-			/* Send message */
-			message_add(g, msg);
+				/* Send message */
+				message_add(g, msg);
+			}
 		}
 	}
 
@@ -13587,6 +14365,7 @@ void note_actions(game *g)
 			{
 				/* Mark prestige action as taken */
 				p_ptr->prestige_action_used = 1;
+				MARK_PLAYER(g, i);
 
 				/* Spend a prestige */
 				spend_prestige(g, i, 1);
@@ -13597,6 +14376,7 @@ void note_actions(game *g)
 			{
 				/* Mark prestige/search as taken */
 				p_ptr->prestige_action_used = 1;
+				MARK_PLAYER(g, i);
 			}
 		}
 	}
@@ -13641,7 +14421,7 @@ int game_round(game *g)
 	if (g->game_over) return 0;
 
 	/* Message */
-	if (!g->simulation)
+	if (show_messages(g))
 	{
 		/* Format message */
 		sprintf(msg, "=== Round %d begins ===\n", g->round);
@@ -13697,9 +14477,10 @@ int game_round(game *g)
 		/* Get chosen actions */
 		extract_choice(g, i, CHOICE_ACTION, p_ptr->action, &j,
 		               NULL, NULL);
+		MARK_PLAYER(g, i);
 
-		/* Check for real game */
-		if (!g->simulation && (!g->advanced || last))
+		/* Check for messages */
+		if (show_messages(g) && (!g->advanced || last))
 		{
 			/* Format message */
 			sprintf(msg, "%s chooses %s.\n", p_ptr->name,
@@ -13717,8 +14498,8 @@ int game_round(game *g)
 			}
 		}
 
-		/* Check for real advanced game */
-		else if (!g->simulation)
+		/* Check for messages in advanced game */
+		else if (show_messages(g))
 		{
 			/* Format message */
 			sprintf(msg, "%s chooses %s/%s.\n", p_ptr->name,
@@ -13771,8 +14552,8 @@ int game_round(game *g)
 		/* Only do player with "select last" */
 		if (!count_active_flags(g, i, FLAG_SELECT_LAST)) continue;
 
-		/* Check for real game */
-		if (!g->simulation && !g->advanced)
+		/* Check for messages */
+		if (show_messages(g) && !g->advanced)
 		{
 			/* Format message */
 			sprintf(msg, "%s chooses %s.\n", p_ptr->name,
@@ -13790,8 +14571,8 @@ int game_round(game *g)
 			}
 		}
 
-		/* Check for real game */
-		if (!g->simulation && g->advanced)
+		/* Check for messages */
+		if (show_messages(g) && g->advanced)
 		{
 			/* Format message */
 			sprintf(msg, "%s chooses %s/%s.\n", p_ptr->name,
@@ -13827,8 +14608,8 @@ int game_round(game *g)
 		/* Check for rotation */
 		check_debug_rotate(g);
 
-		/* Check for real game */
-		if (!g->simulation)
+		/* Check for messages */
+		if (show_messages(g))
 		{
 			/* Format message */
 			sprintf(msg, "--- %s phase ---\n", plain_actname[i]);
@@ -13946,6 +14727,7 @@ int game_round(game *g)
 	{
 		/* Clear both choices */
 		g->p[i].action[0] = g->p[i].action[1] = -1;
+		MARK_PLAYER(g, i);
 
 		/* Set low hand size */
 		g->p[i].low_hand = count_player_area(g, i, WHERE_HAND);
@@ -14311,10 +15093,10 @@ int get_score_bonus(game *g, int who, int which)
 	score = &g->deck[which];
 
 	/* Loop over bonuses */
-	for (i = 0; i < score->d_ptr->num_vp_bonus; i++)
+	for (i = 0; i < library[score->d_idx].num_vp_bonus; i++)
 	{
 		/* Get VP bonus pointer */
-		v_ptr = &score->d_ptr->bonuses[i];
+		v_ptr = &library[score->d_idx].bonuses[i];
 
 		/* Check for simple bonuses */
 		if (v_ptr->type == VP_THREE_VP)
@@ -14352,11 +15134,11 @@ int get_score_bonus(game *g, int who, int which)
 				c_ptr = &g->deck[x];
 
 				/* Skip developments */
-				if (c_ptr->d_ptr->type == TYPE_DEVELOPMENT)
+				if (library[c_ptr->d_idx].type == TYPE_DEVELOPMENT)
 					continue;
 
 				/* Check for "any" kind */
-				if (c_ptr->d_ptr->good_type == GOOD_ANY)
+				if (library[c_ptr->d_idx].good_type == GOOD_ANY)
 				{
 					/* Mark current kind */
 					types[g->oort_kind] = 1;
@@ -14364,7 +15146,7 @@ int get_score_bonus(game *g, int who, int which)
 				else
 				{
 					/* Mark type */
-					types[c_ptr->d_ptr->good_type] = 1;
+					types[library[c_ptr->d_idx].good_type] = 1;
 				}
 			}
 
@@ -14396,13 +15178,13 @@ int get_score_bonus(game *g, int who, int which)
 		c_ptr = &g->deck[x];
 
 		/* Loop over scoring card's bonuses */
-		for (i = 0; i < score->d_ptr->num_vp_bonus; i++)
+		for (i = 0; i < library[score->d_idx].num_vp_bonus; i++)
 		{
 			/* Get bonus pointer */
-			v_ptr = &score->d_ptr->bonuses[i];
+			v_ptr = &library[score->d_idx].bonuses[i];
 
 			/* Check for match against current power */
-			if (bonus_match(g, v_ptr, c_ptr->d_ptr))
+			if (bonus_match(g, v_ptr, &library[c_ptr->d_idx]))
 			{
 				/* Add score */
 				amt += v_ptr->point;
@@ -14442,10 +15224,10 @@ static void score_game_player(game *g, int who)
 		c_ptr = &g->deck[x];
 
 		/* Add points from card */
-		p_ptr->end_vp += c_ptr->d_ptr->vp;
+		p_ptr->end_vp += library[c_ptr->d_idx].vp;
 
 		/* Check for VP bonuses */
-		if (c_ptr->d_ptr->num_vp_bonus)
+		if (library[c_ptr->d_idx].num_vp_bonus)
 		{
 			/* Add in bonuses */
 			p_ptr->end_vp += get_score_bonus(g, who, x);
@@ -14516,7 +15298,7 @@ void score_game(game *g)
 		c_ptr = &g->deck[i];
 
 		/* Skip cards that don't have "any" good type */
-		if (c_ptr->d_ptr->good_type != GOOD_ANY) continue;
+		if (library[c_ptr->d_idx].good_type != GOOD_ANY) continue;
 
 		/* Skip the card if it is not active */
 		if (c_ptr->where != WHERE_ACTIVE) break;
@@ -14541,7 +15323,7 @@ void score_game(game *g)
 			for (j = GOOD_NOVELTY; j <= GOOD_ALIEN; j++)
 			{
 				/* Simulate game */
-				sim = *g;
+				copy_game(&sim, g);
 
 				/* Mark game as simulation */
 				sim.simulation = 1;
@@ -14590,8 +15372,8 @@ void declare_winner(game *g)
 	int i, oort_owner = -1, th, tg, b_s = -1, b_t = -1, num_b_s = 0;
 	char msg[1024];
 
-	/* Check for simulation */
-	if (!g->simulation)
+	/* Check for messages */
+	if (show_messages(g))
 	{
 		/* Send end of game message */
 		message_add_formatted(g, "=== End of game ===\n", FORMAT_EM);
@@ -14607,7 +15389,7 @@ void declare_winner(game *g)
 		c_ptr = &g->deck[i];
 
 		/* Skip cards that don't have "any" good type */
-		if (c_ptr->d_ptr->good_type != GOOD_ANY) continue;
+		if (library[c_ptr->d_idx].good_type != GOOD_ANY) continue;
 
 		/* Skip the card if it is not active */
 		if (c_ptr->where != WHERE_ACTIVE) break;
@@ -14625,8 +15407,8 @@ void declare_winner(game *g)
 		/* Check for bigger score */
 		if (p_ptr->end_vp > b_s) b_s = p_ptr->end_vp;
 
-		/* Check for real game and owner of "any" good type */
-		if (!g->simulation && i == oort_owner)
+		/* Check for messages and owner of "any" good type */
+		if (show_messages(g) && i == oort_owner)
 		{
 			/* Format message */
 			sprintf(msg, "%s changes Alien Oort Cloud Refinery's "
@@ -14664,8 +15446,8 @@ void declare_winner(game *g)
 		/* Get player pointer */
 		p_ptr = &g->p[i];
 
-		/* Check for simulation */
-		if (!g->simulation)
+		/* Check for messages */
+		if (show_messages(g))
 		{
 			/* Format message */
 			sprintf(msg, "%s ends with %d VP%s.\n", g->p[i].name,
@@ -14684,8 +15466,8 @@ void declare_winner(game *g)
 		/* Get tiebreaker (goods) */
 		tg = count_player_area(g, i, WHERE_GOOD);
 
-		/* Check for simulation */
-		if (!g->simulation && num_b_s > 1)
+		/* Check for messages */
+		if (show_messages(g) && num_b_s > 1)
 		{
 			/* Format message */
 			sprintf(msg, "%s has %d card%s in hand and %d good%s "
@@ -14703,8 +15485,8 @@ void declare_winner(game *g)
 		p_ptr->winner = 1;
 	}
 
-	/* Check for simulation */
-	if (!g->simulation)
+	/* Check for messages */
+	if (show_messages(g))
 	{
 		/* Loop over players */
 		for (i = 0; i < g->num_players; i++)
@@ -94,13 +94,18 @@ static int game_replaying;
 /*
  * Choice logs for each player.
  */
-static int *orig_log[MAX_PLAYER];
+static choice_buffer *orig_log[MAX_PLAYER];
 
 /*
  * Original log sizes for each player.
  */
 static int orig_log_size[MAX_PLAYER];
 
+/*
+ * Game state at the start of each round, used to speed up undo and redo.
+ */
+static checkpoint_list checkpoints;
+
 /*
  * Games started (used for random sampling)
  */
@@ -757,6 +762,42 @@ static void clear_log(void)
 	message_last_y = 0;
 }
 
+/*
+ * Return the length of the message log.
+ */
+static int log_length(void)
+{
+	GtkTextBuffer *message_buffer;
+
+	/* Get message buffer */
+	message_buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(message_view));
+
+	/* Return number of characters */
+	return gtk_text_buffer_get_char_count(message_buffer);
+}
+
+/*
+ * Remove messages past the given length from the message log.
+ */
+static void truncate_log(int len)
+{
+	GtkTextBuffer *message_buffer;
+	GtkTextIter start_iter, end_iter;
+
+	/* Get message buffer */
+	message_buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(message_view));
+
+	/* Get iterators at truncation point and end of buffer */
+	gtk_text_buffer_get_iter_at_offset(message_buffer, &start_iter, len);
+	gtk_text_buffer_get_end_iter(message_buffer, &end_iter);
+
+	/* Delete text */
+	gtk_text_buffer_delete(message_buffer, &start_iter, &end_iter);
+
+	/* Reset last seen line */
+	message_last_y = 0;
+}
+
 /*
  * Draw a line across the message text view.
  */
@@ -868,10 +909,10 @@ static gboolean message_motion(GtkWidget *text_view, GdkEventMotion *event,
 	for (i = 0; i < real_game.deck_size; i++)
 	{
 		/* Check if card name is found */
-		if (strstr(line, real_game.deck[i].d_ptr->name))
+		if (strstr(line, library[real_game.deck[i].d_idx].name))
 		{
 			/* Update image */
-			update_card(image_cache[real_game.deck[i].d_ptr->index]);
+			update_card(image_cache[real_game.deck[i].d_idx]);
 
 			/* Card is found */
 			break;
@@ -2258,18 +2299,18 @@ static int cmp_hand(const void *h1, const void *h2)
 	if (!i_ptr1->gapped && i_ptr2->gapped) return -1;
 
 	/* Worlds come before developments */
-	if (c_ptr1->d_ptr->type != c_ptr2->d_ptr->type)
+	if (library[c_ptr1->d_idx].type != library[c_ptr2->d_idx].type)
 	{
 		/* Check for development */
-		if (c_ptr1->d_ptr->type == TYPE_DEVELOPMENT) return 1;
-		if (c_ptr2->d_ptr->type == TYPE_DEVELOPMENT) return -1;
+		if (library[c_ptr1->d_idx].type == TYPE_DEVELOPMENT) return 1;
+		if (library[c_ptr2->d_idx].type == TYPE_DEVELOPMENT) return -1;
 	}
 
 	/* Sort by cost */
-	if (c_ptr1->d_ptr->cost != c_ptr2->d_ptr->cost)
+	if (library[c_ptr1->d_idx].cost != library[c_ptr2->d_idx].cost)
 	{
 		/* Return cost difference */
-		return c_ptr1->d_ptr->cost - c_ptr2->d_ptr->cost;
+		return library[c_ptr1->d_idx].cost - library[c_ptr2->d_idx].cost;
 	}
 
 	/* Otherwise sort by index */
@@ -2964,21 +3005,21 @@ static char *get_vp_tooltip(game *g, int who)
 		c_ptr = &g->deck[x];
 
 		/* Check for world */
-		if (c_ptr->d_ptr->type == TYPE_WORLD)
+		if (library[c_ptr->d_idx].type == TYPE_WORLD)
 		{
 			/* Add VP from this world */
-			worlds += c_ptr->d_ptr->vp;
+			worlds += library[c_ptr->d_idx].vp;
 		}
 
 		/* Check for development */
-		else if (c_ptr->d_ptr->type == TYPE_DEVELOPMENT)
+		else if (library[c_ptr->d_idx].type == TYPE_DEVELOPMENT)
 		{
 			/* Add VP from this development */
-			devs += c_ptr->d_ptr->vp;
+			devs += library[c_ptr->d_idx].vp;
 		}
 
 		/* Check for VP bonuses */
-		if (c_ptr->d_ptr->num_vp_bonus)
+		if (library[c_ptr->d_idx].num_vp_bonus)
 		{
 			/* Count VPs from this card */
 			t = get_score_bonus(g, who, x);
@@ -2987,7 +3028,7 @@ static char *get_vp_tooltip(game *g, int who)
 			strcpy(text, bonus);
 
 			/* Format text */
-			sprintf(bonus, "\n%s: %d VP%s", c_ptr->d_ptr->name, t, PLURAL(t));
+			sprintf(bonus, "\n%s: %d VP%s", library[c_ptr->d_idx].name, t, PLURAL(t));
 
 			/* Add to bonus string */
 			strcat(bonus, text);
@@ -3183,7 +3224,7 @@ static char *get_discount_tooltip(game *g, discounts *discount)
 			/* Create text */
 			sprintf(text, "\nMay discard %s to place\n"
 			        "  a non-military non-Alien world at 0 cost",
-			        discount->zero[i]->d_ptr->name);
+			        library[discount->zero[i]->d_idx].name);
 			strcat(msg, text);
 		}
 	}
@@ -3195,7 +3236,7 @@ static char *get_discount_tooltip(game *g, discounts *discount)
 		{
 			sprintf(text, "\nMay discard %s to place\n"
 			        "  an additional non-military non-Alien world at 0 cost",
-			        discount->extra_zero->d_ptr->name);
+			        library[discount->extra_zero->d_idx].name);
 			strcat(msg, text);
 		}
 	}
@@ -3206,7 +3247,7 @@ static char *get_discount_tooltip(game *g, discounts *discount)
 		/* Create text */
 		sprintf(text, "\nMay discard %s\n"
 		        "  to conquer a non-military world (defense = cost - 2)",
-		        discount->conquer_settle_2->d_ptr->name);
+		        library[discount->conquer_settle_2->d_idx].name);
 		strcat(msg, text);
 	}
 
@@ -3216,7 +3257,7 @@ static char *get_discount_tooltip(game *g, discounts *discount)
 		/* Create text */
 		sprintf(text, "\nMay discard %s\n"
 		        "  to conquer a non-military world (defense = cost)",
-		        discount->conquer_settle_0->d_ptr->name);
+		        library[discount->conquer_settle_0->d_idx].name);
 		strcat(msg, text);
 	}
 
@@ -3418,7 +3459,7 @@ static char *card_hand_tooltip(game *g, int who, int which)
 	c_ptr = &sim.deck[which];
 
 	/* Check for development type */
-	if (c_ptr->d_ptr->type == TYPE_DEVELOPMENT)
+	if (library[c_ptr->d_idx].type == TYPE_DEVELOPMENT)
 	{
 		/* Get list of develop powers */
 		n = get_powers(&sim, who, PHASE_DEVELOP, w_list);
@@ -3433,7 +3474,7 @@ static char *card_hand_tooltip(game *g, int who, int which)
 			if (o_ptr->code & P2_PRESTIGE_REBEL)
 			{
 				/* Check for Rebel flag on played card */
-				if (c_ptr->d_ptr->flags & FLAG_REBEL)
+				if (library[c_ptr->d_idx].flags & FLAG_REBEL)
 				{
 					/* Reward prestige */
 					sim.p[who].prestige += o_ptr->value;
@@ -3444,7 +3485,7 @@ static char *card_hand_tooltip(game *g, int who, int which)
 			if (o_ptr->code & P2_PRESTIGE_SIX)
 			{
 				/* Check for six-cost development */
-				if (c_ptr->d_ptr->cost == 6)
+				if (library[c_ptr->d_idx].cost == 6)
 				{
 					/* Reward prestige */
 					sim.p[who].prestige += o_ptr->value;
@@ -3479,8 +3520,8 @@ static char *card_hand_tooltip(game *g, int who, int which)
 			if (o_ptr->code & P3_PRESTIGE_REBEL)
 			{
 				/* Check for rebel military world placed */
-				if ((c_ptr->d_ptr->flags & FLAG_REBEL) &&
-				    (c_ptr->d_ptr->flags & FLAG_MILITARY))
+				if ((library[c_ptr->d_idx].flags & FLAG_REBEL) &&
+				    (library[c_ptr->d_idx].flags & FLAG_MILITARY))
 				{
 					/* Reward prestige */
 					sim.p[who].prestige += o_ptr->value;
@@ -3491,8 +3532,8 @@ static char *card_hand_tooltip(game *g, int who, int which)
 			if (o_ptr->code & P3_PRODUCE_PRESTIGE)
 			{
 				/* Check for production world */
-				if (c_ptr->d_ptr->good_type > 0 &&
-				    !(c_ptr->d_ptr->flags & FLAG_WINDFALL))
+				if (library[c_ptr->d_idx].good_type > 0 &&
+				    !(library[c_ptr->d_idx].flags & FLAG_WINDFALL))
 				{
 					/* Reward prestige */
 					sim.p[who].prestige += o_ptr->value;
@@ -3503,8 +3544,8 @@ static char *card_hand_tooltip(game *g, int who, int which)
 			if (o_ptr->code & P3_AUTO_PRODUCE)
 			{
 				/* Check for production world placed */
-				if (c_ptr->d_ptr->good_type > 0 &&
-				    !(c_ptr->d_ptr->flags & FLAG_WINDFALL))
+				if (library[c_ptr->d_idx].good_type > 0 &&
+				    !(library[c_ptr->d_idx].flags & FLAG_WINDFALL))
 				{
 					/* Add good to world */
 					add_good(&sim, which);
@@ -3571,7 +3612,7 @@ static char *card_table_tooltip(game *g, int who, int which)
 	c_ptr = &g->deck[which];
 
 	/* Check for cards saved */
-	if (c_ptr->d_ptr->flags & FLAG_START_SAVE)
+	if (library[c_ptr->d_idx].flags & FLAG_START_SAVE)
 	{
 		/* Loop over cards in deck */
 		for (i = 0; i < g->deck_size; i++)
@@ -3603,7 +3644,7 @@ static char *card_table_tooltip(game *g, int who, int which)
 
 			/* Add card name to tooltip */
 			strcat(text, "\n\t");
-			strcat(text, b_ptr->d_ptr->name);
+			strcat(text, library[b_ptr->d_idx].name);
 		}
 
 		/* Return tooltip */
@@ -3621,7 +3662,7 @@ static char *card_table_tooltip(game *g, int who, int which)
 	}
 
 	/* Check for vp bonuses */
-	else if (c_ptr->d_ptr->num_vp_bonus > 0)
+	else if (library[c_ptr->d_idx].num_vp_bonus > 0)
 	{
 		/* Remember old kind */
 		kind = g->oort_kind;
@@ -3700,7 +3741,7 @@ static void military_world_payment(game *g, int who, int which, int mil_only,
 	strength = strength_against(g, who, which, -1, 0) + mil_bonus;
 
 	/* Compute extra military needed */
-	*military = c_ptr->d_ptr->cost - strength;
+	*military = library[c_ptr->d_idx].cost - strength;
 
 	/* Do not reduce below 0 */
 	if (*military <= 0) *military = 0;
@@ -3716,61 +3757,61 @@ static void military_world_payment(game *g, int who, int which, int mil_only,
 
 	/* Check for pay for non-Alien military worlds */
 	if (d_ptr->non_alien_mil_card &&
-	    !(c_ptr->d_ptr->flags & FLAG_XENO) &&
-	    c_ptr->d_ptr->good_type != GOOD_ALIEN)
+	    !(library[c_ptr->d_idx].flags & FLAG_XENO) &&
+	    library[c_ptr->d_idx].good_type != GOOD_ALIEN)
 	{
 		/* Remember reduction */
 		pay_for_mil = d_ptr->non_alien_mil_bonus;
 
 		/* Save card name */
-		*cost_card = d_ptr->non_alien_mil_card->d_ptr->name;
+		*cost_card = library[d_ptr->non_alien_mil_card->d_idx].name;
 	}
 
 	/* Check for pay for Rebel military worlds */
 	if (d_ptr->rebel_mil_card &&
-	    (c_ptr->d_ptr->flags & FLAG_REBEL) &&
-	    !(c_ptr->d_ptr->flags & FLAG_XENO) &&
+	    (library[c_ptr->d_idx].flags & FLAG_REBEL) &&
+	    !(library[c_ptr->d_idx].flags & FLAG_XENO) &&
 	    d_ptr->rebel_mil_bonus > pay_for_mil)
 	{
 		/* Remember reduction */
 		pay_for_mil = d_ptr->rebel_mil_bonus;
 
 		/* Save card name */
-		*cost_card = d_ptr->rebel_mil_card->d_ptr->name;
+		*cost_card = library[d_ptr->rebel_mil_card->d_idx].name;
 	}
 
 	/* Check for pay for Chromosome military worlds */
 	if (d_ptr->chromo_mil_card &&
-	    (c_ptr->d_ptr->flags & FLAG_CHROMO) &&
-	    !(c_ptr->d_ptr->flags & FLAG_XENO) &&
+	    (library[c_ptr->d_idx].flags & FLAG_CHROMO) &&
+	    !(library[c_ptr->d_idx].flags & FLAG_XENO) &&
 	    d_ptr->chromo_mil_bonus > pay_for_mil)
 	{
 		/* Remember reduction */
 		pay_for_mil = d_ptr->chromo_mil_bonus;
 
 		/* Save card name */
-		*cost_card = d_ptr->chromo_mil_card->d_ptr->name;
+		*cost_card = library[d_ptr->chromo_mil_card->d_idx].name;
 	}
 
 	/* Check for pay for Alien military worlds */
 	if (d_ptr->alien_mil_card &&
-	    c_ptr->d_ptr->good_type == GOOD_ALIEN &&
-	    !(c_ptr->d_ptr->flags & FLAG_XENO) &&
+	    library[c_ptr->d_idx].good_type == GOOD_ALIEN &&
+	    !(library[c_ptr->d_idx].flags & FLAG_XENO) &&
 	    d_ptr->alien_mil_bonus > pay_for_mil)
 	{
 		/* Remember reduction */
 		pay_for_mil = d_ptr->alien_mil_bonus;
 
 		/* Save card name */
-		*cost_card = d_ptr->alien_mil_card->d_ptr->name;
+		*cost_card = library[d_ptr->alien_mil_card->d_idx].name;
 	}
 
 	/* Check for any pay-for-military power */
 	if (cost_card)
 	{
 		/* Compute cost */
-		*cost = c_ptr->d_ptr->cost - d_ptr->base - d_ptr->bonus -
-		        d_ptr->specific[c_ptr->d_ptr->good_type] - pay_for_mil;
+		*cost = library[c_ptr->d_idx].cost - d_ptr->base - d_ptr->bonus -
+		        d_ptr->specific[library[c_ptr->d_idx].good_type] - pay_for_mil;
 
 		/* Do not reduce cost below 0 */
 		if (*cost < 0) *cost = 0;
@@ -3799,8 +3840,8 @@ static void peaceful_world_payment(game *g, int who, int which, int mil_only,
 	else
 	{
 		/* Compute cost */
-		*cost = c_ptr->d_ptr->cost - d_ptr->base - d_ptr->bonus -
-				d_ptr->specific[c_ptr->d_ptr->good_type];
+		*cost = library[c_ptr->d_idx].cost - d_ptr->base - d_ptr->bonus -
+				d_ptr->specific[library[c_ptr->d_idx].good_type];
 
 		/* Do not reduce below 0 */
 		if (*cost < 0) *cost = 0;
@@ -3816,7 +3857,7 @@ static void peaceful_world_payment(game *g, int who, int which, int mil_only,
 	if (d_ptr->conquer_settle_0)
 	{
 		/* Compute extra military needed */
-		*conquer_mil = c_ptr->d_ptr->cost - strength;
+		*conquer_mil = library[c_ptr->d_idx].cost - strength;
 
 		/* Do not reduce below 0 */
 		if (*conquer_mil < 0) *conquer_mil = 0;
@@ -3826,7 +3867,7 @@ static void peaceful_world_payment(game *g, int who, int which, int mil_only,
 	if (d_ptr->conquer_settle_2)
 	{
 		/* Compute extra military needed */
-		*conquer_discount_mil = c_ptr->d_ptr->cost - strength - 2;
+		*conquer_discount_mil = library[c_ptr->d_idx].cost - strength - 2;
 
 		/* Do not reduce below 0 */
 		if (*conquer_discount_mil < 0) *conquer_discount_mil = 0;
@@ -3880,27 +3921,27 @@ static char *card_settle_tooltip(game *g, int who, int special,
 
 	/* XXX Check for no pay-for-military available */
 	mil_only = special >= 0 &&
-	           !strcmp(g->deck[special].d_ptr->name, "Rebel Sneak Attack");
+	           !strcmp(library[g->deck[special].d_idx].name, "Rebel Sneak Attack");
 
 	/* XXX Check for zero cost */
 	if (special >= 0 &&
-	    !strcmp(g->deck[special].d_ptr->name, "Terraforming Project"))
+	    !strcmp(library[g->deck[special].d_idx].name, "Terraforming Project"))
 	{
 		/* No cost to place */
 		p += sprintf(p, "Cost to place: 0\n");
 	}
 	/* Check for military world */
-	else if (c_ptr->d_ptr->flags & FLAG_MILITARY)
+	else if (library[c_ptr->d_idx].flags & FLAG_MILITARY)
 	{
 		/* Start with base bonus */
 		bonus = m_ptr->max_bonus;
 
 		/* Check for Xeno world */
-		if (c_ptr->d_ptr->flags & FLAG_XENO) bonus += m_ptr->max_bonus_xeno;
+		if (library[c_ptr->d_idx].flags & FLAG_XENO) bonus += m_ptr->max_bonus_xeno;
 
 		/* XXX Check for using extra military */
 		if (special >= 0 &&
-		    !strcmp(g->deck[special].d_ptr->name, "Imperium Supply Convoy"))
+		    !strcmp(library[g->deck[special].d_idx].name, "Imperium Supply Convoy"))
 		{
 			/* Save card */
 			supply_convoy = 1;
@@ -3909,7 +3950,7 @@ static char *card_settle_tooltip(game *g, int who, int special,
 			placed = g->p[who].head[WHERE_ACTIVE];
 
 			/* Compute strength used for first world */
-			mil_bonus = g->deck[placed].d_ptr->cost - strength_first(g, who, g->p[who].head[WHERE_ACTIVE], which);
+			mil_bonus = library[g->deck[placed].d_idx].cost - strength_first(g, who, g->p[who].head[WHERE_ACTIVE], which);
 		}
 
 		/* Compute payment */
@@ -3945,14 +3986,14 @@ static char *card_settle_tooltip(game *g, int who, int special,
 			}
 
 			/* Check for any pay-for-military power and reduce to 0 */
-			if (c_ptr->d_ptr->good_type != GOOD_ALIEN)
+			if (library[c_ptr->d_idx].good_type != GOOD_ALIEN)
 			{
 				/* Check for reduce to zero cost */
 				if (d_ptr->zero[0])
 				{
 					/* Format text */
 					p += sprintf(p, "Cost to place if using %s\n  and %s: 0\n",
-					             cost_card, d_ptr->zero[0]->d_ptr->name);
+					             cost_card, library[d_ptr->zero[0]->d_idx].name);
 				}
 
 				/* Check for another reduce to zero cost */
@@ -3960,7 +4001,7 @@ static char *card_settle_tooltip(game *g, int who, int special,
 				{
 					/* Format text */
 					p += sprintf(p, "Cost to place if using %s\n  and %s: 0\n",
-					             cost_card, d_ptr->zero[1]->d_ptr->name);
+					             cost_card, library[d_ptr->zero[1]->d_idx].name);
 				}
 			}
 		}
@@ -3979,19 +4020,19 @@ static char *card_settle_tooltip(game *g, int who, int special,
 		}
 
 		/* Check for place at 0 cost */
-		if (c_ptr->d_ptr->good_type != GOOD_ALIEN &&
+		if (library[c_ptr->d_idx].good_type != GOOD_ALIEN &&
 		    d_ptr->zero[0])
 		{
 			/* Format text */
 			p += sprintf(p, "Cost to place if using %s: 0\n",
-			             d_ptr->zero[0]->d_ptr->name);
+			             library[d_ptr->zero[0]->d_idx].name);
 
 			/* Check for another place at 0 cost */
 			if (d_ptr->zero[1])
 			{
 				/* Format text */
 				p += sprintf(p, "Cost to place if using %s: 0\n",
-				             d_ptr->zero[1]->d_ptr->name);
+				             library[d_ptr->zero[1]->d_idx].name);
 			}
 		}
 
@@ -3999,7 +4040,7 @@ static char *card_settle_tooltip(game *g, int who, int special,
 		if (d_ptr->conquer_settle_0)
 		{
 			/* Get card name */
-			cost_card = d_ptr->conquer_settle_0->d_ptr->name;
+			cost_card = library[d_ptr->conquer_settle_0->d_idx].name;
 
 			/* Check for no extra military */
 			if (conquer_mil == 0)
@@ -4022,7 +4063,7 @@ static char *card_settle_tooltip(game *g, int who, int special,
 		if (d_ptr->conquer_settle_2)
 		{
 			/* Get card name */
-			cost_card = d_ptr->conquer_settle_2->d_ptr->name;
+			cost_card = library[d_ptr->conquer_settle_2->d_idx].name;
 
 			/* Check for no extra military */
 			if (conquer_discount_mil == 0)
@@ -4146,7 +4187,7 @@ static char *card_takeover_tooltip(game *g, int defender, int attacker,
 		++num_takeovers;
 
 		/* Check for non-military target */
-		if (!(c_ptr->d_ptr->flags & FLAG_MILITARY))
+		if (!(library[c_ptr->d_idx].flags & FLAG_MILITARY))
 		{
 			/* Loop over cards in table */
 			for (j = 0; j < table_size[attacker]; ++j)
@@ -4155,7 +4196,7 @@ static char *card_takeover_tooltip(game *g, int defender, int attacker,
 				card = table[attacker][j].index;
 
 				/* Get design */
-				d_ptr = g->deck[card].d_ptr;
+				d_ptr = &library[g->deck[card].d_idx];
 
 				/* Loop over powers */
 				for (k = 0; k < d_ptr->num_power; ++k)
@@ -4247,7 +4288,7 @@ static char *card_takeover_tooltip(game *g, int defender, int attacker,
 			t_ptr = &takeovers[i];
 
 			/* Add name of card */
-			p += sprintf(p, "\nUsing %s:", g->deck[t_ptr->card].d_ptr->name);
+			p += sprintf(p, "\nUsing %s:", library[g->deck[t_ptr->card].d_idx].name);
 
 			/* Add attack strength */
 			p += sprintf(p, "\n  Current attack: %d", t_ptr->attack);
@@ -4282,7 +4323,7 @@ static char *card_trade_tooltip(game *g, int who, displayed *i_ptr,
 	c_ptr = &g->deck[i_ptr->index];
 
 	/* Get good type */
-	type = c_ptr->d_ptr->good_type;
+	type = library[c_ptr->d_idx].good_type;
 
 	/* Check for "any" kind */
 	if (type == GOOD_ANY)
@@ -5377,10 +5418,10 @@ static void compute_military(game *g, int who, mil_strength *m_ptr)
 		c_ptr = &g->deck[x];
 
 		/* Loop over card's powers */
-		for (i = 0; i < c_ptr->d_ptr->num_power; i++)
+		for (i = 0; i < library[c_ptr->d_idx].num_power; i++)
 		{
 			/* Get power pointer */
-			o_ptr = &c_ptr->d_ptr->powers[i];
+			o_ptr = &library[c_ptr->d_idx].powers[i];
 
 			/* Skip incorrect phase */
 			if (o_ptr->phase != PHASE_SETTLE) continue;
@@ -5413,12 +5454,12 @@ static void compute_military(game *g, int who, mil_strength *m_ptr)
 				{
 					/* Use name of both cards */
 					sprintf(m_ptr->imp_card + strlen(m_ptr->imp_card),
-					        "/%s", c_ptr->d_ptr->name);
+					        "/%s", library[c_ptr->d_idx].name);
 				}
 				else
 				{
 					/* Remember name of card */
-					strcpy(m_ptr->imp_card, c_ptr->d_ptr->name);
+					strcpy(m_ptr->imp_card, library[c_ptr->d_idx].name);
 				}
 			}
 
@@ -5609,7 +5650,7 @@ static void reset_hand(game *g, int color)
 
 		/* Add card information */
 		i_ptr->index = i;
-		i_ptr->d_ptr = c_ptr->d_ptr;
+		i_ptr->d_ptr = &library[c_ptr->d_idx];
 
 		/* Card is in hand */
 		i_ptr->hand = 1;
@@ -5654,7 +5695,7 @@ static void reset_table(game *g, int who, int color)
 
 		/* Add card information */
 		i_ptr->index = i;
-		i_ptr->d_ptr = c_ptr->d_ptr;
+		i_ptr->d_ptr = &library[c_ptr->d_idx];
 
 		/* Set color flag */
 		i_ptr->color = color;
@@ -6577,7 +6618,7 @@ void gui_choose_start(game *g, int who, int list[], int *num, int special[],
 
 		/* Add card information */
 		i_ptr->index = special[i];
-		i_ptr->d_ptr = c_ptr->d_ptr;
+		i_ptr->d_ptr = &library[c_ptr->d_idx];
 
 		/* Card is eligible */
 		i_ptr->eligible = 1;
@@ -6815,7 +6856,7 @@ void gui_choose_save(game *g, int who, int list[], int *num)
 
 		/* Add card information */
 		i_ptr->index = list[i];
-		i_ptr->d_ptr = c_ptr->d_ptr;
+		i_ptr->d_ptr = &library[c_ptr->d_idx];
 
 		/* Card is in hand */
 		i_ptr->hand = 1;
@@ -6958,7 +6999,7 @@ int gui_choose_place(game *g, int who, int list[], int num, int phase,
 	if (special != -1)
 	{
 		/* Get special card design */
-		d_ptr = g->deck[special].d_ptr;
+		d_ptr = &library[g->deck[special].d_idx];
 
 		/* Append name to prompt */
 		strcat(buf, " using ");
@@ -7182,13 +7223,13 @@ void gui_choose_pay(game *g, int who, int which, int list[], int *num,
 	p = buf;
 
 	/* Create prompt */
-	p += sprintf(p, "Choose payment for %s", c_ptr->d_ptr->name);
+	p += sprintf(p, "Choose payment for %s", library[c_ptr->d_idx].name);
 
 	/* Check for cost enabled */
 	if (opt.cost_in_hand)
 	{
 		/* Check for development */
-		if (c_ptr->d_ptr->type == TYPE_DEVELOPMENT)
+		if (library[c_ptr->d_idx].type == TYPE_DEVELOPMENT)
 		{
 			/* Compute cost */
 			cost = devel_cost(g, who, which);
@@ -7198,7 +7239,7 @@ void gui_choose_pay(game *g, int who, int which, int list[], int *num,
 		}
 
 		/* Check for world */
-		else if (c_ptr->d_ptr->type == TYPE_WORLD)
+		else if (library[c_ptr->d_idx].type == TYPE_WORLD)
 		{
 			/* Find hand size */
 			num_hand = count_player_area(g, who, WHERE_HAND);
@@ -7234,13 +7275,13 @@ void gui_choose_pay(game *g, int who, int which, int list[], int *num,
 			}
 
 			/* Check for military world */
-			else if (c_ptr->d_ptr->flags & FLAG_MILITARY)
+			else if (library[c_ptr->d_idx].flags & FLAG_MILITARY)
 			{
 				/* Start with base bonus */
 				bonus = m_ptr->max_bonus;
 
 				/* Check for Xeno world */
-				if (c_ptr->d_ptr->flags & FLAG_XENO) bonus += m_ptr->max_bonus_xeno;
+				if (library[c_ptr->d_idx].flags & FLAG_XENO) bonus += m_ptr->max_bonus_xeno;
 
 				/* Compute payment */
 				military_world_payment(g, who, which, mil_only,
@@ -7280,14 +7321,14 @@ void gui_choose_pay(game *g, int who, int which, int list[], int *num,
 						}
 
 						/* Check for non-Alien world */
-						if (c_ptr->d_ptr->good_type != GOOD_ALIEN)
+						if (library[c_ptr->d_idx].good_type != GOOD_ALIEN)
 						{
 							/* Check for reduce to 0 */
 							if (d_ptr->zero[0])
 							{
 								/* Format text */
 								p += sprintf(p, "/%s",
-								             d_ptr->zero[0]->d_ptr->name);
+								             library[d_ptr->zero[0]->d_idx].name);
 							}
 
 							/* Check for yet another reduce to 0 */
@@ -7295,25 +7336,25 @@ void gui_choose_pay(game *g, int who, int which, int list[], int *num,
 							{
 								/* Format text */
 								p += sprintf(p, "/%s",
-								             d_ptr->zero[1]->d_ptr->name);
+								             library[d_ptr->zero[1]->d_idx].name);
 							}
 						}
 					}
 
 					/* Check for applicable reduce to 0 */
-					else if (c_ptr->d_ptr->good_type != GOOD_ALIEN &&
+					else if (library[c_ptr->d_idx].good_type != GOOD_ALIEN &&
 					         d_ptr->zero[0])
 					{
 						/* Format text */
 						p += sprintf(p, "%s%s + %s",
 						             conjunction ? " or " : "",
-						             cost_card, d_ptr->zero[0]->d_ptr->name);
+						             cost_card, library[d_ptr->zero[0]->d_idx].name);
 
 						/* Check for yet another reduce to 0 */
 						if (d_ptr->zero[1])
 						{
 							/* Format text */
-							p += sprintf(p, "/%s", d_ptr->zero[1]->d_ptr->name);
+							p += sprintf(p, "/%s", library[d_ptr->zero[1]->d_idx].name);
 						}
 					}
 				}
@@ -7341,11 +7382,11 @@ void gui_choose_pay(game *g, int who, int which, int list[], int *num,
 				}
 
 				/* Check for reduce to 0 */
-				if (c_ptr->d_ptr->good_type != GOOD_ALIEN && d_ptr->zero[0])
+				if (library[c_ptr->d_idx].good_type != GOOD_ALIEN && d_ptr->zero[0])
 				{
 					/* Format text */
 					p += sprintf(p, "%s%s", conjunction ? " or " : "",
-					             d_ptr->zero[0]->d_ptr->name);
+					             library[d_ptr->zero[0]->d_idx].name);
 					conjunction = TRUE;
 
 					/* Check for another reduce to 0 */
@@ -7353,7 +7394,7 @@ void gui_choose_pay(game *g, int who, int which, int list[], int *num,
 					{
 						/* Format text */
 						p += sprintf(p, " or %s",
-						             d_ptr->zero[1]->d_ptr->name);
+						             library[d_ptr->zero[1]->d_idx].name);
 					}
 				}
 
@@ -7363,7 +7404,7 @@ void gui_choose_pay(game *g, int who, int which, int list[], int *num,
 				{
 					/* Format text */
 					p += sprintf(p, "%s%s", conjunction ? " or " : "",
-					             d_ptr->conquer_settle_2->d_ptr->name);
+					             library[d_ptr->conquer_settle_2->d_idx].name);
 
 					/* Check for any military needed */
 					if (conquer_discount_mil)
@@ -7381,7 +7422,7 @@ void gui_choose_pay(game *g, int who, int which, int list[], int *num,
 				{
 					/* Format text */
 					p += sprintf(p, "%s%s", conjunction ? " or " : "",
-					             d_ptr->conquer_settle_0->d_ptr->name);
+					             library[d_ptr->conquer_settle_0->d_idx].name);
 
 					/* Check for any military needed */
 					if (conquer_mil)
@@ -7455,10 +7496,10 @@ void gui_choose_pay(game *g, int who, int which, int list[], int *num,
 		high_color = HIGH_YELLOW;
 
 		/* Loop over powers on card */
-		for (j = 0; j < g->deck[special[i]].d_ptr->num_power; j++)
+		for (j = 0; j < library[g->deck[special[i]].d_idx].num_power; j++)
 		{
 			/* Get power pointer */
-			o_ptr = &g->deck[special[i]].d_ptr->powers[j];
+			o_ptr = &library[g->deck[special[i]].d_idx].powers[j];
 
 			/* Skip non-develop or settle powers */
 			if (o_ptr->phase != PHASE_DEVELOP &&
@@ -7615,7 +7656,7 @@ void gui_choose_settle(game *g, int who, int cidx[], int oidx[], int *num,
 		c_ptr = &g->deck[l_list[i].c_idx];
 
 		/* Get power pointer */
-		o_ptr = &c_ptr->d_ptr->powers[l_list[i].o_idx];
+		o_ptr = &library[c_ptr->d_idx].powers[l_list[i].o_idx];
 
 		/* Check for simple powers */
 		if (o_ptr->code & P3_PLACE_TWO)
@@ -7729,10 +7770,10 @@ int gui_choose_takeover(game *g, int who, int list[], int *num,
 		high_color = HIGH_YELLOW;
 
 		/* Loop over powers on card */
-		for (j = 0; j < g->deck[special[i]].d_ptr->num_power; j++)
+		for (j = 0; j < library[g->deck[special[i]].d_idx].num_power; j++)
 		{
 			/* Get power pointer */
-			o_ptr = &g->deck[special[i]].d_ptr->powers[j];
+			o_ptr = &library[g->deck[special[i]].d_idx].powers[j];
 
 			/* Skip non-settle powers */
 			if (o_ptr->phase != PHASE_SETTLE) continue;
@@ -7858,7 +7899,7 @@ void gui_choose_defend(game *g, int who, int which, int opponent, int deficit,
 
 	/* Create prompt */
 	sprintf(buf, "Choose defense for %s (need %d extra military)",
-	        c_ptr->d_ptr->name, deficit + 1);
+	        library[c_ptr->d_idx].name, deficit + 1);
 
 	/* Set prompt */
 	gtk_label_set_text(GTK_LABEL(action_prompt), buf);
@@ -7903,10 +7944,10 @@ void gui_choose_defend(game *g, int who, int which, int opponent, int deficit,
 		high_color = HIGH_YELLOW;
 
 		/* Loop over powers on card */
-		for (j = 0; j < g->deck[special[i]].d_ptr->num_power; j++)
+		for (j = 0; j < library[g->deck[special[i]].d_idx].num_power; j++)
 		{
 			/* Get power pointer */
-			o_ptr = &g->deck[special[i]].d_ptr->powers[j];
+			o_ptr = &library[g->deck[special[i]].d_idx].powers[j];
 
 			/* Skip non-settle powers */
 			if (o_ptr->phase != PHASE_SETTLE) continue;
@@ -8013,8 +8054,8 @@ void gui_choose_takeover_prevent(game *g, int who, int list[], int *num,
 		b_ptr = &g->deck[special[i]];
 
 		/* Format choice */
-		sprintf(buf, "%s using %s", c_ptr->d_ptr->name,
-		                            b_ptr->d_ptr->name);
+		sprintf(buf, "%s using %s", library[c_ptr->d_idx].name,
+		                            library[b_ptr->d_idx].name);
 
 		/* Append option to combo box */
 		gtk_combo_box_append_text(GTK_COMBO_BOX(combo), buf);
@@ -8382,7 +8423,7 @@ static int cmp_consume(const void *l1, const void *l2)
 	else
 	{
 		/* Get power */
-		o_ptr1 = &real_game.deck[l_ptr1->c_idx].d_ptr->powers[l_ptr1->o_idx];
+		o_ptr1 = &library[real_game.deck[l_ptr1->c_idx].d_idx].powers[l_ptr1->o_idx];
 	}
 
 	/* Check second power */
@@ -8400,7 +8441,7 @@ static int cmp_consume(const void *l1, const void *l2)
 	else
 	{
 		/* Get power */
-		o_ptr2 = &real_game.deck[l_ptr2->c_idx].d_ptr->powers[l_ptr2->o_idx];
+		o_ptr2 = &library[real_game.deck[l_ptr2->c_idx].d_idx].powers[l_ptr2->o_idx];
 	}
 
 	/* Compare consume powers */
@@ -8468,7 +8509,7 @@ void gui_choose_consume(game *g, int who, int cidx[], int oidx[], int *num,
 			c_ptr = &g->deck[l_list[i].c_idx];
 
 			/* Get power pointer */
-			o_ptr = &c_ptr->d_ptr->powers[l_list[i].o_idx];
+			o_ptr = &library[c_ptr->d_idx].powers[l_list[i].o_idx];
 		}
 
 		/* Check for simple powers */
@@ -8725,10 +8766,10 @@ void gui_choose_consume_hand(game *g, int who, int c_idx, int o_idx, int list[],
 		c_ptr = &g->deck[c_idx];
 
 		/* Get power pointer */
-		o_ptr = &c_ptr->d_ptr->powers[o_idx];
+		o_ptr = &library[c_ptr->d_idx].powers[o_idx];
 
 		/* Use card name */
-		card_name = c_ptr->d_ptr->name;
+		card_name = library[c_ptr->d_idx].name;
 	}
 
 	/* Check for needing two cards */
@@ -8868,7 +8909,7 @@ void gui_choose_good(game *g, int who, int c_idx, int o_idx, int goods[],
 
 	/* Create prompt */
 	sprintf(buf, "Choose good%s to consume on %s",
-	        min == 1 && max == 1 ? "" : "s", c_ptr->d_ptr->name);
+	        min == 1 && max == 1 ? "" : "s", library[c_ptr->d_idx].name);
 
 	/* Set prompt */
 	gtk_label_set_text(GTK_LABEL(action_prompt), buf);
@@ -9127,7 +9168,7 @@ int gui_choose_keep(game *g, int who, int list[], int num)
 
 		/* Add card information */
 		i_ptr->index = list[i];
-		i_ptr->d_ptr = c_ptr->d_ptr;
+		i_ptr->d_ptr = &library[c_ptr->d_idx];
 
 		/* Card is in hand */
 		i_ptr->hand = 1;
@@ -9299,7 +9340,7 @@ static int cmp_produce(const void *l1, const void *l2)
 	else
 	{
 		/* Get power */
-		o_ptr1 = &real_game.deck[l_ptr1->c_idx].d_ptr->powers[l_ptr1->o_idx];
+		o_ptr1 = &library[real_game.deck[l_ptr1->c_idx].d_idx].powers[l_ptr1->o_idx];
 	}
 
 	/* Check second power */
@@ -9312,7 +9353,7 @@ static int cmp_produce(const void *l1, const void *l2)
 	else
 	{
 		/* Get power */
-		o_ptr2 = &real_game.deck[l_ptr2->c_idx].d_ptr->powers[l_ptr2->o_idx];
+		o_ptr2 = &library[real_game.deck[l_ptr2->c_idx].d_idx].powers[l_ptr2->o_idx];
 	}
 
 	/* Compare produce powers */
@@ -9373,7 +9414,7 @@ void gui_choose_produce(game *g, int who, int cidx[], int oidx[], int num)
 			c_ptr = &g->deck[l_list[i].c_idx];
 
 			/* Get power pointer */
-			o_ptr = &c_ptr->d_ptr->powers[l_list[i].o_idx];
+			o_ptr = &library[c_ptr->d_idx].powers[l_list[i].o_idx];
 		}
 
 		/* Clear string describing power */
@@ -9423,7 +9464,7 @@ void gui_choose_produce(game *g, int who, int cidx[], int oidx[], int num)
 		{
 			/* Add to string */
 			strcat(buf, "produce on ");
-			strcat(buf, c_ptr->d_ptr->name);
+			strcat(buf, library[c_ptr->d_idx].name);
 		}
 		else if (o_ptr->code & P5_WINDFALL_ANY)
 		{
@@ -9703,7 +9744,7 @@ int gui_choose_search_keep(game *g, int who, int arg1, int arg2)
 	c_ptr = &g->deck[arg1];
 
 	/* Create prompt */
-	sprintf(buf, "Choose to keep/discard %s", c_ptr->d_ptr->name);
+	sprintf(buf, "Choose to keep/discard %s", library[c_ptr->d_idx].name);
 
 	/* Set prompt */
 	gtk_label_set_text(GTK_LABEL(action_prompt), buf);
@@ -9722,7 +9763,7 @@ int gui_choose_search_keep(game *g, int who, int arg1, int arg2)
 
 	/* Add card information */
 	i_ptr->index = arg1;
-	i_ptr->d_ptr = c_ptr->d_ptr;
+	i_ptr->d_ptr = &library[c_ptr->d_idx];
 
 	/* Set tool tip */
 	i_ptr->tooltip = card_hand_tooltip(g, who, arg1);
@@ -9983,6 +10024,9 @@ static void choice_done(game *g)
 {
 	int i;
 
+	/* Forget checkpoints past the point where the logs are rewritten */
+	trim_checkpoints(&checkpoints, g);
+
 	/* Loop over all players */
 	for (i = 0; i < g->num_players; ++i)
 	{
@@ -10241,8 +10285,8 @@ static void gui_make_choice(game *g, int who, int type, int list[], int *nl,
 	/* Get player pointer */
 	p_ptr = &g->p[who];
 
-	/* Get pointer to end of choice log */
-	l_ptr = &p_ptr->choice_log[p_ptr->choice_size];
+	/* Make room for choice and get pointer to end of choice log */
+	l_ptr = reserve_choice_log(p_ptr, 4 + (nl ? *nl : 0) + (ns ? *ns : 0));
 
 	/* Add choice type to log */
 	*l_ptr++ = type;
@@ -10289,7 +10333,7 @@ static void gui_make_choice(game *g, int who, int type, int list[], int *nl,
 	}
 
 	/* Mark new size of choice log */
-	p_ptr->choice_size = l_ptr - p_ptr->choice_log;
+	p_ptr->choice_size = l_ptr - p_ptr->choice_log->data;
 
 	/* Mark one choice is done */
 	choice_done(g);
@@ -10463,6 +10507,16 @@ void reset_gui(void)
 		real_game.p[i].control->init(&real_game, i, 0.0);
 	}
 
+	/* Check for undo, redo or replay to current position */
+	if (restart_loop == RESTART_UNDO || restart_loop == RESTART_UNDO_ROUND ||
+	    restart_loop == RESTART_UNDO_GAME || restart_loop == RESTART_REDO ||
+	    restart_loop == RESTART_REDO_ROUND ||
+	    restart_loop == RESTART_REDO_GAME || restart_loop == RESTART_CURRENT)
+	{
+		/* Keep message log until a checkpoint is looked for */
+		return;
+	}
+
 	/* Clear message log */
 	clear_log();
 }
@@ -10550,6 +10604,7 @@ void modify_gui(int reset_card)
  */
 static void run_game(void)
 {
+	checkpoint *cp_ptr;
 	int i;
 	int pos, choice, saved_choice;
 
@@ -10584,6 +10639,9 @@ static void run_game(void)
 			num_undo = 0;
 			max_undo = 0;
 
+			/* Forget checkpoints of previous game */
+			clear_checkpoints(&checkpoints);
+
 			/* Loop over players */
 			for (i = 0; i < real_game.num_players; i++)
 			{
@@ -10671,19 +10729,19 @@ static void run_game(void)
 			while (choice < num_undo && pos < real_game.p[0].choice_size)
 			{
 				/* Set tampered flag if debug choice found */
-				if (real_game.p[0].choice_log[pos] < 0)
+				if (real_game.p[0].choice_log->data[pos] < 0)
 				    game_tampered |= TAMPERED_DEBUG;
 
 				/* Check if the current position is a round boundary */
 				if (is_round_boundary(real_game.advanced,
-				                      real_game.p[0].choice_log + pos))
+				                      real_game.p[0].choice_log->data + pos))
 				{
 					/* Save the current choice */
 					saved_choice = choice;
 				}
 
 				/* Update the position */
-				pos = next_choice(real_game.p[0].choice_log, pos);
+				pos = next_choice(real_game.p[0].choice_log->data, pos);
 
 				/* Add one to choice count */
 				++choice;
@@ -10745,7 +10803,7 @@ static void run_game(void)
 			while (choice <= num_undo && pos < real_game.p[0].choice_size)
 			{
 				/* Update position */
-				pos = next_choice(real_game.p[0].choice_log, pos);
+				pos = next_choice(real_game.p[0].choice_log->data, pos);
 
 				/* Add one to choice count */
 				++choice;
@@ -10756,7 +10814,7 @@ static void run_game(void)
 			{
 				/* Check for round boundary */
 				if (is_round_boundary(real_game.advanced,
-				                      real_game.p[0].choice_log + pos))
+				                      real_game.p[0].choice_log->data + pos))
 				{
 					/* Save the current choice */
 					saved_choice = choice;
@@ -10764,7 +10822,7 @@ static void run_game(void)
 				}
 
 				/* Update position */
-				pos = next_choice(real_game.p[0].choice_log, pos);
+				pos = next_choice(real_game.p[0].choice_log->data, pos);
 
 				/* Add one to choice count */
 				++choice;
@@ -10808,6 +10866,9 @@ static void run_game(void)
 			/* Set tampered loaded flag */
 			game_tampered = TAMPERED_LOAD;
 
+			/* Forget checkpoints of previous game */
+			clear_checkpoints(&checkpoints);
+
 			/* Start with start of game random seed */
 			real_game.random_seed = real_game.start_seed;
 
@@ -10830,6 +10891,9 @@ static void run_game(void)
 			/* Set tampered loaded flag */
 			game_tampered = TAMPERED_LOAD;
 
+			/* Forget checkpoints of previous game */
+			clear_checkpoints(&checkpoints);
+
 			/* Start with start of game random seed */
 			real_game.random_seed = real_game.start_seed;
 
@@ -10863,7 +10927,7 @@ static void run_game(void)
 		while (choice < num_undo && pos < real_game.p[0].choice_size)
 		{
 			/* Update log position */
-			pos = next_choice(real_game.p[0].choice_log, pos);
+			pos = next_choice(real_game.p[0].choice_log->data, pos);
 
 			/* Add one to choice count */
 			++choice;
@@ -10879,7 +10943,7 @@ static void run_game(void)
 		while (pos < orig_log_size[0])
 		{
 			/* Update log position */
-			pos = next_choice(real_game.p[0].choice_log, pos);
+			pos = next_choice(real_game.p[0].choice_log->data, pos);
 
 			/* Add one to choice count */
 			++choice;
@@ -10894,14 +10958,39 @@ static void run_game(void)
 		/* Game is run by gui */
 		real_game.session_id = -1;
 
-		/* Begin game */
-		begin_game(&real_game);
+		/* Look for latest round start reached by the logs */
+		cp_ptr = find_checkpoint(&checkpoints, &real_game);
 
-		/* Check for aborted game */
-		if (real_game.game_over) continue;
+		/* Check for checkpoint to resume from */
+		if (cp_ptr && !load_checkpoint(&real_game, cp_ptr->snap, cp_ptr->len))
+		{
+			/* Remove messages logged after checkpoint */
+			truncate_log(cp_ptr->log_len);
+		}
+		else
+		{
+			/* Clear message log */
+			clear_log();
+
+			/* Begin game */
+			begin_game(&real_game);
+
+			/* Check for aborted game */
+			if (real_game.game_over) continue;
+		}
 
 		/* Play game rounds until finished */
-		while (game_round(&real_game));
+		while (1)
+		{
+			/* Save state at start of round */
+			cp_ptr = save_checkpoint(&checkpoints, &real_game);
+
+			/* Remember message log length */
+			if (cp_ptr) cp_ptr->log_len = log_length();
+
+			/* Play round */
+			if (!game_round(&real_game)) break;
+		}
 
 		/* Check for restart request */
 		if (restart_loop)
@@ -13083,6 +13172,9 @@ static void gui_options(GtkMenuItem *menu_item, gpointer data)
 		     opt.vp_in_hand != old_options.vp_in_hand ||
 		     opt.cost_in_hand != old_options.cost_in_hand))
 		{
+			/* Regenerate whole message log */
+			clear_checkpoints(&checkpoints);
+
 			/* Force current game over */
 			real_game.game_over = 1;
 
@@ -13484,8 +13576,8 @@ static int debug_update_card(GtkTreeModel *model, GtkTreePath *path,
 		/* Get player pointer */
 		p_ptr = &real_game.p[player_us];
 
-		/* Get pointer to end of choice log */
-		l_ptr = &p_ptr->choice_log[p_ptr->choice_size];
+		/* Make room for choice and get pointer to end of choice log */
+		l_ptr = reserve_choice_log(p_ptr, 6);
 
 		/* Add debug choice type to log */
 		*l_ptr++ = CHOICE_D_MOVE;
@@ -13506,7 +13598,7 @@ static int debug_update_card(GtkTreeModel *model, GtkTreePath *path,
 		*l_ptr++ = 0;
 
 		/* Mark new size of choice log */
-		p_ptr->choice_size = l_ptr - p_ptr->choice_log;
+		p_ptr->choice_size = l_ptr - p_ptr->choice_log->data;
 
 		/* Mark one choice done */
 		choice_done(&real_game);
@@ -13571,7 +13663,7 @@ static void debug_card_dialog(GtkMenuItem *menu_item, gpointer data)
 		/* Set card information */
 		gtk_list_store_set(card_list, &list_iter,
 		                   DEBUG_COL_CARD_ID, i,
-		                   DEBUG_COL_CARD_NAME, c_ptr->d_ptr->name,
+		                   DEBUG_COL_CARD_NAME, library[c_ptr->d_idx].name,
 		                   DEBUG_COL_OWNER, c_ptr->owner,
 		                   DEBUG_COL_LOCATION, c_ptr->where,
 		                   -1);
@@ -13753,7 +13845,7 @@ static void debug_card_dialog(GtkMenuItem *menu_item, gpointer data)
 static void gui_debug_choice(GtkMenuItem *menu_item, gpointer data)
 {
 	player *p_ptr = &real_game.p[player_us];
-	int *l_ptr = &p_ptr->choice_log[p_ptr->choice_size];
+	int *l_ptr;
 	int choice = GPOINTER_TO_INT(data);
 
 	/* Check for connected to non-debug server */
@@ -13774,6 +13866,9 @@ static void gui_debug_choice(GtkMenuItem *menu_item, gpointer data)
 	/* Set the tampered debug flag */
 	game_tampered |= TAMPERED_DEBUG;
 
+	/* Make room for choice and get pointer to end of choice log */
+	l_ptr = reserve_choice_log(p_ptr, 4);
+
 	/* Add debug choice type to log */
 	*l_ptr++ = choice;
 
@@ -13787,7 +13882,7 @@ static void gui_debug_choice(GtkMenuItem *menu_item, gpointer data)
 	*l_ptr++ = 0;
 
 	/* Mark new size of choice log */
-	p_ptr->choice_size = l_ptr - p_ptr->choice_log;
+	p_ptr->choice_size = l_ptr - p_ptr->choice_log->data;
 
 	/* Mark one choice done */
 	choice_done(&real_game);
@@ -14424,7 +14519,7 @@ int main(int argc, char *argv[])
 	for (i = 0; i < MAX_PLAYER; i++)
 	{
 		/* Create log */
-		real_game.p[i].choice_log = (int *)malloc(sizeof(int) * 4096);
+		real_game.p[i].choice_log = new_choice_log();
 
 		/* Save original log */
 		orig_log[i] = real_game.p[i].choice_log;
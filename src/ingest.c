@@ -0,0 +1,483 @@
+/*
+ * Race for the Galaxy AI
+ *
+ * Copyright (C) 2009-2015 Keldon Jones
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "rftg.h"
+#include <setjmp.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*
+ * Print messages?
+ */
+static int verbose = 0;
+
+/*
+ * Game configuration to ingest.
+ */
+static int num_players = 3;
+static int expansion_level, advanced;
+
+/*
+ * Choice logs read from the saved game being ingested.
+ */
+static choice_buffer *archive[MAX_PLAYER];
+
+/*
+ * Number of entries in each archived choice log.
+ */
+static int archive_size[MAX_PLAYER];
+
+/*
+ * Choice logs the game is replayed into.
+ */
+static choice_buffer *replay_log[MAX_PLAYER];
+
+/*
+ * Game currently being replayed.
+ */
+static int replaying;
+
+/*
+ * Place to return to when the current game cannot be finished.
+ */
+static jmp_buf abandon_game;
+
+/*
+ * Print errors to standard error.
+ *
+ * Errors while replaying a game abandon that game instead of stopping.
+ */
+void display_error(char *msg)
+{
+	/* Forward message */
+	fprintf(stderr, "%s", msg);
+
+	/* Check for game being replayed */
+	if (replaying)
+	{
+		/* Give up on game */
+		longjmp(abandon_game, 1);
+	}
+}
+
+/*
+ * Print messages to standard output.
+ */
+void message_add(game *g, char *msg)
+{
+	/* Print if verbose flag set */
+	if (verbose) printf("%s", msg);
+}
+
+/*
+ * Print messages to standard output.
+ */
+void message_add_formatted(game *g, char *msg, char *tag)
+{
+	/* Print without formatting */
+	message_add(g, msg);
+}
+
+/*
+ * Use simple random number generator, as saved games do.
+ */
+int game_rand(game *g)
+{
+	/* Call simple random number generator */
+	return simple_rand(&g->random_seed);
+}
+
+/*
+ * Hand the next archived choice to the engine.
+ *
+ * Role choices are captured for training first.
+ */
+static void ingest_make_choice(game *g, int who, int type, int list[],
+                               int *nl, int special[], int *ns, int arg1,
+                               int arg2, int arg3)
+{
+	int *log = archive[who]->data;
+	int current, next;
+
+	/* Check for role choice */
+	if (type == CHOICE_ACTION)
+	{
+		/* Capture network inputs at this decision */
+		ai_capture_choice(g, who);
+	}
+
+	/* Start at current end of replayed log */
+	current = next = g->p[who].choice_size;
+
+	/* Skip debug choices */
+	while (next < archive_size[who] && log[next] < 0)
+	{
+		/* Go to next choice */
+		next = next_choice(log, next);
+	}
+
+	/* Check for archived log used up */
+	if (next >= archive_size[who])
+	{
+		/* Game was saved before it ended */
+		longjmp(abandon_game, 1);
+	}
+
+	/* Include the choice itself */
+	next = next_choice(log, next);
+
+	/* Check for truncated log */
+	if (next > archive_size[who]) longjmp(abandon_game, 1);
+
+	/* Make room for choices */
+	grow_choice_log(g->p[who].choice_log, next);
+
+	/* Copy choices from archive */
+	memcpy(g->p[who].choice_log->data + current, log + current,
+	       sizeof(int) * (next - current));
+
+	/* Update choice log size */
+	g->p[who].choice_size = next;
+
+	/* Keep replaying without messages */
+	g->fast_replay = 1;
+}
+
+/*
+ * Set of functions called by game engine to ask for choices.
+ */
+static decisions ingest_func =
+{
+	NULL,
+	NULL,
+	NULL,
+	ingest_make_choice,
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+};
+
+/*
+ * Replay a saved game and capture the network inputs of its decisions.
+ *
+ * Returns 1 if the game was ingested, 0 if it was skipped, and -1 if it
+ * could not be loaded or finished.
+ */
+static int ingest_game(game *g, char *fname)
+{
+	int i, more;
+
+	/* Load archived choice logs */
+	for (i = 0; i < MAX_PLAYER; i++) g->p[i].choice_log = archive[i];
+
+	/* No campaign progress */
+	g->camp_status = NULL;
+
+	/* Load saved game */
+	if (load_game(g, fname) < 0)
+	{
+		/* Error */
+		fprintf(stderr, "Could not load %s\n", fname);
+		return -1;
+	}
+
+	/* Skip games of other configurations */
+	if (g->num_players != num_players || g->expanded != expansion_level ||
+	    g->advanced != advanced) return 0;
+
+	/* Loop over players */
+	for (i = 0; i < g->num_players; i++)
+	{
+		/* Remember archived log size */
+		archive_size[i] = g->p[i].choice_size;
+
+		/* Replay into separate log */
+		g->p[i].choice_log = replay_log[i];
+		g->p[i].choice_size = 0;
+		g->p[i].choice_pos = 0;
+
+		/* Take choices from archive */
+		g->p[i].control = &ingest_func;
+	}
+
+	/* Load networks for this configuration */
+	ai_func.init(g, 0, 1.0);
+
+	/* Start from saved seed */
+	g->random_seed = g->start_seed;
+
+	/* Check for abandoned game */
+	if (setjmp(abandon_game))
+	{
+		/* Game no longer replaying */
+		replaying = 0;
+
+		/* Forget captured inputs */
+		ai_capture_discard();
+
+		/* Failure */
+		fprintf(stderr, "Could not finish %s\n", fname);
+		return -1;
+	}
+
+	/* Game is being replayed */
+	replaying = 1;
+
+	/* Initialize game */
+	init_game(g);
+
+	/* Replay without messages */
+	g->fast_replay = 1;
+
+	/* Begin game */
+	begin_game(g);
+
+	/* Play game rounds until finished */
+	do
+	{
+		/* Play round */
+		more = game_round(g);
+
+		/* Note roles chosen this round */
+		ai_capture_round(g);
+
+	} while (more);
+
+	/* Score game */
+	score_game(g);
+
+	/* Declare winner */
+	declare_winner(g);
+
+	/* Game no longer replaying */
+	replaying = 0;
+
+	/* Capture final state and write experience */
+	ai_capture_end(g);
+
+	/* Success */
+	return 1;
+}
+
+/*
+ * Ingest every num_workers'th game, starting with the given one.
+ */
+static int run_worker(int worker, int num_workers, char *eval_name,
+                      char *role_name, int num_files, char **files)
+{
+	game my_game;
+	char eval_buf[1024], role_buf[1024], name[80];
+	int i, result, done = 0, skipped = 0, failed = 0;
+
+	/* Check for several workers */
+	if (num_workers > 1)
+	{
+		/* Give each worker its own files */
+		if (eval_name)
+		{
+			/* Add worker number */
+			sprintf(eval_buf, "%s.%d", eval_name, worker);
+			eval_name = eval_buf;
+		}
+
+		/* Give each worker its own files */
+		if (role_name)
+		{
+			/* Add worker number */
+			sprintf(role_buf, "%s.%d", role_name, worker);
+			role_name = role_buf;
+		}
+	}
+
+	/* Open experience files */
+	if (ai_open_experience(eval_name, role_name) < 0)
+	{
+		/* Error */
+		perror("experience file");
+		return 1;
+	}
+
+	/* Loop over players */
+	for (i = 0; i < MAX_PLAYER; i++)
+	{
+		/* Create choice logs */
+		archive[i] = new_choice_log();
+		replay_log[i] = new_choice_log();
+
+		/* Create player name */
+		sprintf(name, "Player %d", i);
+
+		/* Set player name */
+		my_game.p[i].name = strdup(name);
+	}
+
+	/* Loop over this worker's games */
+	for (i = worker; i < num_files; i += num_workers)
+	{
+		/* Ingest game */
+		result = ingest_game(&my_game, files[i]);
+
+		/* Count result */
+		if (result > 0) done++;
+		else if (result == 0) skipped++;
+		else failed++;
+	}
+
+	/* Close experience files */
+	ai_close_experience();
+
+	printf("Worker %d: %d games ingested, %d skipped, %d failed\n",
+	       worker, done, skipped, failed);
+
+	/* Done */
+	return 0;
+}
+
+/*
+ * Capture network training data from saved games.
+ */
+int main(int argc, char *argv[])
+{
+	char *eval_name = NULL, *role_name = NULL;
+	int i, w, status, num_workers = 1, result = 0;
+
+	/* Read card database */
+	if (read_cards(NULL) < 0)
+	{
+		/* Exit */
+		exit(1);
+	}
+
+	/* Read campaign database */
+	read_campaign();
+
+	/* Parse arguments */
+	for (i = 1; i < argc; i++)
+	{
+		/* Check for verbosity */
+		if (!strcmp(argv[i], "-v"))
+		{
+			/* Set verbose flag */
+			verbose++;
+		}
+
+		/* Check for number of players */
+		else if (!strcmp(argv[i], "-p"))
+		{
+			/* Set number of players */
+			num_players = atoi(argv[++i]);
+		}
+
+		/* Check for advanced game */
+		else if (!strcmp(argv[i], "-a"))
+		{
+			/* Set advanced flag */
+			advanced = 1;
+		}
+
+		/* Check for expansion level */
+		else if (!strcmp(argv[i], "-e"))
+		{
+			/* Set expansion level */
+			expansion_level = atoi(argv[++i]);
+		}
+
+		/* Check for eval experience file */
+		else if (!strcmp(argv[i], "-x"))
+		{
+			/* Set filename */
+			eval_name = argv[++i];
+		}
+
+		/* Check for role experience file */
+		else if (!strcmp(argv[i], "-y"))
+		{
+			/* Set filename */
+			role_name = argv[++i];
+		}
+
+		/* Check for number of workers */
+		else if (!strcmp(argv[i], "-j"))
+		{
+			/* Set number of worker processes */
+			num_workers = atoi(argv[++i]);
+
+			/* Use at least one worker */
+			if (num_workers < 1) num_workers = 1;
+		}
+
+		/* Stop at first non-option */
+		else break;
+	}
+
+	/* Check for nothing to do */
+	if (i == argc || (!eval_name && !role_name))
+	{
+		/* Print usage */
+		fprintf(stderr, "Usage: %s [-p players] [-e expansion] [-a] "
+		                "[-x eval-file] [-y role-file] [-j workers] "
+		                "savefile...\n", argv[0]);
+		exit(1);
+	}
+
+	/* Check for single worker */
+	if (num_workers == 1)
+	{
+		/* Ingest all games here */
+		return run_worker(0, 1, eval_name, role_name, argc - i,
+		                  &argv[i]);
+	}
+
+	/* Flush output before creating workers */
+	fflush(stdout);
+
+	/* Start workers */
+	for (w = 0; w < num_workers; w++)
+	{
+		/* Create worker process */
+		switch (fork())
+		{
+			/* Error */
+			case -1:
+				perror("fork");
+				exit(1);
+
+			/* Worker */
+			case 0:
+				exit(run_worker(w, num_workers, eval_name,
+				                role_name, argc - i, &argv[i]));
+		}
+	}
+
+	/* Wait for workers */
+	for (w = 0; w < num_workers; w++)
+	{
+		/* Wait for any worker */
+		if (wait(&status) < 0) break;
+
+		/* Check for failed worker */
+		if (!WIFEXITED(status) || WEXITSTATUS(status)) result = 1;
+	}
+
+	/* Done */
+	return result;
+}
@@ -983,7 +983,7 @@ static void init_campaign(game *g)
 				if (g->deck[k].where != WHERE_DECK) continue;
 
 				/* Skip cards that do not match */
-				if (g->deck[k].d_ptr != g->camp->order[i][j])
+				if (g->deck[k].d_idx != g->camp->order[i][j]->index)
 					continue;
 
 				/* Move card to campaign location */
@@ -1091,6 +1091,12 @@ void init_game(game *g)
 	/* Game is not simulated */
 	g->simulation = 0;
 
+	/* Game is not being fast replayed */
+	g->fast_replay = 0;
+
+	/* Everything is new to clients */
+	mark_all(g);
+
 	/* Game is not a debug game */
 	g->debug_game = 0;
 
@@ -1171,7 +1177,7 @@ void init_game(game *g)
 			c_ptr->misc = 0;
 
 			/* Set card's design */
-			c_ptr->d_ptr = d_ptr;
+			c_ptr->d_idx = d_ptr->index;
 
 			/* Card is not covering another */
 			c_ptr->covering = -1;
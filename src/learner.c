@@ -22,6 +22,14 @@
 
 #include "rftg.h"
 
+#ifndef WIN32
+#include <sys/time.h>
+#endif
+
+#ifdef AI_THREADS
+#include <pthread.h>
+#endif
+
 /*
  * Print messages?
  */
@@ -63,17 +71,424 @@ int game_rand(game *g)
 	return simple_rand(&g->random_seed);
 }
 
+/*
+ * Settings for training games.
+ */
+static int num_players = 3;
+static int expansion_level, advanced, promo;
+static double factor = 1.0;
+
+/*
+ * Number of training games not yet started.
+ */
+static int games_left = 100;
+
+#ifdef AI_THREADS
+/*
+ * Lock for claiming games.
+ */
+static pthread_mutex_t games_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/*
+ * Directory for checkpoints of the networks, if any.
+ */
+static char *checkpoint_dir;
+
+/*
+ * Games and seconds between checkpoints (zero if not used).
+ */
+static int checkpoint_games, checkpoint_seconds;
+
+/*
+ * Games finished and time since the last checkpoint.
+ */
+static int checkpoint_count;
+static time_t checkpoint_time;
+
+/*
+ * File receiving training metrics, if any.
+ */
+static FILE *metrics_file;
+
+/*
+ * Games between lines of training metrics.
+ */
+static int metrics_games = 100;
+
+/*
+ * AI work, games, and summed game time since the last line of metrics.
+ */
+static ai_stats metrics;
+static int metrics_count;
+static double metrics_game_time;
+
+/*
+ * Games finished in total and time of the last line of metrics.
+ */
+static int metrics_total;
+static double metrics_time;
+
+/*
+ * Return the current wall clock time in seconds.
+ */
+static double wall_time(void)
+{
+#ifdef WIN32
+	/* Use processor clock */
+	return (double)clock() / CLOCKS_PER_SEC;
+#else
+	struct timeval tv;
+
+	/* Get time of day */
+	gettimeofday(&tv, NULL);
+
+	/* Convert to seconds */
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+#endif
+}
+
+/*
+ * Return a ratio, or zero if nothing was counted.
+ */
+static double ratio(double num, double den)
+{
+	/* Avoid dividing by zero */
+	return den > 0 ? num / den : 0.0;
+}
+
+/*
+ * Write the header line of the training metrics.
+ */
+static void write_metrics_header(void)
+{
+	int i;
+
+	/* Write throughput and convergence columns */
+	fprintf(metrics_file, "games,seconds,games_per_sec,computes_per_sec,"
+	                      "cache_hit_ratio,eval_error,role_error,"
+	                      "role_accuracy");
+
+	/* Write columns of time per game spent in each part */
+	for (i = 0; i < MAX_STAT; i++)
+	{
+		/* Write column name */
+		fprintf(metrics_file, ",%s_sec", stat_name[i]);
+	}
+
+	/* Finish with time per game spent outside of AI choices */
+	fprintf(metrics_file, ",other_sec\n");
+	fflush(metrics_file);
+}
+
+/*
+ * Write a line of training metrics and start counting again.
+ *
+ * Must be called with the games lock held.
+ */
+static void write_metrics(void)
+{
+	double now, elapsed, choosing = 0.0;
+	int i;
+
+	/* Get time since last line */
+	now = wall_time();
+	elapsed = now - metrics_time;
+
+	/* Write throughput and convergence */
+	fprintf(metrics_file, "%d,%.3f,%.4f,%.1f,%.4f,%.6f,%.6f,%.4f",
+	        metrics_total, elapsed,
+	        ratio(metrics_count, elapsed),
+	        ratio(metrics.computes, elapsed),
+	        ratio(metrics.cache_hit, metrics.cache_hit + metrics.cache_miss),
+	        ratio(metrics.eval_error, metrics.eval_num_error),
+	        ratio(metrics.role_error, metrics.role_num_error),
+	        ratio(metrics.role_hit, metrics.role_hit + metrics.role_miss));
+
+	/* Loop over parts of game */
+	for (i = 0; i < MAX_STAT; i++)
+	{
+		/* Write mean time spent per game */
+		fprintf(metrics_file, ",%.4f",
+		        ratio(metrics.phase_time[i], metrics_count));
+
+		/* Count total time spent choosing */
+		choosing += metrics.phase_time[i];
+	}
+
+	/* Write mean time per game spent outside of choices */
+	fprintf(metrics_file, ",%.4f\n",
+	        ratio(metrics_game_time - choosing, metrics_count));
+	fflush(metrics_file);
+
+	/* Start counting again */
+	memset(&metrics, 0, sizeof(metrics));
+	metrics_count = 0;
+	metrics_game_time = 0.0;
+	metrics_time = now;
+}
+
+/*
+ * Count a finished game and the AI work done for it by this thread.
+ */
+static void record_metrics(double game_time)
+{
+	/* Check for no metrics wanted */
+	if (!metrics_file) return;
+
+#ifdef AI_THREADS
+	/* Lock counters */
+	pthread_mutex_lock(&games_mutex);
+#endif
+
+	/* Add work done by this thread */
+	ai_collect_stats(&metrics);
+
+	/* Count game */
+	metrics_count++;
+	metrics_total++;
+	metrics_game_time += game_time;
+
+	/* Write line if enough games played */
+	if (metrics_count >= metrics_games) write_metrics();
+
+#ifdef AI_THREADS
+	/* Unlock counters */
+	pthread_mutex_unlock(&games_mutex);
+#endif
+}
+
+/*
+ * Check whether a checkpoint is due after a finished game.
+ */
+static int checkpoint_due(void)
+{
+	int due = 0;
+
+	/* Check for no checkpoints */
+	if (!checkpoint_dir) return 0;
+
+#ifdef AI_THREADS
+	/* Lock counters */
+	pthread_mutex_lock(&games_mutex);
+#endif
+
+	/* Count game */
+	checkpoint_count++;
+
+	/* Check for enough games played */
+	if (checkpoint_games && checkpoint_count >= checkpoint_games) due = 1;
+
+	/* Check for enough time passed */
+	if (checkpoint_seconds &&
+	    time(NULL) - checkpoint_time >= checkpoint_seconds) due = 1;
+
+	/* Check for checkpoint due */
+	if (due)
+	{
+		/* Restart counters */
+		checkpoint_count = 0;
+		checkpoint_time = time(NULL);
+	}
+
+#ifdef AI_THREADS
+	/* Unlock counters */
+	pthread_mutex_unlock(&games_mutex);
+#endif
+
+	/* Return result */
+	return due;
+}
+
+/*
+ * Set up a game and its AI players.
+ *
+ * The first game set up loads the networks, and games set up afterwards in
+ * other threads share their weights.
+ */
+static void setup_game(game *g)
+{
+	char buf[1024];
+	int i;
+
+	/* Set number of players */
+	g->num_players = num_players;
+
+	/* Set expansion level */
+	g->expanded = expansion_level;
+
+	/* Set advanced flag */
+	g->advanced = advanced;
+
+	/* Set promo flag */
+	g->promo = promo;
+
+	/* Assume no options disabled */
+	g->goal_disabled = 0;
+	g->takeover_disabled = 0;
+
+	/* No campaign selected */
+	g->camp = NULL;
+
+	/* Call initialization functions */
+	for (i = 0; i < num_players; i++)
+	{
+		/* Create player name */
+		sprintf(buf, "Player %d", i);
+
+		/* Set player name */
+		g->p[i].name = strdup(buf);
+
+		/* Set player interfaces to AI functions */
+		g->p[i].control = &ai_func;
+
+		/* Initialize AI */
+		g->p[i].control->init(g, i, factor);
+
+		/* Create choice log for player */
+		g->p[i].choice_log = new_choice_log();
+
+		/* Clear choice log size and position */
+		g->p[i].choice_size = 0;
+		g->p[i].choice_pos = 0;
+	}
+}
+
+/*
+ * Play training games until none are left.
+ */
+static void play_games(game *g)
+{
+	char *names[MAX_PLAYER];
+	double start;
+	int j;
+
+	/* Remember player names */
+	for (j = 0; j < num_players; j++) names[j] = g->p[j].name;
+
+	/* Play a number of games */
+	while (1)
+	{
+#ifdef AI_THREADS
+		/* Lock game counter */
+		pthread_mutex_lock(&games_mutex);
+#endif
+
+		/* Check for no games left */
+		if (!games_left)
+		{
+#ifdef AI_THREADS
+			/* Unlock game counter */
+			pthread_mutex_unlock(&games_mutex);
+#endif
+
+			/* Stop */
+			break;
+		}
+
+		/* Claim one game */
+		games_left--;
+
+#ifdef AI_THREADS
+		/* Unlock game counter */
+		pthread_mutex_unlock(&games_mutex);
+#endif
+
+		/* Start timing game */
+		start = wall_time();
+
+		/* Initialize game */
+		init_game(g);
+
+		/* Game is learning game */
+		g->session_id = -2;
+
+		printf("Start seed: %u\n", g->start_seed);
+
+		/* Begin game */
+		begin_game(g);
+
+		/* Play game rounds until finished */
+		while (game_round(g));
+
+		/* Score game */
+		score_game(g);
+
+		/* Print result */
+		for (j = 0; j < num_players; j++)
+		{
+			/* Print score */
+			printf("%s: %d\n", g->p[j].name,
+			                   g->p[j].end_vp);
+		}
+
+		/* Declare winner */
+		declare_winner(g);
+
+		/* Call player game over functions */
+		for (j = 0; j < num_players; j++)
+		{
+			/* Call game over function */
+			g->p[j].control->game_over(g, j);
+
+			/* Clear choice log */
+			g->p[j].choice_size = 0;
+			g->p[j].choice_pos = 0;
+		}
+
+		/* Reset player names */
+		for (j = 0; j < num_players; j++)
+		{
+			/* Reset name */
+			g->p[j].name = names[j];
+		}
+
+		/* Count game for metrics */
+		record_metrics(wall_time() - start);
+
+		/* Check for checkpoint due */
+		if (checkpoint_due() && ai_checkpoint() < 0)
+		{
+			/* Warn and keep training */
+			printf("Could not write checkpoint\n");
+		}
+	}
+}
+
+#ifdef AI_THREADS
+/*
+ * Set up and play games in an additional thread.
+ */
+static void *worker_main(void *arg)
+{
+	game *g = (game *)arg;
+
+	/* Set up game sharing the networks */
+	setup_game(g);
+
+	/* Play games */
+	play_games(g);
+
+	/* Fold statistics into shared networks */
+	ai_thread_done();
+
+	/* Done */
+	return NULL;
+}
+#endif
+
 /*
  * Play a number of training games.
  */
 int main(int argc, char *argv[])
 {
 	game my_game;
-	int i, j, n = 100;
-	int num_players = 3;
-	int expansion = 0, advanced = 0, promo = 0;
-	char buf[1024], *names[MAX_PLAYER];
-	double factor = 1.0;
+#ifdef AI_THREADS
+	game *workers;
+	pthread_t *threads;
+	int num_threads = 1;
+#endif
+	int i, checkpoint_keep = 0;
 
 	/* Set random seed */
 	my_game.random_seed = time(NULL);
@@ -113,7 +528,7 @@ int main(int argc, char *argv[])
 		else if (!strcmp(argv[i], "-e"))
 		{
 			/* Set expansion level */
-			expansion = atoi(argv[++i]);
+			expansion_level = atoi(argv[++i]);
 		}
 
 		/* Check for promo cards */
@@ -127,7 +542,7 @@ int main(int argc, char *argv[])
 		else if (!strcmp(argv[i], "-n"))
 		{
 			/* Set number of games */
-			n = atoi(argv[++i]);
+			games_left = atoi(argv[++i]);
 		}
 
 		/* Check for random seed */
@@ -143,99 +558,167 @@ int main(int argc, char *argv[])
 			/* Set factor */
 			factor = atof(argv[++i]);
 		}
-	}
 
-	/* Set number of players */
-	my_game.num_players = num_players;
+#ifdef AI_THREADS
+		/* Check for number of threads */
+		else if (!strcmp(argv[i], "-j"))
+		{
+			/* Set number of threads */
+			num_threads = atoi(argv[++i]);
 
-	/* Set expansion level */
-	my_game.expanded = expansion;
+			/* Use at least one thread */
+			if (num_threads < 1) num_threads = 1;
+		}
+#endif
 
-	/* Set advanced flag */
-	my_game.advanced = advanced;
+		/* Check for checkpoint directory */
+		else if (!strcmp(argv[i], "-c"))
+		{
+			/* Set directory */
+			checkpoint_dir = argv[++i];
+		}
 
-	/* Set promo flag */
-	my_game.promo = promo;
+		/* Check for games between checkpoints */
+		else if (!strcmp(argv[i], "-k"))
+		{
+			/* Set number of games */
+			checkpoint_games = atoi(argv[++i]);
+		}
 
-	/* Assume no options disabled */
-	my_game.goal_disabled = 0;
-	my_game.takeover_disabled = 0;
+		/* Check for minutes between checkpoints */
+		else if (!strcmp(argv[i], "-m"))
+		{
+			/* Set number of seconds */
+			checkpoint_seconds = atoi(argv[++i]) * 60;
+		}
 
-	/* No campaign selected */
-	my_game.camp = NULL;
+		/* Check for older checkpoints to keep */
+		else if (!strcmp(argv[i], "-K"))
+		{
+			/* Set number of checkpoints */
+			checkpoint_keep = atoi(argv[++i]);
+		}
 
-	/* Call initialization functions */
-	for (i = 0; i < num_players; i++)
-	{
-		/* Create player name */
-		sprintf(buf, "Player %d", i);
+		/* Check for metrics file */
+		else if (!strcmp(argv[i], "-t"))
+		{
+			/* Open file */
+			metrics_file = fopen(argv[++i], "w");
+
+			/* Check for failure */
+			if (!metrics_file)
+			{
+				/* Error */
+				perror(argv[i]);
+				exit(1);
+			}
+		}
 
-		/* Set player name */
-		my_game.p[i].name = strdup(buf);
-		names[i] = my_game.p[i].name;
+		/* Check for games between lines of metrics */
+		else if (!strcmp(argv[i], "-T"))
+		{
+			/* Set number of games */
+			metrics_games = atoi(argv[++i]);
 
-		/* Set player interfaces to AI functions */
-		my_game.p[i].control = &ai_func;
+			/* Write at least every game */
+			if (metrics_games < 1) metrics_games = 1;
+		}
 
-		/* Initialize AI */
-		my_game.p[i].control->init(&my_game, i, factor);
+		/* Check for experience file */
+		else if (!strcmp(argv[i], "-x"))
+		{
+			/* Capture experience instead of training */
+			if (ai_open_experience(argv[++i], NULL) < 0)
+			{
+				/* Error */
+				perror(argv[i]);
+				exit(1);
+			}
+		}
+	}
 
-		/* Create choice log for player */
-		my_game.p[i].choice_log = (int *)malloc(sizeof(int) * 4096);
+	/* Check for checkpoints wanted */
+	if (checkpoint_dir)
+	{
+		/* Checkpoint every 100 games if no interval given */
+		if (!checkpoint_games && !checkpoint_seconds)
+		{
+			/* Set default interval */
+			checkpoint_games = 100;
+		}
 
-		/* Clear choice log size and position */
-		my_game.p[i].choice_size = 0;
-		my_game.p[i].choice_pos = 0;
+		/* Resume from newest checkpoint, and write new ones */
+		ai_set_checkpoint_dir(checkpoint_dir, checkpoint_keep);
+
+		/* Start timing */
+		checkpoint_time = time(NULL);
 	}
 
-	/* Play a number of games */
-	for (i = 0; i < n; i++)
-	{
-		/* Initialize game */
-		init_game(&my_game);
+	/* Set up our game, loading the networks */
+	setup_game(&my_game);
 
-		/* Game is learning game */
-		my_game.session_id = -2;
+	/* Check for metrics wanted */
+	if (metrics_file)
+	{
+		/* Write column names */
+		write_metrics_header();
 
-		printf("Start seed: %u\n", my_game.start_seed);
+		/* Don't count work done while loading networks */
+		ai_collect_stats(&metrics);
+		memset(&metrics, 0, sizeof(metrics));
 
-		/* Begin game */
-		begin_game(&my_game);
+		/* Start timing */
+		metrics_time = wall_time();
+	}
 
-		/* Play game rounds until finished */
-		while (game_round(&my_game));
+#ifdef AI_THREADS
+	/* Create games and threads for additional workers */
+	workers = (game *)malloc(sizeof(game) * num_threads);
+	threads = (pthread_t *)malloc(sizeof(pthread_t) * num_threads);
 
-		/* Score game */
-		score_game(&my_game);
+	/* Start additional workers */
+	for (i = 1; i < num_threads; i++)
+	{
+		/* Give each worker its own random number stream */
+		workers[i].random_seed = my_game.random_seed + i;
 
-		/* Print result */
-		for (j = 0; j < num_players; j++)
+		/* Start thread */
+		if (pthread_create(&threads[i], NULL, worker_main, &workers[i]))
 		{
-			/* Print score */
-			printf("%s: %d\n", my_game.p[j].name,
-			                   my_game.p[j].end_vp);
+			/* Error */
+			perror("pthread_create");
+			exit(1);
 		}
+	}
+#endif
 
-		/* Declare winner */
-		declare_winner(&my_game);
+	/* Play games in this thread as well */
+	play_games(&my_game);
 
-		/* Call player game over functions */
-		for (j = 0; j < num_players; j++)
-		{
-			/* Call game over function */
-			my_game.p[j].control->game_over(&my_game, j);
+#ifdef AI_THREADS
+	/* Wait for other workers to finish */
+	for (i = 1; i < num_threads; i++)
+	{
+		/* Wait for thread */
+		pthread_join(threads[i], NULL);
+	}
+#endif
 
-			/* Clear choice log */
-			my_game.p[j].choice_size = 0;
-			my_game.p[j].choice_pos = 0;
-		}
+	/* Check for metrics of games not yet written */
+	if (metrics_file && metrics_count)
+	{
+		/* Write last line */
+		write_metrics();
+	}
 
-		/* Reset player names */
-		for (j = 0; j < num_players; j++)
-		{
-			/* Reset name */
-			my_game.p[j].name = names[j];
-		}
+	/* Check for metrics file */
+	if (metrics_file) fclose(metrics_file);
+
+	/* Check for checkpoints wanted */
+	if (checkpoint_dir && ai_checkpoint() < 0)
+	{
+		/* Warn */
+		printf("Could not write checkpoint\n");
 	}
 
 	/* Call interface shutdown functions */
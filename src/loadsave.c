@@ -95,11 +95,18 @@ static int read_game(game *g, FILE* fff)
 		/* Read choice log size */
 		if (fscanf(fff, "%d", &p_ptr->choice_size) != 1) return -1;
 
+		/* Check for bad size */
+		if (p_ptr->choice_size < 0) return -1;
+
+		/* Make room for log */
+		grow_choice_log(p_ptr->choice_log, p_ptr->choice_size);
+
 		/* Loop over choice log entries */
 		for (j = 0; j < p_ptr->choice_size; j++)
 		{
 			/* Read choice log entry */
-			if (fscanf(fff, "%d", &p_ptr->choice_log[j]) != 1) return -1;
+			if (fscanf(fff, "%d", &p_ptr->choice_log->data[j]) != 1)
+				return -1;
 		}
 
 		/* Reset choice log position */
@@ -230,7 +237,7 @@ void write_game(game *g, FILE *fff, int player_us)
 		for (j = 0; j < p_ptr->choice_unread_pos; j++)
 		{
 			/* Write choice log entry */
-			fprintf(fff, "%d ", p_ptr->choice_log[j]);
+			fprintf(fff, "%d ", p_ptr->choice_log->data[j]);
 		}
 
 		/* Finish line */
@@ -288,22 +295,22 @@ static int cmp_hand(const void *h1, const void *h2)
 	card *c_ptr1 = *(card **)h1, *c_ptr2 = *(card **)h2;
 
 	/* Worlds come before developments */
-	if (c_ptr1->d_ptr->type != c_ptr2->d_ptr->type)
+	if (library[c_ptr1->d_idx].type != library[c_ptr2->d_idx].type)
 	{
 		/* Check for development */
-		if (c_ptr1->d_ptr->type == TYPE_DEVELOPMENT) return 1;
-		if (c_ptr2->d_ptr->type == TYPE_DEVELOPMENT) return -1;
+		if (library[c_ptr1->d_idx].type == TYPE_DEVELOPMENT) return 1;
+		if (library[c_ptr2->d_idx].type == TYPE_DEVELOPMENT) return -1;
 	}
 
 	/* Sort by cost */
-	if (c_ptr1->d_ptr->cost != c_ptr2->d_ptr->cost)
+	if (library[c_ptr1->d_idx].cost != library[c_ptr2->d_idx].cost)
 	{
 		/* Return cost difference */
-		return c_ptr1->d_ptr->cost - c_ptr2->d_ptr->cost;
+		return library[c_ptr1->d_idx].cost - library[c_ptr2->d_idx].cost;
 	}
 
 	/* Otherwise sort by index */
-	return c_ptr1->d_ptr->index - c_ptr2->d_ptr->index;
+	return c_ptr1->d_idx - c_ptr2->d_idx;
 }
 
 /*
@@ -387,11 +394,11 @@ static void export_cards(FILE *fff, char *header, game *g, int n, card **cards,
 
 		/* Write card name and good indicator */
 		fprintf(fff, "      <Card id=\"%d\"%s%s%s>%s</Card>\n",
-		        cards[p]->d_ptr->index,
+		        cards[p]->d_idx,
 		        cards[p]->num_goods > 0 ? " good=\"yes\"" : "",
 		        num_goods,
 		        exp ? " explore=\"yes\"" : "",
-		        xml_escape(cards[p]->d_ptr->name));
+		        xml_escape(library[cards[p]->d_idx].name));
 	}
 
 	/* End tag */
@@ -486,8 +493,8 @@ static void export_locations(FILE *fff, game *g, int who,
 		/* Write card name and location tag */
 		fprintf(fff,
 		        "    <Card id=\"%d\"%s location=\"%s\">%s</Card>\n",
-		        c_ptr->d_ptr->index, owner, location,
-		        xml_escape(c_ptr->d_ptr->name));
+		        c_ptr->d_idx, owner, location,
+		        xml_escape(library[c_ptr->d_idx].name));
 	}
 }
 
@@ -781,8 +788,8 @@ int export_game(game *g, char *filename, char *style_sheet,
 					{
 						/* Write card name */
 						fprintf(fff, "      <Card id=\"%d\">%s</Card>\n",
-						        g->deck[i].d_ptr->index,
-						        xml_escape(g->deck[i].d_ptr->name));
+						        g->deck[i].d_idx,
+						        xml_escape(library[g->deck[i].d_idx].name));
 					}
 				}
 			}
@@ -22,10 +22,23 @@
 
 #include "net.h"
 
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+/*
+ * Tags at the start of experience records.
+ *
+ * Records of the second kind give desired outputs for every input set
+ * instead of game outcomes.
+ */
+#define EXPERIENCE_TAG "RXP1"
+#define EXPERIENCE_TAG_DESIRED "RXS1"
+
 /*
- * Maximum number of previous input sets.
+ * Tag at the start of binary weight files.
  */
-#define PAST_MAX 120
+#define WEIGHT_TAG "RNB1"
 
 /*
  * Create a random weight value.
@@ -36,21 +49,73 @@ static void init_weight(double *wgt)
 	*wgt = 0.2 * rand() / RAND_MAX - 0.1;
 }
 
+#ifdef __GNUC__
 /*
- * Create a network of the given size.
+ * SIMD type.  Four doubles at once.
  */
-void make_learner(net *learn, int input, int hidden, int output)
+typedef double vec __attribute__ ((vector_size (32)));
+#define VEC_SIZE 4
+#else
+typedef double vec;
+#define VEC_SIZE 1
+#endif
+
+/*
+ * Number of values stored in a matrix row of the given length.
+ *
+ * Rows are padded to a whole number of SIMD vectors.
+ */
+#define ROW_SIZE(n) (((n) + 3) & ~3)
+
+/*
+ * Create a cleared matrix.
+ *
+ * The rows are stored contiguously in the same block as the row pointers,
+ * aligned for SIMD, so the matrix is destroyed with a single free().
+ */
+static double **make_matrix(int rows, int cols)
 {
-	int i, j;
+	double **m, *data;
+	size_t head;
+	int i;
 
-	/* Set number of outputs */
-	learn->num_output = output;
+	/* Compute space for row pointers */
+	head = (sizeof(double *) * rows + 31) & ~(size_t)31;
 
-	/* Set number of inputs */
-	learn->num_inputs = input;
+	/* Create block with room for alignment */
+	m = (double **)malloc(head + sizeof(double) * ROW_SIZE(cols) * rows +
+	                      32);
 
-	/* Number of hidden nodes */
-	learn->num_hidden = hidden;
+	/* Find aligned start of rows */
+	data = (double *)(((size_t)((char *)m + head) + 31) & ~(size_t)31);
+
+	/* Clear rows */
+	memset(data, 0, sizeof(double) * ROW_SIZE(cols) * rows);
+
+	/* Loop over rows */
+	for (i = 0; i < rows; i++)
+	{
+		/* Set row pointer */
+		m[i] = data + i * ROW_SIZE(cols);
+	}
+
+	/* Return matrix */
+	return m;
+}
+
+/*
+ * Create the arrays a network uses while computing and training.
+ *
+ * The network size must already be set.
+ */
+static void make_scratch(net *learn)
+{
+	int input, hidden, output;
+
+	/* Get network size */
+	input = learn->num_inputs;
+	hidden = learn->num_hidden;
+	output = learn->num_output;
 
 	/* Clear error counters */
 	learn->error = learn->num_error = 0;
@@ -80,87 +145,87 @@ void make_learner(net *learn, int input, int hidden, int output)
 	learn->input_value[input] = 1.0;
 	learn->hidden_result[hidden] = 1.0;
 
-	/* Create rows of hidden weights */
-	learn->hidden_weight = (double **)malloc(sizeof(double *) *
-	                                         (input + 1));
+	/* Create cleared hidden weight deltas */
+	learn->hidden_delta = make_matrix(input + 1, hidden);
+
+	/* Create cleared output weight deltas */
+	learn->output_delta = make_matrix(hidden + 1, output);
+
+	/* Clear hidden sums */
+	memset(learn->hidden_sum, 0, sizeof(double) * hidden);
+
+	/* Clear hidden errors */
+	memset(learn->hidden_error, 0, sizeof(double) * hidden);
+
+	/* Clear previous inputs */
+	memset(learn->prev_input, 0, sizeof(double) * (input + 1));
+
+	/* Create set of previous inputs */
+	learn->past_input = (double **)malloc(sizeof(double *) * PAST_MAX);
+
+	/* Create set of previous input players */
+	learn->past_input_player = (int *)malloc(sizeof(int) * PAST_MAX);
+
+	/* No past inputs available */
+	learn->num_past = 0;
+}
+
+/*
+ * Create a network of the given size.
+ */
+void make_learner(net *learn, int input, int hidden, int output)
+{
+	int i, j;
+
+	/* Set number of outputs */
+	learn->num_output = output;
+
+	/* Set number of inputs */
+	learn->num_inputs = input;
+
+	/* Number of hidden nodes */
+	learn->num_hidden = hidden;
+
+	/* Create working arrays */
+	make_scratch(learn);
 
-	/* Create rows of hidden weight deltas */
-	learn->hidden_delta = (double **)malloc(sizeof(double *) *
-	                                        (input + 1));
+	/* Create hidden weights */
+	learn->hidden_weight = make_matrix(input + 1, hidden);
 
 	/* Loop over hidden weight rows */
 	for (i = 0; i < input + 1; i++)
 	{
-		/* Create weight row */
-		learn->hidden_weight[i] = (double *)malloc(sizeof(double) *
-		                                           hidden);
-
-		/* Create weight delta row */
-		learn->hidden_delta[i] = (double *)malloc(sizeof(double) *
-		                                          hidden);
-
 		/* Randomize weights */
 		for (j = 0; j < hidden; j++)
 		{
 			/* Randomize this weight */
 			init_weight(&learn->hidden_weight[i][j]);
-
-			/* Clear delta */
-			learn->hidden_delta[i][j] = 0;
 		}
 	}
 
-	/* Create rows of output weights */
-	learn->output_weight = (double **)malloc(sizeof(double *) *
-	                                         (hidden + 1));
-
-	/* Create rows of output weight deltas */
-	learn->output_delta = (double **)malloc(sizeof(double *) *
-	                                        (hidden + 1));
+	/* Create output weights */
+	learn->output_weight = make_matrix(hidden + 1, output);
 
 	/* Loop over output weight rows */
 	for (i = 0; i < hidden + 1; i++)
 	{
-		/* Create weight row */
-		learn->output_weight[i] = (double *)malloc(sizeof(double) *
-		                                           output);
-
-		/* Create weight delta row */
-		learn->output_delta[i] = (double *)malloc(sizeof(double) *
-		                                          output);
-
 		/* Randomize weights */
 		for (j = 0; j < output; j++)
 		{
 			/* Randomize this weight */
 			init_weight(&learn->output_weight[i][j]);
-
-			/* Clear delta */
-			learn->output_delta[i][j] = 0;
 		}
 	}
 
-	/* Clear hidden sums */
-	memset(learn->hidden_sum, 0, sizeof(double) * hidden);
-
-	/* Clear hidden errors */
-	memset(learn->hidden_error, 0, sizeof(double) * hidden);
-
-	/* Clear previous inputs */
-	memset(learn->prev_input, 0, sizeof(double) * (input + 1));
-
-	/* Create set of previous inputs */
-	learn->past_input = (double **)malloc(sizeof(double *) * PAST_MAX);
-
-	/* Create set of previous input players */
-	learn->past_input_player = (int *)malloc(sizeof(int) * PAST_MAX);
-
-	/* No past inputs available */
-	learn->num_past = 0;
-
 	/* No training done */
 	learn->num_training = 0;
 
+	/* Weights belong to this network */
+	learn->shared = 0;
+
+	/* No inputs pruned */
+	learn->input_dead = (char *)calloc(input, sizeof(char));
+
 	/* Create array for input names */
 	learn->input_name = (char **)malloc(sizeof(char *) * input);
 
@@ -172,6 +237,37 @@ void make_learner(net *learn, int input, int hidden, int output)
 	}
 }
 
+/*
+ * Create a network that uses the weights of another.
+ *
+ * The new network has its own working arrays, training deltas and past
+ * inputs, so that it can be computed and trained in a different thread
+ * than the original.  Training is applied to the shared weights.
+ */
+void share_net(net *learn, net *src)
+{
+	/* Copy size and learning rate */
+	learn->num_inputs = src->num_inputs;
+	learn->num_hidden = src->num_hidden;
+	learn->num_output = src->num_output;
+	learn->alpha = src->alpha;
+
+	/* Create working arrays */
+	make_scratch(learn);
+
+	/* Use weights and input names of original */
+	learn->hidden_weight = src->hidden_weight;
+	learn->output_weight = src->output_weight;
+	learn->input_dead = src->input_dead;
+	learn->input_name = src->input_name;
+
+	/* No training done through this network yet */
+	learn->num_training = 0;
+
+	/* Weights belong to the original */
+	learn->shared = 1;
+}
+
 /*
  * Normalize a number using a 'sigmoid' function.
  */
@@ -181,12 +277,7 @@ static double sigmoid(double x)
 	return tanh(x);
 }
 
-#if 0
-/*
- * SIMD type.  Two doubles at once.
- */
-typedef double v2d __attribute__ ((vector_size (16)));
-#endif
+static void compute_output(net *learn);
 
 /*
  * Compute a neural net's result.
@@ -194,7 +285,6 @@ typedef double v2d __attribute__ ((vector_size (16)));
 void compute_net(net *learn)
 {
 	int i, j;
-	double sum, adj = 0.0;
 #if 0
 	v2d *weight, *hid_sum;
 #endif
@@ -205,6 +295,14 @@ void compute_net(net *learn)
 		/* Check for difference from previous input */
 		if (learn->input_value[i] != learn->prev_input[i])
 		{
+			/* Check for input without weights */
+			if (i < learn->num_inputs && learn->input_dead[i])
+			{
+				/* Store input */
+				learn->prev_input[i] = learn->input_value[i];
+				continue;
+			}
+
 #if 0
 			for (j = 0; j < learn->num_hidden; j += 2)
 			{
@@ -260,6 +358,18 @@ void compute_net(net *learn)
 		}
 	}
 
+	/* Compute results from hidden sums */
+	compute_output(learn);
+}
+
+/*
+ * Compute a neural net's result from its hidden node sums.
+ */
+static void compute_output(net *learn)
+{
+	int i, j;
+	double sum, adj = 0.0;
+
 	/* Normalize hidden node results */
 	for (i = 0; i < learn->num_hidden; i++)
 	{
@@ -368,13 +478,14 @@ void clear_store(net *learn)
 }
 
 /*
- * Train a network so that the current results are more like the desired.
+ * Accumulate output weight deltas for the current results, and compute the
+ * hidden weight correction factors.
  */
-void train_net(net *learn, double lambda, double *desired)
+static void train_output(net *learn, double lambda, double *desired,
+                         double *hidden_corr)
 {
 	int i, j, k;
 	double error, corr, deriv, hderiv;
-	double *hidden_corr;
 
 	/* Count error events */
 	learn->num_error += lambda;
@@ -424,9 +535,6 @@ void train_net(net *learn, double lambda, double *desired)
 		learn->output_delta[j][i] += learn->alpha * -error * deriv;
 	}
 
-	/* Create array of hidden weight correction factors */
-	hidden_corr = (double *)malloc(sizeof(double) * learn->num_hidden);
-
 	/* Loop over hidden nodes */
 	for (i = 0; i < learn->num_hidden; i++)
 	{
@@ -435,7 +543,37 @@ void train_net(net *learn, double lambda, double *desired)
 
 		/* Calculate correction factor */
 		hidden_corr[i] = deriv * -learn->hidden_error[i] * learn->alpha;
+
+		/* Clear node's error */
+		learn->hidden_error[i] = 0;
 	}
+}
+
+/*
+ * Forget the stored hidden sums, so that the next computation starts over.
+ */
+static void clear_sums(net *learn)
+{
+	/* Clear stored sums */
+	memset(learn->hidden_sum, 0, sizeof(double) * learn->num_hidden);
+
+	/* Clear previous inputs */
+	memset(learn->prev_input, 0, sizeof(double) * (learn->num_inputs + 1));
+}
+
+/*
+ * Train a network so that the current results are more like the desired.
+ */
+void train_net(net *learn, double lambda, double *desired)
+{
+	int i, j;
+	double *hidden_corr;
+
+	/* Create array of hidden weight correction factors */
+	hidden_corr = (double *)malloc(sizeof(double) * learn->num_hidden);
+
+	/* Train output weights and compute hidden correction factors */
+	train_output(learn, lambda, desired, hidden_corr);
 
 	/* Loop over inputs */
 	for (i = 0; i < learn->num_inputs + 1; i++)
@@ -455,18 +593,8 @@ void train_net(net *learn, double lambda, double *desired)
 	/* Destroy hidden correction factor array */
 	free(hidden_corr);
 
-	/* Loop over hidden nodes */
-	for (i = 0; i < learn->num_hidden; i++)
-	{
-		/* Clear node's error */
-		learn->hidden_error[i] = 0;
-
-		/* Clear node's stored sum */
-		learn->hidden_sum[i] = 0;
-	}
-
-	/* Clear previous inputs */
-	memset(learn->prev_input, 0, sizeof(double) * (learn->num_inputs + 1));
+	/* Start next computation over */
+	clear_sums(learn);
 
 #ifdef NOISY
 	compute_net();
@@ -477,6 +605,219 @@ void train_net(net *learn, double lambda, double *desired)
 #endif
 }
 
+/*
+ * Number of weight rows worked on at once, small enough to stay in cache.
+ */
+#define TILE_ROWS 32
+
+/*
+ * Compute the hidden sums of a number of input sets at once.
+ *
+ * Four sets are computed together, so that each row of weights is loaded
+ * once for all of them, and the weights are gone over in tiles of rows
+ * that stay in cache.  Each sum adds its weighted inputs in the same order
+ * as compute_net() does, so the results are identical.  The sums must
+ * start cleared.
+ */
+static void batch_sums(net *learn, double **input, double **sums, int num)
+{
+	double *in0, *in1, *in2, *in3, *zero;
+	vec acc0, acc1, acc2, acc3, w, *s1, *s2, *s3, scratch[4];
+	int i, j, k, tile, end, n = learn->num_inputs + 1;
+
+	/* Create input set of zeroes to fill out last group */
+	zero = (double *)calloc(learn->num_inputs + 1, sizeof(double));
+
+	/* Clear sums of sets filling out last group */
+	scratch[1] = scratch[2] = scratch[3] = (vec){ 0 };
+
+	/* Loop over groups of four sets */
+	for (k = 0; k < num; k += 4)
+	{
+		/* Get inputs of sets in group */
+		in0 = input[k];
+		in1 = k + 1 < num ? input[k + 1] : zero;
+		in2 = k + 2 < num ? input[k + 2] : zero;
+		in3 = k + 3 < num ? input[k + 3] : zero;
+
+		/* Loop over tiles of weight rows */
+		for (tile = 0; tile < n; tile = end)
+		{
+			/* Find end of tile */
+			end = tile + TILE_ROWS < n ? tile + TILE_ROWS : n;
+
+			/* Loop over vectors of hidden nodes */
+			for (j = 0; j < learn->num_hidden; j += VEC_SIZE)
+			{
+				/* Find sums of sets in group */
+				s1 = k + 1 < num ? (vec *)&sums[k + 1][j] :
+				                   &scratch[1];
+				s2 = k + 2 < num ? (vec *)&sums[k + 2][j] :
+				                   &scratch[2];
+				s3 = k + 3 < num ? (vec *)&sums[k + 3][j] :
+				                   &scratch[3];
+
+				/* Get sums so far */
+				acc0 = *(vec *)&sums[k][j];
+				acc1 = *s1;
+				acc2 = *s2;
+				acc3 = *s3;
+
+				/* Loop over inputs in tile */
+				for (i = tile; i < end; i++)
+				{
+					/* Get weights to hidden nodes */
+					w = *(vec *)&learn->hidden_weight[i][j];
+
+					/* Add weighted inputs */
+					acc0 += w * in0[i];
+					acc1 += w * in1[i];
+					acc2 += w * in2[i];
+					acc3 += w * in3[i];
+				}
+
+				/* Store sums */
+				*(vec *)&sums[k][j] = acc0;
+				*s1 = acc1;
+				*s2 = acc2;
+				*s3 = acc3;
+			}
+		}
+	}
+
+	/* Destroy input set of zeroes */
+	free(zero);
+}
+
+/*
+ * Accumulate hidden weight deltas of a number of input sets at once.
+ *
+ * Four rows of deltas are updated together, so that each set's correction
+ * factors are loaded once for all of them.  Each delta adds the sets'
+ * corrections in order, as repeated calls to train_net() would.
+ */
+static void batch_deltas(net *learn, double **input, double **corr, int num)
+{
+	vec acc0, acc1, acc2, acc3, c;
+	int i, j, k, n = learn->num_inputs + 1;
+
+	/* Loop over groups of four inputs */
+	for (i = 0; i + 4 <= n; i += 4)
+	{
+		/* Loop over vectors of hidden nodes */
+		for (j = 0; j < learn->num_hidden; j += VEC_SIZE)
+		{
+			/* Get current deltas */
+			acc0 = *(vec *)&learn->hidden_delta[i][j];
+			acc1 = *(vec *)&learn->hidden_delta[i + 1][j];
+			acc2 = *(vec *)&learn->hidden_delta[i + 2][j];
+			acc3 = *(vec *)&learn->hidden_delta[i + 3][j];
+
+			/* Loop over sets */
+			for (k = 0; k < num; k++)
+			{
+				/* Get set's correction factors */
+				c = *(vec *)&corr[k][j];
+
+				/* Add corrections for set's inputs */
+				acc0 += c * input[k][i];
+				acc1 += c * input[k][i + 1];
+				acc2 += c * input[k][i + 2];
+				acc3 += c * input[k][i + 3];
+			}
+
+			/* Store deltas */
+			*(vec *)&learn->hidden_delta[i][j] = acc0;
+			*(vec *)&learn->hidden_delta[i + 1][j] = acc1;
+			*(vec *)&learn->hidden_delta[i + 2][j] = acc2;
+			*(vec *)&learn->hidden_delta[i + 3][j] = acc3;
+		}
+	}
+
+	/* Loop over remaining inputs */
+	for ( ; i < n; i++)
+	{
+		/* Loop over vectors of hidden nodes */
+		for (j = 0; j < learn->num_hidden; j += VEC_SIZE)
+		{
+			/* Get current deltas */
+			acc0 = *(vec *)&learn->hidden_delta[i][j];
+
+			/* Loop over sets */
+			for (k = 0; k < num; k++)
+			{
+				/* Add corrections for set's input */
+				acc0 += *(vec *)&corr[k][j] * input[k][i];
+			}
+
+			/* Store deltas */
+			*(vec *)&learn->hidden_delta[i][j] = acc0;
+		}
+	}
+}
+
+/*
+ * Train a network on a minibatch of input sets (including bias input),
+ * each with its own amount of training and desired outputs.
+ *
+ * The result is the same as computing and training each input set in turn
+ * with train_net(), but the sets are processed together as matrix products
+ * that go over the rows of weights once per group of sets.  The first set
+ * is computed from the network's last computation, as compute_net() would.
+ * If lambda is NULL, every set is fully trained.  Training is accumulated
+ * but not applied.
+ */
+void train_net_batch(net *learn, double **input, double *lambda,
+                     double **desired, int num)
+{
+	double **sums, **corr;
+	int k;
+
+	/* Create hidden sums of each set */
+	sums = make_matrix(num, learn->num_hidden);
+
+	/* Create cleared correction factors of each set */
+	corr = make_matrix(num, learn->num_hidden);
+
+	/* Copy first set's inputs to network */
+	memcpy(learn->input_value, input[0],
+	       sizeof(double) * (learn->num_inputs + 1));
+
+	/* Compute first set as usual */
+	compute_net(learn);
+
+	/* Train first set's output weights */
+	train_output(learn, lambda ? lambda[0] : 1.0, desired[0], corr[0]);
+
+	/* Compute hidden sums of remaining sets */
+	batch_sums(learn, input + 1, sums + 1, num - 1);
+
+	/* Loop over remaining sets */
+	for (k = 1; k < num; k++)
+	{
+		/* Use set's hidden sums */
+		memcpy(learn->hidden_sum, sums[k],
+		       sizeof(double) * learn->num_hidden);
+
+		/* Compute results */
+		compute_output(learn);
+
+		/* Train set's output weights */
+		train_output(learn, lambda ? lambda[k] : 1.0, desired[k],
+		             corr[k]);
+	}
+
+	/* Accumulate hidden weight deltas of all sets */
+	batch_deltas(learn, input, corr, num);
+
+	/* Destroy arrays */
+	free(sums);
+	free(corr);
+
+	/* Start next computation over */
+	clear_sums(learn);
+}
+
 /*
  * Apply accumulated training information.
  */
@@ -501,6 +842,15 @@ void apply_training(net *learn)
 	/* Loop over input values */
 	for (i = 0; i < learn->num_inputs + 1; i++)
 	{
+		/* Check for pruned input */
+		if (i < learn->num_inputs && learn->input_dead[i])
+		{
+			/* Keep weights cleared */
+			memset(learn->hidden_delta[i], 0,
+			       sizeof(double) * learn->num_hidden);
+			continue;
+		}
+
 		/* Loop over hidden nodes */
 		for (j = 0; j < learn->num_hidden; j++)
 		{
@@ -514,12 +864,10 @@ void apply_training(net *learn)
 }
 
 /*
- * Destroy a neural net.
+ * Destroy the arrays a network uses while computing and training.
  */
-void free_net(net *learn)
+static void free_scratch(net *learn)
 {
-	int i;
-
 	/* Free simple arrays */
 	free(learn->input_value);
 	free(learn->prev_input);
@@ -529,28 +877,8 @@ void free_net(net *learn)
 	free(learn->net_result);
 	free(learn->win_prob);
 
-	/* Free rows of hidden weights */
-	for (i = 0; i < learn->num_inputs + 1; i++)
-	{
-		/* Free weight row */
-		free(learn->hidden_weight[i]);
-		free(learn->hidden_delta[i]);
-	}
-
-	/* Free list of rows */
-	free(learn->hidden_weight);
+	/* Free weight deltas */
 	free(learn->hidden_delta);
-
-	/* Free rows of output weights */
-	for (i = 0; i < learn->num_hidden + 1; i++)
-	{
-		/* Free weight row */
-		free(learn->output_weight[i]);
-		free(learn->output_delta[i]);
-	}
-
-	/* Free list of rows */
-	free(learn->output_weight);
 	free(learn->output_delta);
 
 	/* Clear old past input sets */
@@ -559,6 +887,27 @@ void free_net(net *learn)
 	/* Free list of past inputs */
 	free(learn->past_input);
 	free(learn->past_input_player);
+}
+
+/*
+ * Destroy a neural net.
+ */
+void free_net(net *learn)
+{
+	int i;
+
+	/* Free working arrays */
+	free_scratch(learn);
+
+	/* Leave weights and names to the network that owns them */
+	if (learn->shared) return;
+
+	/* Free weights */
+	free(learn->hidden_weight);
+	free(learn->output_weight);
+
+	/* Free pruned input flags */
+	free(learn->input_dead);
 
 	/* Free input names */
 	for (i = 0; i < learn->num_inputs; i++)
@@ -571,6 +920,100 @@ void free_net(net *learn)
 	free(learn->input_name);
 }
 
+/*
+ * Rename a file, replacing any existing file of the new name.
+ *
+ * Returns -1 on error.
+ */
+int replace_file(char *src, char *dest)
+{
+#ifdef WIN32
+	/* Remove old file first, since rename cannot replace it here */
+	remove(dest);
+#endif
+
+	/* Rename file */
+	return rename(src, dest) ? -1 : 0;
+}
+
+/*
+ * Finish writing a file created under a temporary name, and move it to
+ * its real name.
+ *
+ * The real file is replaced only once the new one is completely written,
+ * so that a crash while saving never leaves a partial file behind.
+ * Returns -1 on error.
+ */
+static int finish_file(FILE *fff, int ok, char *tmp, char *fname)
+{
+	/* Check for write errors */
+	if (fflush(fff)) ok = 0;
+
+#ifndef WIN32
+	/* Make sure data is on disk before it replaces old file */
+	if (ok && fsync(fileno(fff))) ok = 0;
+#endif
+
+	/* Close file */
+	if (fclose(fff)) ok = 0;
+
+	/* Check for failure */
+	if (!ok)
+	{
+		/* Remove incomplete file */
+		remove(tmp);
+		return -1;
+	}
+
+	/* Replace old file */
+	return replace_file(tmp, fname);
+}
+
+/*
+ * Change the number of hidden nodes of a network whose weights are about to
+ * be loaded.
+ */
+static void resize_hidden(net *learn, int hidden)
+{
+	/* Free working arrays and weights */
+	free_scratch(learn);
+	free(learn->hidden_weight);
+	free(learn->output_weight);
+
+	/* Set new size */
+	learn->num_hidden = hidden;
+
+	/* Create working arrays */
+	make_scratch(learn);
+
+	/* Create weights */
+	learn->hidden_weight = make_matrix(learn->num_inputs + 1, hidden);
+	learn->output_weight = make_matrix(hidden + 1, learn->num_output);
+}
+
+/*
+ * Mark inputs whose weights are all zero as pruned, so that they are
+ * skipped when computing and kept at zero when training.
+ */
+void mark_dead_inputs(net *learn)
+{
+	int i, j;
+
+	/* Loop over inputs */
+	for (i = 0; i < learn->num_inputs; i++)
+	{
+		/* Look for nonzero weight */
+		for (j = 0; j < learn->num_hidden; j++)
+		{
+			/* Stop at nonzero weight */
+			if (learn->hidden_weight[i][j]) break;
+		}
+
+		/* Mark input if no weights found */
+		learn->input_dead[i] = (j == learn->num_hidden);
+	}
+}
+
 /*
  * Load network weights from disk.
  */
@@ -591,9 +1034,11 @@ int load_net(net *learn, char *fname)
 	if (fscanf(fff, "%d %d %d\n", &input, &hidden, &output) != 3) return -1;
 
 	/* Check for mismatch */
-	if (input != learn->num_inputs ||
-	    hidden != learn->num_hidden ||
-	    output != learn->num_output) return -1;
+	if (input != learn->num_inputs || output != learn->num_output ||
+	    (hidden != learn->num_hidden && learn->shared)) return -1;
+
+	/* Check for pruned or grown hidden layer */
+	if (hidden != learn->num_hidden) resize_hidden(learn, hidden);
 
 	/* Read number of training iterations */
 	if (fscanf(fff, "%d\n", &learn->num_training) != 1) return -1;
@@ -649,20 +1094,32 @@ int load_net(net *learn, char *fname)
 	/* Done */
 	fclose(fff);
 
+	/* Note inputs pruned away */
+	mark_dead_inputs(learn);
+
 	/* Success */
 	return 0;
 }
 
 /*
  * Save network weights to disk.
+ *
+ * Returns -1 on error, in which case the old file is left alone.
  */
-void save_net(net *learn, char *fname)
+int save_net(net *learn, char *fname)
 {
 	FILE *fff;
+	char tmp[1024];
 	int i, j;
 
+	/* Create temporary filename */
+	sprintf(tmp, "%s.tmp", fname);
+
 	/* Open output file */
-	fff = fopen(fname, "w");
+	fff = fopen(tmp, "w");
+
+	/* Check for failure */
+	if (!fff) return -1;
 
 	/* Save network size */
 	fprintf(fff, "%d %d %d\n", learn->num_inputs, learn->num_hidden,
@@ -709,6 +1166,558 @@ void save_net(net *learn, char *fname)
 		}
 	}
 
+	/* Move file into place */
+	return finish_file(fff, !ferror(fff), tmp, fname);
+}
+
+/*
+ * Load network weights from a binary file written by save_net_binary().
+ *
+ * Input names are not stored, so the network must have been created with
+ * them already.
+ */
+int load_net_binary(net *learn, char *fname)
+{
+	FILE *fff;
+	char tag[4];
+	int size[4];
+	int i, ok = 1;
+
+	/* Open weights file */
+	fff = fopen(fname, "rb");
+
+	/* Check for failure */
+	if (!fff) return -1;
+
+	/* Read tag and network size */
+	if (fread(tag, 1, 4, fff) != 4 || memcmp(tag, WEIGHT_TAG, 4) ||
+	    fread(size, sizeof(int), 4, fff) != 4)
+	{
+		/* Failure */
+		fclose(fff);
+		return -1;
+	}
+
+	/* Check for mismatch */
+	if (size[0] != learn->num_inputs || size[2] != learn->num_output ||
+	    (size[1] != learn->num_hidden && learn->shared))
+	{
+		/* Failure */
+		fclose(fff);
+		return -1;
+	}
+
+	/* Check for pruned or grown hidden layer */
+	if (size[1] != learn->num_hidden) resize_hidden(learn, size[1]);
+
+	/* Read rows of hidden weights */
+	for (i = 0; ok && i < learn->num_inputs + 1; i++)
+	{
+		/* Read row */
+		ok = fread(learn->hidden_weight[i], sizeof(double),
+		           learn->num_hidden, fff) == learn->num_hidden;
+	}
+
+	/* Read rows of output weights */
+	for (i = 0; ok && i < learn->num_hidden + 1; i++)
+	{
+		/* Read row */
+		ok = fread(learn->output_weight[i], sizeof(double),
+		           learn->num_output, fff) == learn->num_output;
+	}
+
 	/* Done */
 	fclose(fff);
+
+	/* Check for short file */
+	if (!ok) return -1;
+
+	/* Set number of training iterations */
+	learn->num_training = size[3];
+
+	/* Note inputs pruned away */
+	mark_dead_inputs(learn);
+
+	/* Success */
+	return 0;
+}
+
+/*
+ * Save network weights to a binary file.
+ *
+ * Weights are saved exactly, and are much faster to read and write than
+ * with save_net().  Returns -1 on error, in which case the old file is left
+ * alone.
+ */
+int save_net_binary(net *learn, char *fname)
+{
+	FILE *fff;
+	char tmp[1024];
+	int size[4];
+	int i, ok;
+
+	/* Create temporary filename */
+	sprintf(tmp, "%s.tmp", fname);
+
+	/* Open output file */
+	fff = fopen(tmp, "wb");
+
+	/* Check for failure */
+	if (!fff) return -1;
+
+	/* Get network size and training iterations */
+	size[0] = learn->num_inputs;
+	size[1] = learn->num_hidden;
+	size[2] = learn->num_output;
+	size[3] = learn->num_training;
+
+	/* Write tag and size */
+	ok = fwrite(WEIGHT_TAG, 1, 4, fff) == 4 &&
+	     fwrite(size, sizeof(int), 4, fff) == 4;
+
+	/* Write rows of hidden weights */
+	for (i = 0; ok && i < learn->num_inputs + 1; i++)
+	{
+		/* Write row */
+		ok = fwrite(learn->hidden_weight[i], sizeof(double),
+		            learn->num_hidden, fff) == learn->num_hidden;
+	}
+
+	/* Write rows of output weights */
+	for (i = 0; ok && i < learn->num_hidden + 1; i++)
+	{
+		/* Write row */
+		ok = fwrite(learn->output_weight[i], sizeof(double),
+		            learn->num_output, fff) == learn->num_output;
+	}
+
+	/* Move file into place */
+	return finish_file(fff, ok, tmp, fname);
+}
+
+/*
+ * Add the current inputs to a game's experience.
+ */
+void add_experience(experience *x, net *learn, int who)
+{
+	int n = learn->num_inputs + 1;
+
+	/* Remember network size */
+	x->num_inputs = learn->num_inputs;
+	x->num_output = learn->num_output;
+
+	/* Check for full arrays */
+	if (x->num_states == x->size)
+	{
+		/* Double array size */
+		x->size = x->size ? x->size * 2 : 256;
+
+		/* Grow arrays */
+		x->player = (int *)realloc(x->player, sizeof(int) * x->size);
+		x->input = (double **)realloc(x->input,
+		                              sizeof(double *) * x->size);
+		x->desired = (double **)realloc(x->desired,
+		                                sizeof(double *) * x->size);
+
+		/* Clear new rows */
+		memset(&x->input[x->num_states], 0,
+		       sizeof(double *) * (x->size - x->num_states));
+		memset(&x->desired[x->num_states], 0,
+		       sizeof(double *) * (x->size - x->num_states));
+	}
+
+	/* Create input row if needed */
+	if (!x->input[x->num_states])
+	{
+		/* Create row */
+		x->input[x->num_states] = (double *)malloc(sizeof(double) * n);
+	}
+
+	/* Copy inputs */
+	memcpy(x->input[x->num_states], learn->input_value, sizeof(double) * n);
+
+	/* Copy player index */
+	x->player[x->num_states] = who;
+
+	/* One additional set */
+	x->num_states++;
+}
+
+/*
+ * Set the desired outputs of a player at the end of a game.
+ */
+void set_experience_outcome(experience *x, net *learn, int who,
+                            double *desired)
+{
+	int i;
+
+	/* Check for new player */
+	if (who >= x->num_players)
+	{
+		/* Grow outcome array */
+		x->outcome = (double *)realloc(x->outcome, sizeof(double) *
+		                               (who + 1) * learn->num_output);
+
+		/* Clear outcomes of new players */
+		for (i = x->num_players * learn->num_output;
+		     i < (who + 1) * learn->num_output; i++)
+		{
+			/* Clear outcome */
+			x->outcome[i] = 0.0;
+		}
+
+		/* Set number of players */
+		x->num_players = who + 1;
+	}
+
+	/* Remember network size */
+	x->num_inputs = learn->num_inputs;
+	x->num_output = learn->num_output;
+
+	/* Copy outcome */
+	memcpy(&x->outcome[who * x->num_output], desired,
+	       sizeof(double) * x->num_output);
+}
+
+/*
+ * Set the desired outputs of one input set.
+ *
+ * A game's experience either has desired outputs for all input sets, or
+ * is trained towards the game outcomes.
+ */
+void set_experience_desired(experience *x, int i, double *desired)
+{
+	/* Create row if needed */
+	if (!x->desired[i])
+	{
+		/* Create row */
+		x->desired[i] = (double *)malloc(sizeof(double) *
+		                                 x->num_output);
+	}
+
+	/* Copy desired outputs */
+	memcpy(x->desired[i], desired, sizeof(double) * x->num_output);
+
+	/* Experience has desired outputs */
+	x->supervised = 1;
+}
+
+/*
+ * Forget the contents of a game's experience, keeping its arrays.
+ */
+void clear_experience(experience *x)
+{
+	/* Clear number of input sets */
+	x->num_states = 0;
+
+	/* Clear number of players */
+	x->num_players = 0;
+
+	/* Clear desired outputs flag */
+	x->supervised = 0;
+}
+
+/*
+ * Destroy a game's experience.
+ */
+void free_experience(experience *x)
+{
+	int i;
+
+	/* Free rows */
+	for (i = 0; i < x->size; i++)
+	{
+		/* Free input and desired output rows */
+		free(x->input[i]);
+		free(x->desired[i]);
+	}
+
+	/* Free arrays */
+	free(x->input);
+	free(x->desired);
+	free(x->player);
+	free(x->outcome);
+
+	/* Clear everything */
+	memset(x, 0, sizeof(experience));
+}
+
+/*
+ * Append an integer to an experience record.
+ */
+static unsigned char *put_int(unsigned char *ptr, int v)
+{
+	/* Copy value */
+	memcpy(ptr, &v, sizeof(int));
+
+	/* Return next position */
+	return ptr + sizeof(int);
+}
+
+/*
+ * Append a floating point value to an experience record.
+ */
+static unsigned char *put_double(unsigned char *ptr, double v)
+{
+	/* Copy value */
+	memcpy(ptr, &v, sizeof(double));
+
+	/* Return next position */
+	return ptr + sizeof(double);
+}
+
+/*
+ * Write a game's experience to the end of a file.
+ *
+ * The record is written with a single call, so that several writers can
+ * append to the same file.  Input sets are stored sparsely, as index and
+ * value of each non-zero input.  Values are in native byte order.
+ *
+ * Returns -1 on error.
+ */
+int write_experience(FILE *fff, experience *x)
+{
+	unsigned char *buf, *ptr;
+	size_t len;
+	int i, j, n, count, result;
+
+	/* Number of inputs including bias */
+	n = x->num_inputs + 1;
+
+	/* Compute largest possible record size */
+	len = 4 + 4 * sizeof(int) +
+	      sizeof(double) * x->num_players * x->num_output +
+	      (size_t)x->num_states *
+	      (2 * sizeof(int) + sizeof(double) * x->num_output +
+	       n * (sizeof(int) + sizeof(double)));
+
+	/* Create record buffer */
+	buf = (unsigned char *)malloc(len);
+
+	/* Check for failure */
+	if (!buf) return -1;
+
+	/* Start with tag */
+	memcpy(buf, x->supervised ? EXPERIENCE_TAG_DESIRED : EXPERIENCE_TAG, 4);
+	ptr = buf + 4;
+
+	/* Add sizes */
+	ptr = put_int(ptr, x->num_players);
+	ptr = put_int(ptr, x->num_inputs);
+	ptr = put_int(ptr, x->num_output);
+	ptr = put_int(ptr, x->num_states);
+
+	/* Add outcomes */
+	for (i = 0; i < x->num_players * x->num_output; i++)
+	{
+		/* Add outcome */
+		ptr = put_double(ptr, x->outcome[i]);
+	}
+
+	/* Loop over input sets */
+	for (i = 0; i < x->num_states; i++)
+	{
+		/* Add player */
+		ptr = put_int(ptr, x->player[i]);
+
+		/* Check for desired outputs */
+		if (x->supervised)
+		{
+			/* Loop over outputs */
+			for (j = 0; j < x->num_output; j++)
+			{
+				/* Add desired output (none if never set) */
+				ptr = put_double(ptr, x->desired[i] ?
+				                      x->desired[i][j] : 0.0);
+			}
+		}
+
+		/* Count non-zero inputs */
+		for (j = count = 0; j < n; j++) if (x->input[i][j]) count++;
+
+		/* Add count */
+		ptr = put_int(ptr, count);
+
+		/* Loop over inputs */
+		for (j = 0; j < n; j++)
+		{
+			/* Skip zero inputs */
+			if (!x->input[i][j]) continue;
+
+			/* Add index and value */
+			ptr = put_int(ptr, j);
+			ptr = put_double(ptr, x->input[i][j]);
+		}
+	}
+
+	/* Write record */
+	len = ptr - buf;
+	result = fwrite(buf, 1, len, fff) == len ? 0 : -1;
+
+	/* Destroy buffer */
+	free(buf);
+
+	/* Return result */
+	return result;
+}
+
+/*
+ * Read an integer from an experience file.
+ */
+static int get_int(FILE *fff, int *v)
+{
+	/* Read value */
+	return fread(v, sizeof(int), 1, fff) == 1 ? 0 : -1;
+}
+
+/*
+ * Read a game's experience from a file.
+ *
+ * Returns 1 if a record was read, 0 at end of file, and -1 on error.
+ */
+int read_experience(FILE *fff, experience *x)
+{
+	char tag[4];
+	int i, j, n, count, index, players, inputs, output, states;
+	size_t len;
+
+	/* Read tag */
+	len = fread(tag, 1, 4, fff);
+
+	/* Check for end of file */
+	if (!len && feof(fff)) return 0;
+
+	/* Check for truncated tag */
+	if (len != 4) return -1;
+
+	/* Forget previous record */
+	clear_experience(x);
+
+	/* Check for record with desired outputs */
+	if (!memcmp(tag, EXPERIENCE_TAG_DESIRED, 4))
+	{
+		/* Input sets have desired outputs */
+		x->supervised = 1;
+	}
+
+	/* Check for unknown tag */
+	else if (memcmp(tag, EXPERIENCE_TAG, 4)) return -1;
+
+	/* Read sizes */
+	if (get_int(fff, &players) || get_int(fff, &inputs) ||
+	    get_int(fff, &output) || get_int(fff, &states)) return -1;
+
+	/* Check sizes */
+	if (players < 0 || inputs < 0 || output < 0 || states < 0) return -1;
+
+	/* Check for different network size */
+	if (inputs != x->num_inputs || output != x->num_output)
+	{
+		/* Free rows of old size */
+		for (i = 0; i < x->size; i++)
+		{
+			/* Free rows */
+			free(x->input[i]);
+			free(x->desired[i]);
+
+			/* Clear rows */
+			x->input[i] = NULL;
+			x->desired[i] = NULL;
+		}
+	}
+
+	/* Set sizes */
+	x->num_players = players;
+	x->num_inputs = inputs;
+	x->num_output = output;
+
+	/* Number of inputs including bias */
+	n = inputs + 1;
+
+	/* Create outcome array */
+	x->outcome = (double *)realloc(x->outcome,
+	                               sizeof(double) * (players * output + 1));
+
+	/* Read outcomes */
+	if (fread(x->outcome, sizeof(double), players * output, fff) !=
+	    (size_t)(players * output)) return -1;
+
+	/* Check for more input sets than allocated */
+	if (states > x->size)
+	{
+		/* Grow arrays */
+		x->player = (int *)realloc(x->player, sizeof(int) * states);
+		x->input = (double **)realloc(x->input,
+		                              sizeof(double *) * states);
+		x->desired = (double **)realloc(x->desired,
+		                                sizeof(double *) * states);
+
+		/* Clear new rows */
+		memset(&x->input[x->size], 0,
+		       sizeof(double *) * (states - x->size));
+		memset(&x->desired[x->size], 0,
+		       sizeof(double *) * (states - x->size));
+
+		/* Set new size */
+		x->size = states;
+	}
+
+	/* Loop over input sets */
+	for (i = 0; i < states; i++)
+	{
+		/* Create input row if needed */
+		if (!x->input[i])
+		{
+			/* Create row */
+			x->input[i] = (double *)malloc(sizeof(double) * n);
+		}
+
+		/* Clear inputs */
+		memset(x->input[i], 0, sizeof(double) * n);
+
+		/* Read player */
+		if (get_int(fff, &x->player[i])) return -1;
+
+		/* Check for desired outputs */
+		if (x->supervised)
+		{
+			/* Create desired output row if needed */
+			if (!x->desired[i])
+			{
+				/* Create row */
+				x->desired[i] = (double *)malloc(sizeof(double) *
+				                                 (output + 1));
+			}
+
+			/* Read desired outputs */
+			if (fread(x->desired[i], sizeof(double), output, fff) !=
+			    (size_t)output) return -1;
+		}
+
+		/* Read non-zero input count */
+		if (get_int(fff, &count)) return -1;
+
+		/* Check count */
+		if (count < 0 || count > n) return -1;
+
+		/* Loop over non-zero inputs */
+		for (j = 0; j < count; j++)
+		{
+			/* Read index */
+			if (get_int(fff, &index)) return -1;
+
+			/* Check index */
+			if (index < 0 || index >= n) return -1;
+
+			/* Read value */
+			if (fread(&x->input[i][index], sizeof(double), 1,
+			          fff) != 1) return -1;
+		}
+
+		/* One more input set */
+		x->num_states++;
+	}
+
+	/* Success */
+	return 1;
 }
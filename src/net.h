@@ -23,6 +23,11 @@
 #include <string.h>
 #include <math.h>
 
+/*
+ * Maximum number of previous input sets.
+ */
+#define PAST_MAX 120
+
 /*
  * A two-layer neural net.
  */
@@ -97,15 +102,72 @@ typedef struct net
 	/* Names of inputs */
 	char **input_name;
 
+	/* Inputs whose weights have been pruned away */
+	char *input_dead;
+
+	/* Weights and input names belong to another network */
+	int shared;
+
 } net;
 
+/*
+ * Inputs seen by a network during one game, with the final outcome or the
+ * desired outputs of each input set.
+ */
+typedef struct experience
+{
+	/* Number of players */
+	int num_players;
+
+	/* Number of network inputs and outputs */
+	int num_inputs;
+	int num_output;
+
+	/* Number of input sets stored */
+	int num_states;
+
+	/* Number of input sets allocated */
+	int size;
+
+	/* Player who created each input set */
+	int *player;
+
+	/* Input sets (including bias input) */
+	double **input;
+
+	/* Desired outputs at game end for each player */
+	double *outcome;
+
+	/* Desired outputs of each input set, if trained towards them */
+	double **desired;
+
+	/* Input sets have their own desired outputs */
+	int supervised;
+
+} experience;
+
 /* External functions */
 extern void make_learner(net *learn, int inputs, int hidden, int output);
+extern void share_net(net *learn, net *src);
 extern void compute_net(net *learn);
 extern void store_net(net *learn, int who);
 extern void clear_store(net *learn);
 extern void train_net(net *learn, double lambda, double *desired);
+extern void train_net_batch(net *learn, double **input, double *lambda,
+                            double **desired, int num);
 extern void apply_training(net *learn);
 extern void free_net(net *learn);
+extern void mark_dead_inputs(net *learn);
 extern int load_net(net *learn, char *fname);
-extern void save_net(net *learn, char *fname);
+extern int save_net(net *learn, char *fname);
+extern int load_net_binary(net *learn, char *fname);
+extern int save_net_binary(net *learn, char *fname);
+extern int replace_file(char *src, char *dest);
+extern void add_experience(experience *x, net *learn, int who);
+extern void set_experience_outcome(experience *x, net *learn, int who,
+                                   double *desired);
+extern void set_experience_desired(experience *x, int i, double *desired);
+extern void clear_experience(experience *x);
+extern void free_experience(experience *x);
+extern int write_experience(FILE *fff, experience *x);
+extern int read_experience(FILE *fff, experience *x);
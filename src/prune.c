@@ -0,0 +1,919 @@
+/*
+ * Race for the Galaxy AI
+ *
+ * Copyright (C) 2009-2015 Keldon Jones
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "net.h"
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*
+ * Every this many recorded positions, one is held out for the report.
+ */
+#define HOLD_OUT 10
+
+/*
+ * Number of positions trained together while fine-tuning.
+ */
+#define TUNE_BATCH 64
+
+/*
+ * Game configuration of the networks.
+ */
+static int num_players = 3;
+static int expansion_level, advanced;
+
+/*
+ * Hidden nodes to keep (zero to choose by importance).
+ */
+static int keep_hidden;
+
+/*
+ * Hidden nodes less important than this fraction of the most important one
+ * are pruned.
+ */
+static double hidden_threshold = 0.05;
+
+/*
+ * Inputs with less effect on the hidden nodes than this are pruned.
+ */
+static double input_threshold = 0.001;
+
+/*
+ * Fine-tuning passes and learning rate factor.
+ */
+static int num_pass = 3;
+static double factor = 1.0;
+
+/*
+ * Most recorded positions to use.
+ */
+static int max_positions = 10000;
+
+/*
+ * Recorded positions, their recorded targets, and the original network's
+ * outputs for them.
+ */
+static double **position, **target, **teacher;
+static int num_positions;
+
+/*
+ * Create the filename of a network.
+ */
+static void net_name(char *buf, char *dir, char *kind)
+{
+	/* Create filename */
+	sprintf(buf, "%s/rftg.%s.%d.%d%s.net", dir, kind, expansion_level,
+	        num_players, advanced ? "a" : "");
+}
+
+/*
+ * Create a network of the size given in a weights file and load it.
+ */
+static int load_file(net *learn, char *fname)
+{
+	FILE *fff;
+	char buf[1024];
+	int input, hidden, output;
+
+	/* Open network file */
+	fff = fopen(fname, "r");
+
+	/* Check for failure */
+	if (!fff) return -1;
+
+	/* Read network size */
+	if (!fgets(buf, 1024, fff) ||
+	    sscanf(buf, "%d %d %d", &input, &hidden, &output) != 3)
+	{
+		/* Failure */
+		fclose(fff);
+		return -1;
+	}
+
+	/* Done with file */
+	fclose(fff);
+
+	/* Create network */
+	make_learner(learn, input, hidden, output);
+
+	/* Load weights */
+	return load_net(learn, fname);
+}
+
+/*
+ * Read recorded positions and their targets from an experience file.
+ */
+static int read_positions(net *learn, char *fname)
+{
+	experience x;
+	FILE *fff;
+	int i, n, result;
+
+	/* Open experience file */
+	fff = fopen(fname, "rb");
+
+	/* Check for failure */
+	if (!fff)
+	{
+		/* Error */
+		perror(fname);
+		return -1;
+	}
+
+	/* Start with no experience */
+	memset(&x, 0, sizeof(experience));
+
+	/* Get size of an input set */
+	n = sizeof(double) * (learn->num_inputs + 1);
+
+	/* Read games until enough positions */
+	while (num_positions < max_positions &&
+	       (result = read_experience(fff, &x)) > 0)
+	{
+		/* Check for different network size */
+		if (x.num_inputs != learn->num_inputs ||
+		    x.num_output != learn->num_output)
+		{
+			/* Error */
+			fprintf(stderr, "Experience in %s does not match "
+			                "network\n", fname);
+			fclose(fff);
+			return -1;
+		}
+
+		/* Loop over input sets */
+		for (i = 0; i < x.num_states && num_positions < max_positions;
+		     i++)
+		{
+			/* Copy inputs */
+			position[num_positions] = (double *)malloc(n);
+			memcpy(position[num_positions], x.input[i], n);
+
+			/* Create target */
+			target[num_positions] = (double *)malloc(sizeof(double)
+			                                   * learn->num_output);
+
+			/* Copy desired outputs or player's game outcome */
+			memcpy(target[num_positions], x.supervised ?
+			       x.desired[i] :
+			       &x.outcome[x.player[i] * learn->num_output],
+			       sizeof(double) * learn->num_output);
+
+			/* One more position */
+			num_positions++;
+		}
+	}
+
+	/* Done with file */
+	fclose(fff);
+
+	/* Free experience */
+	free_experience(&x);
+
+	/* Success */
+	return 0;
+}
+
+/*
+ * Return the index of a network's largest output.
+ */
+static int best_output(double *out, int n)
+{
+	int i, best = 0;
+
+	/* Loop over outputs */
+	for (i = 1; i < n; i++)
+	{
+		/* Check for larger output */
+		if (out[i] > out[best]) best = i;
+	}
+
+	/* Return best */
+	return best;
+}
+
+/*
+ * Build a smaller network from the original, using its results on the
+ * positions not held out.
+ *
+ * Inputs that barely change the hidden sums over the recorded positions
+ * have their average contribution folded into the hidden biases, and
+ * hidden nodes that barely change the outputs have their average result
+ * folded into the output biases.
+ */
+static void prune_net(net *orig, net *small)
+{
+	double *lo, *hi, *mean, *act_mean, *act_sq, *importance;
+	double w, most = 0.0, x, n = 0;
+	int *keep, num_keep = 0, num_dead = 0;
+	int i, j, k, input, hidden, output;
+
+	/* Get network size */
+	input = orig->num_inputs;
+	hidden = orig->num_hidden;
+	output = orig->num_output;
+
+	/* Create statistics arrays */
+	lo = (double *)malloc(sizeof(double) * input);
+	hi = (double *)malloc(sizeof(double) * input);
+	mean = (double *)calloc(input, sizeof(double));
+	act_mean = (double *)calloc(hidden, sizeof(double));
+	act_sq = (double *)calloc(hidden, sizeof(double));
+	importance = (double *)malloc(sizeof(double) * hidden);
+	keep = (int *)malloc(sizeof(int) * hidden);
+
+	/* Start input ranges at first position */
+	memcpy(lo, position[0], sizeof(double) * input);
+	memcpy(hi, position[0], sizeof(double) * input);
+
+	/* Loop over positions */
+	for (k = 0; k < num_positions; k++)
+	{
+		/* Skip held out positions */
+		if (k % HOLD_OUT == 0) continue;
+
+		/* Copy inputs to network */
+		memcpy(orig->input_value, position[k],
+		       sizeof(double) * (input + 1));
+
+		/* Compute network */
+		compute_net(orig);
+
+		/* Loop over inputs */
+		for (i = 0; i < input; i++)
+		{
+			/* Track range and sum of input */
+			x = position[k][i];
+			if (x < lo[i]) lo[i] = x;
+			if (x > hi[i]) hi[i] = x;
+			mean[i] += x;
+		}
+
+		/* Loop over hidden nodes */
+		for (j = 0; j < hidden; j++)
+		{
+			/* Track sum and squared sum of result */
+			act_mean[j] += orig->hidden_result[j];
+			act_sq[j] += orig->hidden_result[j] *
+			             orig->hidden_result[j];
+		}
+
+		/* Count position */
+		n++;
+	}
+
+	/* Turn sums into averages */
+	for (i = 0; i < input; i++) mean[i] /= n;
+	for (j = 0; j < hidden; j++) act_mean[j] /= n;
+
+	/* Loop over hidden nodes */
+	for (j = 0; j < hidden; j++)
+	{
+		/* Start with size of output weights */
+		w = 0.0;
+		for (k = 0; k < output; k++)
+		{
+			/* Add squared weight */
+			w += orig->output_weight[j][k] * orig->output_weight[j][k];
+		}
+
+		/* Compute spread of node's result times its weights */
+		x = act_sq[j] / n - act_mean[j] * act_mean[j];
+		importance[j] = sqrt(x > 0 ? x : 0) * sqrt(w);
+
+		/* Track most important node */
+		if (importance[j] > most) most = importance[j];
+	}
+
+	/* Loop over hidden nodes */
+	for (j = 0; j < hidden; j++)
+	{
+		/* Count more important nodes */
+		for (i = k = 0; i < hidden; i++)
+		{
+			/* Check for more important (earlier ones win ties) */
+			if (importance[i] > importance[j] ||
+			    (importance[i] == importance[j] && i < j)) k++;
+		}
+
+		/* Check for node to keep */
+		if (keep_hidden ? k < keep_hidden :
+		                  importance[j] >= hidden_threshold * most)
+		{
+			/* Keep node */
+			keep[num_keep++] = j;
+		}
+	}
+
+	/* Create smaller network */
+	make_learner(small, input, num_keep, output);
+
+	/* Copy training iterations */
+	small->num_training = orig->num_training;
+
+	/* Copy input names */
+	for (i = 0; i < input; i++)
+	{
+		/* Copy name if set */
+		if (orig->input_name[i])
+		{
+			/* Copy name */
+			small->input_name[i] = strdup(orig->input_name[i]);
+		}
+	}
+
+	/* Loop over inputs and bias */
+	for (i = 0; i < input + 1; i++)
+	{
+		/* Loop over kept hidden nodes */
+		for (j = 0; j < num_keep; j++)
+		{
+			/* Copy weight */
+			small->hidden_weight[i][j] =
+			                         orig->hidden_weight[i][keep[j]];
+		}
+	}
+
+	/* Loop over inputs */
+	for (i = 0; i < input; i++)
+	{
+		/* Find largest weight to kept nodes */
+		for (w = 0.0, j = 0; j < num_keep; j++)
+		{
+			/* Check for larger weight */
+			if (fabs(small->hidden_weight[i][j]) > w)
+			{
+				/* Track largest */
+				w = fabs(small->hidden_weight[i][j]);
+			}
+		}
+
+		/* Keep input if it changes hidden sums enough */
+		if ((hi[i] - lo[i]) * w >= input_threshold) continue;
+
+		/* Loop over kept hidden nodes */
+		for (j = 0; j < num_keep; j++)
+		{
+			/* Fold average contribution into bias */
+			small->hidden_weight[input][j] +=
+			                   small->hidden_weight[i][j] * mean[i];
+
+			/* Clear weight */
+			small->hidden_weight[i][j] = 0.0;
+		}
+
+		/* Count pruned input */
+		num_dead++;
+	}
+
+	/* Loop over kept hidden nodes */
+	for (j = 0; j < num_keep; j++)
+	{
+		/* Copy output weights */
+		memcpy(small->output_weight[j], orig->output_weight[keep[j]],
+		       sizeof(double) * output);
+	}
+
+	/* Copy output biases */
+	memcpy(small->output_weight[num_keep], orig->output_weight[hidden],
+	       sizeof(double) * output);
+
+	/* Loop over pruned hidden nodes */
+	for (j = i = 0; j < hidden; j++)
+	{
+		/* Skip kept node */
+		if (i < num_keep && keep[i] == j)
+		{
+			/* Advance to next kept node */
+			i++;
+			continue;
+		}
+
+		/* Fold average result into output biases */
+		for (k = 0; k < output; k++)
+		{
+			/* Adjust bias */
+			small->output_weight[num_keep][k] +=
+			                  act_mean[j] * orig->output_weight[j][k];
+		}
+	}
+
+	/* Skip pruned inputs from now on */
+	mark_dead_inputs(small);
+
+	printf("Pruned %d of %d inputs, kept %d of %d hidden nodes\n",
+	       num_dead, input, num_keep, hidden);
+
+	/* Free statistics arrays */
+	free(lo);
+	free(hi);
+	free(mean);
+	free(act_mean);
+	free(act_sq);
+	free(importance);
+	free(keep);
+}
+
+/*
+ * Train the smaller network to give the original network's outputs on the
+ * positions not held out.
+ */
+static void fine_tune(net *small)
+{
+	double *input[TUNE_BATCH], *desired[TUNE_BATCH];
+	int k, pass, num;
+
+	/* Loop over passes */
+	for (pass = 0; pass < num_pass; pass++)
+	{
+		/* Clear error counters */
+		small->error = small->num_error = 0;
+
+		/* Start first minibatch */
+		num = 0;
+
+		/* Loop over positions */
+		for (k = 0; k < num_positions; k++)
+		{
+			/* Skip held out positions */
+			if (k % HOLD_OUT == 0) continue;
+
+			/* Add position to minibatch */
+			input[num] = position[k];
+			desired[num] = teacher[k];
+
+			/* Check for full minibatch */
+			if (++num == TUNE_BATCH)
+			{
+				/* Train and apply minibatch */
+				train_net_batch(small, input, NULL, desired,
+				                num);
+				apply_training(small);
+
+				/* Start next minibatch */
+				num = 0;
+			}
+		}
+
+		/* Check for partial minibatch */
+		if (num)
+		{
+			/* Train and apply last minibatch */
+			train_net_batch(small, input, NULL, desired, num);
+			apply_training(small);
+		}
+
+		printf("Pass %d: error %f\n", pass + 1,
+		       small->error / small->num_error);
+	}
+}
+
+/*
+ * Compute a network on every held out position and return the time taken
+ * per position in microseconds.
+ *
+ * The squared error and number of best outputs agreeing with the recorded
+ * targets and the original network are added up as well.
+ */
+static double test_net(net *learn, double *target_error, int *target_agree,
+                       double *orig_error, int *orig_agree)
+{
+	clock_t start;
+	double d, elapsed = 0.0;
+	int i, k, n = 0, best;
+
+	/* Clear totals */
+	*target_error = *orig_error = 0.0;
+	*target_agree = *orig_agree = 0;
+
+	/* Loop over held out positions */
+	for (k = 0; k < num_positions; k += HOLD_OUT)
+	{
+		/* Copy inputs to network */
+		memcpy(learn->input_value, position[k],
+		       sizeof(double) * (learn->num_inputs + 1));
+
+		/* Time computation */
+		start = clock();
+
+		/* Compute network */
+		compute_net(learn);
+
+		/* Add time taken */
+		elapsed += clock() - start;
+
+		/* Get best output */
+		best = best_output(learn->win_prob, learn->num_output);
+
+		/* Check for agreement */
+		if (best == best_output(target[k], learn->num_output))
+		{
+			/* Count agreement with target */
+			(*target_agree)++;
+		}
+
+		/* Check for agreement */
+		if (best == best_output(teacher[k], learn->num_output))
+		{
+			/* Count agreement with original */
+			(*orig_agree)++;
+		}
+
+		/* Loop over outputs */
+		for (i = 0; i < learn->num_output; i++)
+		{
+			/* Add squared error from target */
+			d = learn->win_prob[i] - target[k][i];
+			*target_error += d * d;
+
+			/* Add squared difference from original */
+			d = learn->win_prob[i] - teacher[k][i];
+			*orig_error += d * d;
+		}
+
+		/* Count position */
+		n++;
+	}
+
+	/* Average errors */
+	*target_error /= n;
+	*orig_error /= n;
+
+	/* Return time per position */
+	return 1000000.0 * elapsed / CLOCKS_PER_SEC / n;
+}
+
+/*
+ * Print the accuracy and speed of the original and smaller networks on the
+ * held out positions.
+ */
+static void report(net *orig, net *small)
+{
+	double t_err, o_err, t_time, s_err, so_err, s_time;
+	int t_agree, o_agree, s_agree, so_agree, n;
+
+	/* Count held out positions */
+	n = (num_positions + HOLD_OUT - 1) / HOLD_OUT;
+
+	/* Test both networks */
+	t_time = test_net(orig, &t_err, &t_agree, &o_err, &o_agree);
+	s_time = test_net(small, &s_err, &s_agree, &so_err, &so_agree);
+
+	printf("Held out positions: %d\n", n);
+	printf("            hidden  target error  target agree   usec/eval\n");
+	printf("Original    %6d  %12.6f  %11.1f%%  %10.2f\n",
+	       orig->num_hidden, t_err, 100.0 * t_agree / n, t_time);
+	printf("Pruned      %6d  %12.6f  %11.1f%%  %10.2f\n",
+	       small->num_hidden, s_err, 100.0 * s_agree / n, s_time);
+	printf("Pruned vs original: squared difference %f, best output "
+	       "agrees %.1f%%\n", so_err, 100.0 * so_agree / n);
+}
+
+/*
+ * Prune one network using recorded positions, or copy it if none given.
+ */
+static int prune_kind(char *in_dir, char *out_dir, char *kind, char *x_name,
+                      double alpha)
+{
+	net orig, small;
+	char fname[1024];
+	int k;
+
+	/* Create original filename */
+	net_name(fname, in_dir, kind);
+
+	/* Load original network */
+	if (load_file(&orig, fname))
+	{
+		/* Error */
+		fprintf(stderr, "Could not load %s\n", fname);
+		return -1;
+	}
+
+	/* Create output filename */
+	net_name(fname, out_dir, kind);
+
+	/* Check for no recorded positions */
+	if (!x_name)
+	{
+		/* Copy network unchanged */
+		if (save_net(&orig, fname))
+		{
+			/* Error */
+			fprintf(stderr, "Could not save %s\n", fname);
+			return -1;
+		}
+
+		/* Done */
+		free_net(&orig);
+		return 0;
+	}
+
+	printf("Pruning %s network\n", kind);
+
+	/* Create arrays of positions */
+	position = (double **)malloc(sizeof(double *) * max_positions);
+	target = (double **)malloc(sizeof(double *) * max_positions);
+	teacher = (double **)malloc(sizeof(double *) * max_positions);
+	num_positions = 0;
+
+	/* Read positions */
+	if (read_positions(&orig, x_name)) return -1;
+
+	/* Check for too few positions */
+	if (num_positions < 2 * HOLD_OUT)
+	{
+		/* Error */
+		fprintf(stderr, "Too few positions in %s\n", x_name);
+		return -1;
+	}
+
+	/* Loop over positions */
+	for (k = 0; k < num_positions; k++)
+	{
+		/* Copy inputs to network */
+		memcpy(orig.input_value, position[k],
+		       sizeof(double) * (orig.num_inputs + 1));
+
+		/* Compute original network */
+		compute_net(&orig);
+
+		/* Save its outputs */
+		teacher[k] = (double *)malloc(sizeof(double) *
+		                              orig.num_output);
+		memcpy(teacher[k], orig.win_prob,
+		       sizeof(double) * orig.num_output);
+	}
+
+	/* Build smaller network */
+	prune_net(&orig, &small);
+
+	/* Set learning rate */
+	small.alpha = alpha * factor;
+
+	/* Train smaller network towards original */
+	fine_tune(&small);
+
+	/* Report accuracy and speed */
+	report(&orig, &small);
+
+	/* Free positions */
+	for (k = 0; k < num_positions; k++)
+	{
+		/* Free arrays */
+		free(position[k]);
+		free(target[k]);
+		free(teacher[k]);
+	}
+
+	/* Free arrays of positions */
+	free(position);
+	free(target);
+	free(teacher);
+
+	/* Done with original network */
+	free_net(&orig);
+
+	/* Save smaller network */
+	if (save_net(&small, fname))
+	{
+		/* Error */
+		fprintf(stderr, "Could not save %s\n", fname);
+		return -1;
+	}
+
+	/* Done */
+	free_net(&small);
+	return 0;
+}
+
+/*
+ * Play the smaller networks against the originals in the arena.
+ */
+static int run_arena(char *in_dir, char *out_dir, int num_seeds,
+                     int num_workers)
+{
+	char *args[16], exp_buf[20], player_buf[20], seed_buf[20], job_buf[20];
+	int n = 0, status;
+	pid_t pid;
+
+	/* Build arguments */
+	sprintf(exp_buf, "%d", expansion_level);
+	sprintf(player_buf, "%d", num_players);
+	sprintf(seed_buf, "%d", num_seeds);
+	sprintf(job_buf, "%d", num_workers);
+	args[n++] = "arena";
+	args[n++] = "-e";
+	args[n++] = exp_buf;
+	args[n++] = "-p";
+	args[n++] = player_buf;
+	if (advanced) args[n++] = "-a";
+	args[n++] = "-n";
+	args[n++] = seed_buf;
+	args[n++] = "-j";
+	args[n++] = job_buf;
+	args[n++] = out_dir;
+	args[n++] = in_dir;
+	args[n] = NULL;
+
+	/* Flush output before starting arena */
+	fflush(stdout);
+
+	/* Create arena process */
+	pid = fork();
+
+	/* Check for failure */
+	if (pid < 0)
+	{
+		/* Error */
+		perror("fork");
+		return -1;
+	}
+
+	/* Check for child */
+	if (!pid)
+	{
+		/* Try arena next to us */
+		execv("./arena", args);
+
+		/* Try arena in path */
+		execvp("arena", args);
+
+		/* Error */
+		perror("arena");
+		_exit(1);
+	}
+
+	/* Wait for arena */
+	if (waitpid(pid, &status, 0) < 0) return -1;
+
+	/* Check for failure */
+	if (!WIFEXITED(status) || WEXITSTATUS(status) == 1) return -1;
+
+	/* Success */
+	return 0;
+}
+
+/*
+ * Prune the networks of a configuration into smaller ones.
+ */
+int main(int argc, char *argv[])
+{
+	char *eval_name = NULL, *role_name = NULL, *in_dir, *out_dir;
+	int i, num_seeds = 0, num_workers = 1;
+
+	/* Parse arguments */
+	for (i = 1; i < argc; i++)
+	{
+		/* Check for number of players */
+		if (!strcmp(argv[i], "-p"))
+		{
+			/* Set number of players */
+			num_players = atoi(argv[++i]);
+		}
+
+		/* Check for advanced game */
+		else if (!strcmp(argv[i], "-a"))
+		{
+			/* Set advanced flag */
+			advanced = 1;
+		}
+
+		/* Check for expansion level */
+		else if (!strcmp(argv[i], "-e"))
+		{
+			/* Set expansion level */
+			expansion_level = atoi(argv[++i]);
+		}
+
+		/* Check for eval experience file */
+		else if (!strcmp(argv[i], "-x"))
+		{
+			/* Set filename */
+			eval_name = argv[++i];
+		}
+
+		/* Check for role experience file */
+		else if (!strcmp(argv[i], "-y"))
+		{
+			/* Set filename */
+			role_name = argv[++i];
+		}
+
+		/* Check for hidden nodes to keep */
+		else if (!strcmp(argv[i], "-h"))
+		{
+			/* Set number of nodes */
+			keep_hidden = atoi(argv[++i]);
+		}
+
+		/* Check for hidden node threshold */
+		else if (!strcmp(argv[i], "-t"))
+		{
+			/* Set threshold */
+			hidden_threshold = atof(argv[++i]);
+		}
+
+		/* Check for input threshold */
+		else if (!strcmp(argv[i], "-i"))
+		{
+			/* Set threshold */
+			input_threshold = atof(argv[++i]);
+		}
+
+		/* Check for most positions */
+		else if (!strcmp(argv[i], "-m"))
+		{
+			/* Set number of positions */
+			max_positions = atoi(argv[++i]);
+		}
+
+		/* Check for number of passes */
+		else if (!strcmp(argv[i], "-n"))
+		{
+			/* Set number of fine-tuning passes */
+			num_pass = atoi(argv[++i]);
+		}
+
+		/* Check for alpha factor */
+		else if (!strcmp(argv[i], "-f"))
+		{
+			/* Set factor */
+			factor = atof(argv[++i]);
+		}
+
+		/* Check for arena games */
+		else if (!strcmp(argv[i], "-g"))
+		{
+			/* Set number of arena seeds */
+			num_seeds = atoi(argv[++i]);
+		}
+
+		/* Check for number of arena workers */
+		else if (!strcmp(argv[i], "-j"))
+		{
+			/* Set number of workers */
+			num_workers = atoi(argv[++i]);
+		}
+
+		/* Stop at first non-option */
+		else break;
+	}
+
+	/* Check for directories and something to prune */
+	if (argc - i != 2 || (!eval_name && !role_name))
+	{
+		/* Print usage */
+		fprintf(stderr, "Usage: %s [-p players] [-e expansion] [-a] "
+		                "[-x eval-experience] [-y role-experience] "
+		                "[-h hidden] [-t threshold] [-i threshold] "
+		                "[-m positions] [-n passes] [-f factor] "
+		                "[-g seeds] [-j workers] in-dir out-dir\n",
+		                argv[0]);
+		return 1;
+	}
+
+	/* Get directories */
+	in_dir = argv[i];
+	out_dir = argv[i + 1];
+
+	/* Create output directory */
+	if (mkdir(out_dir, 0777) < 0 && errno != EEXIST)
+	{
+		/* Error */
+		perror(out_dir);
+		return 1;
+	}
+
+	/* Prune evaluator, using the eval learning rate */
+	if (prune_kind(in_dir, out_dir, "eval", eval_name, 0.0001)) return 1;
+
+	/* Prune role predictor, using the role learning rate */
+	if (prune_kind(in_dir, out_dir, "role", role_name, 0.0005)) return 1;
+
+	/* Check for strength comparison wanted */
+	if (num_seeds > 0 && run_arena(in_dir, out_dir, num_seeds,
+	                               num_workers)) return 1;
+
+	/* Done */
+	return 0;
+}
@@ -20,7 +20,7 @@
 
 #include "rftg.h"
 #include "comm.h"
-#include <mysql/mysql.h>
+#include "store.h"
 
 /* Number of random bytes stored per game */
 #define MAX_RAND     1024
@@ -46,8 +46,8 @@ static char* export_style_sheet_replay = NULL;
 /* Verbosity */
 static int verbose = 0;
 
-/* Connection to the database server */
-MYSQL *mysql;
+/* Storage backend */
+static store *storage;
 
 /* The current replaying gid */
 static int gid;
@@ -71,7 +71,7 @@ static unsigned char random_pool[MAX_RAND];
 static int random_pos;
 
 /* Choices loaded from db */
-static int *choice_logs[MAX_PLAYER];
+static choice_buffer *choice_logs[MAX_PLAYER];
 
 /* Size of choice_logs */
 static int choice_size[MAX_PLAYER];
@@ -213,91 +213,94 @@ static void export_log(FILE *fff, int who)
 }
 
 /*
- * Export log of a specific game.
+ * Messages written by export_end_message().
  */
-static void export_end_log(FILE *fff, int gid)
-{
-	MYSQL_RES *res;
-	MYSQL_ROW row;
-	char query[1024];
-	char msg[1024], name[1024], *ptr;
+static int num_end_messages;
 
-	/* Create lookup query */
-	sprintf(query, "SELECT message, format, user "
-	               "FROM messages LEFT JOIN users USING (uid) "
-	               "WHERE gid=%d ORDER BY mid", gid);
+/*
+ * Write a message of a finished game to an export file.
+ */
+static void export_end_message(void *arg, char *message, char *format,
+                               char *user)
+{
+	FILE *fff = (FILE *)arg;
+	char name[1024], *text;
 
-	/* Run query */
-	mysql_query(mysql, query);
+	/* Count message */
+	num_end_messages++;
 
-	/* Fetch results */
-	res = mysql_store_result(mysql);
+	/* Copy message */
+	text = strdup(message);
 
-	/* Check for no rows */
-	if (mysql_num_rows(res) == 0)
+	/* Check for chat message */
+	if (!strcmp(format, FORMAT_CHAT))
 	{
-		/* Fallback to saved logs */
-		export_log(fff, -1);
-		return;
-	}
+		/* Write xml start tag with format attribute */
+		fprintf(fff, "    <Message format=\"%s\">", format);
 
-	/* Loop over rows returned */
-	while ((row = mysql_fetch_row(res)))
+		/* Check for player chat */
+		if (user)
+		{
+			/* Put user name */
+			fprintf(fff, "%s: ", xml_escape(user));
+		}
+	}
+	else
 	{
-		/* Reset message */
-		ptr = msg;
+		/* Chop newline */
+		if (*text) text[strlen(text) - 1] = '\0';
 
-		/* Check for chat message */
-		if (!strcmp(row[1], FORMAT_CHAT))
+		/* Check for private message */
+		if (user)
 		{
-			/* Write xml start tag with format attribute */
-			fprintf(fff, "    <Message format=\"%s\">", row[1]);
+			/* Add user name */
+			sprintf(name, " private=\"%s\"", xml_escape(user));
+		}
+		else
+		{
+			/* Clear user name */
+			strcpy(name, "");
+		}
 
-			/* Check for player chat */
-			if (row[2])
-			{
-				/* Put user name */
-				fprintf(fff, "%s: ", xml_escape(row[2]));
-			}
+		/* Check for no format */
+		if (!strlen(format))
+		{
+			/* Write xml start tag */
+			fprintf(fff, "    <Message%s>", name);
 		}
+
+		/* Formatted message */
 		else
 		{
-			/* Chop newline */
-			row[0][strlen(row[0]) - 1] = '\0';
+			/* Write xml start tag with format attribute */
+			fprintf(fff, "    <Message format=\"%s\"%s>", format, name);
+		}
+	}
 
-			/* Check for private message */
-			if (row[2])
-			{
-				/* Add user name */
-				sprintf(name, " private=\"%s\"", xml_escape(row[2]));
-			}
-			else
-			{
-				/* Clear user name */
-				strcpy(name, "");
-			}
+	/* Write message and xml end tag */
+	fprintf(fff, "%s</Message>\n", xml_escape(text));
 
-			/* Check for no format */
-			if (!strlen(row[1]))
-			{
-				/* Write xml start tag */
-				fprintf(fff, "    <Message%s>", name);
-			}
+	/* Free copy */
+	free(text);
+}
 
-			/* Formatted message */
-			else
-			{
-				/* Write xml start tag with format attribute */
-				fprintf(fff, "    <Message format=\"%s\"%s>", row[1], name);
-			}
-		}
+/*
+ * Export log of a specific game.
+ */
+static void export_end_log(FILE *fff, int gid)
+{
+	/* Start with no messages written */
+	num_end_messages = 0;
 
-		/* Write message and xml end tag */
-		fprintf(fff, "%s</Message>\n", xml_escape(row[0]));
-	}
+	/* Write all messages of game */
+	storage->load_messages(gid, -1, export_end_message, fff);
 
-	/* Free results */
-	mysql_free_result(res);
+	/* Check for no messages */
+	if (!num_end_messages)
+	{
+		/* Fallback to saved logs */
+		export_log(fff, -1);
+	}
 }
 
 /* The name of the replay file for a given game, player and choices */
@@ -491,10 +494,10 @@ static void choose_place(game *g, int who, int list[], int num, int phase,
 	{
 		/* Append name to prompt */
 		strcat(msg, " using ");
-		strcat(msg, g->deck[special].d_ptr->name);
+		strcat(msg, library[g->deck[special].d_idx].name);
 
 		/* XXX Check for "Rebel Sneak Attack" */
-		if (!strcmp(g->deck[special].d_ptr->name, "Rebel Sneak Attack"))
+		if (!strcmp(library[g->deck[special].d_idx].name, "Rebel Sneak Attack"))
 		{
 			/* Takeover not allowed */
 			allow_takeover = 0;
@@ -524,7 +527,7 @@ static void choose_pay(game *g, int who, int which, int list[], int *num,
 	c_ptr = &g->deck[which];
 
 	/* Create prompt */
-	sprintf(msg, "Choose payment for %s ", c_ptr->d_ptr->name);
+	sprintf(msg, "Choose payment for %s ", library[c_ptr->d_idx].name);
 }
 
 /* Find the message to the player */
@@ -639,7 +642,7 @@ static void determine_message(game *g, int who, int type, int list[], int *nl,
 
 			/* Create prompt */
 			sprintf(msg, "Choose defense for %s (need %d extra military)",
-			        g->deck[arg1].d_ptr->name, arg3 + 1);
+			        library[g->deck[arg1].d_idx].name, arg3 + 1);
 			break;
 
 		/* Choose whether to prevent a takeover */
@@ -682,19 +685,19 @@ static void determine_message(game *g, int who, int type, int list[], int *nl,
 			else
 			{
 				/* Check for needing two cards */
-				if (g->deck[arg1].d_ptr->powers[arg2].code & P4_CONSUME_TWO)
+				if (library[g->deck[arg1].d_idx].powers[arg2].code & P4_CONSUME_TWO)
 				{
 					/* Create prompt */
-					sprintf(msg, "Choose cards to consume on %s", g->deck[arg1].d_ptr->name);
+					sprintf(msg, "Choose cards to consume on %s", library[g->deck[arg1].d_idx].name);
 				}
 				else
 				{
 					/* Read power size */
-					i = g->deck[arg1].d_ptr->powers[arg2].times;
+					i = library[g->deck[arg1].d_idx].powers[arg2].times;
 
 					/* Create prompt */
 					sprintf(msg, "Choose up to %d card%s to consume on %s",
-					        i, PLURAL(i), g->deck[arg1].d_ptr->name);
+					        i, PLURAL(i), library[g->deck[arg1].d_idx].name);
 				}
 			}
 			break;
@@ -705,7 +708,7 @@ static void determine_message(game *g, int who, int type, int list[], int *nl,
 			/* Create prompt */
 			sprintf(msg, "Choose good%s to consume on %s",
 			                     arg1 == 1 && arg2 == 1 ? "" :
-			                     "s", g->deck[special[0]].d_ptr->name);
+			                     "s", library[g->deck[special[0]].d_idx].name);
 			break;
 
 		/* Choose lucky number */
@@ -765,7 +768,7 @@ static void determine_message(game *g, int who, int type, int list[], int *nl,
 			special_cards[0] = &g->deck[arg1];
 
 			/* Create prompt */
-			sprintf(msg, "Choose to keep/discard %s", g->deck[arg1].d_ptr->name);
+			sprintf(msg, "Choose to keep/discard %s", library[g->deck[arg1].d_idx].name);
 			break;
 
 		/* Choose color of Alien Oort Cloud Refinery */
@@ -828,17 +831,21 @@ static void replay_make_choice(game *g, int who, int type, int list[], int *nl,
 	next = current;
 
 	/* Loop until a non-debug choice is found */
-	while (choice_logs[orig_who][next] < 0)
+	while (choice_logs[orig_who]->data[next] < 0)
 	{
 		/* Compute the next choice position */
-		next = next_choice(choice_logs[orig_who], next);
+		next = next_choice(choice_logs[orig_who]->data, next);
 	}
 
 	/* Take the next choice position */
-	next = next_choice(choice_logs[orig_who], next);
+	next = next_choice(choice_logs[orig_who]->data, next);
+
+	/* Make room for choices */
+	grow_choice_log(g->p[who].choice_log, next);
 
 	/* Copy choices from database */
-	memcpy(g->p[who].choice_log + current, choice_logs[orig_who] + current,
+	memcpy(g->p[who].choice_log->data + current,
+	       choice_logs[orig_who]->data + current,
 	       sizeof(int) * (next - current));
 
 	/* Update choice position */
@@ -891,63 +898,20 @@ decisions replay_func =
 	replay_private_message,
 };
 
-/*
- * Return the user name for a given user ID.
- */
-static void db_user_name(int uid, char *name)
-{
-	MYSQL_RES *res;
-	MYSQL_ROW row;
-	char query[1024];
-
-	/* Create query */
-	sprintf(query, "SELECT user FROM users WHERE uid=%d", uid);
-
-	/* Run query */
-	mysql_query(mysql, query);
-
-	/* Fetch results */
-	res = mysql_store_result(mysql);
-
-	/* Get row */
-	row = mysql_fetch_row(res);
-
-	/* Copy user name */
-	strcpy(name, row[0]);
-
-	/* Free result */
-	mysql_free_result(res);
-}
-
 /*
  * Read game from database.
  */
 static int db_load_game(int gid)
 {
-	MYSQL_RES *res;
-	MYSQL_ROW row;
-	int i, players = 0, uids[MAX_PLAYER];
-	unsigned long *field_len;
-	char query[1024];
-	char name[80];
-
-	/* Format query */
-	sprintf(query, "SELECT exp, adv, dis_goal, dis_takeover \
-	                FROM games WHERE gid = %d AND state = 'DONE'", gid);
-
-	/* Run query */
-	mysql_query(mysql, query);
-
-	/* Fetch results */
-	res = mysql_store_result(mysql);
+	store_game info;
+	unsigned char *data;
+	int i, players, uids[MAX_PLAYER], ai[MAX_PLAYER], len;
+	char name[1024];
 
-	/* Check for no rows returned */
-	if (!(row = mysql_fetch_row(res)))
+	/* Look up game */
+	if (storage->load_game(gid, &info) < 0 || info.state != GS_DONE)
 	{
-		/* Free result */
-		mysql_free_result(res);
-
-		/* No pool to load */
+		/* No game to load */
 		printf("Could not load game\n");
 		error = 1;
 		return 0;
@@ -957,50 +921,34 @@ static int db_load_game(int gid)
 	g.simulation = 0;
 
 	/* Read fields */
-	g.expanded = strtol(row[0], NULL, 0);
-	g.advanced = strtol(row[1], NULL, 0);
-	g.goal_disabled = strtol(row[2], NULL, 0);
-	g.takeover_disabled = strtol(row[3], NULL, 0);
+	g.expanded = info.expanded;
+	g.advanced = info.advanced;
+	g.goal_disabled = info.disable_goal;
+	g.takeover_disabled = info.disable_takeover;
 	g.promo = 0;
 	g.camp = NULL;
 
-	/* Free results */
-	mysql_free_result(res);
-
-	/* Format query */
-	sprintf(query, "SELECT uid, ai FROM attendance WHERE gid = %d ORDER BY seat",
-	               gid);
+	/* Look up players in seat order */
+	players = storage->load_players(gid, uids, ai, MAX_PLAYER);
 
-	/* Run query */
-	mysql_query(mysql, query);
-
-	/* Fetch results */
-	res = mysql_store_result(mysql);
-
-	/* Loop over rows returned */
-	while ((row = mysql_fetch_row(res)))
+	/* Loop over players */
+	for (i = 0; i < players; i++)
 	{
-		/* Store user ids */
-		uids[players] = strtol(row[0], NULL, 0);
-
 		/* Set player interface function */
-		g.p[players].control = &replay_func;
+		g.p[i].control = &replay_func;
 
 		/* Create choice log */
-		g.p[players].choice_log = (int *)malloc(sizeof(int) * 4096);
-		choice_logs[players] = (int *)malloc(sizeof(int) * 4096);
+		g.p[i].choice_log = new_choice_log();
+		choice_logs[i] = new_choice_log();
 
 		/* Get player's name */
-		db_user_name(uids[players], name);
+		storage->user_name(uids[i], name);
 
 		/* Copy player's name */
-		g.p[players].name = strdup(name);
+		g.p[i].name = strdup(name);
 
 		/* Copy ai information */
-		g.p[players].ai = strtol(row[1], NULL, 0);
-
-		/* Next player */
-		++players;
+		g.p[i].ai = ai[i];
 	}
 
 	/* Store the number of players */
@@ -1013,70 +961,36 @@ static int db_load_game(int gid)
 		g.advanced = 0;
 	}
 
-	/* Free results */
-	mysql_free_result(res);
-
-	/* Create query */
-	sprintf(query, "SELECT pool FROM seed WHERE gid=%d", gid);
-
-	/* Run query */
-	mysql_query(mysql, query);
-
-	/* Fetch results */
-	res = mysql_store_result(mysql);
-
-	/* Check for no rows returned */
-	if (!(row = mysql_fetch_row(res)))
+	/* Load random byte pool */
+	if (!storage->load_seed(gid, random_pool, MAX_RAND))
 	{
-		/* Free result */
-		mysql_free_result(res);
-
 		/* No pool to load */
 		printf("Could not load random pool\n");
 		return 0;
 	}
 
-	/* Copy returned data to random byte pool */
-	memcpy(random_pool, row[0], MAX_RAND);
-
-	/* Free result */
-	mysql_free_result(res);
-
 	/* Loop over players in session */
 	for (i = 0; i < players; i++)
 	{
-		/* TODO: Join with query above */
-		/* Create query to load choice log */
-		sprintf(query,"SELECT log FROM choices WHERE gid=%d AND uid=%d",
-		        gid, uids[i]);
+		/* Load choice log */
+		len = storage->load_choices(gid, uids[i], &data);
 
-		/* Run query */
-		mysql_query(mysql, query);
+		/* Check for no log */
+		if (len < 0) continue;
 
-		/* Fetch results */
-		res = mysql_store_result(mysql);
+		/* Decode log and remember length */
+		choice_size[i] = decode_choice_log(choice_logs[i], data, len);
 
-		/* Check for no rows returned */
-		if (!(row = mysql_fetch_row(res)))
-		{
-			/* Free result */
-			mysql_free_result(res);
+		/* Free encoded log */
+		free(data);
 
-			/* Go to next player */
-			continue;
+		/* Check for corrupt log */
+		if (choice_size[i] < 0)
+		{
+			/* Log cannot be replayed */
+			printf("Corrupt choice log for user %d\n", uids[i]);
+			return 0;
 		}
-
-		/* Get length of log in bytes */
-		field_len = mysql_fetch_lengths(res);
-
-		/* Copy log */
-		memcpy(choice_logs[i], row[0], field_len[0]);
-
-		/* Remember length */
-		choice_size[i] = field_len[0] / sizeof(int);
-
-		/* Free result */
-		mysql_free_result(res);
 	}
 
 	/* Success */
@@ -1185,7 +1099,7 @@ void replay_game()
 int main(int argc, char *argv[])
 {
 	int i, j;
-	my_bool reconnect = 1;
+	char *store_name = "mysql";
 	char *db = "rftg";
 	char *db_user = "rftg";
 	char *db_pw = NULL, *db_host = NULL;
@@ -1202,8 +1116,9 @@ int main(int argc, char *argv[])
 			printf("Arguments:\n");
 			printf("  -gs    Game id to start replay from\n");
 			printf("  -ge    Game id to end replay at\n");
+			printf("  -store Storage backend: mysql or sqlite. Default: mysql\n");
 			printf("  -host  MySQL database host. Default: \"localhost\"\n");
-			printf("  -d     MySQL database name. Default: \"rftg\"\n");
+			printf("  -d     MySQL database name, or SQLite database file. Default: \"rftg\"\n");
 			printf("  -u     MySQL database user. Default: \"rftg\"\n");
 			printf("  -pw    MySQL database password. Default: [none]\n");
 			printf("  -e     Folder to put exported games. Default: \".\"\n");
@@ -1231,6 +1146,13 @@ int main(int argc, char *argv[])
 			gid_max = atoi(argv[++i]);
 		}
 
+		/* Check for storage backend */
+		if (!strcmp(argv[i], "-store"))
+		{
+			/* Set storage backend */
+			store_name = argv[++i];
+		}
+
 		/* Check for database host */
 		if (!strcmp(argv[i], "-host"))
 		{
@@ -1324,28 +1246,21 @@ int main(int argc, char *argv[])
 		}
 	}
 
-	/* Initialize database library */
-	mysql = mysql_init(NULL);
-
-	/* Check for error */
-	if (!mysql)
+	/* Find storage backend */
+	if (!(storage = find_store(store_name)))
 	{
 		/* Print error and exit */
-		printf("Couldn't initialize database library!");
+		printf("Unknown storage backend: %s\n", store_name);
 		exit(1);
 	}
 
-	/* Attempt to connect to database server */
-	if (!mysql_real_connect(mysql, db_host, db_user, db_pw, db, 0, NULL, 0))
+	/* Open database */
+	if (storage->open(db_host, db_user, db_pw, db) < 0)
 	{
-		/* Print error and exit */
-		printf("Database connection: %s", mysql_error(mysql));
+		/* Exit */
 		exit(1);
 	}
 
-	/* Reconnect automatically when connection to database is lost */
-	mysql_options(mysql, MYSQL_OPT_RECONNECT, &reconnect);
-
 	/* Loop over all games */
 	for (i = gid_min; i <= gid_max; ++i)
 	{
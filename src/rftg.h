@@ -46,6 +46,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #ifdef WIN32
 #include "stdint.h"
 #else
@@ -588,6 +589,21 @@
 #define CHOICE_D_TAKE_PRESTIGE  -14
 #define CHOICE_D_ROTATE         -15
 
+/*
+ * Initial number of entries allocated for a choice log.
+ */
+#define CHOICE_LOG_INIT 4096
+
+/*
+ * Tag at the start of an encoded choice log.
+ */
+#define CHOICE_LOG_MAGIC "RCL1"
+
+/*
+ * Largest encoded size of a choice log with the given number of entries.
+ */
+#define CHOICE_ENCODED_MAX(n) (4 + 5 * (n))
+
 
 /*
  * GUI: Text formatting
@@ -727,8 +743,8 @@ typedef struct card
 	/* Miscellaneous card flags */
 	uint16_t misc;
 
-	/* Card design */
-	design *d_ptr;
+	/* Card design (index into design library) */
+	int16_t d_idx;
 
 	/* Card we are covering (if a good) */
 	int16_t covering;
@@ -814,6 +830,22 @@ typedef struct decisions
 
 } decisions;
 
+/*
+ * Storage for a player's choice log.
+ *
+ * Simulated games share the log of the game they were copied from, so the
+ * storage is reached through a pointer and grown in place.
+ */
+typedef struct choice_buffer
+{
+	/* Log entries */
+	int *data;
+
+	/* Number of entries allocated */
+	int size;
+
+} choice_buffer;
+
 /*
  * Information about a player.
  */
@@ -921,7 +953,7 @@ typedef struct player
 	int16_t phase_prestige;
 
 	/* Log of player's choices */
-	int *choice_log;
+	choice_buffer *choice_log;
 
 	/* Size and current position of choice log */
 	int choice_size;
@@ -994,17 +1026,14 @@ typedef struct game
 	/* Size of deck in use */
 	int16_t deck_size;
 
-	/* Information about each card */
-	card deck[MAX_DECK];
-
 	/* Victory points remaining in the pool */
 	int8_t vp_pool;
 
 	/* Goals active in this game */
-	short goal_active[MAX_GOAL];
+	int8_t goal_active[MAX_GOAL];
 
 	/* Goals yet unclaimed */
-	short goal_avail[MAX_GOAL];
+	int8_t goal_avail[MAX_GOAL];
 
 	/* Maximum progress toward a "most" goal */
 	int8_t goal_most[MAX_GOAL];
@@ -1045,8 +1074,46 @@ typedef struct game
 	/* Game is over */
 	int8_t game_over;
 
+	/* Replaying choice logs without messages or player callbacks */
+	int8_t fast_replay;
+
+	/* Cards, players and goals changed since last cleared (see MARK_*) */
+	uint8_t dirty_card[(MAX_DECK + 7) / 8];
+	int8_t dirty_player;
+	int8_t dirty_goal;
+
+	/* Information about each card (kept last so copies can stop early) */
+	card deck[MAX_DECK];
+
 } game;
 
+/*
+ * Game states are copied for every simulated move the AI makes, so make
+ * sure the layout stays compact.
+ *
+ * A card is exactly sixteen bytes.  A game must not grow beyond 6600
+ * bytes, which is the 6552 bytes of the compact layout with 64-bit
+ * pointers plus the 48-byte set of changed cards, players and goals.
+ */
+#define CARD_SIZE 16
+#define GAME_SIZE_MAX 6600
+
+typedef char card_size_check[sizeof(card) == CARD_SIZE ? 1 : -1];
+typedef char game_size_check[sizeof(game) <= GAME_SIZE_MAX ? 1 : -1];
+
+/*
+ * Record changes to information shown to clients.
+ *
+ * Every change to a card's owner, location, misc flags, order, goods or
+ * covering card, to a player's actions, points, goals or bonuses, or to
+ * goal availability must be marked, so that the server can send only what
+ * changed.
+ */
+#define MARK_CARD(g, x) ((g)->dirty_card[(x) >> 3] |= 1 << ((x) & 7))
+#define MARK_PLAYER(g, who) ((g)->dirty_player |= 1 << (who))
+#define MARK_GOALS(g) ((g)->dirty_goal = 1)
+#define CARD_DIRTY(g, x) ((g)->dirty_card[(x) >> 3] & (1 << ((x) & 7)))
+
 /*
  * Campaign card order.
  */
@@ -1106,6 +1173,123 @@ typedef struct campaign_status
 } campaign_status;
 
 
+/*
+ * Snapshot format version.
+ *
+ * Increase this whenever the layout of the game structure changes.
+ */
+#define SNAPSHOT_MAGIC 0x52534e32
+
+/*
+ * Header at the start of a game state snapshot.
+ *
+ * A snapshot is this header followed by the game structure (up to the
+ * last card in use) with every pointer cleared, followed by the campaign
+ * status if a campaign is in use.  Snapshots only contain indices, so
+ * they can be written to disk, sent to another process or mapped at any
+ * address, as long as the reader was built with the same game layout.
+ */
+typedef struct snapshot_header
+{
+	/* Format version */
+	int magic;
+
+	/* Layout check */
+	int game_size;
+	int card_size;
+
+	/* Total snapshot length */
+	int length;
+
+	/* Number of cards stored */
+	int deck_size;
+
+	/* Index of campaign in use (or -1) */
+	int camp;
+
+	/* Unused */
+	int reserved[2];
+
+} snapshot_header;
+
+/*
+ * Maximum number of round checkpoints kept.
+ */
+#define MAX_CHECKPOINT 64
+
+/*
+ * Game state checkpoint taken at the start of a round.
+ */
+typedef struct checkpoint
+{
+	/* Rounds played before checkpoint */
+	int round;
+
+	/* Choice log position of each player */
+	int pos[MAX_PLAYER];
+
+	/* Length of message log (if kept by caller) */
+	int log_len;
+
+	/* Snapshot of game state */
+	char *snap;
+
+	/* Length of snapshot */
+	int len;
+
+} checkpoint;
+
+/*
+ * Checkpoints of a game, in round order.
+ */
+typedef struct checkpoint_list
+{
+	/* Number of checkpoints */
+	int num;
+
+	/* Checkpoints */
+	checkpoint list[MAX_CHECKPOINT];
+
+} checkpoint_list;
+
+/*
+ * Parts of a game that AI decision time is reported for.
+ */
+#define STAT_START    0
+#define STAT_ACTION   1
+#define STAT_EXPLORE  2
+#define STAT_DEVELOP  3
+#define STAT_SETTLE   4
+#define STAT_CONSUME  5
+#define STAT_PRODUCE  6
+#define STAT_DISCARD  7
+#define MAX_STAT      8
+
+/*
+ * Work done by the AI, for training metrics.
+ */
+typedef struct ai_stats
+{
+	/* Number of network computations */
+	double computes;
+
+	/* Evaluations found in and missing from the cache */
+	double cache_hit, cache_miss;
+
+	/* Summed training errors and weights of the evaluator */
+	double eval_error, eval_num_error;
+
+	/* Summed training errors and weights of the role predictor */
+	double role_error, role_num_error;
+
+	/* Right and wrong role predictions */
+	double role_hit, role_miss;
+
+	/* Seconds spent choosing during each part of the game */
+	double phase_time[MAX_STAT];
+
+} ai_stats;
+
 /*
  * External variables.
  */
@@ -1121,6 +1305,7 @@ extern char *goal_name[MAX_GOAL];
 extern char *search_name[MAX_SEARCH];
 extern char *player_labels[MAX_PLAYER];
 extern char *location_names[MAX_WHERE];
+extern char *stat_name[MAX_STAT];
 extern decisions ai_func;
 extern decisions gui_func;
 
@@ -1145,6 +1330,22 @@ extern campaign *find_campaign(char *name);
 extern void apply_campaign(game *g);
 extern void init_game(game *g);
 extern int simple_rand(unsigned int *seed);
+extern void copy_game(game *dst, game *src);
+extern void mark_all(game *g);
+extern void clear_dirty(game *g);
+extern int snapshot_size(game *g);
+extern int save_snapshot(game *g, char *buf);
+extern int load_snapshot(game *g, char *buf, int len);
+extern checkpoint *save_checkpoint(checkpoint_list *cl, game *g);
+extern checkpoint *find_checkpoint(checkpoint_list *cl, game *g);
+extern int load_checkpoint(game *g, char *buf, int len);
+extern void trim_checkpoints(checkpoint_list *cl, game *g);
+extern void clear_checkpoints(checkpoint_list *cl);
+extern choice_buffer *new_choice_log(void);
+extern void grow_choice_log(choice_buffer *b, int size);
+extern int *reserve_choice_log(player *p_ptr, int num);
+extern int encode_choice_log(unsigned char *buf, int *log, int num);
+extern int decode_choice_log(choice_buffer *b, unsigned char *buf, int len);
 extern int next_choice(int* log, int pos);
 extern int count_player_area(game *g, int who, int where);
 extern int count_active_flags(game *g, int who, int flags);
@@ -1243,6 +1444,20 @@ extern void declare_winner(game *g);
 extern void ai_debug(game *g, double win_prob[MAX_PLAYER][MAX_PLAYER],
                               double *role[], double *action_score[],
                               int *num_action);
+extern int ai_open_experience(char *eval_fname, char *role_fname);
+extern void ai_close_experience(void);
+extern void ai_capture_choice(game *g, int who);
+extern void ai_capture_round(game *g);
+extern void ai_capture_end(game *g);
+extern void ai_capture_discard(void);
+extern int ai_load_networks(game *g, char *dir);
+extern void ai_use_networks(int who, int set);
+extern void ai_set_checkpoint_dir(char *dir, int keep);
+extern int ai_checkpoint(void);
+extern void ai_collect_stats(ai_stats *s);
+#ifdef AI_THREADS
+extern void ai_thread_done(void);
+#endif
 
 extern int load_game(game *g, char *filename);
 extern int save_game(game *g, char *filename, int player_us);
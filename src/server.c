@@ -23,9 +23,15 @@
 
 #include "rftg.h"
 #include "comm.h"
-#include <mysql/mysql.h>
+#include "store.h"
 #include <pthread.h>
 #include <unistd.h>
+#include <ucontext.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/timerfd.h>
+#include <sys/uio.h>
 
 /*
  * Server settings.
@@ -43,15 +49,112 @@
 #define SS_DONE      3
 #define SS_ABANDONED 4
 
+/*
+ * Most queued messages to hand to one writev() call.
+ */
+#define MAX_IOV      64
+
+/*
+ * Unsent bytes past which a client only gets the updates it must have.
+ */
+#define OUT_HIGH_WATER (256 * 1024)
+
+/*
+ * Unsent bytes past which a client is disconnected.
+ */
+#define OUT_LIMIT      (4 * 1024 * 1024)
+
 /*
  * Number of random bytes to store per session (2 needed per number generated).
  */
 #define MAX_RAND     1024
 
 /*
- * Size (in int) of the choice log of a player.
+ * Largest size (in int) the choice log of a player may grow to.
+ */
+#define CHOICE_LOG_MAX    65536
+
+/*
+ * Maximum number of connections.
+ */
+#define MAX_CONN 4096
+
+/*
+ * Event loop identifiers of the listening socket, housekeeping timer and
+ * output wakeup (connections use their index).
+ */
+#define EV_LISTEN MAX_CONN
+#define EV_TIMER  (MAX_CONN + 1)
+#define EV_WAKE   (MAX_CONN + 2)
+
+/*
+ * Most events handled per wakeup.
+ */
+#define MAX_EVENTS 64
+
+/*
+ * Maximum number of sessions.
+ */
+#define MAX_SESSION 1024
+
+/*
+ * Stack size of a game task.
+ */
+#define TASK_STACK (512 * 1024)
+
+/*
+ * Room for database writes waiting to be done (grown when needed).
+ */
+#define DB_QUEUE_START 4096
+
+/*
+ * Most database writes done together.
+ */
+#define DB_BATCH_MAX 64
+
+/*
+ * Kinds of database writes.
+ *
+ * Kinds up to DB_REPLAY are jobs done alone once earlier writes are done.
+ *
+ * Waiting writes of kind DB_STATE or above are replaced by later writes of
+ * the same kind, game and user.
+ */
+#define DB_EXPORT     0
+#define DB_REPLAY     1
+#define DB_PLAIN      2
+#define DB_ROWS       3
+#define DB_STATE      4
+#define DB_SEAT       5
+#define DB_AI         6
+#define DB_WAITING    7
+#define DB_CHOICES    8
+#define DB_CHECKPOINT 9
+
+/*
+ * A message to be sent.
+ *
+ * Messages are never changed once built, so one copy is shared by every
+ * connection it is queued on, and freed when the last one has sent it.
  */
-#define CHOICE_LOG_LEN    4096
+typedef struct out_msg
+{
+	/* Number of references held */
+	int refs;
+
+	/* Length of message */
+	int len;
+
+	/* Message data is filled in and may be sent */
+	int ready;
+
+	/* Pointer to message data */
+	char *ptr;
+
+	/* Message data */
+	char data[];
+
+} out_msg;
 
 /*
  * A connection from a client.
@@ -61,24 +164,37 @@ typedef struct conn
 	/* File descriptor of socket */
 	int fd;
 
-	/* Connection is to a local AI client */
-	int ai;
-
 	/* Data buffer for incoming bytes */
 	char buf[BUF_LEN];
 
 	/* Amount of data currently in buffer */
 	int buf_full;
 
-	/* Data buffer for unsent messages */
-	char *out_buf;
+	/* Ring of unsent messages */
+	out_msg **out_q;
 
-	/* Amount of data needing to be sent */
-	int out_len;
+	/* Position of first unsent message and number of messages queued */
+	int out_first;
+	int out_num;
 
-	/* Current size of outgoing buffer */
+	/* Number of messages ring has room for (a power of two) */
 	int out_size;
 
+	/* Bytes of first queued message already sent */
+	int out_sent;
+
+	/* Total unsent bytes queued */
+	int out_bytes;
+
+	/* Queue went past its limit and connection must be dropped */
+	int overflow;
+
+	/* Socket can accept more data without blocking */
+	int writable;
+
+	/* Connection is waiting in the list of output to flush */
+	int queued;
+
 	/* Connection state */
 	int state;
 
@@ -88,6 +204,9 @@ typedef struct conn
 	/* Client version */
 	char version[80];
 
+	/* Protocol revision agreed with client */
+	int proto;
+
 	/* User ID */
 	int uid;
 
@@ -163,8 +282,17 @@ typedef struct session
 	/* Game information */
 	game g;
 
-	/* Game information remembered by each client */
-	game old[MAX_PLAYER];
+	/* Client needs every card, player and goal resent */
+	int resend[MAX_PLAYER];
+
+	/* Card shown to each client in place of each hidden card (or -1) */
+	int16_t sub[MAX_PLAYER][MAX_DECK];
+
+	/* Hidden card each card is shown in place of, for each client */
+	int16_t sub_for[MAX_PLAYER][MAX_DECK];
+
+	/* Current action when status was last sent */
+	int old_action;
 
 	/* Outstanding choice for each player */
 	choice out[MAX_PLAYER];
@@ -178,6 +306,13 @@ typedef struct session
 	/* Current position in random pool */
 	int random_pos;
 
+	/* Checkpoint loaded from database (if any) */
+	char *checkpoint;
+	int checkpoint_len;
+
+	/* Random pool position at checkpoint */
+	int checkpoint_rand;
+
 	/* User ID who created session */
 	int created;
 
@@ -220,27 +355,156 @@ typedef struct session
 	/* Mutex for access to session variables */
 	pthread_mutex_t session_mutex;
 
-	/* Condition variable to signal game thread when reply is ready */
-	pthread_cond_t wait_cond;
+	/* Saved state of game task while it waits for a reply */
+	ucontext_t task;
+
+	/* Worker to return to when game task waits */
+	ucontext_t *worker;
+
+	/* Stack of game task */
+	char *stack;
+
+	/* Game task is in run queue */
+	int queued;
+
+	/* Game task is running on a worker */
+	int running;
+
+	/* Game task was woken while running */
+	int woken;
+
+	/* Game task has finished */
+	int finished;
+
+	/* Results of finished game have been written and exported */
+	int saved;
 
 	/* Time since last player joined */
 	time_t last_join;
 
 } session;
 
+/*
+ * A choice to be made by the AI for a player.
+ */
+typedef struct ai_job
+{
+	/* Session and player the choice is for */
+	int sid;
+	int who;
+
+	/* Choice log of player and position the answer goes to */
+	choice_buffer *log;
+	int pos;
+
+	/* Choice to make */
+	choice out;
+
+	/* Next job in queue */
+	struct ai_job *next;
+
+	/* Game as seen by the player */
+	game view;
+
+} ai_job;
+
+/*
+ * A game log being loaded for a client.
+ */
+typedef struct replay_log
+{
+	/* Messages loaded */
+	char *data;
+
+	/* Length of messages and room in buffer */
+	int len;
+	int size;
+
+} replay_log;
+
+/*
+ * A database write waiting to be done by the writer thread.
+ */
+typedef struct db_write
+{
+	/* Kind of write */
+	int type;
+
+	/* Write passed to storage backend */
+	store_write w;
+
+	/* Message to fill in with replayed game log */
+	out_msg *fill;
+
+} db_write;
+
 
 /*
  * List of all active connections.
  */
-static conn c_list[1024];
+static conn c_list[MAX_CONN];
 static int num_conn;
 
+/*
+ * Event loop descriptors.
+ */
+static int epoll_fd, timer_fd, wake_fd;
+
+/*
+ * Thread running the event loop.
+ */
+static pthread_t main_thread;
+
+/*
+ * Connections with output waiting to be flushed by the event loop.
+ */
+static int pending[MAX_CONN];
+static int num_pending;
+
+/*
+ * Mutex to protect list of pending output.
+ */
+static pthread_mutex_t pending_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 /*
  * List of active game sessions.
  */
-static session s_list[1024];
+static session s_list[MAX_SESSION];
 static int num_session;
 
+/*
+ * Number of worker threads running game tasks.
+ */
+static int num_workers = 4;
+
+/*
+ * Queue of game tasks ready to run.
+ */
+static int run_queue[MAX_SESSION];
+static int run_head, run_len;
+
+/*
+ * Mutex and condition variable protecting run queue and task flags.
+ */
+static pthread_mutex_t run_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t run_cond = PTHREAD_COND_INITIALIZER;
+
+/*
+ * Number of threads making choices for AI players.
+ */
+static int num_ai_threads = 4;
+
+/*
+ * Queue of choices waiting for the AI.
+ */
+static ai_job *ai_head, *ai_tail;
+
+/*
+ * Mutex and condition variable protecting AI queue.
+ */
+static pthread_mutex_t ai_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ai_cond = PTHREAD_COND_INITIALIZER;
+
 /*
  * Tick size (in seconds).
  */
@@ -287,9 +551,33 @@ static char* server_name = NULL;
 static int debug_server = 0;
 
 /*
- * Connection to the database server.
+ * Storage backend.
+ */
+static store *storage;
+
+/*
+ * Queue of database writes.
+ */
+static db_write *db_list;
+static int db_head, db_len;
+
+/*
+ * Number of writes queue has room for (a power of two).
+ */
+static int db_size;
+
+/*
+ * Mutex and condition variables protecting database write queue.
  */
-MYSQL *mysql;
+static pthread_mutex_t db_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t db_cond = PTHREAD_COND_INITIALIZER;
+
+/*
+ * Forward declarations.
+ */
+static void wake_task(session *s_ptr);
+static void kick_player(int cid, char *reason);
+static void db_replay(int gid, int uid, int cid, out_msg *m);
 
 /*
  * Log message to stdout.
@@ -322,130 +610,125 @@ static void server_log(char *format, ...)
 	printf("\n");
 }
 
-
 /*
- * Check for a user in the database with the given password.
- *
- * If the user does not exist, create an entry for them.
- *
- * Return -1 if the password given does not match an existing entry.
+ * Free the data of a queued write.
  */
-static int db_user(char *user, char *pass)
+static void db_free_data(db_write *w_ptr)
 {
-	MYSQL_RES *res1, *res2;
-	MYSQL_ROW row1, row2;
-	char query[1024];
-	char euser[1024], epass[1024];
-	int uid;
+	/* Free data */
+	free(w_ptr->w.data[0]);
+	free(w_ptr->w.data[1]);
+}
 
-	/* Escape user and password */
-	mysql_real_escape_string(mysql, euser, user, strlen(user));
-	mysql_real_escape_string(mysql, epass, pass, strlen(pass));
+/*
+ * Clear a write before filling it in.
+ */
+static void db_clear(store_write *w_ptr, int type, int gid, int uid)
+{
+	/* Clear write */
+	memset(w_ptr, 0, sizeof(store_write));
 
-	/* Create lookup query */
-	sprintf(query, "SELECT pass, uid FROM users WHERE user='%s'", euser);
+	/* Set kind, game and user */
+	w_ptr->type = type;
+	w_ptr->gid = gid;
+	w_ptr->uid = uid;
+}
 
-	/* Run query */
-	mysql_query(mysql, query);
+/*
+ * Queue a database write or job to be done by the writer thread.
+ *
+ * Data written must be allocated, and is freed once written.
+ *
+ * The queue is grown rather than waiting for the writer, so that callers
+ * never block on the database.
+ */
+static void db_add(int type, store_write *w, out_msg *fill)
+{
+	db_write *w_ptr, *list;
+	int i;
 
-	/* Fetch results */
-	res1 = mysql_store_result(mysql);
+	/* Grab database queue mutex */
+	pthread_mutex_lock(&db_mutex);
 
-	/* Check for no rows returned */
-	if (!(row1 = mysql_fetch_row(res1)))
+	/* Check for write replacing earlier ones */
+	if (type >= DB_STATE)
 	{
-		/* Free old results */
-		mysql_free_result(res1);
-
-		/* Create insertion query */
-		sprintf(query, "INSERT INTO users (user, pass) VALUES \
-		        ('%s', SHA1('%s'))", euser, epass);
-
-		/* Send query */
-		mysql_query(mysql, query);
-
-		/* Get ID of user inserted */
-		strcpy(query, "SELECT LAST_INSERT_ID()");
-
-		/* Run query */
-		mysql_query(mysql, query);
-
-		/* Fetch results */
-		res1 = mysql_store_result(mysql);
+		/* Look backwards through queue */
+		for (i = db_len - 1; i >= 0; i--)
+		{
+			/* Get write pointer */
+			w_ptr = &db_list[(db_head + i) & (db_size - 1)];
 
-		/* Get row */
-		row1 = mysql_fetch_row(res1);
+			/* Skip writes to other games */
+			if (w_ptr->w.gid != w->gid) continue;
 
-		/* Get user ID */
-		uid = strtol(row1[0], NULL, 0);
+			/* Do not move write before other writes */
+			if (w_ptr->type < DB_ROWS) break;
 
-		/* Free result */
-		mysql_free_result(res1);
+			/* Check for same kind of write to same user */
+			if (w_ptr->type == type && w_ptr->w.uid == w->uid)
+			{
+				/* Replace waiting write */
+				db_free_data(w_ptr);
+				w_ptr->w = *w;
 
-		/* Return ID */
-		return uid;
+				/* Release database queue mutex */
+				pthread_mutex_unlock(&db_mutex);
+				return;
+			}
+		}
 	}
 
-	/* Create password hash query */
-	sprintf(query, "SELECT SHA1('%s')", epass);
-
-	/* Send query */
-	mysql_query(mysql, query);
+	/* Check for full queue */
+	if (db_len == db_size)
+	{
+		/* Create queue of double size */
+		i = db_size ? db_size * 2 : DB_QUEUE_START;
+		list = (db_write *)malloc(sizeof(db_write) * i);
 
-	/* Fetch results */
-	res2 = mysql_store_result(mysql);
+		/* Loop over queued writes */
+		for (i = 0; i < db_len; i++)
+		{
+			/* Copy write in order */
+			list[i] = db_list[(db_head + i) & (db_size - 1)];
+		}
 
-	/* Get row */
-	row2 = mysql_fetch_row(res2);
+		/* Replace old queue */
+		free(db_list);
+		db_list = list;
+		db_size = db_size ? db_size * 2 : DB_QUEUE_START;
+		db_head = 0;
 
-	/* Check for matching password */
-	if (!strcmp(row2[0], row1[0]))
-	{
-		/* Get ID */
-		uid = strtol(row1[1], NULL, 0);
+		/* Log database falling behind */
+		if (db_size > DB_QUEUE_START)
+		{
+			/* Log message */
+			server_log("Database queue grown to %d writes", db_size);
+		}
+	}
 
-		/* Free results */
-		mysql_free_result(res1);
-		mysql_free_result(res2);
+	/* Get pointer to end of queue */
+	w_ptr = &db_list[(db_head + db_len++) & (db_size - 1)];
 
-		/* Return ID */
-		return uid;
-	}
+	/* Fill in write */
+	w_ptr->type = type;
+	w_ptr->w = *w;
+	w_ptr->fill = fill;
 
-	/* Free results */
-	mysql_free_result(res1);
-	mysql_free_result(res2);
+	/* Wake writer thread */
+	pthread_cond_signal(&db_cond);
 
-	/* Bad password */
-	return -1;
+	/* Release database queue mutex */
+	pthread_mutex_unlock(&db_mutex);
 }
 
 /*
- * Return the user name for a given user ID.
+ * Queue a database write to be done by the writer thread.
  */
-static void db_user_name(int uid, char *name)
+static void db_queue(int type, store_write *w)
 {
-	MYSQL_RES *res;
-	MYSQL_ROW row;
-	char query[1024];
-
-	/* Create query */
-	sprintf(query, "SELECT user FROM users WHERE uid=%d", uid);
-
-	/* Run query */
-	mysql_query(mysql, query);
-
-	/* Fetch results */
-	res = mysql_store_result(mysql);
-
-	/* Get row */
-	row = mysql_fetch_row(res);
-
-	/* Copy user name */
-	strcpy(name, row[0]);
-
-	/* Free result */
-	mysql_free_result(res);
+	/* Queue write with no message to fill */
+	db_add(type, w, NULL);
 }
 
 /*
@@ -455,85 +738,55 @@ static void db_user_name(int uid, char *name)
  */
 static int db_new_game(int sid)
 {
-	MYSQL_RES *res;
-	MYSQL_ROW row;
 	session *s_ptr = &s_list[sid];
-	char query[1024];
-	char edesc[1024], epass[1024];
+	store_game info;
 	int gid;
 
-	/* Escape game description and password */
-	mysql_real_escape_string(mysql, edesc, s_ptr->desc,strlen(s_ptr->desc));
-	mysql_real_escape_string(mysql, epass, s_ptr->pass,strlen(s_ptr->pass));
-
-	/* Create insertion query */
-	sprintf(query, "INSERT INTO games (description, pass, created, state, \
-	                                   minp, maxp, \
-	                                   exp, adv, dis_goal, dis_takeover, \
-	                                   speed, version) \
-	             VALUES ('%s', '%s', %d, 'WAITING', %d, %d, %d, %d, \
-	                     %d, %d, %d, '%s')",
-	        edesc, epass, s_ptr->created,
-	        s_ptr->min_player, s_ptr->max_player,
-	        s_ptr->expanded, s_ptr->advanced, s_ptr->disable_goal,
-	        s_ptr->disable_takeover, s_ptr->speed, VERSION);
-
-	/* Send query */
-	mysql_query(mysql, query);
-
-	/* Check for error */
-	if (*mysql_error(mysql))
+	/* Set game fields */
+	strcpy(info.desc, s_ptr->desc);
+	strcpy(info.pass, s_ptr->pass);
+	info.created = s_ptr->created;
+	info.min_player = s_ptr->min_player;
+	info.max_player = s_ptr->max_player;
+	info.expanded = s_ptr->expanded;
+	info.advanced = s_ptr->advanced;
+	info.disable_goal = s_ptr->disable_goal;
+	info.disable_takeover = s_ptr->disable_takeover;
+	info.speed = s_ptr->speed;
+
+	/* Insert game */
+	if ((gid = storage->new_game(&info)) < 0)
 	{
 		/* Print error */
-		server_log("%s", mysql_error(mysql));
+		server_log("Could not create game");
 		exit(1);
 	}
 
-	/* Get ID of game inserted */
-	strcpy(query, "SELECT LAST_INSERT_ID()");
-
-	/* Run query */
-	mysql_query(mysql, query);
-
-	/* Fetch results */
-	res = mysql_store_result(mysql);
-
-	/* Get row */
-	row = mysql_fetch_row(res);
-
-	/* Get ID */
-	gid = strtol(row[0], NULL, 0);
-
-	/* Free result */
-	mysql_free_result(res);
-
-	/* Return ID */
+	/* Return game ID */
 	return gid;
 }
 
 /*
- * Read waiting/running games from database.
+ * Read waiting/running games and their players from database.
  */
 static void db_load_sessions(void)
 {
-	MYSQL_RES *res;
-	MYSQL_ROW row;
 	session *s_ptr;
-	int sid = 0;
+	store_game *list, *g_ptr;
+	int sid, i, n;
 
-	/* Run query */
-	mysql_query(mysql, "SELECT gid, description, pass, created, state, \
-	                           minp, maxp, exp, adv, dis_goal, \
-	                           dis_takeover, speed \
-	                    FROM games \
-	                    WHERE state='WAITING' OR state='STARTED'");
+	/* Allocate list of games */
+	list = (store_game *)malloc(MAX_SESSION * sizeof(store_game));
 
-	/* Fetch results */
-	res = mysql_store_result(mysql);
+	/* Load games */
+	n = storage->load_games(list, MAX_SESSION);
 
-	/* Loop over rows returned */
-	while ((row = mysql_fetch_row(res)))
+	/* Loop over games loaded */
+	for (sid = 0; sid < n; sid++)
 	{
+		/* Get pointer to game */
+		g_ptr = &list[sid];
+
 		/* Get pointer to session */
 		s_ptr = &s_list[sid];
 
@@ -544,113 +797,47 @@ static void db_load_sessions(void)
 		pthread_mutex_init(&s_ptr->session_mutex, NULL);
 
 		/* Read fields */
-		s_ptr->gid = strtol(row[0], NULL, 0);
-		strcpy(s_ptr->desc, row[1]);
-		strcpy(s_ptr->pass, row[2]);
-		s_ptr->created = strtol(row[3], NULL, 0);
+		s_ptr->gid = g_ptr->gid;
+		strcpy(s_ptr->desc, g_ptr->desc);
+		strcpy(s_ptr->pass, g_ptr->pass);
+		s_ptr->created = g_ptr->created;
 
-		/* Check state */
-		if (!strcmp(row[4], "WAITING"))
-		{
-			/* Set state */
-			s_ptr->state = SS_WAITING;
-		}
-		else
-		{
-			/* Game is started */
-			s_ptr->state = SS_STARTED;
-		}
+		/* Set state */
+		s_ptr->state = g_ptr->state == GS_WAITING ? SS_WAITING : SS_STARTED;
 
 		/* Read fields */
-		s_ptr->min_player = strtol(row[5], NULL, 0);
-		s_ptr->max_player = strtol(row[6], NULL, 0);
-		s_ptr->expanded = strtol(row[7], NULL, 0);
-		s_ptr->advanced = strtol(row[8], NULL, 0);
-		s_ptr->disable_goal = strtol(row[9], NULL, 0);
-		s_ptr->disable_takeover = strtol(row[10], NULL, 0);
-		s_ptr->speed = strtol(row[11], NULL, 0);
+		s_ptr->min_player = g_ptr->min_player;
+		s_ptr->max_player = g_ptr->max_player;
+		s_ptr->expanded = g_ptr->expanded;
+		s_ptr->advanced = g_ptr->advanced;
+		s_ptr->disable_goal = g_ptr->disable_goal;
+		s_ptr->disable_takeover = g_ptr->disable_takeover;
+		s_ptr->speed = g_ptr->speed;
+
+		/* Load users in seat order */
+		s_ptr->num_users = storage->load_players(s_ptr->gid, s_ptr->uids,
+		                                         s_ptr->ai_control,
+		                                         MAX_PLAYER);
+
+		/* Loop over users */
+		for (i = 0; i < s_ptr->num_users; i++)
+		{
+			/* No connection for user yet */
+			s_ptr->cids[i] = -1;
+
+			/* Set AI control */
+			s_ptr->g.p[i].ai = s_ptr->ai_control[i];
+		}
 
 		/* Set last join time */
 		s_ptr->last_join = time(NULL);
 
 		/* Increase number of sessions */
 		num_session++;
-
-		/* Go to next session ID */
-		sid++;
 	}
 
-	/* Free results */
-	mysql_free_result(res);
-}
-
-/*
- * Read list of players in waiting/running games from database.
- */
-static void db_load_attendance(void)
-{
-	MYSQL_RES *res;
-	MYSQL_ROW row;
-	session *s_ptr;
-	int uid, gid, ai;
-	int i;
-
-	/* Run query */
-	mysql_query(mysql, "SELECT uid, gid, ai \
-	                    FROM attendance \
-	                    JOIN games USING (gid) \
-	                    WHERE state='WAITING' OR state='STARTED' \
-	                    ORDER BY seat");
-
-	/* Fetch results */
-	res = mysql_store_result(mysql);
-
-	/* Loop over rows returned */
-	while ((row = mysql_fetch_row(res)))
-	{
-		/* Get user ID */
-		uid = strtol(row[0], NULL, 0);
-
-		/* Get game ID */
-		gid = strtol(row[1], NULL, 0);
-
-		/* Get AI control */
-		ai = strtol(row[2], NULL, 0);
-
-		/* Loop over sessions */
-		for (i = 0; i < num_session; i++)
-		{
-			/* Stop at correct game ID */
-			if (s_list[i].gid == gid) break;
-		}
-
-		/* Check for error */
-		if (i == num_session)
-		{
-			/* Error */
-			server_log("Bad attendance: no gid %d", gid);
-			continue;
-		}
-
-		/* Get pointer to session */
-		s_ptr = &s_list[i];
-
-		/* Add user to session */
-		s_ptr->uids[s_ptr->num_users] = uid;
-
-		/* No connection for user yet */
-		s_ptr->cids[s_ptr->num_users] = -1;
-
-		/* Set AI control */
-		s_ptr->ai_control[s_ptr->num_users] = ai;
-		s_ptr->g.p[s_ptr->num_users].ai = ai;
-
-		/* Count users */
-		s_ptr->num_users++;
-	}
-
-	/* Free results */
-	mysql_free_result(res);
+	/* Free list */
+	free(list);
 }
 
 /*
@@ -658,14 +845,13 @@ static void db_load_attendance(void)
  */
 static void db_join_game(int uid, int gid)
 {
-	char query[1024];
+	store_write w;
 
-	/* Create query */
-	sprintf(query, "INSERT INTO attendance (uid, gid) VALUES (%d, %d)",
-	        uid, gid);
+	/* Set user and game */
+	db_clear(&w, STORE_JOIN, gid, uid);
 
-	/* Run query */
-	mysql_query(mysql, query);
+	/* Queue write */
+	db_queue(DB_PLAIN, &w);
 }
 
 /*
@@ -673,14 +859,13 @@ static void db_join_game(int uid, int gid)
  */
 static void db_leave_game(int uid, int gid)
 {
-	char query[1024];
+	store_write w;
 
-	/* Create query */
-	sprintf(query, "DELETE FROM attendance WHERE uid=%d AND gid=%d",
-	        uid, gid);
+	/* Set user and game */
+	db_clear(&w, STORE_LEAVE, gid, uid);
 
-	/* Run query */
-	mysql_query(mysql, query);
+	/* Queue write */
+	db_queue(DB_PLAIN, &w);
 }
 
 /*
@@ -690,81 +875,99 @@ static void db_leave_game(int uid, int gid)
  */
 static int db_load_game_state(int sid)
 {
-	MYSQL_RES *res;
-	MYSQL_ROW row;
 	session *s_ptr = &s_list[sid];
-	unsigned long *field_len;
-	char query[1024];
-	int i;
-
-	/* Create query */
-	sprintf(query, "SELECT pool FROM seed WHERE gid=%d", s_ptr->gid);
-
-	/* Run query */
-	mysql_query(mysql, query);
+	unsigned char *data;
+	int i, len;
 
-	/* Fetch results */
-	res = mysql_store_result(mysql);
-
-	/* Check for no rows returned */
-	if (!res || !(row = mysql_fetch_row(res)))
+	/* Load random byte pool */
+	if (!storage->load_seed(s_ptr->gid, s_ptr->random_pool, MAX_RAND))
 	{
-		/* Free result */
-		mysql_free_result(res);
-
 		/* No pool to load */
 		return 0;
 	}
 
-	/* Copy returned data to random byte pool */
-	memcpy(s_ptr->random_pool, row[0], MAX_RAND);
-
 	/* Start at beginning of byte pool */
 	s_ptr->random_pos = 0;
 
-	/* Free result */
-	mysql_free_result(res);
-
 	/* Loop over players in session */
 	for (i = 0; i < s_ptr->num_users; i++)
 	{
-		/* Create query to load choice log */
-		sprintf(query,"SELECT log FROM choices WHERE gid=%d AND uid=%d",
-		        s_ptr->gid, s_ptr->uids[i]);
+		/* Load choice log */
+		len = storage->load_choices(s_ptr->gid, s_ptr->uids[i], &data);
 
-		/* Run query */
-		mysql_query(mysql, query);
+		/* Check for no log */
+		if (len < 0) continue;
 
-		/* Fetch results */
-		res = mysql_store_result(mysql);
+		/* Decode log and remember length */
+		s_ptr->g.p[i].choice_size =
+		            decode_choice_log(s_ptr->g.p[i].choice_log, data, len);
 
-		/* Check for no rows returned */
-		if (!(row = mysql_fetch_row(res)))
+		/* Check for corrupt log */
+		if (s_ptr->g.p[i].choice_size < 0)
 		{
-			/* Free result */
-			mysql_free_result(res);
+			/* Log error */
+			server_log("Corrupt choice log for game %d user %d",
+			           s_ptr->gid, s_ptr->uids[i]);
 
-			/* Go to next player */
-			continue;
+			/* Discard log */
+			s_ptr->g.p[i].choice_size = 0;
 		}
 
-		/* Get length of log in bytes */
-		field_len = mysql_fetch_lengths(res);
-
-		/* Copy log */
-		memcpy(s_ptr->g.p[i].choice_log, row[0], field_len[0]);
+		/* Free encoded log */
+		free(data);
+	}
 
-		/* Remember length */
-		s_ptr->g.p[i].choice_size = field_len[0] / sizeof(int);
+	/* Load latest round checkpoint */
+	len = storage->load_checkpoint(s_ptr->gid, &s_ptr->checkpoint_rand,
+	                               &s_ptr->checkpoint);
 
-		/* Free result */
-		mysql_free_result(res);
-	}
+	/* Remember length of checkpoint, if any */
+	if (len >= 0) s_ptr->checkpoint_len = len;
 
 	/* Success */
 	return 1;
 }
 
+/*
+ * Save the game state at the start of a round, so that the game can be
+ * restored without replaying it from the beginning.
+ */
+static void db_save_checkpoint(int sid)
+{
+	session *s_ptr = &s_list[sid];
+	store_write w;
+
+	/* Campaigns are not played online */
+	if (s_ptr->g.camp) return;
+
+	/* Set game and random pool position */
+	db_clear(&w, STORE_CHECKPOINT, s_ptr->gid, -1);
+	w.num[0] = s_ptr->random_pos;
+
+	/* Allocate buffer for game state */
+	w.data[0] = (char *)malloc(sizeof(snapshot_header) + sizeof(game));
+
+	/* Save game state */
+	w.len[0] = save_snapshot(&s_ptr->g, w.data[0]);
+
+	/* Queue write */
+	db_queue(DB_CHECKPOINT, &w);
+}
+
+/*
+ * Remove the checkpoint of a finished game.
+ */
+static void db_clear_checkpoint(int sid)
+{
+	store_write w;
+
+	/* Set game */
+	db_clear(&w, STORE_CLEAR, s_list[sid].gid, -1);
+
+	/* Queue write */
+	db_queue(DB_CHECKPOINT, &w);
+}
+
 /*
  * Save the basic state about a game, including random seeds and which
  * players begin in each seat.
@@ -772,39 +975,38 @@ static int db_load_game_state(int sid)
 static void db_save_game_state(int sid)
 {
 	session *s_ptr = &s_list[sid];
-	char query[4096], pool[4096], *status = "";
+	store_write w;
 
-	/* Determine session status */
+	/* Set game */
+	db_clear(&w, STORE_STATE, s_ptr->gid, -1);
+
+	/* Determine game state */
 	switch (s_ptr->state)
 	{
-		case SS_WAITING: status = "WAITING"; break;
-		case SS_STARTED: status = "STARTED"; break;
-		case SS_DONE: status = "DONE"; break;
-		case SS_ABANDONED: status = "ABANDONED"; break;
+		case SS_WAITING: w.num[0] = GS_WAITING; break;
+		case SS_STARTED: w.num[0] = GS_STARTED; break;
+		case SS_DONE: w.num[0] = GS_DONE; break;
+		case SS_ABANDONED: w.num[0] = GS_ABANDONED; break;
 	}
 
-	/* Create query for session status */
-	sprintf(query, "UPDATE games SET state='%s' WHERE gid=%d", status,
-	        s_ptr->gid);
-
-	/* Run query */
-	mysql_query(mysql, query);
+	/* Queue write */
+	db_queue(DB_STATE, &w);
 
 	/* No need to save further data if game has not started or is finished */
 	if (s_ptr->state == SS_WAITING ||
 	    s_ptr->state == SS_ABANDONED ||
 	    s_ptr->state == SS_DONE) return;
 
-	/* Escape random byte pool */
-	mysql_real_escape_string(mysql, pool, (char *)s_ptr->random_pool,
-	                         MAX_RAND);
+	/* Set game */
+	db_clear(&w, STORE_SEED, s_ptr->gid, -1);
 
-	/* Create query to save random byte pool */
-	sprintf(query, "INSERT IGNORE INTO seed VALUES (%d, '%s')",
-	        s_ptr->gid, pool);
+	/* Copy random byte pool */
+	w.data[0] = (char *)malloc(MAX_RAND);
+	memcpy(w.data[0], s_ptr->random_pool, MAX_RAND);
+	w.len[0] = MAX_RAND;
 
-	/* Run query */
-	mysql_query(mysql, query);
+	/* Queue write */
+	db_queue(DB_PLAIN, &w);
 }
 
 /*
@@ -813,19 +1015,18 @@ static void db_save_game_state(int sid)
 static void db_save_seats(int sid)
 {
 	session *s_ptr = &s_list[sid];
-	char query[1024];
+	store_write w;
 	int i;
 
 	/* Loop over players in game */
 	for (i = 0; i < s_ptr->num_users; i++)
 	{
-		/* Update seat number */
-		sprintf(query, "UPDATE attendance SET seat=%d \
-		                WHERE gid=%d AND uid=%d",
-		                i, s_ptr->gid, s_ptr->uids[i]);
+		/* Set game, user and seat number */
+		db_clear(&w, STORE_SEAT, s_ptr->gid, s_ptr->uids[i]);
+		w.num[0] = i;
 
-		/* Run query */
-		mysql_query(mysql, query);
+		/* Queue write */
+		db_queue(DB_SEAT, &w);
 	}
 }
 
@@ -835,45 +1036,48 @@ static void db_save_seats(int sid)
 static void db_save_ai_control(int sid)
 {
 	session *s_ptr = &s_list[sid];
-	char query[1024];
+	store_write w;
 	int i;
 
 	/* Loop over players in game */
 	for (i = 0; i < s_ptr->num_users; i++)
 	{
-		/* Update seat number */
-		sprintf(query, "UPDATE attendance SET ai=%d \
-		                WHERE gid=%d AND uid=%d",
-		                s_ptr->ai_control[i], s_ptr->gid,
-		                s_ptr->uids[i]);
+		/* Set game, user and AI control */
+		db_clear(&w, STORE_AI, s_ptr->gid, s_ptr->uids[i]);
+		w.num[0] = s_ptr->ai_control[i];
 
-		/* Run query */
-		mysql_query(mysql, query);
+		/* Queue write */
+		db_queue(DB_AI, &w);
 	}
 }
 
 /*
  * Save a player's choice log to the database.
+ *
+ * The encoded log is sent as binary data, without escaping.
  */
 static void db_save_choices(int sid, int who)
 {
 	session *s_ptr = &s_list[sid];
 	player *p_ptr;
-	char query[20000], log[20000];
+	store_write w;
 
 	/* Get player pointer */
 	p_ptr = &s_ptr->g.p[who];
 
-	/* Escape choice log string */
-	mysql_real_escape_string(mysql, log, (char *)p_ptr->choice_log,
-	                         sizeof(int) * p_ptr->choice_size);
+	/* Set game and user */
+	db_clear(&w, STORE_CHOICES, s_ptr->gid, s_ptr->uids[who]);
+
+	/* Allocate buffer for largest encoded size of log */
+	w.data[0] = (char *)malloc(CHOICE_ENCODED_MAX(p_ptr->choice_size));
 
-	/* Create query */
-	sprintf(query, "REPLACE INTO choices VALUES (%d, %d, '%s')", s_ptr->gid,
-	        s_ptr->uids[who], log);
+	/* Encode choice log */
+	w.len[0] = encode_choice_log((unsigned char *)w.data[0],
+	                             p_ptr->choice_log->data,
+	                             p_ptr->choice_size);
 
-	/* Run query */
-	mysql_query(mysql, query);
+	/* Queue write */
+	db_queue(DB_CHOICES, &w);
 }
 
 /*
@@ -882,121 +1086,101 @@ static void db_save_choices(int sid, int who)
 static void db_save_waiting(int sid, int who)
 {
 	session *s_ptr = &s_list[sid];
-	char query[1024];
-	char *state_str;
-
-	/* Check waiting status */
-	switch (s_ptr->waiting[who])
-	{
-		case WAIT_READY:
-			state_str = "'READY'";
-			break;
-		case WAIT_BLOCKED:
-			state_str = "'BLOCKED'";
-			break;
-		case WAIT_OPTION:
-			state_str = "'OPTION'";
-			break;
-		default:
-			state_str = "NULL";
-			break;
-	}
+	store_write w;
 
-	/* Update waiting status */
-	sprintf(query, "UPDATE attendance SET waiting=%s \
-	                WHERE gid=%d AND uid=%d",
-	               state_str, s_ptr->gid, s_ptr->uids[who]);
+	/* Set game, user and waiting state */
+	db_clear(&w, STORE_WAITING, s_ptr->gid, s_ptr->uids[who]);
+	w.num[0] = s_ptr->waiting[who];
 
-	/* Run query */
-	mysql_query(mysql, query);
+	/* Queue write */
+	db_queue(DB_WAITING, &w);
 }
 
 /*
- * Export log of a specific game.
+ * Write a message of a game to an export file.
  */
-static void export_log(FILE *fff, int gid)
+static void export_message(void *arg, char *message, char *format,
+                           char *user)
 {
-	MYSQL_RES *res;
-	MYSQL_ROW row;
-	char query[1024];
-	char name[1024];
-
-	/* Create lookup query */
-	sprintf(query, "SELECT message, format, user "
-	               "FROM messages LEFT JOIN users USING (uid) "
-	               "WHERE gid=%d ORDER BY mid", gid);
+	FILE *fff = (FILE *)arg;
+	char name[1024], *text;
 
-	/* Run query */
-	mysql_query(mysql, query);
+	/* Copy message */
+	text = strdup(message);
 
-	/* Fetch results */
-	res = mysql_store_result(mysql);
-
-	/* Loop over rows returned */
-	while ((row = mysql_fetch_row(res)))
+	/* Check for chat message */
+	if (!strcmp(format, FORMAT_CHAT))
 	{
-		/* Check for chat message */
-		if (!strcmp(row[1], FORMAT_CHAT))
+		/* Write xml start tag with format attribute */
+		fprintf(fff, "    <Message format=\"%s\">", format);
+
+		/* Check for player chat */
+		if (user)
 		{
-			/* Write xml start tag with format attribute */
-			fprintf(fff, "    <Message format=\"%s\">", row[1]);
+			/* Put user name */
+			fprintf(fff, "%s: ", xml_escape(user));
+		}
+	}
+	else
+	{
+		/* Chop newline */
+		if (*text) text[strlen(text) - 1] = '\0';
 
-			/* Check for player chat */
-			if (row[2])
-			{
-				/* Put user name */
-				fprintf(fff, "%s: ", xml_escape(row[2]));
-			}
+		/* Check for private message */
+		if (user)
+		{
+			/* Add user name */
+			sprintf(name, " private=\"%s\"", xml_escape(user));
 		}
 		else
 		{
-			/* Chop newline */
-			row[0][strlen(row[0]) - 1] = '\0';
-
-			/* Check for private message */
-			if (row[2])
-			{
-				/* Add user name */
-				sprintf(name, " private=\"%s\"", xml_escape(row[2]));
-			}
-			else
-			{
-				/* Clear user name */
-				strcpy(name, "");
-			}
-
-			/* Check for no format */
-			if (!strlen(row[1]))
-			{
-				/* Write xml start tag */
-				fprintf(fff, "    <Message%s>", name);
-			}
+			/* Clear user name */
+			strcpy(name, "");
+		}
 
-			/* Formatted message */
-			else
-			{
-				/* Write xml start tag with format attribute */
-				fprintf(fff, "    <Message format=\"%s\"%s>", row[1], name);
-			}
+		/* Check for no format */
+		if (!strlen(format))
+		{
+			/* Write xml start tag */
+			fprintf(fff, "    <Message%s>", name);
 		}
 
-		/* Write message and xml end tag */
-		fprintf(fff, "%s</Message>\n", xml_escape(row[0]));
+		/* Formatted message */
+		else
+		{
+			/* Write xml start tag with format attribute */
+			fprintf(fff, "    <Message format=\"%s\"%s>", format, name);
+		}
 	}
 
-	/* Free results */
-	mysql_free_result(res);
+	/* Write message and xml end tag */
+	fprintf(fff, "%s</Message>\n", xml_escape(text));
+
+	/* Free copy */
+	free(text);
+}
+
+/*
+ * Export log of a specific game.
+ */
+static void export_log(FILE *fff, int gid)
+{
+	/* Write all messages of game */
+	storage->load_messages(gid, -1, export_message, fff);
 }
 
 /*
  * Save the results from a finished game.
+ *
+ * The game is exported by the writer thread once the results are written,
+ * and the session is marked as saved.
  */
 static void db_save_results(int sid)
 {
 	session *s_ptr = &s_list[sid];
 	player *p_ptr;
-	int i, tie;
-	char query[1024], filename[1024];
+	store_write w;
+	int i;
 
 	/* Save finished choice logs */
 	for (i = 0; i < s_ptr->num_users; i++)
@@ -1011,19 +1195,52 @@ static void db_save_results(int sid)
 		/* Get player pointer */
 		p_ptr = &s_ptr->g.p[i];
 
-		/* Get tiebreaker value for player */
-		tie = count_player_area(&s_ptr->g, i, WHERE_HAND) +
-		      count_player_area(&s_ptr->g, i, WHERE_GOOD);
+		/* Set game and user */
+		db_clear(&w, STORE_RESULT, s_ptr->gid, s_ptr->uids[i]);
+
+		/* Set points */
+		w.num[0] = p_ptr->end_vp;
+
+		/* Set tiebreaker value for player */
+		w.num[1] = count_player_area(&s_ptr->g, i, WHERE_HAND) +
+		           count_player_area(&s_ptr->g, i, WHERE_GOOD);
+
+		/* Set winner flag */
+		w.num[2] = p_ptr->winner;
+
+		/* Queue row */
+		db_queue(DB_ROWS, &w);
+	}
+
+	/* Have game exported after everything is written */
+	db_clear(&w, -1, s_ptr->gid, -1);
+	db_queue(DB_EXPORT, &w);
+}
 
-		/* Create query */
-		sprintf(query, "INSERT INTO results VALUES (%d, %d, %d, %d,%d)",
-		        s_ptr->gid, s_ptr->uids[i], p_ptr->end_vp, tie,
-		        p_ptr->winner);
+/*
+ * Export a finished game, and tell its game task that it is saved.
+ *
+ * This function runs in the writer thread.
+ */
+static void db_export(int gid)
+{
+	session *s_ptr;
+	char filename[1024];
+	int sid;
 
-		/* Run query */
-		mysql_query(mysql, query);
+	/* Loop over sessions */
+	for (sid = 0; sid < num_session; sid++)
+	{
+		/* Stop at finished session of game */
+		if (s_list[sid].gid == gid && s_list[sid].state == SS_DONE) break;
 	}
 
+	/* Check for session not found */
+	if (sid == num_session) return;
+
+	/* Get session pointer */
+	s_ptr = &s_list[sid];
+
 	/* Create file name */
 	sprintf(filename, "%s/Game_%06d.xml", export_folder, s_ptr->gid);
 
@@ -1039,6 +1256,12 @@ static void db_save_results(int sid)
 		/* Log export location */
 		server_log("Game exported to %s", filename);
 	}
+
+	/* Mark game as saved */
+	s_ptr->saved = 1;
+
+	/* Wake game task waiting for save */
+	wake_task(s_ptr);
 }
 
 /*
@@ -1046,312 +1269,729 @@ static void db_save_results(int sid)
  */
 static void db_save_message(int sid, int uid, char* txt, char* tag)
 {
-	char query[1024];
-	char etxt[1024], etag[1024];
+	store_write w;
 
 	/* Do not save message if game is replaying */
 	if (s_list[sid].replaying) return;
 
-	/* Escape message and format */
-	mysql_real_escape_string(mysql, etxt, txt, strlen(txt));
-	mysql_real_escape_string(mysql, etag, tag, strlen(tag));
-
-	/* Create insertion query */
-	sprintf(query, "INSERT INTO messages (gid, uid, message, format) \
-	                VALUES (%d, %d, '%s', '%s')",
-	        s_list[sid].gid, uid, etxt, etag);
-
-	/* Send query */
-	mysql_query(mysql, query);
+	/* Set game, user, text and format */
+	db_clear(&w, STORE_MESSAGE, s_list[sid].gid, uid);
+	w.data[0] = strdup(txt);
+	w.data[1] = strdup(tag);
 
-	/* Check for error */
-	if (*mysql_error(mysql))
-	{
-		/* Print error */
-		server_log("%s", mysql_error(mysql));
-		exit(1);
-	}
+	/* Queue row */
+	db_queue(DB_ROWS, &w);
 }
 
 /*
- * Replays game messages to a client.
+ * Run queued database writes.
+ *
+ * This function runs in the writer thread.
  */
-static void replay_messages(int gid, int cid)
+static void *run_db_writer(void *arg)
 {
-	MYSQL_RES *res;
-	MYSQL_ROW row;
-	char query[1024];
-	char msg[BUF_LEN], name[1024], *ptr;
+	db_write batch[DB_BATCH_MAX];
+	store_write list[DB_BATCH_MAX];
+	int i, n;
 
-	/* Create lookup query */
-	sprintf(query, "SELECT message, format, user "
-	               "FROM messages LEFT JOIN users USING (uid) "
-	               "WHERE gid=%d AND (uid=%d OR uid=-1 OR format='%s') "
-	               "ORDER BY mid",
-	               gid, c_list[cid].uid, FORMAT_CHAT);
+	/* Connect writer thread to database */
+	if (storage->connect() < 0) exit(1);
 
-	/* Run query */
-	mysql_query(mysql, query);
+	/* Loop forever */
+	while (1)
+	{
+		/* Grab database queue mutex */
+		pthread_mutex_lock(&db_mutex);
 
-	/* Fetch results */
-	res = mysql_store_result(mysql);
+		/* Wait for writes */
+		while (!db_len) pthread_cond_wait(&db_cond, &db_mutex);
 
-	/* Loop over rows returned */
-	while ((row = mysql_fetch_row(res)))
-	{
-		/* Reset message */
-		ptr = msg;
+		/* Start with no writes taken */
+		n = 0;
 
-		/* Check for no format */
-		if (!strlen(row[1]))
+		/* Take first write, and writes following up to any job */
+		do
 		{
-			/* Create log message */
-			start_msg(&ptr, MSG_LOG);
+			/* Take write from front of queue */
+			batch[n++] = db_list[db_head];
+			db_head = (db_head + 1) & (db_size - 1);
+			db_len--;
 
-			/* Add text of message */
-			put_string(row[0], &ptr);
+		} while (batch[0].type > DB_REPLAY && db_len && n < DB_BATCH_MAX &&
+		         db_list[db_head].type > DB_REPLAY);
 
-			/* Finish message */
-			finish_msg(msg, ptr);
+		/* Release database queue mutex */
+		pthread_mutex_unlock(&db_mutex);
 
-			/* Send to client */
-			send_msg(cid, msg);
+		/* Check for finished game to export */
+		if (batch[0].type == DB_EXPORT)
+		{
+			/* Export game */
+			db_export(batch[0].w.gid);
 		}
 
-		/* Check for chat message */
-		else if (!strcmp(row[1], FORMAT_CHAT))
+		/* Check for game log to replay */
+		else if (batch[0].type == DB_REPLAY)
+		{
+			/* Load log and fill in message */
+			db_replay(batch[0].w.gid, batch[0].w.uid, batch[0].w.num[0],
+			          batch[0].fill);
+		}
+		else
 		{
-			/* Check for global message */
-			if (!row[2])
+			/* Loop over writes */
+			for (i = 0; i < n; i++)
 			{
-				/* Set empty user name */
-				strcpy(name, "");
+				/* Add write to list */
+				list[i] = batch[i].w;
 			}
-			else
+
+			/* Do writes */
+			storage->write(list, n);
+
+			/* Loop over writes */
+			for (i = 0; i < n; i++)
 			{
-				/* Copy user name */
-				strcpy(name, row[2]);
+				/* Free data not kept by backend */
+				free(list[i].data[0]);
+				free(list[i].data[1]);
 			}
+		}
+	}
+
+	/* Not reached */
+	return NULL;
+}
 
-			/* Create log message */
-			start_msg(&ptr, MSG_GAMECHAT);
+/*
+ * Create a shared message from a finished message buffer.
+ *
+ * The caller holds one reference, and must release it when done queueing.
+ */
+static out_msg *new_msg(char *msg)
+{
+	out_msg *m;
+	int size;
+	char *ptr;
 
-			/* Copy user sending chat to message */
-			put_string(name, &ptr);
+	/* Go to size area of message */
+	ptr = msg + 4;
 
-			/* Copy chat text to message */
-			put_string(row[0], &ptr);
+	/* Read size */
+	get_integer(&size, msg, HEADER_LEN, &ptr);
 
-			/* Finish message */
-			finish_msg(msg, ptr);
+	/* Allocate message */
+	m = (out_msg *)malloc(sizeof(out_msg) + size);
 
-			/* Send to client */
-			send_msg(cid, msg);
-		}
+	/* Caller holds the only reference */
+	m->refs = 1;
 
-		/* Formatted message */
-		else
-		{
-			/* Create log message */
-			start_msg(&ptr, MSG_LOG_FORMAT);
+	/* Copy message */
+	m->len = size;
+	m->ready = 1;
+	m->ptr = m->data;
+	memcpy(m->data, msg, size);
 
-			/* Add text of message */
-			put_string(row[0], &ptr);
+	/* Return message */
+	return m;
+}
 
-			/* Add format of message */
-			put_string(row[1], &ptr);
+/*
+ * Create a shared formatted message.
+ */
+static out_msg *new_msgf(int type, char *fmt, ...)
+{
+	char msg[BUF_LEN];
+	va_list ap;
 
-			/* Finish message */
-			finish_msg(msg, ptr);
+	/* Start processing variable arguments */
+	va_start(ap, fmt);
 
-			/* Send to client */
-			send_msg(cid, msg);
-		}
+	/* Build message */
+	format_msgv(msg, type, fmt, ap);
+
+	/* Stop processing arguments */
+	va_end(ap);
+
+	/* Create shared copy */
+	return new_msg(msg);
+}
+
+/*
+ * Drop a reference to a shared message, and free it once unused.
+ */
+static void release_msg(out_msg *m)
+{
+	/* Check for last reference */
+	if (!__sync_sub_and_fetch(&m->refs, 1))
+	{
+		/* Free data filled in separately */
+		if (m->ptr != m->data) free(m->ptr);
+
+		/* Free message */
+		free(m);
+	}
+}
+
+/*
+ * Release every message queued on a connection.
+ *
+ * The connection mutex must be held.
+ */
+static void clear_queue(conn *c)
+{
+	/* Loop over queued messages */
+	for ( ; c->out_num > 0; c->out_num--)
+	{
+		/* Release message */
+		release_msg(c->out_q[c->out_first]);
+
+		/* Advance to next message */
+		c->out_first = (c->out_first + 1) & (c->out_size - 1);
 	}
 
-	/* Free results */
-	mysql_free_result(res);
+	/* Start queue over */
+	c->out_first = 0;
+	c->out_sent = 0;
+	c->out_bytes = 0;
+	c->overflow = 0;
 }
 
 /*
- * Send a message to a client.
+ * Check whether a client is too far behind to be sent optional updates.
  */
-void send_msg(int cid, char *msg)
+static int conn_behind(int cid)
 {
 	conn *c;
-	int size, x;
-	char *ptr;
+	int behind;
 
 	/* Ensure valid connection */
-	if (cid < 0) return;
+	if (cid < 0) return 0;
 
 	/* Get connection pointer */
 	c = &c_list[cid];
 
-	/* Check for kicked player */
-	if (c->fd < 0) return;
+	/* Grab mutex for connection */
+	pthread_mutex_lock(&c->conn_mutex);
 
-	/* Go to size area of message */
-	ptr = msg + 4;
+	/* Check amount of data not yet sent */
+	behind = c->out_bytes > OUT_HIGH_WATER;
 
-	/* Read size */
-	get_integer(&size, msg, HEADER_LEN, &ptr);
+	/* Release connection mutex */
+	pthread_mutex_unlock(&c->conn_mutex);
 
-	/* Grab mutex for connection */
-	pthread_mutex_lock(&c->conn_mutex);
+	/* Return result */
+	return behind;
+}
+
+/*
+ * Send as much of a connection's queued messages as the socket will take.
+ *
+ * The connection mutex must be held.
+ */
+static void write_conn(conn *c)
+{
+	struct iovec iov[MAX_IOV];
+	out_msg *m;
+	int i, n, x, mask = c->out_size - 1;
 
-	/* Check for insufficient buffer size to hold message */
-	if (c->out_size < c->out_len + size)
+	/* Loop while data remains and socket has room */
+	while (c->fd > 0 && c->out_num > 0 && c->writable)
 	{
-		/* Reallocate buffer */
-		c->out_buf = (char *)realloc(c->out_buf, c->out_len + size);
-	}
+		/* Count messages to send at once */
+		n = c->out_num < MAX_IOV ? c->out_num : MAX_IOV;
 
-	/* Copy current message to end of buffer */
-	memcpy(c->out_buf + c->out_len, msg, size);
+		/* Loop over messages */
+		for (i = 0; i < n; i++)
+		{
+			/* Get message */
+			m = c->out_q[(c->out_first + i) & mask];
 
-	/* Add to current buffer length */
-	c->out_len += size;
+			/* Stop at message not yet filled in */
+			if (!m->ready) break;
 
-	/* Attempt to send full amount of buffer */
-	x = send(c->fd, c->out_buf, c->out_len, 0);
+			/* Point at message data */
+			iov[i].iov_base = m->ptr;
+			iov[i].iov_len = m->len;
+		}
 
-	/* Check for errors */
-	if (x < 0)
-	{
-		/* Check for try again error */
-		if (errno == EAGAIN || errno == EWOULDBLOCK)
+		/* Check for nothing ready to send */
+		if (!i) return;
+
+		/* Send only messages ready */
+		n = i;
+
+		/* Skip part of first message already sent */
+		iov[0].iov_base = (char *)iov[0].iov_base + c->out_sent;
+		iov[0].iov_len -= c->out_sent;
+
+		/* Attempt to send all of them */
+		x = writev(c->fd, iov, n);
+
+		/* Check for errors */
+		if (x < 0)
 		{
-			/* Release mutex */
-			pthread_mutex_unlock(&c->conn_mutex);
+			/* Check for try again error */
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				/* Wait until socket is writable again */
+				c->writable = 0;
+				return;
+			}
+
+			/* Print error */
+			perror("writev");
 			return;
 		}
 
-		/* Print error */
-		perror("send");
+		/* Remove sent bytes from total */
+		c->out_bytes -= x;
 
-		/* Release mutex */
-		pthread_mutex_unlock(&c->conn_mutex);
-		return;
+		/* Count part of first message already sent */
+		x += c->out_sent;
+
+		/* Loop over messages sent completely */
+		while (c->out_num > 0 && c->out_q[c->out_first]->ready &&
+		       x >= c->out_q[c->out_first]->len)
+		{
+			/* Get message */
+			m = c->out_q[c->out_first];
+
+			/* Remove from queue */
+			c->out_first = (c->out_first + 1) & mask;
+			c->out_num--;
+			x -= m->len;
+
+			/* Release message */
+			release_msg(m);
+		}
+
+		/* Remember part of next message sent */
+		c->out_sent = x;
 	}
+}
+
+/*
+ * Send unsent data of a connection now.
+ */
+static void flush_conn(int cid)
+{
+	conn *c = &c_list[cid];
 
-	/* Reduce buffer length by amount sent */
-	c->out_len -= x;
+	/* Grab mutex for connection */
+	pthread_mutex_lock(&c->conn_mutex);
 
-	/* Shift buffer */
-	memmove(c->out_buf, c->out_buf + x, c->out_len);
+	/* Send data */
+	write_conn(c);
 
 	/* Release connection mutex */
 	pthread_mutex_unlock(&c->conn_mutex);
 }
 
 /*
- * Create a new AI client connection.
+ * Send unsent data of every connection that has queued some.
+ *
+ * Connections whose queue overflowed are disconnected here, so that it is
+ * always the event loop that closes them.
  */
-static int new_ai_client(int sid)
+static void flush_pending(void)
 {
-	int fds[2];
-	int i;
+	int list[MAX_CONN], n, i, overflow;
+	conn *c;
 
-	/* Loop through current list looking for an empty spot */
-	for (i = 0; i < num_conn; i++)
+	/* Loop until no more output is queued */
+	while (1)
 	{
-		/* Stop at empty connection */
-		if (c_list[i].state == CS_EMPTY ||
-		    c_list[i].state == CS_DISCONN) break;
-	}
+		/* Grab pending list mutex */
+		pthread_mutex_lock(&pending_mutex);
 
-	/* Check for end of list reached */
-	if (i == num_conn)
-	{
-		/* Increase count of active connections */
-		num_conn++;
-	}
+		/* Take list of connections */
+		n = num_pending;
+		memcpy(list, pending, sizeof(int) * n);
+		num_pending = 0;
 
-	/* Set connection state */
-	c_list[i].state = CS_PLAYING;
+		/* Release pending list mutex */
+		pthread_mutex_unlock(&pending_mutex);
 
-	/* Create a socket pair to communicate with AI client */
-	socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+		/* Check for nothing left */
+		if (!n) break;
 
-	/* Fork a child process */
-	switch (fork())
-	{
-		/* Error */
-		case -1:
+		/* Loop over connections */
+		for (i = 0; i < n; i++)
+		{
+			/* Get connection pointer */
+			c = &c_list[list[i]];
 
-			/* Print error */
-			perror("fork");
-			exit(1);
+			/* Grab mutex for connection */
+			pthread_mutex_lock(&c->conn_mutex);
 
-		/* Child */
-		case 0:
+			/* Connection may be queued again */
+			c->queued = 0;
 
-			/* Close our copy of one end of socket */
-			close(fds[0]);
+			/* Check for overflowed queue */
+			overflow = c->overflow && c->fd > 0;
 
-			/* Close standard input */
-			close(0);
+			/* Send data */
+			write_conn(c);
 
-			/* Move socket to FD zero */
-			dup2(fds[1], 0);
+			/* Release connection mutex */
+			pthread_mutex_unlock(&c->conn_mutex);
 
-			/* Check for local binary */
-			if (access("./ai_client", X_OK) != -1)
-			{
-				/* Execute AI client program from local folder */
-				execl("./ai_client", "ai_client", NULL);
-			}
-			else
+			/* Drop client that cannot keep up */
+			if (overflow && c->state != CS_DISCONN)
 			{
-				/* Execute AI client program from bin folder */
-				execl(BINDIR "/ai_client", "ai_client", NULL);
+				/* Kick player */
+				kick_player(list[i], "Too much unsent data");
 			}
-
-			/* XXX */
-			perror("execlp");
-			exit(1);
-
-		/* Server */
-		default:
-
-			/* Close our copy of one end of socket */
-			close(fds[1]);
-
-			/* Remember socket */
-			c_list[i].fd = fds[0];
-			break;
+		}
 	}
+}
 
-	/* Mark connection as AI */
-	c_list[i].ai = 1;
+/*
+ * Queue a connection for the event loop to send its output.
+ *
+ * The connection mutex must be held.  Return true if the event loop must
+ * be woken.
+ */
+static int pend_conn(int cid)
+{
+	conn *c = &c_list[cid];
+	int wake;
 
-	/* Mark session ID of connection */
-	c_list[i].sid = sid;
+	/* Check for connection already queued */
+	if (c->queued) return 0;
 
-	/* Reset timeout information */
-	c_list[i].last_active = c_list[i].last_seen = time(NULL);
+	/* Mark connection */
+	c->queued = 1;
 
-	/* Clear buffer length */
-	c_list[i].buf_full = 0;
+	/* Grab pending list mutex */
+	pthread_mutex_lock(&pending_mutex);
 
-	/* Clear outgoing buffer length */
-	c_list[i].out_len = 0;
+	/* Add connection to list */
+	pending[num_pending++] = cid;
 
-	/* Clear username */
-	strcpy(c_list[i].user, "AI client");
+	/* Wake event loop if it may be waiting */
+	wake = num_pending == 1 && !pthread_equal(pthread_self(), main_thread);
 
-	/* Set version */
-	strcpy(c_list[i].version, RELEASE);
+	/* Release pending list mutex */
+	pthread_mutex_unlock(&pending_mutex);
 
-	/* Return connection index */
-	return i;
+	/* Return whether to wake */
+	return wake;
 }
 
 /*
- * Send information about a player to all clients.
+ * Add a shared message to a client's queue.
+ *
+ * The message is added to the connection's outgoing ring, and the
+ * connection is queued for the event loop to send.  Messages added while
+ * handling one event are sent together.
+ *
+ * A client that lets OUT_LIMIT bytes pile up is marked to be dropped.
  */
-static void send_player_one(int dest, int who)
+static void queue_msg(int cid, out_msg *m)
+{
+	conn *c;
+	out_msg **q;
+	int i, wake;
+
+	/* Ensure valid connection */
+	if (cid < 0) return;
+
+	/* Get connection pointer */
+	c = &c_list[cid];
+
+	/* Check for kicked player */
+	if (c->fd < 0) return;
+
+	/* Grab mutex for connection */
+	pthread_mutex_lock(&c->conn_mutex);
+
+	/* Check for queue past limit */
+	if (c->overflow || c->out_bytes + m->len > OUT_LIMIT)
+	{
+		/* Drop connection once event loop gets to it */
+		c->overflow = 1;
+	}
+
+	/* Check for full ring */
+	else if (c->out_num == c->out_size)
+	{
+		/* Create ring of double size */
+		i = c->out_size ? c->out_size * 2 : 64;
+		q = (out_msg **)malloc(sizeof(out_msg *) * i);
+
+		/* Loop over queued messages */
+		for (i = 0; i < c->out_num; i++)
+		{
+			/* Copy message in order */
+			q[i] = c->out_q[(c->out_first + i) & (c->out_size - 1)];
+		}
+
+		/* Replace old ring */
+		free(c->out_q);
+		c->out_q = q;
+		c->out_size = c->out_size ? c->out_size * 2 : 64;
+		c->out_first = 0;
+	}
+
+	/* Check for room to queue message */
+	if (!c->overflow)
+	{
+		/* Take reference to message */
+		__sync_add_and_fetch(&m->refs, 1);
+
+		/* Add message to end of ring */
+		c->out_q[(c->out_first + c->out_num++) &
+		         (c->out_size - 1)] = m;
+
+		/* Count unsent bytes */
+		c->out_bytes += m->len;
+	}
+
+	/* Queue connection for event loop */
+	wake = pend_conn(cid);
+
+	/* Release connection mutex */
+	pthread_mutex_unlock(&c->conn_mutex);
+
+	/* Check for event loop to wake */
+	if (wake)
+	{
+		/* Signal pending output */
+		eventfd_write(wake_fd, 1);
+	}
+}
+
+/*
+ * Fill in a message queued before its data was known.
+ *
+ * The caller's reference to the message is released.
+ */
+static void fill_msg(int cid, out_msg *m, char *data, int len)
+{
+	conn *c = &c_list[cid];
+	int i, wake = 0;
+
+	/* Grab mutex for connection */
+	pthread_mutex_lock(&c->conn_mutex);
+
+	/* Set message data */
+	m->ptr = data;
+	m->len = len;
+	m->ready = 1;
+
+	/* Loop over queued messages */
+	for (i = 0; i < c->out_num; i++)
+	{
+		/* Stop at message */
+		if (c->out_q[(c->out_first + i) & (c->out_size - 1)] == m) break;
+	}
+
+	/* Check for message still queued */
+	if (i < c->out_num)
+	{
+		/* Check for queue past limit */
+		if (c->out_bytes + len > OUT_LIMIT)
+		{
+			/* Drop connection once event loop gets to it */
+			c->overflow = 1;
+		}
+
+		/* Count unsent bytes */
+		c->out_bytes += len;
+
+		/* Queue connection for event loop */
+		wake = pend_conn(cid);
+	}
+
+	/* Release connection mutex */
+	pthread_mutex_unlock(&c->conn_mutex);
+
+	/* Check for event loop to wake */
+	if (wake)
+	{
+		/* Signal pending output */
+		eventfd_write(wake_fd, 1);
+	}
+
+	/* Release our reference */
+	release_msg(m);
+}
+
+/*
+ * Send a message to a client.
+ */
+void send_msg(int cid, char *msg)
+{
+	out_msg *m;
+
+	/* Ensure valid connection */
+	if (cid < 0 || c_list[cid].fd < 0) return;
+
+	/* Create shared message */
+	m = new_msg(msg);
+
+	/* Queue message */
+	queue_msg(cid, m);
+
+	/* Release our reference */
+	release_msg(m);
+}
+
+/*
+ * Add a saved game message to a log being replayed.
+ *
+ * This function runs in the writer thread.
+ */
+static void replay_message(void *arg, char *message, char *format,
+                           char *user)
+{
+	replay_log *l_ptr = (replay_log *)arg;
+	char msg[BUF_LEN], *ptr = msg;
+	int size;
+
+	/* Check for no format */
+	if (!strlen(format))
+	{
+		/* Create log message */
+		start_msg(&ptr, MSG_LOG);
+
+		/* Add text of message */
+		put_string(message, &ptr);
+	}
+
+	/* Check for chat message */
+	else if (!strcmp(format, FORMAT_CHAT))
+	{
+		/* Create log message */
+		start_msg(&ptr, MSG_GAMECHAT);
+
+		/* Copy user sending chat to message, if any */
+		put_string(user ? user : "", &ptr);
+
+		/* Copy chat text to message */
+		put_string(message, &ptr);
+	}
+
+	/* Formatted message */
+	else
+	{
+		/* Create log message */
+		start_msg(&ptr, MSG_LOG_FORMAT);
+
+		/* Add text of message */
+		put_string(message, &ptr);
+
+		/* Add format of message */
+		put_string(format, &ptr);
+	}
+
+	/* Finish message */
+	finish_msg(msg, ptr);
+
+	/* Go to size area of message */
+	ptr = msg + 4;
+
+	/* Read size */
+	get_integer(&size, msg, HEADER_LEN, &ptr);
+
+	/* Check for full buffer */
+	if (l_ptr->len + size > l_ptr->size)
+	{
+		/* Make room for message, doubling buffer */
+		l_ptr->size = 2 * (l_ptr->len + size);
+		l_ptr->data = (char *)realloc(l_ptr->data, l_ptr->size);
+	}
+
+	/* Add message to log */
+	memcpy(l_ptr->data + l_ptr->len, msg, size);
+	l_ptr->len += size;
+}
+
+/*
+ * Load game messages seen by a user, and fill in a message to a client
+ * with them.
+ *
+ * This function runs in the writer thread, after every message queued
+ * before the replay was asked for has been written.
+ */
+static void db_replay(int gid, int uid, int cid, out_msg *m)
+{
+	replay_log log;
+
+	/* Start with empty log */
+	log.data = NULL;
+	log.len = log.size = 0;
+
+	/* Add messages seen by user */
+	storage->load_messages(gid, uid, replay_message, &log);
+
+	/* Hand log to client */
+	fill_msg(cid, m, log.data, log.len);
+}
+
+/*
+ * Replay game messages to a client.
+ *
+ * A message to be filled in later is queued now, so that the log is sent
+ * ahead of anything queued after it, and the writer thread loads the log
+ * once the game's waiting messages are saved.
+ */
+static void replay_messages(int sid, int cid)
+{
+	store_write w;
+	out_msg *m;
+
+	/* Create empty message */
+	m = (out_msg *)malloc(sizeof(out_msg));
+
+	/* One reference for us, handed to the writer thread */
+	m->refs = 1;
+
+	/* Message is not filled in yet */
+	m->len = 0;
+	m->ready = 0;
+	m->ptr = NULL;
+
+	/* Hold place in client's queue */
+	queue_msg(cid, m);
+
+	/* Set game, user and connection */
+	db_clear(&w, -1, s_list[sid].gid, c_list[cid].uid);
+	w.num[0] = cid;
+
+	/* Have writer thread load log */
+	db_add(DB_REPLAY, &w, m);
+}
+
+
+/*
+ * Add a connection's socket to the event loop.
+ */
+static void watch_conn(int cid)
+{
+	struct epoll_event ev;
+
+	/* Watch for data and room to send, reported on changes */
+	ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+	ev.data.u32 = cid;
+
+	/* New socket has room to send */
+	c_list[cid].writable = 1;
+
+	/* Add socket */
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, c_list[cid].fd, &ev) < 0)
+	{
+		/* Print error */
+		perror("epoll_ctl");
+	}
+}
+
+/*
+ * Send information about a player to all clients.
+ */
+static void send_player_one(int dest, int who)
 {
 	/* Check for disconnected player */
 	if (c_list[who].state == CS_DISCONN)
@@ -1374,8 +2014,22 @@ static void send_player_one(int dest, int who)
  */
 static void send_player(int who)
 {
+	out_msg *m;
 	int i;
 
+	/* Check for disconnected player */
+	if (c_list[who].state == CS_DISCONN)
+	{
+		/* Create "player left" message */
+		m = new_msgf(MSG_PLAYER_LEFT, "s", c_list[who].user);
+	}
+	else
+	{
+		/* Create "new player" message as seen by others */
+		m = new_msgf(MSG_PLAYER_NEW, "sdd", c_list[who].user,
+		             c_list[who].state == CS_PLAYING, 0);
+	}
+
 	/* Loop over connections */
 	for (i = 0; i < num_conn; i++)
 	{
@@ -1383,12 +2037,20 @@ static void send_player(int who)
 		if (c_list[i].state != CS_LOBBY &&
 		    c_list[i].state != CS_PLAYING) continue;
 
-		/* Skip AI connections */
-		if (c_list[i].ai) continue;
+		/* Check for player being told about themself */
+		if (i == who)
+		{
+			/* Send own information */
+			send_player_one(i, who);
+			continue;
+		}
 
-		/* Send information */
-		send_player_one(i, who);
+		/* Send shared message */
+		queue_msg(i, m);
 	}
+
+	/* Release our reference */
+	release_msg(m);
 }
 
 /*
@@ -1405,50 +2067,65 @@ static void send_all_players(int dest)
 		if (c_list[i].state != CS_LOBBY &&
 		    c_list[i].state != CS_PLAYING) continue;
 
-		/* Skip AI connections */
-		if (c_list[i].ai) continue;
-
 		/* Send to player */
 		send_player_one(dest, i);
 	}
 }
 
 /*
- * Send information about an open game to a client.
+ * Messages about a session, built once and shared by the clients they are
+ * sent to.
+ *
+ * Messages that differ for the client they concern have a second version
+ * for that client.
  */
-static void send_session_one(int sid, int cid)
+typedef struct session_msgs
+{
+	/* Game description, as seen by others and by its creator */
+	out_msg *game[2];
+
+	/* Player spots, as seen by others and by the player in the spot */
+	out_msg *spot[MAX_PLAYER][2];
+
+} session_msgs;
+
+/*
+ * Build the messages describing a session.
+ */
+static void build_session_msgs(int sid, session_msgs *sm)
 {
 	session *s_ptr = &s_list[sid];
 	char name[1024];
-	int i;
+	int i, k;
 
-	/*
-	 * Do not advertise XI and RVIO games to clients not supporting XI
-	 */
-	if ((s_ptr->expanded == EXP_XI || s_ptr->expanded == EXP_RVIO) &&
-	        strcmp(c_list[cid].version, "0.9.5") < 0)
-		return;
+	/* Clear messages */
+	memset(sm, 0, sizeof(session_msgs));
 
 	/* Check for game not in waiting status */
 	if (s_ptr->state != SS_WAITING)
 	{
-		/* Tell client that game is closed */
-		send_msgf(cid, MSG_CLOSE_GAME, "d", sid);
+		/* Tell clients that game is closed */
+		sm->game[0] = new_msgf(MSG_CLOSE_GAME, "d", sid);
 
 		/* Done */
 		return;
 	}
 
 	/* Get username of game creator */
-	db_user_name(s_ptr->created, name);
+	storage->user_name(s_ptr->created, name);
 
-	/* Send message to client */
-	send_msgf(cid, MSG_OPENGAME, "dssddddddddd",
-	          sid, s_ptr->desc, name, strlen(s_ptr->pass) > 0,
-	          s_ptr->min_player, s_ptr->max_player,
-	          s_ptr->expanded, s_ptr->advanced, s_ptr->disable_goal,
-	          s_ptr->disable_takeover, s_ptr->speed,
-	          c_list[cid].uid == s_ptr->created);
+	/* Loop over versions */
+	for (k = 0; k < 2; k++)
+	{
+		/* Create game message */
+		sm->game[k] = new_msgf(MSG_OPENGAME, "dssddddddddd",
+		                       sid, s_ptr->desc, name,
+		                       strlen(s_ptr->pass) > 0,
+		                       s_ptr->min_player, s_ptr->max_player,
+		                       s_ptr->expanded, s_ptr->advanced,
+		                       s_ptr->disable_goal,
+		                       s_ptr->disable_takeover, s_ptr->speed, k);
+	}
 
 	/* Loop over player spots */
 	for (i = 0; i < MAX_PLAYER; i++)
@@ -1456,32 +2133,119 @@ static void send_session_one(int sid, int cid)
 		/* Check for empty player */
 		if (i >= s_ptr->num_users)
 		{
-			/* Send empty player spot */
-			send_msgf(cid, MSG_GAME_PLAYER, "ddsdd",
-			          sid, i, "", 0, 0);
+			/* Create empty player spot */
+			sm->spot[i][0] = new_msgf(MSG_GAME_PLAYER, "ddsdd",
+			                          sid, i, "", 0, 0);
 
 			/* Next spot */
 			continue;
 		}
 
 		/* Get user name for player */
-		db_user_name(s_ptr->uids[i], name);
+		storage->user_name(s_ptr->uids[i], name);
+
+		/* Loop over versions */
+		for (k = 0; k < 2; k++)
+		{
+			/* Skip own version of spot without a connection */
+			if (k && s_ptr->cids[i] < 0) break;
+
+			/* Create message about joined player */
+			sm->spot[i][k] = new_msgf(MSG_GAME_PLAYER, "ddsdd",
+			                          sid, i, name,
+			                          s_ptr->ai_control[i] ||
+			                          s_ptr->cids[i] != -1, k);
+		}
+	}
+}
+
+/*
+ * Release the messages describing a session.
+ */
+static void free_session_msgs(session_msgs *sm)
+{
+	int i, k;
 
-		/* Send message about joined player */
-		send_msgf(cid, MSG_GAME_PLAYER, "ddsdd",
-		          sid, i, name,
-		          s_ptr->ai_control[i] || s_ptr->cids[i] != -1,
-		          s_ptr->cids[i] == cid);
+	/* Loop over versions */
+	for (k = 0; k < 2; k++)
+	{
+		/* Release game message */
+		if (sm->game[k]) release_msg(sm->game[k]);
+
+		/* Loop over player spots */
+		for (i = 0; i < MAX_PLAYER; i++)
+		{
+			/* Release spot message */
+			if (sm->spot[i][k]) release_msg(sm->spot[i][k]);
+		}
+	}
+}
+
+/*
+ * Send the messages describing a session to a client.
+ */
+static void send_session_msgs(int sid, session_msgs *sm, int cid)
+{
+	session *s_ptr = &s_list[sid];
+	int i;
+
+	/*
+	 * Do not advertise XI and RVIO games to clients not supporting XI
+	 */
+	if ((s_ptr->expanded == EXP_XI || s_ptr->expanded == EXP_RVIO) &&
+	        strcmp(c_list[cid].version, "0.9.5") < 0)
+		return;
+
+	/* Check for game not in waiting status */
+	if (s_ptr->state != SS_WAITING)
+	{
+		/* Tell client that game is closed */
+		queue_msg(cid, sm->game[0]);
+
+		/* Done */
+		return;
+	}
+
+	/* Send game, as seen by creator if this is them */
+	queue_msg(cid, sm->game[c_list[cid].uid == s_ptr->created]);
+
+	/* Loop over player spots */
+	for (i = 0; i < MAX_PLAYER; i++)
+	{
+		/* Send spot, as seen by its player if this is them */
+		queue_msg(cid, sm->spot[i][i < s_ptr->num_users &&
+		                           s_ptr->cids[i] == cid]);
 	}
 }
 
+/*
+ * Send information about an open game to a client.
+ */
+static void send_session_one(int sid, int cid)
+{
+	session_msgs sm;
+
+	/* Build messages */
+	build_session_msgs(sid, &sm);
+
+	/* Send them */
+	send_session_msgs(sid, &sm, cid);
+
+	/* Release messages */
+	free_session_msgs(&sm);
+}
+
 /*
  * Send information about a session to every connected player.
  */
 static void send_session(int sid)
 {
+	session_msgs sm;
 	int cid;
 
+	/* Build messages once for everyone */
+	build_session_msgs(sid, &sm);
+
 	/* Loop over connections */
 	for (cid = 0; cid < num_conn; cid++)
 	{
@@ -1489,12 +2253,12 @@ static void send_session(int sid)
 		if (c_list[cid].state != CS_LOBBY &&
 		    c_list[cid].state != CS_PLAYING) continue;
 
-		/* Skip AI connections */
-		if (c_list[cid].ai) continue;
-
 		/* Send game state */
-		send_session_one(sid, cid);
+		send_session_msgs(sid, &sm, cid);
 	}
+
+	/* Release messages */
+	free_session_msgs(&sm);
 }
 
 /*
@@ -1522,8 +2286,12 @@ static void send_open_sessions(int cid)
 static void send_to_session(int sid, char *msg)
 {
 	session *s_ptr = &s_list[sid];
+	out_msg *m;
 	int i, cid;
 
+	/* Create message shared by all clients */
+	m = new_msg(msg);
+
 	/* Loop over users in a session */
 	for (i = 0; i < s_ptr->num_users; i++)
 	{
@@ -1534,8 +2302,11 @@ static void send_to_session(int sid, char *msg)
 		if (cid < 0) continue;
 
 		/* Send to client */
-		send_msg(cid, msg);
+		queue_msg(cid, m);
 	}
+
+	/* Release our reference */
+	release_msg(m);
 }
 
 /*
@@ -1579,6 +2350,9 @@ void message_add(game *g, char *txt)
 {
 	char msg[1024], *ptr = msg;
 
+	/* Ignore messages from copies of the game made for the AI */
+	if (g != &s_list[g->session_id].g) return;
+
 	/* Save message to db */
 	db_save_message(g->session_id, -1, txt, "");
 
@@ -1602,6 +2376,9 @@ void message_add_formatted(game *g, char *txt, char *tag)
 {
 	char msg[1024], *ptr = msg;
 
+	/* Ignore messages from copies of the game made for the AI */
+	if (g != &s_list[g->session_id].g) return;
+
 	/* Check for no tag */
 	if (!tag || !strlen(tag))
 	{
@@ -1630,29 +2407,91 @@ void message_add_formatted(game *g, char *txt, char *tag)
 }
 
 /*
- * Wait for player to have an answer ready.
+ * Add a game task to the run queue.
+ *
+ * The run mutex must be held.
  */
-static void server_wait(game *g, int who)
+static void queue_task(session *s_ptr)
 {
-	session *s_ptr;
+	/* Check for task already queued */
+	if (s_ptr->queued) return;
 
-	/* Do not wait for in simulated game */
-	if (g->simulation) return;
+	/* Add to end of queue */
+	run_queue[(run_head + run_len++) % MAX_SESSION] = s_ptr - s_list;
 
-	/* Get session pointer */
-	s_ptr = &s_list[g->session_id];
+	/* Mark task */
+	s_ptr->queued = 1;
 
-	/* Check if we are waiting on player */
-	if (s_ptr->waiting[who])
-	{
-		/* Wait until player is ready */
-		while (s_ptr->waiting[who])
-		{
+	/* Wake a worker */
+	pthread_cond_signal(&run_cond);
+}
+
+/*
+ * Wake a game task waiting for a reply.
+ */
+static void wake_task(session *s_ptr)
+{
+	/* Grab run mutex */
+	pthread_mutex_lock(&run_mutex);
+
+	/* Check for task still running */
+	if (s_ptr->running)
+	{
+		/* Have worker queue it again once it stops */
+		s_ptr->woken = 1;
+	}
+	else
+	{
+		/* Queue task */
+		queue_task(s_ptr);
+	}
+
+	/* Release run mutex */
+	pthread_mutex_unlock(&run_mutex);
+}
+
+/*
+ * Suspend the current game task until woken, giving its worker back to
+ * other sessions.
+ *
+ * The session mutex must be held, and is held again on return.
+ */
+static void suspend_task(session *s_ptr)
+{
+	/* Release session mutex */
+	pthread_mutex_unlock(&s_ptr->session_mutex);
+
+	/* Return to worker */
+	swapcontext(&s_ptr->task, s_ptr->worker);
+
+	/* Acquire session mutex again (possibly from another worker) */
+	pthread_mutex_lock(&s_ptr->session_mutex);
+}
+
+/*
+ * Wait for player to have an answer ready.
+ */
+static void server_wait(game *g, int who)
+{
+	session *s_ptr;
+
+	/* Do not wait for in simulated game */
+	if (g->simulation) return;
+
+	/* Get session pointer */
+	s_ptr = &s_list[g->session_id];
+
+	/* Check if we are waiting on player */
+	if (s_ptr->waiting[who])
+	{
+		/* Wait until player is ready */
+		while (s_ptr->waiting[who])
+		{
 			/* Log message */
 			server_log("S:%d waiting on player %d", g->session_id, who);
 
-			/* Wait for signal */
-			pthread_cond_wait(&s_ptr->wait_cond, &s_ptr->session_mutex);
+			/* Wait to be woken */
+			suspend_task(s_ptr);
 		}
 
 		/* Log message */
@@ -1710,16 +2549,16 @@ static void init_random_pool(int sid)
 /*
  * More complex random number generator for multiplayer games.
  *
- * Call simple RNG in simulated games, otherwise use the results from the
- * system RNG saved per session.
+ * Call simple RNG in simulated games and copies of the game made for the
+ * AI, otherwise use the results from the system RNG saved per session.
  */
 int game_rand(game *g)
 {
 	session *s_ptr = &s_list[g->session_id];
 	unsigned int x;
 
-	/* Check for simulated game */
-	if (g->simulation)
+	/* Check for simulated game or AI copy */
+	if (g->simulation || g != &s_ptr->g)
 	{
 		/* Use simple random number generator */
 		return simple_rand(&g->random_seed);
@@ -1789,8 +2628,8 @@ static void update_meta(int sid)
 	/* Loop over players */
 	for (i = 0; i < s_ptr->num_users; i++)
 	{
-		/* Clear old game structure */
-		memset(&s_ptr->old[i], 0, sizeof(game));
+		/* Resend everything to client */
+		s_ptr->resend[i] = 1;
 	}
 }
 
@@ -1887,180 +2726,489 @@ static void obfuscate_game(game *ob, game *g, int who)
 }
 
 /*
- * Return true if two player structures differ in a way that requires
- * resending to a client.
+ * Return true if the given player may see where a card is.
  */
-static int player_changed(player *p_ptr, player *q_ptr)
+static int card_known(game *g, int x, int who)
 {
-	int i;
+	card *c_ptr = &g->deck[x];
 
-	/* Check for change in actions selected */
-	if (p_ptr->action[0] != q_ptr->action[0]) return 1;
-	if (p_ptr->action[1] != q_ptr->action[1]) return 1;
+	/* Check for active card (known to all) */
+	if (c_ptr->where == WHERE_ACTIVE) return 1;
+	if (c_ptr->start_where == WHERE_ACTIVE) return 1;
 
-	/* Check for change in VP/prestige/etc */
-	if (p_ptr->vp != q_ptr->vp) return 1;
-	if (p_ptr->prestige != q_ptr->prestige) return 1;
-	if (p_ptr->prestige_action_used != q_ptr->prestige_action_used)return 1;
+	/* Check for card owned by player (but not a good) */
+	if ((c_ptr->owner == who || c_ptr->start_owner == who) &&
+	    c_ptr->where != WHERE_GOOD)
+		return 1;
 
-	/* Check for change in temporary phase bonuses */
-	if (p_ptr->phase_bonus_used != q_ptr->phase_bonus_used) return 1;
-	if (p_ptr->bonus_military != q_ptr->bonus_military) return 1;
-	if (p_ptr->bonus_military_xeno != q_ptr->bonus_military_xeno) return 1;
-	if (p_ptr->bonus_reduce != q_ptr->bonus_reduce) return 1;
+	/* Card is hidden */
+	return 0;
+}
 
-	/* Loop over goals */
-	for (i = 0; i < MAX_GOAL; i++)
+/*
+ * Return true if a hidden card must be shown by a substitute, because it
+ * is somewhere other than the draw pile.
+ */
+static int needs_sub(game *g, int x, int who)
+{
+	/* Check for known card or card in draw pile */
+	if (card_known(g, x, who)) return 0;
+	if (g->deck[x].where == WHERE_DECK) return 0;
+
+	/* Substitute needed */
+	return 1;
+}
+
+/*
+ * Pick a substitute to show a hidden card to a player, and mark it to be
+ * sent.
+ */
+static void assign_sub(session *s_ptr, int who, int x, uint8_t *send)
+{
+	game *g = &s_ptr->g;
+	int i;
+
+	/* Loop over cards */
+	for (i = 0; i < g->deck_size; i++)
 	{
-		/* Check for change in goal parameters */
-		if (p_ptr->goal_claimed[i] != q_ptr->goal_claimed[i]) return 1;
-		if (p_ptr->goal_progress[i] != q_ptr->goal_progress[i])return 1;
+		/* Do not show card as itself */
+		if (i == x) continue;
+
+		/* Skip cards already showing another */
+		if (s_ptr->sub_for[who][i] != -1) continue;
+
+		/* Skip cards known to player */
+		if (card_known(g, i, who)) continue;
+
+		/* Show hidden card by this one */
+		s_ptr->sub[who][x] = i;
+		s_ptr->sub_for[who][i] = x;
+
+		/* Send substitute */
+		send[i] = 1;
+		return;
 	}
 
-	/* No change */
-	return 0;
+	/* XXX */
+	server_log("Failed to find substitute card");
 }
 
 /*
- * Send updates to game status to one client.
+ * Get the status fields of a card (in the order of card_default) as seen
+ * by the given player.
+ *
+ * Hidden cards are shown as being in the draw pile.  A hidden card used as
+ * a substitute is shown at the location of the card it stands for instead.
  */
-static void update_status_one(int sid, int who)
+static void card_status(session *s_ptr, int who, int x, int *f)
 {
-	session *s_ptr = &s_list[sid];
-	game obfus;
-	player *p_ptr;
-	card *c_ptr;
-	char msg[BUF_LEN], *ptr;
-	int i, j;
+	game *g = &s_ptr->g;
+	card *c_ptr, *h_ptr;
+	int h;
 
-	/* Obfuscate hidden information for this player */
-	obfuscate_game(&obfus, &s_ptr->g, who);
+	/* Get card pointer */
+	c_ptr = &g->deck[x];
 
-	/* Check for change in player status */
-	for (i = 0; i < s_ptr->g.num_players; i++)
+	/* Assume card is shown as itself */
+	h_ptr = c_ptr;
+
+	/* Check for hidden card */
+	if (!card_known(g, x, who))
 	{
-		/* Check for difference in status */
-		if (player_changed(&obfus.p[i], &s_ptr->old[who].p[i]) ||
-		    (s_ptr->old[who].cur_action < ACT_SEARCH &&
-		     obfus.cur_action >= ACT_SEARCH))
-		{
-			/* Get player pointer */
-			p_ptr = &obfus.p[i];
+		/* Get hidden card shown by this one (if any) */
+		h = s_ptr->sub_for[who][x];
 
-			/* Start at beginning of message buffer */
-			ptr = msg;
+		/* Use hidden card's location, or none */
+		h_ptr = h == -1 ? NULL : &g->deck[h];
+	}
 
-			/* Start message about player */
-			start_msg(&ptr, MSG_STATUS_PLAYER);
+	/* Check for card shown in draw pile */
+	if (!h_ptr)
+	{
+		/* No owner and draw pile location */
+		f[0] = f[1] = -1;
+		f[2] = f[3] = WHERE_DECK;
+	}
+	else
+	{
+		/* Card owner */
+		f[0] = h_ptr->owner;
+		f[1] = h_ptr->start_owner;
 
-			/* Add player number to message */
-			put_integer(i, &ptr);
+		/* Card location */
+		f[2] = h_ptr->where;
+		f[3] = h_ptr->start_where;
+	}
 
-			/* Check for whether to send actions */
-			if (obfus.cur_action >= ACT_SEARCH ||
-			    count_active_flags(&obfus, who, FLAG_SELECT_LAST))
-			{
-				/* Add actions to message */
-				put_integer(p_ptr->action[0], &ptr);
-				put_integer(p_ptr->action[1], &ptr);
-			}
-			else
-			{
-				/* Add empty actions to message */
-				put_integer(-1, &ptr);
-				put_integer(-1, &ptr);
-			}
+	/* Misc flags */
+	f[4] = c_ptr->misc;
 
-			/* Add prestige action/search used flag */
-			put_integer(p_ptr->prestige_action_used, &ptr);
+	/* Order played on table */
+	f[5] = c_ptr->order;
 
-			/* Loop over goals */
-			for (j = 0; j < MAX_GOAL; j++)
-			{
-				/* Add whether player has claimed goal */
-				put_integer(p_ptr->goal_claimed[j], &ptr);
+	/* Number of goods */
+	f[6] = c_ptr->num_goods;
 
-				/* Add player's progress toward goal */
-				put_integer(p_ptr->goal_progress[j], &ptr);
-			}
+	/* Covering card of known cards and goods */
+	if (h_ptr == c_ptr || (h_ptr && h_ptr->where == WHERE_GOOD))
+		f[7] = h_ptr->covering;
+	else
+		f[7] = -1;
+}
+
+/*
+ * Send a card to a client as seen by the given player.
+ */
+static void send_card(session *s_ptr, int who, int x)
+{
+	char msg[BUF_LEN], *ptr = msg;
+	int f[CARD_FIELDS], i;
+
+	/* Get card status */
+	card_status(s_ptr, who, x, f);
+
+	/* Start message about card */
+	start_msg(&ptr, MSG_STATUS_CARD);
+
+	/* Add card index */
+	put_integer(x, &ptr);
+
+	/* Loop over fields */
+	for (i = 0; i < CARD_FIELDS; i++)
+	{
+		/* Add field */
+		put_integer(f[i], &ptr);
+	}
+
+	/* Finish message */
+	finish_msg(msg, ptr);
+
+	/* Send to client */
+	send_msg(s_ptr->cids[who], msg);
+}
 
-			/* Add player's prestige count */
-			put_integer(p_ptr->prestige, &ptr);
+/*
+ * Send marked cards to a client in batches, as seen by the given player.
+ *
+ * A snapshot tells the client to first return every card to the draw pile,
+ * so that cards shown there need not be sent at all.
+ */
+static void send_cards(session *s_ptr, int who, uint8_t *send, int snapshot)
+{
+	game *g = &s_ptr->g;
+	char msg[BUF_LEN], *ptr = msg;
+	int f[CARD_FIELDS];
+	int i, last = -1, sent = 0;
+
+	/* Start message about cards */
+	start_msg(&ptr, MSG_STATUS_CARDS);
+
+	/* Add snapshot flag */
+	put_varint(snapshot, &ptr);
 
-			/* Add player's VP count */
-			put_integer(p_ptr->vp, &ptr);
+	/* Loop over cards in deck */
+	for (i = 0; i < g->deck_size; i++)
+	{
+		/* Skip unchanged cards */
+		if (!send[i]) continue;
 
-			/* Add player's temporary phase bonuses */
-			put_integer(p_ptr->phase_bonus_used, &ptr);
-			put_integer(p_ptr->bonus_military, &ptr);
-			/* Xeno military bonus transmitted only for XI games */
-			if (s_ptr->g.expanded == EXP_XI)
-				put_integer(p_ptr->bonus_military_xeno, &ptr);
-			put_integer(p_ptr->bonus_reduce, &ptr);
+		/* Get card status */
+		card_status(s_ptr, who, i, f);
 
-			/* Add whether player has prestige on the tile */
-			put_integer(p_ptr->prestige_turn, &ptr);
+		/* Skip cards left in draw pile by snapshot */
+		if (snapshot && !memcmp(f, card_default, sizeof(f))) continue;
 
+		/* Check for full message */
+		if (ptr - msg + CARD_STATUS_MAX > BUF_LEN)
+		{
 			/* Finish message */
 			finish_msg(msg, ptr);
 
 			/* Send to client */
 			send_msg(s_ptr->cids[who], msg);
+			sent = 1;
+
+			/* Start next message, continuing any snapshot */
+			ptr = msg;
+			start_msg(&ptr, MSG_STATUS_CARDS);
+			put_varint(0, &ptr);
+			last = -1;
 		}
+
+		/* Add card */
+		put_card_status(i, last, f, &ptr);
+		last = i;
 	}
 
-	/* Loop over cards in deck */
-	for (i = 0; i < obfus.deck_size; i++)
+	/* Check for cards to send, or snapshot not yet sent */
+	if (last >= 0 || (snapshot && !sent))
 	{
-		/* Check for difference from before */
-		if (memcmp(&obfus.deck[i], &s_ptr->old[who].deck[i],
-		           sizeof(card)))
-		{
-			/* Get card pointer */
-			c_ptr = &obfus.deck[i];
+		/* Finish message */
+		finish_msg(msg, ptr);
 
-			/* Start at beginning of message buffer */
-			ptr = msg;
+		/* Send to client */
+		send_msg(s_ptr->cids[who], msg);
+	}
+}
 
-			/* Start message about card */
-			start_msg(&ptr, MSG_STATUS_CARD);
+/*
+ * Get the status fields of a player (in the order of get_player_status) as
+ * seen by the given player.
+ */
+static void player_status(session *s_ptr, int who, int i, int *f)
+{
+	game *g = &s_ptr->g;
+	player *p_ptr;
+	int j;
 
-			/* Add card index */
-			put_integer(i, &ptr);
+	/* Get player pointer */
+	p_ptr = &g->p[i];
 
-			/* Add card owner */
-			put_integer(c_ptr->owner, &ptr);
-			put_integer(c_ptr->start_owner, &ptr);
+	/* Check for whether to show actions */
+	if (g->cur_action >= ACT_SEARCH ||
+	    count_active_flags(g, who, FLAG_SELECT_LAST))
+	{
+		/* Actions */
+		f[0] = p_ptr->action[0];
+		f[1] = p_ptr->action[1];
+	}
+	else
+	{
+		/* Empty actions */
+		f[0] = f[1] = -1;
+	}
 
-			/* Add card location */
-			put_integer(c_ptr->where, &ptr);
-			put_integer(c_ptr->start_where, &ptr);
+	/* Prestige action/search used flag */
+	f[2] = p_ptr->prestige_action_used;
 
-			/* Add misc flags */
-			put_integer(c_ptr->misc, &ptr);
+	/* Loop over goals */
+	for (j = 0; j < MAX_GOAL; j++)
+	{
+		/* Whether player has claimed goal and progress toward it */
+		f[PLAYER_GOALS + 2 * j] = p_ptr->goal_claimed[j];
+		f[PLAYER_GOALS + 2 * j + 1] = p_ptr->goal_progress[j];
+	}
+
+	/* Point past goals */
+	f += PLAYER_GOALS + 2 * MAX_GOAL;
+
+	/* Prestige and VP counts */
+	f[0] = p_ptr->prestige;
+	f[1] = p_ptr->vp;
+
+	/* Temporary phase bonuses */
+	f[2] = p_ptr->phase_bonus_used;
+	f[3] = p_ptr->bonus_military;
+	f[4] = p_ptr->bonus_military_xeno;
+	f[5] = p_ptr->bonus_reduce;
+
+	/* Whether player has prestige on the tile */
+	f[6] = p_ptr->prestige_turn;
+}
+
+/*
+ * Send a player's status to a client in a message of its own.
+ */
+static void send_player_status(session *s_ptr, int who, int i, int *f)
+{
+	char msg[BUF_LEN], *ptr = msg;
+	int j;
+
+	/* Start message about player */
+	start_msg(&ptr, MSG_STATUS_PLAYER);
+
+	/* Add player number to message */
+	put_integer(i, &ptr);
+
+	/* Loop over fields */
+	for (j = 0; j < PLAYER_FIELDS; j++)
+	{
+		/* Xeno military bonus transmitted only for XI games */
+		if (j == PLAYER_FIELDS - 3 && s_ptr->g.expanded != EXP_XI)
+			continue;
+
+		/* Add field */
+		put_integer(f[j], &ptr);
+	}
+
+	/* Finish message */
+	finish_msg(msg, ptr);
+
+	/* Send to client */
+	send_msg(s_ptr->cids[who], msg);
+}
 
-			/* Add order played on table */
-			put_integer(c_ptr->order, &ptr);
+/*
+ * Send updates to game status to one client.
+ *
+ * Only players, cards and goals marked as changed by the game engine are
+ * sent, unless the client needs everything resent.
+ */
+static void update_status_one(int sid, int who)
+{
+	session *s_ptr = &s_list[sid];
+	game *g = &s_ptr->g;
+	uint8_t send[MAX_DECK];
+	int16_t pending[2 * MAX_DECK];
+	char msg[BUF_LEN], *ptr;
+	int f[PLAYER_FIELDS];
+	int i, j, full, reveal, batch, num_pending = 0;
+
+	/* Check for everything to be resent */
+	full = s_ptr->resend[who];
 
-			/* Add number of goods */
-			put_integer(c_ptr->num_goods, &ptr);
+	/* Check for actions being revealed */
+	reveal = s_ptr->old_action < ACT_SEARCH && g->cur_action >= ACT_SEARCH;
 
-			/* Add covering flag */
-			put_integer(c_ptr->covering, &ptr);
+	/* Check for client understanding batches */
+	batch = c_list[s_ptr->cids[who]].proto >= 2;
 
+	/* Start message about players */
+	ptr = msg;
+	start_msg(&ptr, MSG_STATUS_PLAYERS);
+
+	/* Check for change in player status */
+	for (i = 0; i < g->num_players; i++)
+	{
+		/* Skip unchanged players */
+		if (!full && !reveal && !(g->dirty_player & (1 << i))) continue;
+
+		/* Get player status */
+		player_status(s_ptr, who, i, f);
+
+		/* Check for client not understanding batches */
+		if (!batch)
+		{
+			/* Send player alone */
+			send_player_status(s_ptr, who, i, f);
+			continue;
+		}
+
+		/* Check for full message */
+		if (ptr - msg + PLAYER_STATUS_MAX > BUF_LEN)
+		{
 			/* Finish message */
 			finish_msg(msg, ptr);
 
 			/* Send to client */
 			send_msg(s_ptr->cids[who], msg);
+
+			/* Start next message */
+			ptr = msg;
+			start_msg(&ptr, MSG_STATUS_PLAYERS);
+		}
+
+		/* Add player number and status */
+		put_varint(i, &ptr);
+		put_player_status(f, &ptr);
+	}
+
+	/* Check for players in batch */
+	if (ptr - msg > HEADER_LEN)
+	{
+		/* Finish message */
+		finish_msg(msg, ptr);
+
+		/* Send to client */
+		send_msg(s_ptr->cids[who], msg);
+	}
+
+	/* Start with no cards to send */
+	memset(send, 0, sizeof(send));
+
+	/* Check for everything to be resent */
+	if (full)
+	{
+		/* Forget old substitutes */
+		memset(s_ptr->sub[who], -1, sizeof(s_ptr->sub[who]));
+		memset(s_ptr->sub_for[who], -1, sizeof(s_ptr->sub_for[who]));
+
+		/* Loop over cards */
+		for (i = 0; i < g->deck_size; i++)
+		{
+			/* Send card */
+			send[i] = 1;
+
+			/* Remember cards needing a substitute */
+			if (needs_sub(g, i, who)) pending[num_pending++] = i;
+		}
+	}
+	else
+	{
+		/* Loop over cards */
+		for (i = 0; i < g->deck_size; i++)
+		{
+			/* Skip unchanged cards */
+			if (!CARD_DIRTY(g, i)) continue;
+
+			/* Send card */
+			send[i] = 1;
+
+			/* Check for hidden card shown by a substitute */
+			j = s_ptr->sub[who][i];
+			if (j != -1)
+			{
+				/* Send substitute at new location */
+				send[j] = 1;
+
+				/* Check for card no longer needing one */
+				if (!needs_sub(g, i, who))
+				{
+					/* Free substitute */
+					s_ptr->sub[who][i] = -1;
+					s_ptr->sub_for[who][j] = -1;
+				}
+			}
+
+			/* Check for substitute card that is now known */
+			j = s_ptr->sub_for[who][i];
+			if (j != -1 && card_known(g, i, who))
+			{
+				/* Free substitute */
+				s_ptr->sub[who][j] = -1;
+				s_ptr->sub_for[who][i] = -1;
+
+				/* Hidden card needs another */
+				pending[num_pending++] = j;
+			}
+
+			/* Check for hidden card newly needing a substitute */
+			if (s_ptr->sub[who][i] == -1 && needs_sub(g, i, who))
+				pending[num_pending++] = i;
+		}
+	}
+
+	/* Loop over hidden cards needing a substitute */
+	for (i = 0; i < num_pending; i++)
+	{
+		/* Skip cards already given one */
+		if (s_ptr->sub[who][pending[i]] != -1) continue;
+
+		/* Skip cards no longer hidden */
+		if (!needs_sub(g, pending[i], who)) continue;
+
+		/* Find substitute */
+		assign_sub(s_ptr, who, pending[i], send);
+	}
+
+	/* Check for client understanding batches */
+	if (batch)
+	{
+		/* Send changed cards together, or everything as a snapshot */
+		send_cards(s_ptr, who, send, full);
+	}
+	else
+	{
+		/* Loop over cards in deck */
+		for (i = 0; i < g->deck_size; i++)
+		{
+			/* Send changed cards */
+			if (send[i]) send_card(s_ptr, who, i);
 		}
 	}
 
 	/* Check for change in goal status */
-	if (memcmp(obfus.goal_avail, s_ptr->old[who].goal_avail,
-	           MAX_GOAL * sizeof(int)) ||
-	    memcmp(obfus.goal_most, s_ptr->old[who].goal_most,
-	           MAX_GOAL * sizeof(int8_t)))
+	if (full || g->dirty_goal)
 	{
 		/* Start at beginning of message buffer */
 		ptr = msg;
@@ -2072,8 +3220,8 @@ static void update_status_one(int sid, int who)
 		for (i = 0; i < MAX_GOAL; i++)
 		{
 			/* Put availabiltiy and progress counts */
-			put_integer(s_ptr->g.goal_avail[i], &ptr);
-			put_integer(s_ptr->g.goal_most[i], &ptr);
+			put_integer(g->goal_avail[i], &ptr);
+			put_integer(g->goal_most[i], &ptr);
 		}
 
 		/* Finish message */
@@ -2083,14 +3231,18 @@ static void update_status_one(int sid, int who)
 		send_msg(s_ptr->cids[who], msg);
 	}
 
-	/* Copy game state to remembered */
-	s_ptr->old[who] = obfus;
+	/* Client is up to date */
+	s_ptr->resend[who] = 0;
 }
 
 /*
  * Send updates to game status to all clients in a session.
+ *
+ * Clients too far behind in reading are skipped, and sent everything once
+ * they catch up, except for the player given by "need" (or everyone, if
+ * negative), who must see the current state.
  */
-static void update_status(int sid)
+static void update_status(int sid, int need)
 {
 	session *s_ptr = &s_list[sid];
 	char msg[1024], *ptr;
@@ -2099,13 +3251,32 @@ static void update_status(int sid)
 	/* Send individualized status to everyone */
 	for (i = 0; i < s_ptr->num_users; i++)
 	{
-		/* Skip players who are not connected */
-		if (s_ptr->cids[i] < 0) continue;
+		/* Check for player not connected */
+		if (s_ptr->cids[i] < 0)
+		{
+			/* Resend everything once connected */
+			s_ptr->resend[i] = 1;
+			continue;
+		}
+
+		/* Check for client behind that may be skipped */
+		if (need >= 0 && i != need && conn_behind(s_ptr->cids[i]))
+		{
+			/* Resend everything next time */
+			s_ptr->resend[i] = 1;
+			continue;
+		}
 
 		/* Send updates */
 		update_status_one(sid, i);
 	}
 
+	/* Changes have been sent */
+	clear_dirty(&s_ptr->g);
+
+	/* Remember current action */
+	s_ptr->old_action = s_ptr->g.cur_action;
+
 	/* Start at beginning of message buffer */
 	ptr = msg;
 
@@ -2198,12 +3369,291 @@ static void server_notify_rotation(game *g, int who)
 		/* Skip players who are not connected */
 		if (s_ptr->cids[i] < 0) continue;
 
-		/* Tell player about new seat */
-		send_msgf(s_ptr->cids[i], MSG_SEAT, "d", i);
+		/* Tell player about new seat */
+		send_msgf(s_ptr->cids[i], MSG_SEAT, "d", i);
+	}
+
+	/* Tell players about new names in seats */
+	update_meta(g->session_id);
+}
+
+/*
+ * Create the game seen by an AI player.
+ *
+ * The AI is told only what a client playing this seat would be told.
+ */
+static void ai_view(game *view, game *g, int who)
+{
+	player *p_ptr;
+	card *c_ptr;
+	int i, hide;
+
+	/* Obfuscate hidden information for this player */
+	obfuscate_game(view, g, who);
+
+	/* Check for actions of other players still secret */
+	hide = view->cur_action < ACT_SEARCH &&
+	       !count_active_flags(view, who, FLAG_SELECT_LAST);
+
+	/* Loop over players */
+	for (i = 0; i < view->num_players; i++)
+	{
+		/* Get player pointer */
+		p_ptr = &view->p[i];
+
+		/* Clear card lists */
+		memset(p_ptr->head, -1, sizeof(p_ptr->head));
+		memset(p_ptr->start_head, -1, sizeof(p_ptr->start_head));
+
+		/* Player choices are not made through the server */
+		p_ptr->control = NULL;
+
+		/* Choice logs are given by the AI thread */
+		p_ptr->choice_log = NULL;
+		p_ptr->choice_history = NULL;
+
+		/* Skip our own actions */
+		if (i == who || !hide) continue;
+
+		/* Hide selected actions */
+		p_ptr->action[0] = p_ptr->action[1] = -1;
+	}
+
+	/* Loop over cards, last first */
+	for (i = view->deck_size - 1; i >= 0; i--)
+	{
+		/* Get card pointer */
+		c_ptr = &view->deck[i];
+
+		/* Check for owned card */
+		if (c_ptr->owner != -1)
+		{
+			/* Add card to owner's list */
+			c_ptr->next = view->p[c_ptr->owner].head[c_ptr->where];
+			view->p[c_ptr->owner].head[c_ptr->where] = i;
+		}
+		else
+		{
+			/* Card is in no list */
+			c_ptr->next = -1;
+		}
+
+		/* Check for owned card at start of phase */
+		if (c_ptr->start_owner != -1)
+		{
+			/* Add card to owner's start of phase list */
+			c_ptr->start_next =
+			         view->p[c_ptr->start_owner].start_head[c_ptr->start_where];
+			view->p[c_ptr->start_owner].start_head[c_ptr->start_where] = i;
+		}
+		else
+		{
+			/* Card is in no list */
+			c_ptr->start_next = -1;
+		}
+
+		/* Set known flags for active and revealed cards */
+		if (c_ptr->where == WHERE_ACTIVE || c_ptr->where == WHERE_ASIDE)
+		{
+			/* Card's location is known to everyone */
+			c_ptr->misc |= MISC_KNOWN_MASK;
+		}
+
+		/* Set known flags for our cards in hand and saved cards */
+		if (c_ptr->owner == who &&
+		    (c_ptr->where == WHERE_HAND || c_ptr->where == WHERE_SAVED))
+		{
+			/* Set known flag */
+			c_ptr->misc |= (1 << who);
+		}
+	}
+}
+
+/*
+ * Give a choice to the AI threads.
+ *
+ * The session mutex must be held.
+ */
+static void queue_ai(int sid, int who)
+{
+	session *s_ptr = &s_list[sid];
+	ai_job *j_ptr;
+
+	/* Create job */
+	j_ptr = (ai_job *)malloc(sizeof(ai_job));
+
+	/* Remember who the choice is for */
+	j_ptr->sid = sid;
+	j_ptr->who = who;
+	j_ptr->log = s_ptr->g.p[who].choice_log;
+	j_ptr->pos = s_ptr->g.p[who].choice_size;
+
+	/* Copy choice */
+	j_ptr->out = s_ptr->out[who];
+
+	/* Copy game as seen by player */
+	ai_view(&j_ptr->view, &s_ptr->g, who);
+
+	/* Job goes at end of queue */
+	j_ptr->next = NULL;
+
+	/* Grab AI queue mutex */
+	pthread_mutex_lock(&ai_mutex);
+
+	/* Add job to queue */
+	if (ai_tail) ai_tail->next = j_ptr;
+	else ai_head = j_ptr;
+	ai_tail = j_ptr;
+
+	/* Wake an AI thread */
+	pthread_cond_signal(&ai_cond);
+
+	/* Release AI queue mutex */
+	pthread_mutex_unlock(&ai_mutex);
+}
+
+/*
+ * Add a choice made by the AI to the player's choice log.
+ */
+static void ai_answer(ai_job *j_ptr)
+{
+	int sid = j_ptr->sid, who = j_ptr->who;
+	session *s_ptr = &s_list[sid];
+	player *p_ptr, *v_ptr;
+	int *l_ptr;
+
+	/* Grab session mutex */
+	pthread_mutex_lock(&s_ptr->session_mutex);
+
+	/* Get player pointers */
+	p_ptr = &s_ptr->g.p[who];
+	v_ptr = &j_ptr->view.p[who];
+
+	/* Check for player no longer waiting on this choice */
+	if (s_ptr->state != SS_STARTED || !s_ptr->ai_control[who] ||
+	    p_ptr->choice_log != j_ptr->log ||
+	    p_ptr->choice_size != j_ptr->pos)
+	{
+		/* Discard answer */
+		pthread_mutex_unlock(&s_ptr->session_mutex);
+		return;
+	}
+
+	/* Make room for choices and get pointer to end of choice log */
+	l_ptr = reserve_choice_log(p_ptr, v_ptr->choice_size);
+
+	/* Copy choices */
+	memcpy(l_ptr, v_ptr->choice_log->data, sizeof(int) * v_ptr->choice_size);
+
+	/* Mark new size of choice log */
+	p_ptr->choice_size += v_ptr->choice_size;
+
+	/* Log message */
+	server_log("S:%d P:%d AI made choice at position %d", sid, who,
+	           j_ptr->pos);
+
+	/* Release session mutex */
+	pthread_mutex_unlock(&s_ptr->session_mutex);
+
+	/* Save choice log to database */
+	db_save_choices(sid, who);
+
+	/* Acquire mutex for session */
+	pthread_mutex_lock(&s_ptr->session_mutex);
+
+	/* Check for blocked player */
+	if (s_ptr->waiting[who] == WAIT_BLOCKED)
+	{
+		/* Mark player as ready */
+		s_ptr->waiting[who] = WAIT_READY;
+
+		/* Save waiting status */
+		db_save_waiting(sid, who);
+
+		/* Log message */
+		server_log("S:%d P:%d READY", sid, who);
+	}
+
+	/* Wake game task to continue */
+	wake_task(s_ptr);
+
+	/* Update waiting status */
+	update_waiting(sid);
+
+	/* Release session mutex */
+	pthread_mutex_unlock(&s_ptr->session_mutex);
+}
+
+/*
+ * Make choices for AI players.
+ *
+ * This function runs in each AI thread.
+ */
+static void *run_ai(void *arg)
+{
+	choice_buffer *log[MAX_PLAYER];
+	ai_job *j_ptr;
+	choice *o_ptr;
+	player *p_ptr;
+	int i;
+
+	/* Loop over players */
+	for (i = 0; i < MAX_PLAYER; i++)
+	{
+		/* Create choice log for AI's copy of player */
+		log[i] = new_choice_log();
+	}
+
+	/* Loop forever */
+	while (1)
+	{
+		/* Grab AI queue mutex */
+		pthread_mutex_lock(&ai_mutex);
+
+		/* Wait for a job */
+		while (!ai_head) pthread_cond_wait(&ai_cond, &ai_mutex);
+
+		/* Take job from front of queue */
+		j_ptr = ai_head;
+		ai_head = j_ptr->next;
+		if (!ai_head) ai_tail = NULL;
+
+		/* Release AI queue mutex */
+		pthread_mutex_unlock(&ai_mutex);
+
+		/* Loop over players */
+		for (i = 0; i < MAX_PLAYER; i++)
+		{
+			/* Get player pointer */
+			p_ptr = &j_ptr->view.p[i];
+
+			/* Start with empty choice log */
+			p_ptr->choice_log = log[i];
+			p_ptr->choice_size = p_ptr->choice_pos = 0;
+			p_ptr->choice_unread_pos = 0;
+		}
+
+		/* Get choice pointer */
+		o_ptr = &j_ptr->out;
+
+		/* Load AI neural networks for this game */
+		ai_func.init(&j_ptr->view, j_ptr->who, 0);
+
+		/* Ask AI for decision */
+		ai_func.make_choice(&j_ptr->view, j_ptr->who, o_ptr->type,
+		                    o_ptr->list, &o_ptr->num,
+		                    o_ptr->special, &o_ptr->num_special,
+		                    o_ptr->arg1, o_ptr->arg2, o_ptr->arg3);
+
+		/* Store answer */
+		ai_answer(j_ptr);
+
+		/* Done with job */
+		free(j_ptr);
 	}
 
-	/* Tell players about new names in seats */
-	update_meta(g->session_id);
+	/* Not reached */
+	return NULL;
 }
 
 /*
@@ -2219,7 +3669,7 @@ static void ask_client(int sid, int who)
 	int i;
 
 	/* Send game updates to players */
-	update_status(sid);
+	update_status(sid, who);
 
 	/* Get choice pointer */
 	o_ptr = &s_ptr->out[who];
@@ -2234,9 +3684,6 @@ static void ask_client(int sid, int who)
 		return;
 	}
 
-	/* Check for no player */
-	if (cid < 0) return;
-
 	/* Check for choice already received */
 	if (g->p[who].choice_size > g->p[who].choice_pos)
 	{
@@ -2244,6 +3691,17 @@ static void ask_client(int sid, int who)
 		return;
 	}
 
+	/* Check for AI player */
+	if (s_ptr->ai_control[who])
+	{
+		/* Have AI thread make choice */
+		if (o_ptr->type != CHOICE_PREPARE) queue_ai(sid, who);
+		return;
+	}
+
+	/* Check for no player */
+	if (cid < 0) return;
+
 	/* Check for prepare message */
 	if (o_ptr->type == CHOICE_PREPARE)
 	{
@@ -2464,15 +3922,30 @@ static void kick_player(int cid, char *reason)
 	/* Send goodbye message */
 	send_msgf(cid, MSG_GOODBYE, "s", reason);
 
+	/* Send goodbye and anything else still waiting */
+	flush_conn(cid);
+
 	/* Set state to disconnected */
 	c_list[cid].state = CS_DISCONN;
 
+	/* Remove socket from event loop */
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c_list[cid].fd, NULL);
+
 	/* Close connection */
 	close(c_list[cid].fd);
 
+	/* Grab connection mutex */
+	pthread_mutex_lock(&c_list[cid].conn_mutex);
+
 	/* Clear file descriptor */
 	c_list[cid].fd = -1;
 
+	/* Drop anything that could not be sent */
+	clear_queue(&c_list[cid]);
+
+	/* Release connection mutex */
+	pthread_mutex_unlock(&c_list[cid].conn_mutex);
+
 	/* Send disconnect to everyone */
 	send_player(cid);
 
@@ -2519,7 +3992,7 @@ static void kick_player(int cid, char *reason)
 		update_waiting(sid);
 
 		/* Check for kick timeout */
-		if (kick_timeout && !c_list[cid].ai)
+		if (kick_timeout)
 		{
 			/* Format time to AI control message */
 			sprintf(text, "%s will be set to AI control in %d seconds.",
@@ -2613,7 +4086,7 @@ static void handle_choice(int cid, int size)
 	 * consumption. If we kick the player the log is still full. The game seems
 	 * definitively messed up. We adopt the option of abandoning the game.
 	 */
-	if (p_ptr->choice_size + len_choices > CHOICE_LOG_LEN)
+	if (p_ptr->choice_size + len_choices > CHOICE_LOG_MAX)
 	{
 		/* Save client ids */
 		for (who = 0; who < s_ptr->num_users; who++)
@@ -2633,8 +4106,8 @@ static void handle_choice(int cid, int size)
 		return;
 	}
 
-	/* Get pointer to end of choice log */
-	l_ptr = &p_ptr->choice_log[p_ptr->choice_size];
+	/* Make room for choices and get pointer to end of choice log */
+	l_ptr = reserve_choice_log(p_ptr, len_choices);
 
 	/* Start processing choices */
 	process_choices = 1;
@@ -2716,7 +4189,7 @@ static void handle_choice(int cid, int size)
 	}
 
 	/* Mark new size of choice log */
-	p_ptr->choice_size = l_ptr - p_ptr->choice_log;
+	p_ptr->choice_size = l_ptr - p_ptr->choice_log->data;
 
 	/* Release session mutex */
 	pthread_mutex_unlock(&s_ptr->session_mutex);
@@ -2743,8 +4216,8 @@ static void handle_choice(int cid, int size)
 	/* Mark time of activity */
 	c_list[cid].last_active = time(NULL);
 
-	/* Signal game thread to continue */
-	pthread_cond_signal(&s_ptr->wait_cond);
+	/* Wake game task to continue */
+	wake_task(s_ptr);
 
 	/* Update waiting status */
 	update_waiting(sid);
@@ -2811,8 +4284,8 @@ static void handle_prepare(int cid)
 		server_log("S:%d P:%d READY", sid, who);
 	}
 
-	/* Signal game thread to continue */
-	pthread_cond_signal(&s_ptr->wait_cond);
+	/* Wake game task to continue */
+	wake_task(s_ptr);
 
 	/* Update waiting status */
 	update_waiting(sid);
@@ -2882,12 +4355,31 @@ decisions server_func =
 
 /*
  * Accept a new connection.
+ *
+ * Return -1 when no more connections are waiting.
  */
-static void accept_conn(int listen_fd)
+static int accept_conn(int listen_fd)
 {
 	struct sockaddr_in peer_addr;
 	socklen_t size = sizeof(struct sockaddr_in);
-	int i;
+	int i, fd;
+
+	/* Accept connection */
+	fd = accept(listen_fd, (struct sockaddr *)&peer_addr, &size);
+
+	/* Check for failure */
+	if (fd < 0)
+	{
+		/* Check for recoverable error */
+		if (errno == EAGAIN || errno == EWOULDBLOCK) return -1;
+
+		/* Check for connection aborted before accepted */
+		if (errno == ECONNABORTED || errno == EINTR) return 0;
+
+		/* Print error and exit */
+		perror("accept");
+		exit(1);
+	}
 
 	/* Loop through current list looking for an empty spot */
 	for (i = 0; i < num_conn; i++)
@@ -2897,6 +4389,16 @@ static void accept_conn(int listen_fd)
 		    c_list[i].state == CS_DISCONN) break;
 	}
 
+	/* Check for full list */
+	if (i == MAX_CONN)
+	{
+		/* Refuse connection */
+		server_log("Refusing connection from %s, too many connections",
+		           inet_ntoa(peer_addr.sin_addr));
+		close(fd);
+		return 0;
+	}
+
 	/* Check for end of list reached */
 	if (i == num_conn)
 	{
@@ -2904,22 +4406,8 @@ static void accept_conn(int listen_fd)
 		num_conn++;
 	}
 
-	/* Accept connection */
-	c_list[i].fd = accept(listen_fd, (struct sockaddr *)&peer_addr, &size);
-
-	/* Connection is not local AI */
-	c_list[i].ai = 0;
-
-	/* Check for failure */
-	if (c_list[i].fd < 0)
-	{
-		/* Check for recoverable error */
-		if (errno == EAGAIN) return;
-
-		/* Print error and exit */
-		perror("accept");
-		exit(1);
-	}
+	/* Remember socket */
+	c_list[i].fd = fd;
 
 	/* Set socket to nonblocking */
 	fcntl(c_list[i].fd, F_SETFL, O_NONBLOCK);
@@ -2936,17 +4424,32 @@ static void accept_conn(int listen_fd)
 	/* Clear buffer length */
 	c_list[i].buf_full = 0;
 
-	/* Clear outgoing buffer length */
-	c_list[i].out_len = 0;
+	/* Speak first protocol revision until told otherwise */
+	c_list[i].proto = 1;
+
+	/* Grab connection mutex */
+	pthread_mutex_lock(&c_list[i].conn_mutex);
+
+	/* Drop anything left from an earlier connection */
+	clear_queue(&c_list[i]);
+
+	/* Release connection mutex */
+	pthread_mutex_unlock(&c_list[i].conn_mutex);
 
 	/* Clear username */
 	strcpy(c_list[i].user, "");
 
+	/* Add socket to event loop */
+	watch_conn(i);
+
 	/* Print message */
 	server_log("New connection %d from %s", i, c_list[i].addr);
 
 	/* Log new connection */
 	server_log("State for connection %d set to INIT", i);
+
+	/* Success */
+	return 0;
 }
 
 /*
@@ -3077,39 +4580,23 @@ static void switch_ai(int sid, int who)
 {
 	session *s_ptr = &s_list[sid];
 	char text[1024];
-	int cid;
 
 	/* Acquire session mutex */
 	pthread_mutex_lock(&s_ptr->session_mutex);
 
-	/* Create a new AI connection */
-	cid = new_ai_client(sid);
-
-	/* Save client ID in session */
-	s_ptr->cids[who] = cid;
-
-	/* Client is playing */
-	c_list[cid].state = CS_PLAYING;
-
-	/* Log connection state */
-	server_log("State for connection %d set to PLAYING", cid);
-
 	/* Log game seat */
-	server_log("S:%d P:%d Connection %d joined", sid, who, cid);
+	server_log("S:%d P:%d AI joined", sid, who);
 
 	/* Log player state */
 	log_waiting(sid, who, s_ptr->waiting[who]);
 
-	/* Tell client about game state */
-	update_meta(sid);
-
-	/* Give player a seat number */
-	send_msgf(cid, MSG_SEAT, "d", who);
-
 	/* Mark player as AI */
 	s_ptr->ai_control[who] = 1;
 	s_ptr->g.p[who].ai = 1;
 
+	/* Tell clients about game state */
+	update_meta(sid);
+
 	/* Save AI control in database */
 	db_save_ai_control(sid);
 
@@ -3143,16 +4630,14 @@ static void switch_ai(int sid, int who)
 /*
  * Run a started game.
  *
- * This function runs in a new thread.
+ * This function runs as a game task on a worker thread, and is suspended
+ * whenever it waits for a player.
  */
-void *run_game(void *arg)
+static void run_game(int sid)
 {
-	session *s_ptr = (session *)arg;
+	session *s_ptr = &s_list[sid];
 	int i;
 
-	/* Initialize condition variable */
-	pthread_cond_init(&s_ptr->wait_cond, NULL);
-
 	/* Acquire session mutex */
 	pthread_mutex_lock(&s_ptr->session_mutex);
 
@@ -3190,11 +4675,36 @@ void *run_game(void *arg)
 		send_msgf(s_ptr->cids[i], MSG_SEAT, "d", i);
 	}
 
-	/* Begin game */
-	begin_game(&s_ptr->g);
+	/* Messages from the replayed part of the game are already saved */
+	s_ptr->g.fast_replay = s_ptr->replaying;
+
+	/* Check for checkpoint reached by the loaded choice logs */
+	if (s_ptr->checkpoint &&
+	    !load_checkpoint(&s_ptr->g, s_ptr->checkpoint, s_ptr->checkpoint_len))
+	{
+		/* Continue random numbers from checkpoint */
+		s_ptr->random_pos = s_ptr->checkpoint_rand;
+	}
+	else
+	{
+		/* Begin game */
+		begin_game(&s_ptr->g);
+	}
+
+	/* Checkpoint is no longer needed */
+	free(s_ptr->checkpoint);
+	s_ptr->checkpoint = NULL;
 
 	/* Play game rounds until finished */
-	while (game_round(&s_ptr->g));
+	while (1)
+	{
+		/* Save state at start of round (unless still replaying) */
+		if (!s_ptr->replaying && !s_ptr->g.game_over)
+			db_save_checkpoint(s_ptr->sid);
+
+		/* Play round */
+		if (!game_round(&s_ptr->g)) break;
+	}
 
 	/* Score game */
 	score_game(&s_ptr->g);
@@ -3203,7 +4713,7 @@ void *run_game(void *arg)
 	declare_winner(&s_ptr->g);
 
 	/* Send status to everyone */
-	update_status(s_ptr - s_list);
+	update_status(s_ptr - s_list, -1);
 
 	/* Loop over players */
 	for (i = 0; i < s_ptr->num_users; i++)
@@ -3218,19 +4728,151 @@ void *run_game(void *arg)
 	/* Mark session as finished */
 	s_ptr->state = SS_DONE;
 
-	/* Release mutex */
-	pthread_mutex_unlock(&s_ptr->session_mutex);
-
 	/* Save state */
 	db_save_game_state(s_ptr->sid);
 
 	/* Save results */
 	db_save_results(s_ptr->sid);
 
-	/* Done */
+	/* Remove round checkpoint */
+	db_clear_checkpoint(s_ptr->sid);
+
+	/* Wait until results are saved and game is exported */
+	while (!s_ptr->saved) suspend_task(s_ptr);
+
+	/* Release mutex */
+	pthread_mutex_unlock(&s_ptr->session_mutex);
+}
+
+/*
+ * Entry point of a game task.
+ */
+static void game_task(int sid)
+{
+	session *s_ptr = &s_list[sid];
+
+	/* Play game */
+	run_game(sid);
+
+	/* Mark task as finished */
+	s_ptr->finished = 1;
+
+	/* Return to worker for the last time */
+	setcontext(s_ptr->worker);
+}
+
+/*
+ * Run game tasks from the run queue.
+ *
+ * This function runs in each worker thread.
+ */
+static void *run_worker(void *arg)
+{
+	ucontext_t worker;
+	session *s_ptr;
+
+	/* Connect worker thread to database */
+	if (storage->connect() < 0) exit(1);
+
+	/* Loop forever */
+	while (1)
+	{
+		/* Grab run mutex */
+		pthread_mutex_lock(&run_mutex);
+
+		/* Wait for a task to be ready */
+		while (!run_len) pthread_cond_wait(&run_cond, &run_mutex);
+
+		/* Take task from front of queue */
+		s_ptr = &s_list[run_queue[run_head]];
+		run_head = (run_head + 1) % MAX_SESSION;
+		run_len--;
+
+		/* Mark task as running */
+		s_ptr->queued = 0;
+		s_ptr->running = 1;
+		s_ptr->woken = 0;
+
+		/* Release run mutex */
+		pthread_mutex_unlock(&run_mutex);
+
+		/* Have task return here */
+		s_ptr->worker = &worker;
+
+		/* Run task until it waits or finishes */
+		swapcontext(&worker, &s_ptr->task);
+
+		/* Check for finished task */
+		if (s_ptr->finished)
+		{
+			/* Free task stack */
+			munmap(s_ptr->stack, TASK_STACK);
+			s_ptr->stack = NULL;
+		}
+
+		/* Grab run mutex */
+		pthread_mutex_lock(&run_mutex);
+
+		/* Task has stopped */
+		s_ptr->running = 0;
+
+		/* Check for task woken while running */
+		if (s_ptr->woken && !s_ptr->finished) queue_task(s_ptr);
+
+		/* Release run mutex */
+		pthread_mutex_unlock(&run_mutex);
+	}
+
+	/* Not reached */
 	return NULL;
 }
 
+/*
+ * Create the game task of a session and queue it to run.
+ */
+static void start_task(int sid)
+{
+	session *s_ptr = &s_list[sid];
+
+	/* Create stack */
+	s_ptr->stack = mmap(NULL, TASK_STACK, PROT_READ | PROT_WRITE,
+	                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK |
+	                    MAP_NORESERVE, -1, 0);
+
+	/* Check for failure */
+	if (s_ptr->stack == MAP_FAILED)
+	{
+		/* Print error and exit */
+		perror("mmap");
+		exit(1);
+	}
+
+	/* Make lowest page a guard against overflow */
+	mprotect(s_ptr->stack, getpagesize(), PROT_NONE);
+
+	/* Create task context */
+	getcontext(&s_ptr->task);
+	s_ptr->task.uc_stack.ss_sp = s_ptr->stack;
+	s_ptr->task.uc_stack.ss_size = TASK_STACK;
+	s_ptr->task.uc_link = NULL;
+	makecontext(&s_ptr->task, (void (*)(void))game_task, 1, sid);
+
+	/* Task has not finished */
+	s_ptr->finished = 0;
+
+	/* Results are not saved */
+	s_ptr->saved = 0;
+
+	/* Grab run mutex */
+	pthread_mutex_lock(&run_mutex);
+
+	/* Queue task */
+	queue_task(s_ptr);
+
+	/* Release run mutex */
+	pthread_mutex_unlock(&run_mutex);
+}
+
 /*
  * Start a game session.
  */
@@ -3238,7 +4880,6 @@ static void start_session(int sid)
 {
 	session *s_ptr = &s_list[sid];
 	char name[80];
-	pthread_t t;
 	int i;
 
 	/* Check for advanced flag and more than two players */
@@ -3266,14 +4907,14 @@ static void start_session(int sid)
 		s_ptr->g.p[i].control = &server_func;
 
 		/* Create choice log */
-		s_ptr->g.p[i].choice_log = (int *)malloc(sizeof(int) * CHOICE_LOG_LEN);
+		s_ptr->g.p[i].choice_log = new_choice_log();
 
 		/* Clear choice log size and position */
 		s_ptr->g.p[i].choice_size = 0;
 		s_ptr->g.p[i].choice_pos = 0;
 
 		/* Get player's name */
-		db_user_name(s_ptr->uids[i], name);
+		storage->user_name(s_ptr->uids[i], name);
 
 		/* Copy player's name */
 		s_ptr->g.p[i].name = strdup(name);
@@ -3281,18 +4922,8 @@ static void start_session(int sid)
 		/* Clear waiting amount */
 		s_ptr->wait_ticks[i] = 0;
 
-		/* Check for AI-controlled player */
-		if (s_ptr->ai_control[i])
-		{
-			/* Create AI client connection */
-			s_ptr->cids[i] = new_ai_client(sid);
-			s_ptr->g.p[i].ai = 1;
-		}
-		else
-		{
-			/* Player is not AI-controlled */
-			s_ptr->g.p[i].ai = 0;
-		}
+		/* Mark whether player is AI-controlled */
+		s_ptr->g.p[i].ai = s_ptr->ai_control[i];
 	}
 
 	/* Load game state from database, if able */
@@ -3308,8 +4939,8 @@ static void start_session(int sid)
 		db_save_seats(sid);
 	}
 
-	/* Start a thread to run game */
-	pthread_create(&t, NULL, run_game, (void *)s_ptr);
+	/* Start a task to run game */
+	start_task(sid);
 }
 
 /*
@@ -3343,7 +4974,7 @@ static void handle_login(int cid, int size)
 	char text[1024];
 	char *msg_buf = c_list[cid].buf;
 	char *ptr = msg_buf;
-	int i, j;
+	int i, j, proto;
 
 	/* Ensure client is in INIT state */
 	if (c_list[cid].state != CS_INIT)
@@ -3375,6 +5006,19 @@ static void handle_login(int cid, int size)
 		strcpy(c_list[cid].version, version);
 	}
 
+	/* Check for protocol revision */
+	if (ptr - msg_buf < size)
+	{
+		/* Read newest revision client understands */
+		if (!get_integer(&proto, msg_buf, size, &ptr)) goto format_error;
+
+		/* Use newest revision both understand */
+		c_list[cid].proto = proto < COMM_PROTOCOL ? proto : COMM_PROTOCOL;
+
+		/* Always understand first revision */
+		if (c_list[cid].proto < 1) c_list[cid].proto = 1;
+	}
+
 	/* Log message */
 	server_log("Login attempt from %s (%s)", user, c_list[cid].version);
 
@@ -3469,7 +5113,7 @@ static void handle_login(int cid, int size)
 	}
 
 	/* Get user's ID and check password */
-	c_list[cid].uid = db_user(user, pass);
+	c_list[cid].uid = storage->user(user, pass);
 
 	/* Check for bad password */
 	if (c_list[cid].uid < 0)
@@ -3567,7 +5211,7 @@ static void handle_login(int cid, int size)
 			send_msgf(cid, MSG_START, "");
 
 			/* Replay game messages */
-			replay_messages(s_ptr->gid, cid);
+			replay_messages(i, cid);
 
 			/* Client is playing */
 			c_list[cid].state = CS_PLAYING;
@@ -3992,7 +5636,7 @@ static void handle_remove(int cid, int size)
 	for (i = 0; i < s_ptr->num_users; i++)
 	{
 		/* Get user's name */
-		db_user_name(s_ptr->uids[i], name);
+		storage->user_name(s_ptr->uids[i], name);
 
 		/* Check for match */
 		if (!strcmp(buf, name))
@@ -4076,7 +5720,7 @@ static void handle_add_ai(int cid, int size)
 	for (i = 0; ai_names[i]; i++)
 	{
 		/* Look up user ID for AI */
-		uid = db_user(ai_names[i], "");
+		uid = storage->user(ai_names[i], "");
 
 		/* Check for failure */
 		if (uid < 0) continue;
@@ -4321,6 +5965,7 @@ format_error:
 static void handle_chat(int cid, int size)
 {
 	char chat[1024];
+	out_msg *m;
 	int i;
 	char *msg_buf = c_list[cid].buf;
 	char *ptr = msg_buf;
@@ -4334,6 +5979,9 @@ static void handle_chat(int cid, int size)
 	/* Check for sender in lobby */
 	if (c_list[cid].state == CS_LOBBY)
 	{
+		/* Create chat message */
+		m = new_msgf(MSG_CHAT, "ss", c_list[cid].user, chat);
+
 		/* Loop over all clients in lobby */
 		for (i = 0; i < num_conn; i++)
 		{
@@ -4341,8 +5989,11 @@ static void handle_chat(int cid, int size)
 			if (c_list[i].state == CS_DISCONN) continue;
 
 			/* Send chat to player */
-			send_msgf(i, MSG_CHAT, "ss", c_list[cid].user, chat);
+			queue_msg(i, m);
 		}
+
+		/* Release our reference */
+		release_msg(m);
 	}
 	else
 	{
@@ -4496,8 +6147,10 @@ static void handle_msg(int cid)
 
 /*
  * Handle incoming data from a client.
+ *
+ * Return 0 once no more data is waiting.
  */
-static void handle_data(int cid)
+static int handle_data(int cid)
 {
 	conn *c;
 	char *ptr;
@@ -4525,10 +6178,18 @@ static void handle_data(int cid)
 	/* Try to read as many bytes as needed */
 	x = recv(c->fd, c->buf + c->buf_full, size - c->buf_full, 0);
 
+	/* Check for errors */
 	if (x < 0)
 	{
+		/* Check for all data read */
+		if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+
+		/* Print error */
 		perror("recv");
-		return;
+
+		/* Drop connection */
+		kick_player(cid, "Connection error");
+		return 0;
 	}
 
 	/* Check for no bytes read */
@@ -4536,7 +6197,7 @@ static void handle_data(int cid)
 	{
 		/* Client closed connection */
 		kick_player(cid, "Client closed connection");
-		return;
+		return 0;
 	}
 
 	/* Add to amount read */
@@ -4554,7 +6215,7 @@ static void handle_data(int cid)
 		{
 			/* Kick client */
 			kick_player(cid, "Message too small");
-			return;
+			return 0;
 		}
 
 		/* Check for too long message */
@@ -4562,7 +6223,7 @@ static void handle_data(int cid)
 		{
 			/* Close connection */
 			kick_player(cid, "Message too long");
-			return;
+			return 0;
 		}
 	}
 
@@ -4579,6 +6240,9 @@ static void handle_data(int cid)
 	/* Mark time of last data seen */
 	c->last_seen = time(NULL);
 	c->ping_sent = 0;
+
+	/* More data may be waiting */
+	return 1;
 }
 
 /*
@@ -4601,6 +6265,9 @@ static void do_housekeeping(void)
 		/* Check for finished session */
 		if (s_ptr->state == SS_DONE)
 		{
+			/* Keep session until its results are saved */
+			if (!s_ptr->finished) continue;
+
 			/* Assume no players left in session */
 			num = 0;
 
@@ -4635,9 +6302,6 @@ static void do_housekeeping(void)
 		if (c_list[i].state == CS_EMPTY ||
 		    c_list[i].state == CS_DISCONN) continue;
 
-		/* Skip AI clients */
-		if (c_list[i].ai) continue;
-
 		/* Check for no data from client in quite some time */
 		if (timeout &&
 		    c_list[i].ping_sent &&
@@ -4825,13 +6489,15 @@ static void do_housekeeping(void)
 int main(int argc, char *argv[])
 {
 	struct sockaddr_in listen_addr;
-	struct timeval sel_timeout;
-	fd_set readfds, writefds;
+	struct epoll_event ev, events[MAX_EVENTS];
+	struct itimerspec tick;
+	pthread_t worker;
+	eventfd_t count;
+	uint64_t expired;
 	int listen_fd;
-	int i, n;
-	my_bool reconnect = 1;
-	time_t last_housekeep = 0;
+	int i, n, id;
 	int port = 16309;
+	char *store_name = "mysql";
 	char *db = "rftg";
 	char *db_user = "rftg";
 	char *db_pw = NULL, *db_host = NULL;
@@ -4846,8 +6512,9 @@ int main(int argc, char *argv[])
 			printf("Race for the Galaxy server, version " RELEASE "\n\n");
 			printf("Arguments:\n");
 			printf("  -p     Port number to listen to. Default: 16309\n");
+			printf("  -store Storage backend: mysql, sqlite or memory. Default: mysql\n");
 			printf("  -host  MySQL database host. Default: \"localhost\"\n");
-			printf("  -d     MySQL database name. Default: \"rftg\"\n");
+			printf("  -d     MySQL database name, or SQLite database file. Default: \"rftg\"\n");
 			printf("  -u     MySQL database user. Default: \"rftg\"\n");
 			printf("  -pw    MySQL database password. Default: [none]\n");
 			printf("  -t     Client timeout in seconds. 0 means do not kick players. Default: 60\n");
@@ -4857,6 +6524,8 @@ int main(int argc, char *argv[])
 			printf("  -e     Folder to put exported games. Default: \".\"\n");
 			printf("  -s     Server name (to be used in exports). Default: [none]\n");
 			printf("  -ss    XSLT style sheets for exported games. Default: [none]\n");
+			printf("  -w     Number of threads running games. Default: 4\n");
+			printf("  -a     Number of threads playing for the A.I. Default: 4\n");
 			printf("  -debug Accept debug card messages.\n");
 			printf("  -h     Print this usage text and exit.\n\n");
 			printf("For more information, see the following web sites:\n");
@@ -4871,6 +6540,13 @@ int main(int argc, char *argv[])
 			port = atoi(argv[++i]);
 		}
 
+		/* Check for storage backend */
+		if (!strcmp(argv[i], "-store"))
+		{
+			/* Set storage backend */
+			store_name = argv[++i];
+		}
+
 		/* Check for database host */
 		if (!strcmp(argv[i], "-host"))
 		{
@@ -4942,6 +6618,20 @@ int main(int argc, char *argv[])
 			export_style_sheet = argv[++i];
 		}
 
+		/* Check for number of workers */
+		if (!strcmp(argv[i], "-w"))
+		{
+			/* Set number of workers */
+			num_workers = atoi(argv[++i]);
+		}
+
+		/* Check for number of AI threads */
+		if (!strcmp(argv[i], "-a"))
+		{
+			/* Set number of AI threads */
+			num_ai_threads = atoi(argv[++i]);
+		}
+
 		/* Check for debug server */
 		if (!strcmp(argv[i], "-debug"))
 		{
@@ -4950,6 +6640,12 @@ int main(int argc, char *argv[])
 		}
 	}
 
+	/* Run games on at least one worker */
+	if (num_workers < 1) num_workers = 1;
+
+	/* Have at least one thread play for the AI */
+	if (num_ai_threads < 1) num_ai_threads = 1;
+
 	/* Read card library */
 	if (read_cards(NULL) < 0)
 	{
@@ -4957,31 +6653,72 @@ int main(int argc, char *argv[])
 		exit(1);
 	}
 
-	/* Initialize database library */
-	mysql = mysql_init(NULL);
+	/* Find storage backend */
+	if (!(storage = find_store(store_name)))
+	{
+		/* Print error and exit */
+		server_log("Unknown storage backend: %s", store_name);
+		exit(1);
+	}
+
+	/* Open database */
+	if (storage->open(db_host, db_user, db_pw, db) < 0)
+	{
+		/* Exit */
+		exit(1);
+	}
+
+	/* Remember thread running the event loop */
+	main_thread = pthread_self();
+
+	/* Create event loop */
+	epoll_fd = epoll_create1(0);
+
+	/* Create signal for output queued by game threads */
+	wake_fd = eventfd(0, EFD_NONBLOCK);
 
 	/* Check for error */
-	if (!mysql)
+	if (epoll_fd < 0 || wake_fd < 0)
 	{
 		/* Print error and exit */
-		server_log("Couldn't initialize database library!");
+		perror("epoll");
 		exit(1);
 	}
 
-	/* Attempt to connect to database server */
-	if (!mysql_real_connect(mysql, db_host, db_user, db_pw, db, 0, NULL, 0))
+	/* Read game states from database */
+	db_load_sessions();
+
+	/* Start database writer thread */
+	if (pthread_create(&worker, NULL, run_db_writer, NULL))
 	{
 		/* Print error and exit */
-		server_log("Database connection: %s", mysql_error(mysql));
+		server_log("Couldn't start database writer thread!");
 		exit(1);
 	}
 
-	/* Reconnect automatically when connection to database is lost */
-	mysql_options(mysql, MYSQL_OPT_RECONNECT, &reconnect);
+	/* Loop over workers */
+	for (i = 0; i < num_workers; i++)
+	{
+		/* Start worker thread */
+		if (pthread_create(&worker, NULL, run_worker, NULL))
+		{
+			/* Print error and exit */
+			server_log("Couldn't start worker thread!");
+			exit(1);
+		}
+	}
 
-	/* Read game states from database */
-	db_load_sessions();
-	db_load_attendance();
+	/* Loop over AI threads */
+	for (i = 0; i < num_ai_threads; i++)
+	{
+		/* Start AI thread */
+		if (pthread_create(&worker, NULL, run_ai, NULL))
+		{
+			/* Print error and exit */
+			server_log("Couldn't start AI thread!");
+			exit(1);
+		}
+	}
 
 	/* Start sessions that were running previously */
 	start_all_sessions();
@@ -4989,9 +6726,6 @@ int main(int argc, char *argv[])
 	/* Ignore SIGPIPE when writing to a closed socket */
 	signal(SIGPIPE, SIG_IGN);
 
-	/* Do not wait for forked children processes */
-	signal(SIGCHLD, SIG_IGN);
-
 	/* Create main socket for new connections */
 	listen_fd = socket(AF_INET, SOCK_STREAM, 0);
 
@@ -5025,98 +6759,125 @@ int main(int argc, char *argv[])
 		exit(1);
 	}
 
+	/* Set listening socket to nonblocking */
+	fcntl(listen_fd, F_SETFL, O_NONBLOCK);
+
+	/* Watch for new connections */
+	ev.events = EPOLLIN | EPOLLET;
+	ev.data.u32 = EV_LISTEN;
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev);
+
+	/* Create housekeeping timer */
+	timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+
+	/* Check for error */
+	if (timer_fd < 0)
+	{
+		/* Message and exit */
+		perror("timerfd_create");
+		exit(1);
+	}
+
+	/* Expire once right away, then every tick */
+	tick.it_value.tv_sec = 0;
+	tick.it_value.tv_nsec = 1;
+	tick.it_interval.tv_sec = tick_size;
+	tick.it_interval.tv_nsec = 0;
+	timerfd_settime(timer_fd, 0, &tick, NULL);
+
+	/* Watch for timer expiring */
+	ev.events = EPOLLIN;
+	ev.data.u32 = EV_TIMER;
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &ev);
+
+	/* Watch for output signalled by game threads */
+	ev.events = EPOLLIN;
+	ev.data.u32 = EV_WAKE;
+	epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev);
+
 	/* Print ready message */
 	server_log("Server ready. Listening on port %d...", port);
 
 	/* Loop forever */
 	while (1)
 	{
-		/* Clear set of connections to listen on */
-		FD_ZERO(&readfds);
-
-		/* Clear set of connections to wait for ability to write */
-		FD_ZERO(&writefds);
+		/* Wait for activity */
+		n = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
 
-		/* Add main listening socket to list */
-		FD_SET(listen_fd, &readfds);
+		/* Check for error */
+		if (n < 0)
+		{
+			/* Check for interrupted wait */
+			if (errno == EINTR) continue;
 
-		/* Track biggest file descriptor */
-		n = listen_fd;
+			/* Message and exit */
+			perror("epoll_wait");
+			exit(1);
+		}
 
-		/* Loop over active connections */
-		for (i = 0; i < num_conn; i++)
+		/* Loop over events */
+		for (i = 0; i < n; i++)
 		{
-			/* Check for still active */
-			if (c_list[i].fd > 0)
-			{
-				/* Add descriptor to set */
-				FD_SET(c_list[i].fd, &readfds);
+			/* Get source of event */
+			id = events[i].data.u32;
 
-				/* Track biggest file descriptor */
-				if (c_list[i].fd > n) n = c_list[i].fd;
-
-				/* Grab connection mutex */
-				pthread_mutex_lock(&c_list[i].conn_mutex);
+			/* Check for new incoming connections */
+			if (id == EV_LISTEN)
+			{
+				/* Accept all waiting connections */
+				while (accept_conn(listen_fd) == 0);
+			}
 
-				/* Check for unsent data */
-				if (c_list[i].out_len > 0)
-				{
-					/* Add to write set */
-					FD_SET(c_list[i].fd, &writefds);
-				}
+			/* Check for housekeeping tick */
+			else if (id == EV_TIMER)
+			{
+				/* Read number of expirations */
+				if (read(timer_fd, &expired, sizeof(uint64_t)) < 0)
+					continue;
 
-				/* Release connection mutex */
-				pthread_mutex_unlock(&c_list[i].conn_mutex);
+				/* Perform housekeeping */
+				do_housekeeping();
 			}
-		}
-
-		/* Wait no more than one tick */
-		sel_timeout.tv_sec = tick_size;
-		sel_timeout.tv_usec = 0;
 
-		/* Wait for activity on any connection */
-		select(n + 1, &readfds, &writefds, NULL, &sel_timeout);
+			/* Check for output queued by game threads */
+			else if (id == EV_WAKE)
+			{
+				/* Clear signal, output is sent below */
+				eventfd_read(wake_fd, &count);
+			}
 
-		/* Check for new incoming connection */
-		if (FD_ISSET(listen_fd, &readfds))
-		{
-			/* Accept new connection */
-			accept_conn(listen_fd);
-		}
+			/* Check for connection already closed */
+			else if (c_list[id].fd < 0) continue;
 
-		/* Loop over active connections */
-		for (i = 0; i < num_conn; i++)
-		{
-			/* Check for still active */
-			if (c_list[i].fd > 0)
+			/* Handle connection */
+			else
 			{
-				/* Check for activity on this connection */
-				if (FD_ISSET(c_list[i].fd, &readfds))
+				/* Check for room to send */
+				if (events[i].events & (EPOLLOUT | EPOLLERR))
 				{
-					/* Handle incoming data */
-					handle_data(i);
-				}
+					/* Grab connection mutex */
+					pthread_mutex_lock(&c_list[id].conn_mutex);
+
+					/* Socket can take data again */
+					c_list[id].writable = 1;
+
+					/* Release connection mutex */
+					pthread_mutex_unlock(&c_list[id].conn_mutex);
 
-				/* Check for connection closed */
-				if (c_list[i].fd < 0) continue;
+					/* Send data waiting for room */
+					flush_conn(id);
+				}
 
-				/* Check for unsent data ready to send */
-				if (FD_ISSET(c_list[i].fd, &writefds))
+				/* Check for incoming data or hangup */
+				if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
 				{
-					/* Send ping to flush buffer */
-					send_msgf(i, MSG_PING, "");
+					/* Handle data until none is waiting */
+					while (c_list[id].fd > 0 && handle_data(id));
 				}
 			}
 		}
 
-		/* Check time since last housekeeping */
-		if (time(NULL) - last_housekeep >= tick_size)
-		{
-			/* Perform housekeeping */
-			do_housekeeping();
-
-			/* Remember time */
-			last_housekeep = time(NULL);
-		}
+		/* Send output queued while handling events */
+		flush_pending();
 	}
 }
@@ -0,0 +1,396 @@
+/*
+ * Race for the Galaxy AI
+ *
+ * Copyright (C) 2009-2015 Keldon Jones
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "sql.h"
+#include <mysql/errmsg.h>
+#include <mysql/mysqld_error.h>
+
+/*
+ * Starting size of result column buffers.
+ */
+#define SQL_COL_SIZE 64
+
+/*
+ * Set a parameter to NULL.
+ */
+void sql_null(sql_param *p_ptr)
+{
+	/* Set parameter */
+	p_ptr->type = SQL_NULL;
+	p_ptr->num = 0;
+	p_ptr->data = NULL;
+	p_ptr->len = 0;
+}
+
+/*
+ * Set an integer parameter.
+ */
+void sql_int(sql_param *p_ptr, int num)
+{
+	/* Set parameter */
+	p_ptr->type = SQL_INT;
+	p_ptr->num = num;
+	p_ptr->data = NULL;
+	p_ptr->len = 0;
+}
+
+/*
+ * Set a text parameter.
+ */
+void sql_text(sql_param *p_ptr, char *text)
+{
+	/* Set parameter */
+	p_ptr->type = SQL_TEXT;
+	p_ptr->num = 0;
+	p_ptr->data = text;
+	p_ptr->len = strlen(text);
+}
+
+/*
+ * Set a binary parameter.
+ */
+void sql_blob(sql_param *p_ptr, void *data, unsigned long len)
+{
+	/* Set parameter */
+	p_ptr->type = SQL_BLOB;
+	p_ptr->num = 0;
+	p_ptr->data = (char *)data;
+	p_ptr->len = len;
+}
+
+/*
+ * Close a statement's handle, so that it is prepared again on next use.
+ */
+static void sql_close(sql_stmt *s_ptr)
+{
+	/* Close handle */
+	if (s_ptr->stmt) mysql_stmt_close(s_ptr->stmt);
+
+	/* Forget handle */
+	s_ptr->stmt = NULL;
+	s_ptr->prepared = 0;
+}
+
+/*
+ * Prepare a statement on a connection, unless already done.
+ *
+ * Return -1 on error.
+ */
+static int sql_prepare(MYSQL *conn, sql_stmt *s_ptr)
+{
+	int i;
+
+	/* Check for statement already prepared on this connection */
+	if (s_ptr->prepared && s_ptr->conn == conn) return 0;
+
+	/* Close any handle on another connection */
+	sql_close(s_ptr);
+
+	/* Create statement handle */
+	s_ptr->stmt = mysql_stmt_init(conn);
+
+	/* Check for failure */
+	if (!s_ptr->stmt) return -1;
+
+	/* Remember connection */
+	s_ptr->conn = conn;
+
+	/* Prepare statement */
+	if (mysql_stmt_prepare(s_ptr->stmt, s_ptr->query, strlen(s_ptr->query)))
+	{
+		/* Failure */
+		return -1;
+	}
+
+	/* Statement is prepared */
+	s_ptr->prepared = 1;
+
+	/* Check for bindings already allocated */
+	if (s_ptr->param) return 0;
+
+	/* Count parameters and result columns */
+	s_ptr->num_param = mysql_stmt_param_count(s_ptr->stmt);
+	s_ptr->num_col = mysql_stmt_field_count(s_ptr->stmt);
+
+	/* Allocate bindings */
+	s_ptr->param = (MYSQL_BIND *)calloc(s_ptr->num_param + 1,
+	                                    sizeof(MYSQL_BIND));
+	s_ptr->col = (MYSQL_BIND *)calloc(s_ptr->num_col + 1,
+	                                  sizeof(MYSQL_BIND));
+
+	/* Allocate column buffers */
+	s_ptr->buf = (char **)calloc(s_ptr->num_col + 1, sizeof(char *));
+	s_ptr->size = (unsigned long *)calloc(s_ptr->num_col + 1,
+	                                      sizeof(unsigned long));
+	s_ptr->len = (unsigned long *)calloc(s_ptr->num_col + 1,
+	                                     sizeof(unsigned long));
+	s_ptr->null = (my_bool *)calloc(s_ptr->num_col + 1, sizeof(my_bool));
+	s_ptr->row = (char **)calloc(s_ptr->num_col + 1, sizeof(char *));
+
+	/* Loop over columns */
+	for (i = 0; i < s_ptr->num_col; i++)
+	{
+		/* Allocate buffer */
+		s_ptr->buf[i] = (char *)malloc(SQL_COL_SIZE);
+		s_ptr->size[i] = SQL_COL_SIZE;
+
+		/* Fetch column as string */
+		s_ptr->col[i].buffer_type = MYSQL_TYPE_STRING;
+		s_ptr->col[i].buffer = s_ptr->buf[i];
+		s_ptr->col[i].buffer_length = SQL_COL_SIZE;
+		s_ptr->col[i].length = &s_ptr->len[i];
+		s_ptr->col[i].is_null = &s_ptr->null[i];
+	}
+
+	/* Success */
+	return 0;
+}
+
+/*
+ * Bind parameters and execute a statement.
+ *
+ * Return -1 on error.
+ */
+static int sql_execute(MYSQL *conn, sql_stmt *s_ptr, sql_param *param, int n)
+{
+	MYSQL_BIND *b_ptr;
+	int i, tries;
+
+	/* Try twice, in case the connection was lost */
+	for (tries = 0; tries < 2; tries++)
+	{
+		/* Prepare statement */
+		if (sql_prepare(conn, s_ptr) < 0)
+		{
+			/* Keep handle for error message after last try */
+			if (tries) return -1;
+
+			/* Forget handle and try again */
+			sql_close(s_ptr);
+			continue;
+		}
+
+		/* Check for wrong number of parameters */
+		if (n != s_ptr->num_param) return -1;
+
+		/* Loop over parameters */
+		for (i = 0; i < n; i++)
+		{
+			/* Get binding */
+			b_ptr = &s_ptr->param[i];
+
+			/* Clear binding */
+			memset(b_ptr, 0, sizeof(MYSQL_BIND));
+
+			/* Check kind of parameter */
+			switch (param[i].type)
+			{
+				case SQL_INT:
+					b_ptr->buffer_type = MYSQL_TYPE_LONG;
+					b_ptr->buffer = &param[i].num;
+					break;
+				case SQL_TEXT:
+					b_ptr->buffer_type = MYSQL_TYPE_STRING;
+					b_ptr->buffer = param[i].data;
+					b_ptr->buffer_length = param[i].len;
+					break;
+				case SQL_BLOB:
+					b_ptr->buffer_type = MYSQL_TYPE_BLOB;
+					b_ptr->buffer = param[i].data;
+					b_ptr->buffer_length = param[i].len;
+					break;
+				default:
+					b_ptr->buffer_type = MYSQL_TYPE_NULL;
+					break;
+			}
+		}
+
+		/* Bind parameters */
+		if (n && mysql_stmt_bind_param(s_ptr->stmt, s_ptr->param))
+		{
+			/* Failure */
+			return -1;
+		}
+
+		/* Execute statement */
+		if (!mysql_stmt_execute(s_ptr->stmt)) return 0;
+
+		/* Check for error other than lost connection or statement */
+		if (mysql_stmt_errno(s_ptr->stmt) != CR_SERVER_GONE_ERROR &&
+		    mysql_stmt_errno(s_ptr->stmt) != CR_SERVER_LOST &&
+		    mysql_stmt_errno(s_ptr->stmt) != ER_UNKNOWN_STMT_HANDLER)
+		{
+			/* Failure */
+			return -1;
+		}
+
+		/* Forget handle and try again */
+		sql_close(s_ptr);
+	}
+
+	/* Failure */
+	return -1;
+}
+
+/*
+ * Run a statement that returns no rows.
+ *
+ * Return -1 on error.
+ */
+int sql_run(MYSQL *conn, sql_stmt *s_ptr, sql_param *param, int n)
+{
+	/* Execute statement */
+	return sql_execute(conn, s_ptr, param, n);
+}
+
+/*
+ * Run a statement returning rows, which are then read with sql_fetch().
+ *
+ * All rows are read from the server at once, so that other statements
+ * may be run before sql_done() is called.
+ *
+ * Return -1 on error.
+ */
+int sql_select(MYSQL *conn, sql_stmt *s_ptr, sql_param *param, int n)
+{
+	/* Execute statement */
+	if (sql_execute(conn, s_ptr, param, n) < 0) return -1;
+
+	/* Bind result columns */
+	if (mysql_stmt_bind_result(s_ptr->stmt, s_ptr->col)) return -1;
+
+	/* Read all rows */
+	if (mysql_stmt_store_result(s_ptr->stmt)) return -1;
+
+	/* Success */
+	return 0;
+}
+
+/*
+ * Return the next row of a statement's result, or NULL when there are no
+ * more rows.
+ *
+ * Columns are returned as strings, and NULL columns as NULL pointers.
+ */
+char **sql_fetch(sql_stmt *s_ptr)
+{
+	int i, rebind = 0;
+
+	/* Check for statement not prepared */
+	if (!s_ptr->prepared) return NULL;
+
+	/* Fetch row */
+	switch (mysql_stmt_fetch(s_ptr->stmt))
+	{
+		/* Columns fetched */
+		case 0:
+		case MYSQL_DATA_TRUNCATED:
+			break;
+
+		/* No more rows, or error */
+		default:
+			return NULL;
+	}
+
+	/* Loop over columns */
+	for (i = 0; i < s_ptr->num_col; i++)
+	{
+		/* Check for NULL column */
+		if (s_ptr->null[i])
+		{
+			/* Return NULL pointer */
+			s_ptr->row[i] = NULL;
+			continue;
+		}
+
+		/* Check for column too large for buffer */
+		if (s_ptr->len[i] >= s_ptr->size[i])
+		{
+			/* Enlarge buffer */
+			s_ptr->size[i] = s_ptr->len[i] + 1;
+			s_ptr->buf[i] = (char *)realloc(s_ptr->buf[i],
+			                                s_ptr->size[i]);
+
+			/* Point binding at new buffer */
+			s_ptr->col[i].buffer = s_ptr->buf[i];
+			s_ptr->col[i].buffer_length = s_ptr->size[i];
+
+			/* Fetch whole column */
+			mysql_stmt_fetch_column(s_ptr->stmt, &s_ptr->col[i], i, 0);
+
+			/* Bindings must be given again */
+			rebind = 1;
+		}
+
+		/* Terminate string */
+		s_ptr->buf[i][s_ptr->len[i]] = '\0';
+
+		/* Return column */
+		s_ptr->row[i] = s_ptr->buf[i];
+	}
+
+	/* Give new buffers for later rows */
+	if (rebind) mysql_stmt_bind_result(s_ptr->stmt, s_ptr->col);
+
+	/* Return row */
+	return s_ptr->row;
+}
+
+/*
+ * Return the lengths of the columns in the current row.
+ */
+unsigned long *sql_lengths(sql_stmt *s_ptr)
+{
+	/* Return lengths */
+	return s_ptr->len;
+}
+
+/*
+ * Finish reading a statement's result.
+ */
+void sql_done(sql_stmt *s_ptr)
+{
+	/* Free rows read */
+	if (s_ptr->prepared) mysql_stmt_free_result(s_ptr->stmt);
+}
+
+/*
+ * Return the ID of the row inserted by a statement.
+ */
+int sql_insert_id(sql_stmt *s_ptr)
+{
+	/* Return ID */
+	return (int)mysql_stmt_insert_id(s_ptr->stmt);
+}
+
+/*
+ * Return the error from the last use of a statement.
+ */
+const char *sql_error(sql_stmt *s_ptr)
+{
+	/* Check for statement handle */
+	if (s_ptr->stmt) return mysql_stmt_error(s_ptr->stmt);
+
+	/* Check for connection */
+	if (s_ptr->conn) return mysql_error(s_ptr->conn);
+
+	/* Unknown error */
+	return "Statement not prepared";
+}
@@ -0,0 +1,114 @@
+/*
+ * Race for the Galaxy AI
+ *
+ * Copyright (C) 2009-2015 Keldon Jones
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mysql/mysql.h>
+
+/*
+ * MySQL 8 replaced my_bool with bool.
+ */
+#if !defined(MARIADB_BASE_VERSION) && MYSQL_VERSION_ID >= 80000
+#include <stdbool.h>
+typedef bool my_bool;
+#endif
+
+/*
+ * Kinds of statement parameters.
+ */
+#define SQL_NULL 0
+#define SQL_INT  1
+#define SQL_TEXT 2
+#define SQL_BLOB 3
+
+/*
+ * A parameter bound to a statement.
+ */
+typedef struct sql_param
+{
+	/* Kind of parameter */
+	int type;
+
+	/* Value of integer parameter */
+	int num;
+
+	/* Data of text or blob parameter */
+	char *data;
+
+	/* Length of data */
+	unsigned long len;
+
+} sql_param;
+
+/*
+ * A statement, prepared on first use and kept for later ones.
+ *
+ * A statement must only be used by the thread owning its connection.
+ */
+typedef struct sql_stmt
+{
+	/* Text of statement, with a ? for each parameter */
+	char *query;
+
+	/* Connection statement is prepared on */
+	MYSQL *conn;
+
+	/* Statement handle */
+	MYSQL_STMT *stmt;
+
+	/* Handle has been prepared */
+	int prepared;
+
+	/* Bindings for parameters */
+	MYSQL_BIND *param;
+	int num_param;
+
+	/* Bindings for result columns */
+	MYSQL_BIND *col;
+	int num_col;
+
+	/* Buffers for result columns and their sizes */
+	char **buf;
+	unsigned long *size;
+
+	/* Length and null flag of each column in current row */
+	unsigned long *len;
+	my_bool *null;
+
+	/* Current row */
+	char **row;
+
+} sql_stmt;
+
+/*
+ * External functions.
+ */
+extern void sql_null(sql_param *p_ptr);
+extern void sql_int(sql_param *p_ptr, int num);
+extern void sql_text(sql_param *p_ptr, char *text);
+extern void sql_blob(sql_param *p_ptr, void *data, unsigned long len);
+extern int sql_run(MYSQL *conn, sql_stmt *s_ptr, sql_param *param, int n);
+extern int sql_select(MYSQL *conn, sql_stmt *s_ptr, sql_param *param, int n);
+extern char **sql_fetch(sql_stmt *s_ptr);
+extern unsigned long *sql_lengths(sql_stmt *s_ptr);
+extern void sql_done(sql_stmt *s_ptr);
+extern int sql_insert_id(sql_stmt *s_ptr);
+extern const char *sql_error(sql_stmt *s_ptr);
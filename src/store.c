@@ -0,0 +1,180 @@
+/*
+ * Race for the Galaxy AI
+ *
+ * Copyright (C) 2009-2015 Keldon Jones
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "store.h"
+#include <stdint.h>
+
+/*
+ * Available backends.
+ */
+static store *store_list[] =
+{
+	&store_mysql,
+	&store_sqlite,
+	&store_memory,
+	NULL
+};
+
+/*
+ * Return the backend with the given name, or NULL if there is none.
+ */
+store *find_store(char *name)
+{
+	int i;
+
+	/* Loop over backends */
+	for (i = 0; store_list[i]; i++)
+	{
+		/* Check for matching name */
+		if (!strcmp(store_list[i]->name, name)) return store_list[i];
+	}
+
+	/* No such backend */
+	return NULL;
+}
+
+/*
+ * Rotate a 32-bit word left.
+ */
+#define ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+/*
+ * Process one 64-byte block of SHA-1 input.
+ */
+static void sha1_block(uint32_t *h, unsigned char *block)
+{
+	uint32_t w[80], a, b, c, d, e, f, k, t;
+	int i;
+
+	/* Read block as big-endian words */
+	for (i = 0; i < 16; i++)
+	{
+		/* Read word */
+		w[i] = (uint32_t)block[4 * i] << 24 |
+		       (uint32_t)block[4 * i + 1] << 16 |
+		       (uint32_t)block[4 * i + 2] << 8 |
+		       (uint32_t)block[4 * i + 3];
+	}
+
+	/* Extend to 80 words */
+	for (i = 16; i < 80; i++)
+	{
+		/* Compute word */
+		w[i] = ROTL(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+	}
+
+	/* Start with current hash */
+	a = h[0];
+	b = h[1];
+	c = h[2];
+	d = h[3];
+	e = h[4];
+
+	/* Loop over rounds */
+	for (i = 0; i < 80; i++)
+	{
+		/* Choose round function */
+		if (i < 20)
+		{
+			f = (b & c) | (~b & d);
+			k = 0x5a827999;
+		}
+		else if (i < 40)
+		{
+			f = b ^ c ^ d;
+			k = 0x6ed9eba1;
+		}
+		else if (i < 60)
+		{
+			f = (b & c) | (b & d) | (c & d);
+			k = 0x8f1bbcdc;
+		}
+		else
+		{
+			f = b ^ c ^ d;
+			k = 0xca62c1d6;
+		}
+
+		/* Mix */
+		t = ROTL(a, 5) + f + e + k + w[i];
+		e = d;
+		d = c;
+		c = ROTL(b, 30);
+		b = a;
+		a = t;
+	}
+
+	/* Add to hash */
+	h[0] += a;
+	h[1] += b;
+	h[2] += c;
+	h[3] += d;
+	h[4] += e;
+}
+
+/*
+ * Hash a password the same way as the SHA1() function of MySQL, giving
+ * 40 lowercase hex digits.
+ *
+ * This is used by the backends without such a function, so that user
+ * tables may be moved between backends.
+ */
+void store_hash(char *text, char *hex)
+{
+	uint32_t h[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476,
+	                  0xc3d2e1f0 };
+	unsigned char block[64];
+	uint64_t bits;
+	size_t len, left;
+	int i;
+
+	/* Get length of text */
+	len = left = strlen(text);
+
+	/* Process whole blocks */
+	for (; left >= 64; left -= 64, text += 64)
+	{
+		/* Process block */
+		sha1_block(h, (unsigned char *)text);
+	}
+
+	/* Copy rest of text and add end marker */
+	memset(block, 0, 64);
+	memcpy(block, text, left);
+	block[left] = 0x80;
+
+	/* Check for no room for length */
+	if (left >= 56)
+	{
+		/* Process block and start another */
+		sha1_block(h, block);
+		memset(block, 0, 64);
+	}
+
+	/* Add length in bits */
+	bits = (uint64_t)len * 8;
+	for (i = 0; i < 8; i++) block[63 - i] = bits >> (8 * i);
+
+	/* Process last block */
+	sha1_block(h, block);
+
+	/* Write hash as hex digits */
+	for (i = 0; i < 5; i++) sprintf(hex + 8 * i, "%08x", h[i]);
+}
@@ -0,0 +1,194 @@
+/*
+ * Race for the Galaxy AI
+ *
+ * Copyright (C) 2009-2015 Keldon Jones
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Game states.
+ */
+#define GS_WAITING   1
+#define GS_STARTED   2
+#define GS_DONE      3
+#define GS_ABANDONED 4
+
+/*
+ * Kinds of writes.
+ *
+ * STORE_JOIN        Add user to game.
+ * STORE_LEAVE       Remove user from game.
+ * STORE_STATE       Set game state to num[0].
+ * STORE_SEED        Save random byte pool in data[0].
+ * STORE_SEAT        Set seat of user to num[0].
+ * STORE_AI          Set AI control of user to num[0].
+ * STORE_WAITING     Set waiting state of user to num[0] (WAIT_READY,
+ *                   WAIT_BLOCKED, WAIT_OPTION, or anything else for none).
+ * STORE_CHOICES     Save encoded choice log of user in data[0].
+ * STORE_CHECKPOINT  Save game state in data[0] at random position num[0].
+ * STORE_CLEAR       Remove checkpoint of game.
+ * STORE_MESSAGE     Add message data[0] with format data[1] for user.
+ * STORE_RESULT      Add result of user: points num[0], tiebreaker num[1]
+ *                   and winner flag num[2].
+ */
+#define STORE_JOIN       0
+#define STORE_LEAVE      1
+#define STORE_STATE      2
+#define STORE_SEED       3
+#define STORE_SEAT       4
+#define STORE_AI         5
+#define STORE_WAITING    6
+#define STORE_CHOICES    7
+#define STORE_CHECKPOINT 8
+#define STORE_CLEAR      9
+#define STORE_MESSAGE    10
+#define STORE_RESULT     11
+
+/*
+ * Basic information about a game.
+ */
+typedef struct store_game
+{
+	/* Game ID */
+	int gid;
+
+	/* Description and password */
+	char desc[1024];
+	char pass[21];
+
+	/* User ID who created game */
+	int created;
+
+	/* Game state */
+	int state;
+
+	/* Desired min/max number of players */
+	int min_player;
+	int max_player;
+
+	/* Expansion level and options */
+	int expanded;
+	int advanced;
+	int disable_goal;
+	int disable_takeover;
+
+	/* Game speed */
+	int speed;
+
+} store_game;
+
+/*
+ * A write to be done.
+ */
+typedef struct store_write
+{
+	/* Kind of write */
+	int type;
+
+	/* Game and user written */
+	int gid;
+	int uid;
+
+	/* Numbers written */
+	int num[3];
+
+	/* Allocated text or binary data written, and its length */
+	char *data[2];
+	int len[2];
+
+} store_write;
+
+/*
+ * Function called for each message read.
+ *
+ * User is NULL for messages not belonging to a known user.
+ */
+typedef void (*store_message_func)(void *arg, char *message, char *format,
+                                   char *user);
+
+/*
+ * A storage backend.
+ *
+ * Each thread using a backend must call open() or connect() first.  Writes
+ * are only done by one thread.
+ */
+typedef struct store
+{
+	/* Name to select backend with */
+	char *name;
+
+	/* Open database for the calling thread, return -1 on failure */
+	int (*open)(char *host, char *user, char *pass, char *db);
+
+	/* Connect another thread to the open database */
+	int (*connect)(void);
+
+	/* Find or create user, return -1 if password does not match */
+	int (*user)(char *user, char *pass);
+
+	/* Get name of user */
+	void (*user_name)(int uid, char *name);
+
+	/* Create game, and return its ID */
+	int (*new_game)(store_game *g_ptr);
+
+	/* Load waiting and started games, return number loaded */
+	int (*load_games)(store_game *list, int max);
+
+	/* Load a game, return -1 if not found */
+	int (*load_game)(int gid, store_game *g_ptr);
+
+	/* Load users of a game and their AI flags in seat order */
+	int (*load_players)(int gid, int *uids, int *ai, int max);
+
+	/* Load random byte pool, return 0 if none */
+	int (*load_seed)(int gid, unsigned char *pool, int len);
+
+	/* Load choice log, return allocated data and its length, or -1 */
+	int (*load_choices)(int gid, int uid, unsigned char **data);
+
+	/* Load checkpoint, return allocated state and its length, or -1 */
+	int (*load_checkpoint)(int gid, int *rand_pos, char **state);
+
+	/* Read messages seen by a user, or all messages if uid is negative */
+	void (*load_messages)(int gid, int uid, store_message_func func,
+	                      void *arg);
+
+	/*
+	 * Do a list of writes.
+	 *
+	 * The backend may keep written data, and set the pointer to NULL.
+	 */
+	void (*write)(store_write *list, int n);
+
+} store;
+
+/*
+ * Backends.
+ */
+extern store store_mysql;
+extern store store_sqlite;
+extern store store_memory;
+
+/*
+ * External functions.
+ */
+extern store *find_store(char *name);
+extern void store_hash(char *text, char *hex);
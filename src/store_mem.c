@@ -0,0 +1,721 @@
+/*
+ * Race for the Galaxy AI
+ *
+ * Copyright (C) 2009-2015 Keldon Jones
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "rftg.h"
+#include "store.h"
+#include <pthread.h>
+
+/*
+ * A user.
+ */
+typedef struct mem_account
+{
+	/* User name */
+	char *name;
+
+	/* Hashed password */
+	char hash[41];
+
+} mem_account;
+
+/*
+ * A user attending a game.
+ */
+typedef struct mem_player
+{
+	/* User ID */
+	int uid;
+
+	/* AI control */
+	int ai;
+
+	/* Seat */
+	int seat;
+
+	/* Waiting state */
+	int waiting;
+
+} mem_player;
+
+/*
+ * A choice log.
+ */
+typedef struct mem_choices
+{
+	/* User ID */
+	int uid;
+
+	/* Encoded log */
+	char *data;
+	int len;
+
+} mem_choices;
+
+/*
+ * A message.
+ */
+typedef struct mem_message
+{
+	/* User ID, or -1 for all users */
+	int uid;
+
+	/* Text and format */
+	char *message;
+	char *format;
+
+} mem_message;
+
+/*
+ * A game.
+ */
+typedef struct mem_game
+{
+	/* Basic information */
+	store_game info;
+
+	/* Users attending */
+	mem_player players[MAX_PLAYER];
+	int num_players;
+
+	/* Random byte pool */
+	char *seed;
+	int seed_len;
+
+	/* Choice logs */
+	mem_choices choices[MAX_PLAYER];
+	int num_choices;
+
+	/* Checkpoint */
+	char *state;
+	int state_len;
+	int rand_pos;
+
+	/* Messages */
+	mem_message *messages;
+	int num_messages;
+	int max_messages;
+
+	/* Results (user, points, tiebreaker and winner flag) */
+	int results[MAX_PLAYER][4];
+	int num_results;
+
+} mem_game;
+
+/*
+ * Users, indexed by user ID less one.
+ */
+static mem_account *users;
+static int num_users, max_users;
+
+/*
+ * Games, indexed by game ID less one.
+ */
+static mem_game **games;
+static int num_games, max_games;
+
+/*
+ * Mutex protecting everything stored.
+ */
+static pthread_mutex_t mem_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Nothing needs to be done to use the store from another thread.
+ */
+static int mem_connect(void)
+{
+	/* Success */
+	return 0;
+}
+
+/*
+ * Start with nothing stored.
+ */
+static int mem_open(char *host, char *user, char *pass, char *db)
+{
+	/* Success */
+	return 0;
+}
+
+/*
+ * Return a game, or NULL if there is none with the given ID.
+ *
+ * The mutex must be held.
+ */
+static mem_game *find_game(int gid)
+{
+	/* Check for bad game ID */
+	if (gid < 1 || gid > num_games) return NULL;
+
+	/* Return game */
+	return games[gid - 1];
+}
+
+/*
+ * Return a user attending a game, or NULL.
+ *
+ * The mutex must be held.
+ */
+static mem_player *find_player(mem_game *g_ptr, int uid)
+{
+	int i;
+
+	/* Loop over players */
+	for (i = 0; i < g_ptr->num_players; i++)
+	{
+		/* Check for matching user */
+		if (g_ptr->players[i].uid == uid) return &g_ptr->players[i];
+	}
+
+	/* Not found */
+	return NULL;
+}
+
+/*
+ * Return the choice log of a user, or NULL.
+ *
+ * The mutex must be held.
+ */
+static mem_choices *find_choices(mem_game *g_ptr, int uid)
+{
+	int i;
+
+	/* Loop over choice logs */
+	for (i = 0; i < g_ptr->num_choices; i++)
+	{
+		/* Check for matching user */
+		if (g_ptr->choices[i].uid == uid) return &g_ptr->choices[i];
+	}
+
+	/* Not found */
+	return NULL;
+}
+
+/*
+ * Find or create a user.
+ */
+static int mem_user(char *user, char *pass)
+{
+	char hash[41];
+	int i, uid = -1;
+
+	/* Hash password */
+	store_hash(pass, hash);
+
+	/* Grab mutex */
+	pthread_mutex_lock(&mem_mutex);
+
+	/* Loop over users */
+	for (i = 0; i < num_users; i++)
+	{
+		/* Check for matching name */
+		if (!strcmp(users[i].name, user)) break;
+	}
+
+	/* Check for user found */
+	if (i < num_users)
+	{
+		/* Check for matching password */
+		if (!strcmp(users[i].hash, hash)) uid = i + 1;
+	}
+	else
+	{
+		/* Check for full list */
+		if (num_users == max_users)
+		{
+			/* Enlarge list */
+			max_users = max_users ? 2 * max_users : 64;
+			users = (mem_account *)realloc(users,
+			                               max_users * sizeof(mem_account));
+		}
+
+		/* Add user */
+		users[num_users].name = strdup(user);
+		strcpy(users[num_users].hash, hash);
+		uid = ++num_users;
+	}
+
+	/* Release mutex */
+	pthread_mutex_unlock(&mem_mutex);
+
+	/* Return ID */
+	return uid;
+}
+
+/*
+ * Get the name of a user.
+ */
+static void mem_user_name(int uid, char *name)
+{
+	/* Grab mutex */
+	pthread_mutex_lock(&mem_mutex);
+
+	/* Copy name */
+	strcpy(name, uid >= 1 && uid <= num_users ? users[uid - 1].name : "");
+
+	/* Release mutex */
+	pthread_mutex_unlock(&mem_mutex);
+}
+
+/*
+ * Create a game.
+ */
+static int mem_new_game(store_game *g_ptr)
+{
+	mem_game *n_ptr;
+	int gid;
+
+	/* Create game */
+	n_ptr = (mem_game *)calloc(1, sizeof(mem_game));
+
+	/* Copy information */
+	n_ptr->info = *g_ptr;
+	n_ptr->info.state = GS_WAITING;
+
+	/* Grab mutex */
+	pthread_mutex_lock(&mem_mutex);
+
+	/* Check for full list */
+	if (num_games == max_games)
+	{
+		/* Enlarge list */
+		max_games = max_games ? 2 * max_games : 64;
+		games = (mem_game **)realloc(games, max_games * sizeof(mem_game *));
+	}
+
+	/* Add game */
+	games[num_games] = n_ptr;
+	gid = ++num_games;
+
+	/* Set game ID */
+	n_ptr->info.gid = gid;
+
+	/* Release mutex */
+	pthread_mutex_unlock(&mem_mutex);
+
+	/* Return game ID */
+	return gid;
+}
+
+/*
+ * Load waiting and started games.
+ *
+ * Nothing survives a restart, so there are none.
+ */
+static int mem_load_games(store_game *list, int max)
+{
+	/* No games */
+	return 0;
+}
+
+/*
+ * Load a game.
+ */
+static int mem_load_game(int gid, store_game *g_ptr)
+{
+	mem_game *n_ptr;
+
+	/* Grab mutex */
+	pthread_mutex_lock(&mem_mutex);
+
+	/* Copy game information if found */
+	if ((n_ptr = find_game(gid))) *g_ptr = n_ptr->info;
+
+	/* Release mutex */
+	pthread_mutex_unlock(&mem_mutex);
+
+	/* Return whether game was found */
+	return n_ptr ? 0 : -1;
+}
+
+/*
+ * Load users of a game in seat order.
+ */
+static int mem_load_players(int gid, int *uids, int *ai, int max)
+{
+	mem_game *n_ptr;
+	mem_player list[MAX_PLAYER], temp;
+	int i, j, n = 0;
+
+	/* Grab mutex */
+	pthread_mutex_lock(&mem_mutex);
+
+	/* Check for game found */
+	if ((n_ptr = find_game(gid)))
+	{
+		/* Copy players */
+		n = n_ptr->num_players;
+		memcpy(list, n_ptr->players, n * sizeof(mem_player));
+	}
+
+	/* Release mutex */
+	pthread_mutex_unlock(&mem_mutex);
+
+	/* Sort players by seat, keeping order of equal seats */
+	for (i = 1; i < n; i++)
+	{
+		/* Move player back past later seats */
+		for (j = i; j > 0 && list[j - 1].seat > list[j].seat; j--)
+		{
+			/* Swap players */
+			temp = list[j];
+			list[j] = list[j - 1];
+			list[j - 1] = temp;
+		}
+	}
+
+	/* Do not return more than asked */
+	if (n > max) n = max;
+
+	/* Loop over players */
+	for (i = 0; i < n; i++)
+	{
+		/* Copy user and AI flag */
+		uids[i] = list[i].uid;
+		ai[i] = list[i].ai;
+	}
+
+	/* Return number of players */
+	return n;
+}
+
+/*
+ * Load random byte pool.
+ */
+static int mem_load_seed(int gid, unsigned char *pool, int len)
+{
+	mem_game *n_ptr;
+	int found = 0;
+
+	/* Grab mutex */
+	pthread_mutex_lock(&mem_mutex);
+
+	/* Check for pool found */
+	if ((n_ptr = find_game(gid)) && n_ptr->seed)
+	{
+		/* Copy pool */
+		memcpy(pool, n_ptr->seed, n_ptr->seed_len < len ?
+		                          n_ptr->seed_len : len);
+		found = 1;
+	}
+
+	/* Release mutex */
+	pthread_mutex_unlock(&mem_mutex);
+
+	/* Return whether pool was found */
+	return found;
+}
+
+/*
+ * Load a choice log.
+ */
+static int mem_load_choices(int gid, int uid, unsigned char **data)
+{
+	mem_game *n_ptr;
+	mem_choices *c_ptr;
+	int len = -1;
+
+	/* Grab mutex */
+	pthread_mutex_lock(&mem_mutex);
+
+	/* Check for log found */
+	if ((n_ptr = find_game(gid)) && (c_ptr = find_choices(n_ptr, uid)))
+	{
+		/* Copy log */
+		len = c_ptr->len;
+		*data = (unsigned char *)malloc(len);
+		memcpy(*data, c_ptr->data, len);
+	}
+
+	/* Release mutex */
+	pthread_mutex_unlock(&mem_mutex);
+
+	/* Return length */
+	return len;
+}
+
+/*
+ * Load a checkpoint.
+ */
+static int mem_load_checkpoint(int gid, int *rand_pos, char **state)
+{
+	mem_game *n_ptr;
+	int len = -1;
+
+	/* Grab mutex */
+	pthread_mutex_lock(&mem_mutex);
+
+	/* Check for checkpoint found */
+	if ((n_ptr = find_game(gid)) && n_ptr->state)
+	{
+		/* Copy state */
+		len = n_ptr->state_len;
+		*state = (char *)malloc(len);
+		memcpy(*state, n_ptr->state, len);
+
+		/* Get random pool position */
+		*rand_pos = n_ptr->rand_pos;
+	}
+
+	/* Release mutex */
+	pthread_mutex_unlock(&mem_mutex);
+
+	/* Return length */
+	return len;
+}
+
+/*
+ * Read messages of a game.
+ *
+ * The mutex is not held while each message is used, since the text of
+ * messages already added is never changed.
+ */
+static void mem_load_messages(int gid, int uid, store_message_func func,
+                              void *arg)
+{
+	mem_game *n_ptr;
+	mem_message *m_ptr;
+	char *message, *format, *name;
+	int i, n;
+
+	/* Grab mutex */
+	pthread_mutex_lock(&mem_mutex);
+
+	/* Loop over messages */
+	for (i = 0; (n_ptr = find_game(gid)) && i < n_ptr->num_messages; i++)
+	{
+		/* Get message pointer */
+		m_ptr = &n_ptr->messages[i];
+
+		/* Skip messages not seen by user */
+		if (uid >= 0 && m_ptr->uid != uid && m_ptr->uid != -1 &&
+		    strcmp(m_ptr->format, FORMAT_CHAT)) continue;
+
+		/* Get text and format, which are never moved */
+		message = m_ptr->message;
+		format = m_ptr->format;
+
+		/* Get name of user, if any */
+		n = m_ptr->uid;
+		name = n >= 1 && n <= num_users ? users[n - 1].name : NULL;
+
+		/* Release mutex while message is used */
+		pthread_mutex_unlock(&mem_mutex);
+
+		/* Pass message on */
+		func(arg, message, format, name);
+
+		/* Grab mutex */
+		pthread_mutex_lock(&mem_mutex);
+	}
+
+	/* Release mutex */
+	pthread_mutex_unlock(&mem_mutex);
+}
+
+/*
+ * Do a single write.
+ *
+ * The mutex must be held.
+ */
+static void write_one(store_write *w_ptr)
+{
+	mem_game *n_ptr;
+	mem_player *p_ptr;
+	mem_choices *c_ptr;
+	mem_message *m_ptr;
+	int i;
+
+	/* Get game */
+	if (!(n_ptr = find_game(w_ptr->gid))) return;
+
+	/* Get user's attendance, if any */
+	p_ptr = find_player(n_ptr, w_ptr->uid);
+
+	/* Check kind of write */
+	switch (w_ptr->type)
+	{
+		/* Join game */
+		case STORE_JOIN:
+			/* Check for no room */
+			if (n_ptr->num_players == MAX_PLAYER) break;
+
+			/* Add player */
+			p_ptr = &n_ptr->players[n_ptr->num_players++];
+			p_ptr->uid = w_ptr->uid;
+			p_ptr->ai = 0;
+			p_ptr->seat = 0;
+			p_ptr->waiting = -1;
+			break;
+
+		/* Leave game */
+		case STORE_LEAVE:
+			/* Check for player not found */
+			if (!p_ptr) break;
+
+			/* Remove player */
+			i = p_ptr - n_ptr->players;
+			memmove(p_ptr, p_ptr + 1,
+			        (--n_ptr->num_players - i) * sizeof(mem_player));
+			break;
+
+		/* Game state */
+		case STORE_STATE:
+			n_ptr->info.state = w_ptr->num[0];
+			break;
+
+		/* Random byte pool, unless already saved */
+		case STORE_SEED:
+			if (n_ptr->seed) break;
+			n_ptr->seed = w_ptr->data[0];
+			n_ptr->seed_len = w_ptr->len[0];
+			w_ptr->data[0] = NULL;
+			break;
+
+		/* Seat of user */
+		case STORE_SEAT:
+			if (p_ptr) p_ptr->seat = w_ptr->num[0];
+			break;
+
+		/* AI control of user */
+		case STORE_AI:
+			if (p_ptr) p_ptr->ai = w_ptr->num[0];
+			break;
+
+		/* Waiting state of user */
+		case STORE_WAITING:
+			if (p_ptr) p_ptr->waiting = w_ptr->num[0];
+			break;
+
+		/* Choice log */
+		case STORE_CHOICES:
+			/* Find log of user */
+			c_ptr = find_choices(n_ptr, w_ptr->uid);
+
+			/* Check for no log yet */
+			if (!c_ptr)
+			{
+				/* Check for no room */
+				if (n_ptr->num_choices == MAX_PLAYER) break;
+
+				/* Add log */
+				c_ptr = &n_ptr->choices[n_ptr->num_choices++];
+				c_ptr->uid = w_ptr->uid;
+				c_ptr->data = NULL;
+			}
+
+			/* Replace log */
+			free(c_ptr->data);
+			c_ptr->data = w_ptr->data[0];
+			c_ptr->len = w_ptr->len[0];
+			w_ptr->data[0] = NULL;
+			break;
+
+		/* Checkpoint */
+		case STORE_CHECKPOINT:
+			free(n_ptr->state);
+			n_ptr->state = w_ptr->data[0];
+			n_ptr->state_len = w_ptr->len[0];
+			n_ptr->rand_pos = w_ptr->num[0];
+			w_ptr->data[0] = NULL;
+			break;
+
+		/* Remove checkpoint */
+		case STORE_CLEAR:
+			free(n_ptr->state);
+			n_ptr->state = NULL;
+			break;
+
+		/* Message */
+		case STORE_MESSAGE:
+			/* Check for full list */
+			if (n_ptr->num_messages == n_ptr->max_messages)
+			{
+				/* Enlarge list */
+				n_ptr->max_messages = n_ptr->max_messages ?
+				                      2 * n_ptr->max_messages : 256;
+				n_ptr->messages = (mem_message *)realloc(
+				           n_ptr->messages,
+				           n_ptr->max_messages * sizeof(mem_message));
+			}
+
+			/* Add message */
+			m_ptr = &n_ptr->messages[n_ptr->num_messages++];
+			m_ptr->uid = w_ptr->uid;
+			m_ptr->message = w_ptr->data[0];
+			m_ptr->format = w_ptr->data[1];
+			w_ptr->data[0] = w_ptr->data[1] = NULL;
+			break;
+
+		/* Result */
+		case STORE_RESULT:
+			/* Check for no room */
+			if (n_ptr->num_results == MAX_PLAYER) break;
+
+			/* Add result */
+			i = n_ptr->num_results++;
+			n_ptr->results[i][0] = w_ptr->uid;
+			n_ptr->results[i][1] = w_ptr->num[0];
+			n_ptr->results[i][2] = w_ptr->num[1];
+			n_ptr->results[i][3] = w_ptr->num[2];
+			break;
+	}
+}
+
+/*
+ * Do a list of writes.
+ */
+static void mem_write(store_write *list, int n)
+{
+	int i;
+
+	/* Grab mutex */
+	pthread_mutex_lock(&mem_mutex);
+
+	/* Loop over writes */
+	for (i = 0; i < n; i++)
+	{
+		/* Do write */
+		write_one(&list[i]);
+	}
+
+	/* Release mutex */
+	pthread_mutex_unlock(&mem_mutex);
+}
+
+/*
+ * In-memory backend, which forgets everything when the server stops.
+ */
+store store_memory =
+{
+	"memory",
+	mem_open,
+	mem_connect,
+	mem_user,
+	mem_user_name,
+	mem_new_game,
+	mem_load_games,
+	mem_load_game,
+	mem_load_players,
+	mem_load_seed,
+	mem_load_choices,
+	mem_load_checkpoint,
+	mem_load_messages,
+	mem_write
+};
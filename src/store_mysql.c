@@ -0,0 +1,756 @@
+/*
+ * Race for the Galaxy AI
+ *
+ * Copyright (C) 2009-2015 Keldon Jones
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "rftg.h"
+#include "sql.h"
+#include "store.h"
+
+/*
+ * Most rows inserted by a single statement.
+ */
+#define ROWS_MAX 64
+
+/*
+ * Statements inserting rows into a table, several rows at a time.
+ */
+typedef struct rows
+{
+	/* Start of statement */
+	char *prefix;
+
+	/* Values of one row */
+	char *values;
+
+	/* Statements inserting each number of rows */
+	sql_stmt stmt[ROWS_MAX];
+
+} rows;
+
+/*
+ * Connection settings.
+ */
+static char *db_host, *db_user, *db_pass, *db_name;
+
+/*
+ * Connection of the calling thread.
+ */
+static __thread MYSQL *conn;
+
+/*
+ * Names of game states.
+ */
+static char *state_name[] = { "", "WAITING", "STARTED", "DONE", "ABANDONED" };
+
+/*
+ * Names of waiting states.
+ */
+static char *waiting_name[] = { "READY", "BLOCKED", "OPTION" };
+
+/*
+ * Statements used by each thread.
+ */
+static __thread sql_stmt stmt_find_user =
+	{ "SELECT pass, uid FROM users WHERE user=?" };
+static __thread sql_stmt stmt_add_user =
+	{ "INSERT INTO users (user, pass) VALUES (?, SHA1(?))" };
+static __thread sql_stmt stmt_hash_pass = { "SELECT SHA1(?)" };
+static __thread sql_stmt stmt_user_name =
+	{ "SELECT user FROM users WHERE uid=?" };
+static __thread sql_stmt stmt_new_game =
+	{ "INSERT INTO games (description, pass, created, state, minp, maxp, "
+	  "exp, adv, dis_goal, dis_takeover, speed, version) "
+	  "VALUES (?, ?, ?, 'WAITING', ?, ?, ?, ?, ?, ?, ?, ?)" };
+static __thread sql_stmt stmt_load_games =
+	{ "SELECT gid, description, pass, created, state, minp, maxp, exp, "
+	  "adv, dis_goal, dis_takeover, speed FROM games "
+	  "WHERE state='WAITING' OR state='STARTED'" };
+static __thread sql_stmt stmt_load_game =
+	{ "SELECT gid, description, pass, created, state, minp, maxp, exp, "
+	  "adv, dis_goal, dis_takeover, speed FROM games WHERE gid=?" };
+static __thread sql_stmt stmt_load_players =
+	{ "SELECT uid, ai FROM attendance WHERE gid=? ORDER BY seat" };
+static __thread sql_stmt stmt_load_seed =
+	{ "SELECT pool FROM seed WHERE gid=?" };
+static __thread sql_stmt stmt_load_choices =
+	{ "SELECT log FROM choices WHERE gid=? AND uid=?" };
+static __thread sql_stmt stmt_load_checkpoint =
+	{ "SELECT rand_pos, state FROM checkpoints WHERE gid=?" };
+static __thread sql_stmt stmt_all_messages =
+	{ "SELECT message, format, user "
+	  "FROM messages LEFT JOIN users USING (uid) "
+	  "WHERE gid=? ORDER BY mid" };
+static __thread sql_stmt stmt_user_messages =
+	{ "SELECT message, format, user "
+	  "FROM messages LEFT JOIN users USING (uid) "
+	  "WHERE gid=? AND (uid=? OR uid=-1 OR format=?) ORDER BY mid" };
+static __thread sql_stmt stmt_join =
+	{ "INSERT INTO attendance (uid, gid) VALUES (?, ?)" };
+static __thread sql_stmt stmt_leave =
+	{ "DELETE FROM attendance WHERE uid=? AND gid=?" };
+static __thread sql_stmt stmt_state = { "UPDATE games SET state=? WHERE gid=?" };
+static __thread sql_stmt stmt_seed = { "INSERT IGNORE INTO seed VALUES (?, ?)" };
+static __thread sql_stmt stmt_seat =
+	{ "UPDATE attendance SET seat=? WHERE gid=? AND uid=?" };
+static __thread sql_stmt stmt_ai =
+	{ "UPDATE attendance SET ai=? WHERE gid=? AND uid=?" };
+static __thread sql_stmt stmt_waiting =
+	{ "UPDATE attendance SET waiting=? WHERE gid=? AND uid=?" };
+static __thread sql_stmt stmt_choices =
+	{ "REPLACE INTO choices VALUES (?, ?, ?)" };
+static __thread sql_stmt stmt_checkpoint =
+	{ "REPLACE INTO checkpoints VALUES (?, ?, ?)" };
+static __thread sql_stmt stmt_clear =
+	{ "DELETE FROM checkpoints WHERE gid=?" };
+
+/*
+ * Statements inserting rows.
+ */
+static __thread rows insert_message =
+	{ "INSERT INTO messages (gid, uid, message, format) VALUES ",
+	  "(?, ?, ?, ?)" };
+static __thread rows insert_result =
+	{ "INSERT INTO results VALUES ", "(?, ?, ?, ?, ?)" };
+
+/*
+ * Connect the calling thread to the database server.
+ */
+static int mys_connect(void)
+{
+	my_bool reconnect = 1;
+
+	/* Prepare database library for this thread */
+	mysql_thread_init();
+
+	/* Initialize connection */
+	conn = mysql_init(NULL);
+
+	/* Check for error */
+	if (!conn)
+	{
+		/* Print error */
+		printf("Couldn't initialize database library!\n");
+		return -1;
+	}
+
+	/* Attempt to connect to database server */
+	if (!mysql_real_connect(conn, db_host, db_user, db_pass, db_name, 0,
+	                        NULL, 0))
+	{
+		/* Print error */
+		printf("Database connection: %s\n", mysql_error(conn));
+		return -1;
+	}
+
+	/* Reconnect automatically when connection to database is lost */
+	mysql_options(conn, MYSQL_OPT_RECONNECT, &reconnect);
+
+	/* Success */
+	return 0;
+}
+
+/*
+ * Remember connection settings, and connect the calling thread.
+ */
+static int mys_open(char *host, char *user, char *pass, char *db)
+{
+	/* Remember settings */
+	db_host = host;
+	db_user = user;
+	db_pass = pass;
+	db_name = db;
+
+	/* Connect */
+	return mys_connect();
+}
+
+/*
+ * Find or create a user.
+ */
+static int mys_user(char *user, char *pass)
+{
+	sql_param param[2];
+	char **row1, **row2;
+	int uid;
+
+	/* Look up user */
+	sql_text(&param[0], user);
+	sql_select(conn, &stmt_find_user, param, 1);
+
+	/* Check for no rows returned */
+	if (!(row1 = sql_fetch(&stmt_find_user)))
+	{
+		/* Free old results */
+		sql_done(&stmt_find_user);
+
+		/* Insert user */
+		sql_text(&param[0], user);
+		sql_text(&param[1], pass);
+		sql_run(conn, &stmt_add_user, param, 2);
+
+		/* Return ID of user inserted */
+		return sql_insert_id(&stmt_add_user);
+	}
+
+	/* Hash password */
+	sql_text(&param[0], pass);
+	sql_select(conn, &stmt_hash_pass, param, 1);
+
+	/* Get row */
+	row2 = sql_fetch(&stmt_hash_pass);
+
+	/* Check for matching password */
+	uid = strcmp(row2[0], row1[0]) ? -1 : strtol(row1[1], NULL, 0);
+
+	/* Free results */
+	sql_done(&stmt_find_user);
+	sql_done(&stmt_hash_pass);
+
+	/* Return ID */
+	return uid;
+}
+
+/*
+ * Get the name of a user.
+ */
+static void mys_user_name(int uid, char *name)
+{
+	sql_param param[1];
+	char **row;
+
+	/* Look up user */
+	sql_int(&param[0], uid);
+	sql_select(conn, &stmt_user_name, param, 1);
+
+	/* Get row */
+	row = sql_fetch(&stmt_user_name);
+
+	/* Copy user name */
+	strcpy(name, row ? row[0] : "");
+
+	/* Free result */
+	sql_done(&stmt_user_name);
+}
+
+/*
+ * Create a game.
+ */
+static int mys_new_game(store_game *g_ptr)
+{
+	sql_param param[11];
+
+	/* Set game fields */
+	sql_text(&param[0], g_ptr->desc);
+	sql_text(&param[1], g_ptr->pass);
+	sql_int(&param[2], g_ptr->created);
+	sql_int(&param[3], g_ptr->min_player);
+	sql_int(&param[4], g_ptr->max_player);
+	sql_int(&param[5], g_ptr->expanded);
+	sql_int(&param[6], g_ptr->advanced);
+	sql_int(&param[7], g_ptr->disable_goal);
+	sql_int(&param[8], g_ptr->disable_takeover);
+	sql_int(&param[9], g_ptr->speed);
+	sql_text(&param[10], VERSION);
+
+	/* Insert game */
+	if (sql_run(conn, &stmt_new_game, param, 11) < 0)
+	{
+		/* Print error */
+		printf("Database write: %s\n", sql_error(&stmt_new_game));
+		return -1;
+	}
+
+	/* Return ID of game inserted */
+	return sql_insert_id(&stmt_new_game);
+}
+
+/*
+ * Read a game from a row.
+ */
+static void read_game(char **row, store_game *g_ptr)
+{
+	int i;
+
+	/* Read fields */
+	g_ptr->gid = strtol(row[0], NULL, 0);
+	snprintf(g_ptr->desc, sizeof(g_ptr->desc), "%s", row[1]);
+	snprintf(g_ptr->pass, sizeof(g_ptr->pass), "%s", row[2]);
+	g_ptr->created = strtol(row[3], NULL, 0);
+
+	/* Assume unknown state */
+	g_ptr->state = 0;
+
+	/* Loop over state names */
+	for (i = GS_WAITING; i <= GS_ABANDONED; i++)
+	{
+		/* Check for matching name */
+		if (row[4] && !strcmp(row[4], state_name[i])) g_ptr->state = i;
+	}
+
+	/* Read fields */
+	g_ptr->min_player = strtol(row[5], NULL, 0);
+	g_ptr->max_player = strtol(row[6], NULL, 0);
+	g_ptr->expanded = strtol(row[7], NULL, 0);
+	g_ptr->advanced = strtol(row[8], NULL, 0);
+	g_ptr->disable_goal = strtol(row[9], NULL, 0);
+	g_ptr->disable_takeover = strtol(row[10], NULL, 0);
+	g_ptr->speed = strtol(row[11], NULL, 0);
+}
+
+/*
+ * Load waiting and started games.
+ */
+static int mys_load_games(store_game *list, int max)
+{
+	char **row;
+	int n = 0;
+
+	/* Run query */
+	sql_select(conn, &stmt_load_games, NULL, 0);
+
+	/* Loop over rows returned */
+	while (n < max && (row = sql_fetch(&stmt_load_games)))
+	{
+		/* Read game */
+		read_game(row, &list[n++]);
+	}
+
+	/* Free results */
+	sql_done(&stmt_load_games);
+
+	/* Return number of games */
+	return n;
+}
+
+/*
+ * Load a game.
+ */
+static int mys_load_game(int gid, store_game *g_ptr)
+{
+	sql_param param[1];
+	char **row;
+
+	/* Look up game */
+	sql_int(&param[0], gid);
+	sql_select(conn, &stmt_load_game, param, 1);
+
+	/* Check for game found */
+	if ((row = sql_fetch(&stmt_load_game))) read_game(row, g_ptr);
+
+	/* Free result */
+	sql_done(&stmt_load_game);
+
+	/* Return whether game was found */
+	return row ? 0 : -1;
+}
+
+/*
+ * Load users of a game in seat order.
+ */
+static int mys_load_players(int gid, int *uids, int *ai, int max)
+{
+	sql_param param[1];
+	char **row;
+	int n = 0;
+
+	/* Look up players */
+	sql_int(&param[0], gid);
+	sql_select(conn, &stmt_load_players, param, 1);
+
+	/* Loop over rows returned */
+	while (n < max && (row = sql_fetch(&stmt_load_players)))
+	{
+		/* Read user and AI flag */
+		uids[n] = strtol(row[0], NULL, 0);
+		ai[n++] = strtol(row[1], NULL, 0);
+	}
+
+	/* Free results */
+	sql_done(&stmt_load_players);
+
+	/* Return number of players */
+	return n;
+}
+
+/*
+ * Load random byte pool.
+ */
+static int mys_load_seed(int gid, unsigned char *pool, int len)
+{
+	sql_param param[1];
+	unsigned long *field_len;
+	char **row;
+
+	/* Look up pool */
+	sql_int(&param[0], gid);
+	sql_select(conn, &stmt_load_seed, param, 1);
+
+	/* Check for pool found */
+	if ((row = sql_fetch(&stmt_load_seed)))
+	{
+		/* Get length of pool */
+		field_len = sql_lengths(&stmt_load_seed);
+
+		/* Copy pool */
+		memcpy(pool, row[0], field_len[0] < len ? field_len[0] : len);
+	}
+
+	/* Free result */
+	sql_done(&stmt_load_seed);
+
+	/* Return whether pool was found */
+	return row != NULL;
+}
+
+/*
+ * Load a choice log.
+ */
+static int mys_load_choices(int gid, int uid, unsigned char **data)
+{
+	sql_param param[2];
+	unsigned long *field_len;
+	char **row;
+	int len = -1;
+
+	/* Look up choice log */
+	sql_int(&param[0], gid);
+	sql_int(&param[1], uid);
+	sql_select(conn, &stmt_load_choices, param, 2);
+
+	/* Check for log found */
+	if ((row = sql_fetch(&stmt_load_choices)))
+	{
+		/* Get length of log */
+		field_len = sql_lengths(&stmt_load_choices);
+		len = field_len[0];
+
+		/* Copy log */
+		*data = (unsigned char *)malloc(len);
+		memcpy(*data, row[0], len);
+	}
+
+	/* Free result */
+	sql_done(&stmt_load_choices);
+
+	/* Return length */
+	return len;
+}
+
+/*
+ * Load a checkpoint.
+ */
+static int mys_load_checkpoint(int gid, int *rand_pos, char **state)
+{
+	sql_param param[1];
+	unsigned long *field_len;
+	char **row;
+	int len = -1;
+
+	/* Look up checkpoint */
+	sql_int(&param[0], gid);
+	sql_select(conn, &stmt_load_checkpoint, param, 1);
+
+	/* Check for checkpoint found */
+	if ((row = sql_fetch(&stmt_load_checkpoint)))
+	{
+		/* Get length of state */
+		field_len = sql_lengths(&stmt_load_checkpoint);
+		len = field_len[1];
+
+		/* Copy state */
+		*state = (char *)malloc(len);
+		memcpy(*state, row[1], len);
+
+		/* Get random pool position */
+		*rand_pos = strtol(row[0], NULL, 0);
+	}
+
+	/* Free result */
+	sql_done(&stmt_load_checkpoint);
+
+	/* Return length */
+	return len;
+}
+
+/*
+ * Read messages of a game.
+ */
+static void mys_load_messages(int gid, int uid, store_message_func func,
+                              void *arg)
+{
+	sql_param param[3];
+	sql_stmt *s_ptr;
+	char **row;
+
+	/* Set game */
+	sql_int(&param[0], gid);
+
+	/* Check for all messages wanted */
+	if (uid < 0)
+	{
+		/* Look up all messages */
+		s_ptr = &stmt_all_messages;
+		sql_select(conn, s_ptr, param, 1);
+	}
+	else
+	{
+		/* Look up messages seen by user */
+		s_ptr = &stmt_user_messages;
+		sql_int(&param[1], uid);
+		sql_text(&param[2], FORMAT_CHAT);
+		sql_select(conn, s_ptr, param, 3);
+	}
+
+	/* Loop over rows returned */
+	while ((row = sql_fetch(s_ptr)))
+	{
+		/* Pass message on */
+		func(arg, row[0], row[1], row[2]);
+	}
+
+	/* Free results */
+	sql_done(s_ptr);
+}
+
+/*
+ * Insert rows of the same kind with a single statement.
+ */
+static void insert_rows(store_write *list, int n)
+{
+	sql_param param[ROWS_MAX * 5];
+	sql_stmt *s_ptr;
+	rows *r_ptr;
+	char *ptr;
+	int i, k = 0, len;
+
+	/* Check for messages */
+	if (list[0].type == STORE_MESSAGE)
+	{
+		/* Insert messages */
+		r_ptr = &insert_message;
+
+		/* Loop over rows */
+		for (i = 0; i < n; i++)
+		{
+			/* Set values of row */
+			sql_int(&param[k++], list[i].gid);
+			sql_int(&param[k++], list[i].uid);
+			sql_text(&param[k++], list[i].data[0]);
+			sql_text(&param[k++], list[i].data[1]);
+		}
+	}
+	else
+	{
+		/* Insert results */
+		r_ptr = &insert_result;
+
+		/* Loop over rows */
+		for (i = 0; i < n; i++)
+		{
+			/* Set values of row */
+			sql_int(&param[k++], list[i].gid);
+			sql_int(&param[k++], list[i].uid);
+			sql_int(&param[k++], list[i].num[0]);
+			sql_int(&param[k++], list[i].num[1]);
+			sql_int(&param[k++], list[i].num[2]);
+		}
+	}
+
+	/* Get statement inserting this many rows */
+	s_ptr = &r_ptr->stmt[n - 1];
+
+	/* Check for statement text not yet created */
+	if (!s_ptr->query)
+	{
+		/* Allocate statement text */
+		len = strlen(r_ptr->prefix) + n * (strlen(r_ptr->values) + 2) + 1;
+		s_ptr->query = (char *)malloc(len);
+
+		/* Start statement */
+		ptr = s_ptr->query + sprintf(s_ptr->query, "%s", r_ptr->prefix);
+
+		/* Add values of each row */
+		for (i = 0; i < n; i++)
+		{
+			/* Add row */
+			ptr += sprintf(ptr, "%s%s", i ? ", " : "", r_ptr->values);
+		}
+	}
+
+	/* Run statement */
+	if (sql_run(conn, s_ptr, param, k) < 0)
+	{
+		/* Print error */
+		printf("Database write: %s\n", sql_error(s_ptr));
+	}
+}
+
+/*
+ * Do a single write.
+ */
+static void write_one(store_write *w_ptr)
+{
+	sql_param param[3];
+	sql_stmt *s_ptr = NULL;
+	int n = 0;
+
+	/* Check kind of write */
+	switch (w_ptr->type)
+	{
+		/* Join or leave game */
+		case STORE_JOIN:
+		case STORE_LEAVE:
+			s_ptr = w_ptr->type == STORE_JOIN ? &stmt_join : &stmt_leave;
+			sql_int(&param[n++], w_ptr->uid);
+			sql_int(&param[n++], w_ptr->gid);
+			break;
+
+		/* Game state */
+		case STORE_STATE:
+			s_ptr = &stmt_state;
+			sql_text(&param[n++], state_name[w_ptr->num[0]]);
+			sql_int(&param[n++], w_ptr->gid);
+			break;
+
+		/* Random byte pool */
+		case STORE_SEED:
+			s_ptr = &stmt_seed;
+			sql_int(&param[n++], w_ptr->gid);
+			sql_blob(&param[n++], w_ptr->data[0], w_ptr->len[0]);
+			break;
+
+		/* Seat, AI control or waiting state of user */
+		case STORE_SEAT:
+		case STORE_AI:
+		case STORE_WAITING:
+			/* Check for waiting state */
+			if (w_ptr->type == STORE_WAITING)
+			{
+				/* Check for no waiting state */
+				if (w_ptr->num[0] < 0 || w_ptr->num[0] > 2)
+				{
+					/* Clear state */
+					sql_null(&param[n++]);
+				}
+				else
+				{
+					/* Set state */
+					sql_text(&param[n++], waiting_name[w_ptr->num[0]]);
+				}
+
+				/* Use waiting statement */
+				s_ptr = &stmt_waiting;
+			}
+			else
+			{
+				/* Set seat or AI flag */
+				sql_int(&param[n++], w_ptr->num[0]);
+				s_ptr = w_ptr->type == STORE_SEAT ? &stmt_seat : &stmt_ai;
+			}
+
+			/* Set game and user */
+			sql_int(&param[n++], w_ptr->gid);
+			sql_int(&param[n++], w_ptr->uid);
+			break;
+
+		/* Choice log */
+		case STORE_CHOICES:
+			s_ptr = &stmt_choices;
+			sql_int(&param[n++], w_ptr->gid);
+			sql_int(&param[n++], w_ptr->uid);
+			sql_blob(&param[n++], w_ptr->data[0], w_ptr->len[0]);
+			break;
+
+		/* Checkpoint */
+		case STORE_CHECKPOINT:
+			s_ptr = &stmt_checkpoint;
+			sql_int(&param[n++], w_ptr->gid);
+			sql_int(&param[n++], w_ptr->num[0]);
+			sql_blob(&param[n++], w_ptr->data[0], w_ptr->len[0]);
+			break;
+
+		/* Remove checkpoint */
+		case STORE_CLEAR:
+			s_ptr = &stmt_clear;
+			sql_int(&param[n++], w_ptr->gid);
+			break;
+	}
+
+	/* Check for unknown write */
+	if (!s_ptr) return;
+
+	/* Run statement */
+	if (sql_run(conn, s_ptr, param, n) < 0)
+	{
+		/* Print error */
+		printf("Database write: %s\n", sql_error(s_ptr));
+	}
+}
+
+/*
+ * Do a list of writes.
+ *
+ * Rows of messages or results next to each other are inserted together.
+ */
+static void mys_write(store_write *list, int n)
+{
+	int i, k;
+
+	/* Loop over writes */
+	for (i = 0; i < n; i += k)
+	{
+		/* Check for rows to insert */
+		if (list[i].type == STORE_MESSAGE || list[i].type == STORE_RESULT)
+		{
+			/* Count rows of the same kind following */
+			for (k = 1; i + k < n && k < ROWS_MAX &&
+			            list[i + k].type == list[i].type; k++) ;
+
+			/* Insert rows */
+			insert_rows(list + i, k);
+		}
+		else
+		{
+			/* Do single write */
+			write_one(&list[i]);
+			k = 1;
+		}
+	}
+}
+
+/*
+ * MySQL backend.
+ */
+store store_mysql =
+{
+	"mysql",
+	mys_open,
+	mys_connect,
+	mys_user,
+	mys_user_name,
+	mys_new_game,
+	mys_load_games,
+	mys_load_game,
+	mys_load_players,
+	mys_load_seed,
+	mys_load_choices,
+	mys_load_checkpoint,
+	mys_load_messages,
+	mys_write
+};
@@ -0,0 +1,802 @@
+/*
+ * Race for the Galaxy AI
+ *
+ * Copyright (C) 2009-2015 Keldon Jones
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "rftg.h"
+#include "store.h"
+#include <sqlite3.h>
+
+/*
+ * Milliseconds to wait for another thread's transaction.
+ */
+#define BUSY_TIMEOUT 10000
+
+/*
+ * A statement, prepared on first use by each thread.
+ */
+typedef struct lite_stmt
+{
+	/* Text of statement */
+	char *query;
+
+	/* Prepared statement */
+	sqlite3_stmt *stmt;
+
+} lite_stmt;
+
+/*
+ * Name of database file.
+ */
+static char *db_file;
+
+/*
+ * Connection of the calling thread.
+ */
+static __thread sqlite3 *conn;
+
+/*
+ * Names of game states.
+ */
+static char *state_name[] = { "", "WAITING", "STARTED", "DONE", "ABANDONED" };
+
+/*
+ * Names of waiting states.
+ */
+static char *waiting_name[] = { "READY", "BLOCKED", "OPTION" };
+
+/*
+ * Tables, created when missing.
+ */
+static char *schema =
+	"CREATE TABLE IF NOT EXISTS users("
+	" uid INTEGER PRIMARY KEY AUTOINCREMENT,"
+	" user TEXT NOT NULL UNIQUE,"
+	" pass TEXT NOT NULL);"
+	"CREATE TABLE IF NOT EXISTS games("
+	" gid INTEGER PRIMARY KEY AUTOINCREMENT,"
+	" description TEXT NOT NULL,"
+	" pass TEXT NOT NULL,"
+	" created INT NOT NULL,"
+	" state TEXT,"
+	" minp INT NOT NULL,"
+	" maxp INT NOT NULL,"
+	" exp INT NOT NULL,"
+	" adv INT NOT NULL,"
+	" dis_goal INT NOT NULL,"
+	" dis_takeover INT NOT NULL,"
+	" speed INT NOT NULL,"
+	" version TEXT NOT NULL);"
+	"CREATE TABLE IF NOT EXISTS attendance("
+	" uid INT NOT NULL,"
+	" gid INT NOT NULL,"
+	" ai INT NOT NULL DEFAULT 0,"
+	" seat INT NOT NULL DEFAULT 0,"
+	" waiting TEXT);"
+	"CREATE INDEX IF NOT EXISTS attendance_gid ON attendance (gid);"
+	"CREATE TABLE IF NOT EXISTS results("
+	" gid INT NOT NULL,"
+	" uid INT NOT NULL,"
+	" vp INT NOT NULL,"
+	" tie INT NOT NULL,"
+	" winner INT NOT NULL);"
+	"CREATE TABLE IF NOT EXISTS seed("
+	" gid INTEGER PRIMARY KEY,"
+	" pool BLOB NOT NULL);"
+	"CREATE TABLE IF NOT EXISTS choices("
+	" gid INT NOT NULL,"
+	" uid INT NOT NULL,"
+	" log BLOB NOT NULL,"
+	" PRIMARY KEY (gid, uid));"
+	"CREATE TABLE IF NOT EXISTS checkpoints("
+	" gid INTEGER PRIMARY KEY,"
+	" rand_pos INT NOT NULL,"
+	" state BLOB NOT NULL);"
+	"CREATE TABLE IF NOT EXISTS messages("
+	" mid INTEGER PRIMARY KEY AUTOINCREMENT,"
+	" gid INT NOT NULL,"
+	" uid INT NOT NULL,"
+	" message TEXT NOT NULL,"
+	" format TEXT NOT NULL);"
+	"CREATE INDEX IF NOT EXISTS messages_gid ON messages (gid);";
+
+/*
+ * Statements used by each thread.
+ */
+static __thread lite_stmt stmt_find_user =
+	{ "SELECT pass, uid FROM users WHERE user=?" };
+static __thread lite_stmt stmt_add_user =
+	{ "INSERT INTO users (user, pass) VALUES (?, ?)" };
+static __thread lite_stmt stmt_user_name =
+	{ "SELECT user FROM users WHERE uid=?" };
+static __thread lite_stmt stmt_new_game =
+	{ "INSERT INTO games (description, pass, created, state, minp, maxp, "
+	  "exp, adv, dis_goal, dis_takeover, speed, version) "
+	  "VALUES (?, ?, ?, 'WAITING', ?, ?, ?, ?, ?, ?, ?, ?)" };
+static __thread lite_stmt stmt_load_games =
+	{ "SELECT gid, description, pass, created, state, minp, maxp, exp, "
+	  "adv, dis_goal, dis_takeover, speed FROM games "
+	  "WHERE state='WAITING' OR state='STARTED'" };
+static __thread lite_stmt stmt_load_game =
+	{ "SELECT gid, description, pass, created, state, minp, maxp, exp, "
+	  "adv, dis_goal, dis_takeover, speed FROM games WHERE gid=?" };
+static __thread lite_stmt stmt_load_players =
+	{ "SELECT uid, ai FROM attendance WHERE gid=? ORDER BY seat" };
+static __thread lite_stmt stmt_load_seed =
+	{ "SELECT pool FROM seed WHERE gid=?" };
+static __thread lite_stmt stmt_load_choices =
+	{ "SELECT log FROM choices WHERE gid=? AND uid=?" };
+static __thread lite_stmt stmt_load_checkpoint =
+	{ "SELECT rand_pos, state FROM checkpoints WHERE gid=?" };
+static __thread lite_stmt stmt_all_messages =
+	{ "SELECT message, format, user "
+	  "FROM messages LEFT JOIN users USING (uid) "
+	  "WHERE gid=? ORDER BY mid" };
+static __thread lite_stmt stmt_user_messages =
+	{ "SELECT message, format, user "
+	  "FROM messages LEFT JOIN users USING (uid) "
+	  "WHERE gid=? AND (uid=? OR uid=-1 OR format=?) ORDER BY mid" };
+static __thread lite_stmt stmt_begin = { "BEGIN IMMEDIATE" };
+static __thread lite_stmt stmt_commit = { "COMMIT" };
+static __thread lite_stmt stmt_join =
+	{ "INSERT INTO attendance (uid, gid) VALUES (?, ?)" };
+static __thread lite_stmt stmt_leave =
+	{ "DELETE FROM attendance WHERE uid=? AND gid=?" };
+static __thread lite_stmt stmt_state =
+	{ "UPDATE games SET state=? WHERE gid=?" };
+static __thread lite_stmt stmt_seed =
+	{ "INSERT OR IGNORE INTO seed VALUES (?, ?)" };
+static __thread lite_stmt stmt_seat =
+	{ "UPDATE attendance SET seat=? WHERE gid=? AND uid=?" };
+static __thread lite_stmt stmt_ai =
+	{ "UPDATE attendance SET ai=? WHERE gid=? AND uid=?" };
+static __thread lite_stmt stmt_waiting =
+	{ "UPDATE attendance SET waiting=? WHERE gid=? AND uid=?" };
+static __thread lite_stmt stmt_choices =
+	{ "REPLACE INTO choices VALUES (?, ?, ?)" };
+static __thread lite_stmt stmt_checkpoint =
+	{ "REPLACE INTO checkpoints VALUES (?, ?, ?)" };
+static __thread lite_stmt stmt_clear =
+	{ "DELETE FROM checkpoints WHERE gid=?" };
+static __thread lite_stmt stmt_message =
+	{ "INSERT INTO messages (gid, uid, message, format) "
+	  "VALUES (?, ?, ?, ?)" };
+static __thread lite_stmt stmt_result =
+	{ "INSERT INTO results VALUES (?, ?, ?, ?, ?)" };
+
+/*
+ * Return a statement ready to have parameters bound, or NULL on error.
+ */
+static sqlite3_stmt *prepare(lite_stmt *s_ptr)
+{
+	/* Check for statement not yet prepared */
+	if (!s_ptr->stmt &&
+	    sqlite3_prepare_v2(conn, s_ptr->query, -1, &s_ptr->stmt, NULL))
+	{
+		/* Print error */
+		printf("Database statement: %s\n", sqlite3_errmsg(conn));
+		return NULL;
+	}
+
+	/* Return statement */
+	return s_ptr->stmt;
+}
+
+/*
+ * Reset a statement after use.
+ */
+static void finish(sqlite3_stmt *stmt)
+{
+	/* Reset statement and forget parameters */
+	sqlite3_reset(stmt);
+	sqlite3_clear_bindings(stmt);
+}
+
+/*
+ * Run a statement returning no rows, and reset it.
+ */
+static void run(sqlite3_stmt *stmt)
+{
+	/* Run statement */
+	if (sqlite3_step(stmt) != SQLITE_DONE)
+	{
+		/* Print error */
+		printf("Database write: %s\n", sqlite3_errmsg(conn));
+	}
+
+	/* Reset statement */
+	finish(stmt);
+}
+
+/*
+ * Copy a text column.
+ */
+static void copy_text(sqlite3_stmt *stmt, int col, char *dest, int size)
+{
+	const unsigned char *text;
+
+	/* Get text */
+	text = sqlite3_column_text(stmt, col);
+
+	/* Copy text */
+	snprintf(dest, size, "%s", text ? (char *)text : "");
+}
+
+/*
+ * Connect the calling thread to the database file.
+ */
+static int lite_connect(void)
+{
+	/* Open database */
+	if (sqlite3_open(db_file, &conn))
+	{
+		/* Print error */
+		printf("Database connection: %s\n", sqlite3_errmsg(conn));
+		return -1;
+	}
+
+	/* Wait for other threads' transactions instead of failing */
+	sqlite3_busy_timeout(conn, BUSY_TIMEOUT);
+
+	/* Sync less often, which is safe with a write-ahead log */
+	sqlite3_exec(conn, "PRAGMA synchronous=NORMAL", NULL, NULL, NULL);
+
+	/* Success */
+	return 0;
+}
+
+/*
+ * Open the database file, creating tables if needed.
+ */
+static int lite_open(char *host, char *user, char *pass, char *db)
+{
+	char *err;
+
+	/* Remember file name */
+	db_file = db;
+
+	/* Connect */
+	if (lite_connect() < 0) return -1;
+
+	/* Let readers work while writes are done */
+	sqlite3_exec(conn, "PRAGMA journal_mode=WAL", NULL, NULL, NULL);
+
+	/* Create tables */
+	if (sqlite3_exec(conn, schema, NULL, NULL, &err))
+	{
+		/* Print error */
+		printf("Database schema: %s\n", err);
+		sqlite3_free(err);
+		return -1;
+	}
+
+	/* Success */
+	return 0;
+}
+
+/*
+ * Find or create a user.
+ */
+static int lite_user(char *user, char *pass)
+{
+	sqlite3_stmt *stmt;
+	char hash[41];
+	int uid = -1;
+
+	/* Hash password */
+	store_hash(pass, hash);
+
+	/* Look up user */
+	if (!(stmt = prepare(&stmt_find_user))) return -1;
+	sqlite3_bind_text(stmt, 1, user, -1, SQLITE_STATIC);
+
+	/* Check for user found */
+	if (sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		/* Check for matching password */
+		if (!strcmp((char *)sqlite3_column_text(stmt, 0), hash))
+		{
+			/* Get ID */
+			uid = sqlite3_column_int(stmt, 1);
+		}
+
+		/* Reset statement */
+		finish(stmt);
+
+		/* Return ID */
+		return uid;
+	}
+
+	/* Reset statement */
+	finish(stmt);
+
+	/* Insert user */
+	if (!(stmt = prepare(&stmt_add_user))) return -1;
+	sqlite3_bind_text(stmt, 1, user, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 2, hash, -1, SQLITE_STATIC);
+	run(stmt);
+
+	/* Return ID of user inserted */
+	return sqlite3_last_insert_rowid(conn);
+}
+
+/*
+ * Get the name of a user.
+ */
+static void lite_user_name(int uid, char *name)
+{
+	sqlite3_stmt *stmt;
+
+	/* Assume no name */
+	strcpy(name, "");
+
+	/* Look up user */
+	if (!(stmt = prepare(&stmt_user_name))) return;
+	sqlite3_bind_int(stmt, 1, uid);
+
+	/* Copy user name */
+	if (sqlite3_step(stmt) == SQLITE_ROW) copy_text(stmt, 0, name, 1024);
+
+	/* Reset statement */
+	finish(stmt);
+}
+
+/*
+ * Create a game.
+ */
+static int lite_new_game(store_game *g_ptr)
+{
+	sqlite3_stmt *stmt;
+
+	/* Get statement */
+	if (!(stmt = prepare(&stmt_new_game))) return -1;
+
+	/* Set game fields */
+	sqlite3_bind_text(stmt, 1, g_ptr->desc, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 2, g_ptr->pass, -1, SQLITE_STATIC);
+	sqlite3_bind_int(stmt, 3, g_ptr->created);
+	sqlite3_bind_int(stmt, 4, g_ptr->min_player);
+	sqlite3_bind_int(stmt, 5, g_ptr->max_player);
+	sqlite3_bind_int(stmt, 6, g_ptr->expanded);
+	sqlite3_bind_int(stmt, 7, g_ptr->advanced);
+	sqlite3_bind_int(stmt, 8, g_ptr->disable_goal);
+	sqlite3_bind_int(stmt, 9, g_ptr->disable_takeover);
+	sqlite3_bind_int(stmt, 10, g_ptr->speed);
+	sqlite3_bind_text(stmt, 11, VERSION, -1, SQLITE_STATIC);
+
+	/* Insert game */
+	if (sqlite3_step(stmt) != SQLITE_DONE)
+	{
+		/* Print error */
+		printf("Database write: %s\n", sqlite3_errmsg(conn));
+		finish(stmt);
+		return -1;
+	}
+
+	/* Reset statement */
+	finish(stmt);
+
+	/* Return ID of game inserted */
+	return sqlite3_last_insert_rowid(conn);
+}
+
+/*
+ * Read a game from the current row of a statement.
+ */
+static void read_game(sqlite3_stmt *stmt, store_game *g_ptr)
+{
+	const unsigned char *state;
+	int i;
+
+	/* Read fields */
+	g_ptr->gid = sqlite3_column_int(stmt, 0);
+	copy_text(stmt, 1, g_ptr->desc, sizeof(g_ptr->desc));
+	copy_text(stmt, 2, g_ptr->pass, sizeof(g_ptr->pass));
+	g_ptr->created = sqlite3_column_int(stmt, 3);
+
+	/* Get state name */
+	state = sqlite3_column_text(stmt, 4);
+
+	/* Assume unknown state */
+	g_ptr->state = 0;
+
+	/* Loop over state names */
+	for (i = GS_WAITING; i <= GS_ABANDONED; i++)
+	{
+		/* Check for matching name */
+		if (state && !strcmp((char *)state, state_name[i]))
+		{
+			/* Set state */
+			g_ptr->state = i;
+		}
+	}
+
+	/* Read fields */
+	g_ptr->min_player = sqlite3_column_int(stmt, 5);
+	g_ptr->max_player = sqlite3_column_int(stmt, 6);
+	g_ptr->expanded = sqlite3_column_int(stmt, 7);
+	g_ptr->advanced = sqlite3_column_int(stmt, 8);
+	g_ptr->disable_goal = sqlite3_column_int(stmt, 9);
+	g_ptr->disable_takeover = sqlite3_column_int(stmt, 10);
+	g_ptr->speed = sqlite3_column_int(stmt, 11);
+}
+
+/*
+ * Load waiting and started games.
+ */
+static int lite_load_games(store_game *list, int max)
+{
+	sqlite3_stmt *stmt;
+	int n = 0;
+
+	/* Get statement */
+	if (!(stmt = prepare(&stmt_load_games))) return 0;
+
+	/* Loop over rows returned */
+	while (n < max && sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		/* Read game */
+		read_game(stmt, &list[n++]);
+	}
+
+	/* Reset statement */
+	finish(stmt);
+
+	/* Return number of games */
+	return n;
+}
+
+/*
+ * Load a game.
+ */
+static int lite_load_game(int gid, store_game *g_ptr)
+{
+	sqlite3_stmt *stmt;
+	int found = 0;
+
+	/* Look up game */
+	if (!(stmt = prepare(&stmt_load_game))) return -1;
+	sqlite3_bind_int(stmt, 1, gid);
+
+	/* Check for game found */
+	if (sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		/* Read game */
+		read_game(stmt, g_ptr);
+		found = 1;
+	}
+
+	/* Reset statement */
+	finish(stmt);
+
+	/* Return whether game was found */
+	return found ? 0 : -1;
+}
+
+/*
+ * Load users of a game in seat order.
+ */
+static int lite_load_players(int gid, int *uids, int *ai, int max)
+{
+	sqlite3_stmt *stmt;
+	int n = 0;
+
+	/* Look up players */
+	if (!(stmt = prepare(&stmt_load_players))) return 0;
+	sqlite3_bind_int(stmt, 1, gid);
+
+	/* Loop over rows returned */
+	while (n < max && sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		/* Read user and AI flag */
+		uids[n] = sqlite3_column_int(stmt, 0);
+		ai[n++] = sqlite3_column_int(stmt, 1);
+	}
+
+	/* Reset statement */
+	finish(stmt);
+
+	/* Return number of players */
+	return n;
+}
+
+/*
+ * Load random byte pool.
+ */
+static int lite_load_seed(int gid, unsigned char *pool, int len)
+{
+	sqlite3_stmt *stmt;
+	int found = 0, size;
+
+	/* Look up pool */
+	if (!(stmt = prepare(&stmt_load_seed))) return 0;
+	sqlite3_bind_int(stmt, 1, gid);
+
+	/* Check for pool found */
+	if (sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		/* Get size of pool */
+		size = sqlite3_column_bytes(stmt, 0);
+
+		/* Copy pool */
+		memcpy(pool, sqlite3_column_blob(stmt, 0), size < len ? size : len);
+		found = 1;
+	}
+
+	/* Reset statement */
+	finish(stmt);
+
+	/* Return whether pool was found */
+	return found;
+}
+
+/*
+ * Load a choice log.
+ */
+static int lite_load_choices(int gid, int uid, unsigned char **data)
+{
+	sqlite3_stmt *stmt;
+	int len = -1;
+
+	/* Look up choice log */
+	if (!(stmt = prepare(&stmt_load_choices))) return -1;
+	sqlite3_bind_int(stmt, 1, gid);
+	sqlite3_bind_int(stmt, 2, uid);
+
+	/* Check for log found */
+	if (sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		/* Copy log */
+		len = sqlite3_column_bytes(stmt, 0);
+		*data = (unsigned char *)malloc(len);
+		memcpy(*data, sqlite3_column_blob(stmt, 0), len);
+	}
+
+	/* Reset statement */
+	finish(stmt);
+
+	/* Return length */
+	return len;
+}
+
+/*
+ * Load a checkpoint.
+ */
+static int lite_load_checkpoint(int gid, int *rand_pos, char **state)
+{
+	sqlite3_stmt *stmt;
+	int len = -1;
+
+	/* Look up checkpoint */
+	if (!(stmt = prepare(&stmt_load_checkpoint))) return -1;
+	sqlite3_bind_int(stmt, 1, gid);
+
+	/* Check for checkpoint found */
+	if (sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		/* Get random pool position */
+		*rand_pos = sqlite3_column_int(stmt, 0);
+
+		/* Copy state */
+		len = sqlite3_column_bytes(stmt, 1);
+		*state = (char *)malloc(len);
+		memcpy(*state, sqlite3_column_blob(stmt, 1), len);
+	}
+
+	/* Reset statement */
+	finish(stmt);
+
+	/* Return length */
+	return len;
+}
+
+/*
+ * Read messages of a game.
+ */
+static void lite_load_messages(int gid, int uid, store_message_func func,
+                               void *arg)
+{
+	sqlite3_stmt *stmt;
+
+	/* Check for all messages wanted */
+	if (uid < 0)
+	{
+		/* Look up all messages */
+		if (!(stmt = prepare(&stmt_all_messages))) return;
+		sqlite3_bind_int(stmt, 1, gid);
+	}
+	else
+	{
+		/* Look up messages seen by user */
+		if (!(stmt = prepare(&stmt_user_messages))) return;
+		sqlite3_bind_int(stmt, 1, gid);
+		sqlite3_bind_int(stmt, 2, uid);
+		sqlite3_bind_text(stmt, 3, FORMAT_CHAT, -1, SQLITE_STATIC);
+	}
+
+	/* Loop over rows returned */
+	while (sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		/* Pass message on */
+		func(arg, (char *)sqlite3_column_text(stmt, 0),
+		     (char *)sqlite3_column_text(stmt, 1),
+		     (char *)sqlite3_column_text(stmt, 2));
+	}
+
+	/* Reset statement */
+	finish(stmt);
+}
+
+/*
+ * Do a single write.
+ */
+static void write_one(store_write *w_ptr)
+{
+	sqlite3_stmt *stmt = NULL;
+
+	/* Check kind of write */
+	switch (w_ptr->type)
+	{
+		/* Join or leave game */
+		case STORE_JOIN:
+		case STORE_LEAVE:
+			stmt = prepare(w_ptr->type == STORE_JOIN ? &stmt_join :
+			                                          &stmt_leave);
+			if (!stmt) return;
+			sqlite3_bind_int(stmt, 1, w_ptr->uid);
+			sqlite3_bind_int(stmt, 2, w_ptr->gid);
+			break;
+
+		/* Game state */
+		case STORE_STATE:
+			if (!(stmt = prepare(&stmt_state))) return;
+			sqlite3_bind_text(stmt, 1, state_name[w_ptr->num[0]], -1,
+			                  SQLITE_STATIC);
+			sqlite3_bind_int(stmt, 2, w_ptr->gid);
+			break;
+
+		/* Random byte pool */
+		case STORE_SEED:
+			if (!(stmt = prepare(&stmt_seed))) return;
+			sqlite3_bind_int(stmt, 1, w_ptr->gid);
+			sqlite3_bind_blob(stmt, 2, w_ptr->data[0], w_ptr->len[0],
+			                  SQLITE_STATIC);
+			break;
+
+		/* Seat or AI control of user */
+		case STORE_SEAT:
+		case STORE_AI:
+			stmt = prepare(w_ptr->type == STORE_SEAT ? &stmt_seat :
+			                                          &stmt_ai);
+			if (!stmt) return;
+			sqlite3_bind_int(stmt, 1, w_ptr->num[0]);
+			sqlite3_bind_int(stmt, 2, w_ptr->gid);
+			sqlite3_bind_int(stmt, 3, w_ptr->uid);
+			break;
+
+		/* Waiting state of user */
+		case STORE_WAITING:
+			if (!(stmt = prepare(&stmt_waiting))) return;
+
+			/* Check for waiting state */
+			if (w_ptr->num[0] >= 0 && w_ptr->num[0] <= 2)
+			{
+				/* Set state */
+				sqlite3_bind_text(stmt, 1, waiting_name[w_ptr->num[0]],
+				                  -1, SQLITE_STATIC);
+			}
+
+			/* Set game and user */
+			sqlite3_bind_int(stmt, 2, w_ptr->gid);
+			sqlite3_bind_int(stmt, 3, w_ptr->uid);
+			break;
+
+		/* Choice log */
+		case STORE_CHOICES:
+			if (!(stmt = prepare(&stmt_choices))) return;
+			sqlite3_bind_int(stmt, 1, w_ptr->gid);
+			sqlite3_bind_int(stmt, 2, w_ptr->uid);
+			sqlite3_bind_blob(stmt, 3, w_ptr->data[0], w_ptr->len[0],
+			                  SQLITE_STATIC);
+			break;
+
+		/* Checkpoint */
+		case STORE_CHECKPOINT:
+			if (!(stmt = prepare(&stmt_checkpoint))) return;
+			sqlite3_bind_int(stmt, 1, w_ptr->gid);
+			sqlite3_bind_int(stmt, 2, w_ptr->num[0]);
+			sqlite3_bind_blob(stmt, 3, w_ptr->data[0], w_ptr->len[0],
+			                  SQLITE_STATIC);
+			break;
+
+		/* Remove checkpoint */
+		case STORE_CLEAR:
+			if (!(stmt = prepare(&stmt_clear))) return;
+			sqlite3_bind_int(stmt, 1, w_ptr->gid);
+			break;
+
+		/* Message */
+		case STORE_MESSAGE:
+			if (!(stmt = prepare(&stmt_message))) return;
+			sqlite3_bind_int(stmt, 1, w_ptr->gid);
+			sqlite3_bind_int(stmt, 2, w_ptr->uid);
+			sqlite3_bind_text(stmt, 3, w_ptr->data[0], -1, SQLITE_STATIC);
+			sqlite3_bind_text(stmt, 4, w_ptr->data[1], -1, SQLITE_STATIC);
+			break;
+
+		/* Result */
+		case STORE_RESULT:
+			if (!(stmt = prepare(&stmt_result))) return;
+			sqlite3_bind_int(stmt, 1, w_ptr->gid);
+			sqlite3_bind_int(stmt, 2, w_ptr->uid);
+			sqlite3_bind_int(stmt, 3, w_ptr->num[0]);
+			sqlite3_bind_int(stmt, 4, w_ptr->num[1]);
+			sqlite3_bind_int(stmt, 5, w_ptr->num[2]);
+			break;
+	}
+
+	/* Run statement */
+	if (stmt) run(stmt);
+}
+
+/*
+ * Do a list of writes in a single transaction.
+ */
+static void lite_write(store_write *list, int n)
+{
+	sqlite3_stmt *begin, *commit;
+	int i;
+
+	/* Get transaction statements */
+	begin = prepare(&stmt_begin);
+	commit = prepare(&stmt_commit);
+
+	/* Start transaction */
+	if (begin) run(begin);
+
+	/* Loop over writes */
+	for (i = 0; i < n; i++)
+	{
+		/* Do write */
+		write_one(&list[i]);
+	}
+
+	/* Finish transaction */
+	if (commit) run(commit);
+}
+
+/*
+ * SQLite backend.
+ */
+store store_sqlite =
+{
+	"sqlite",
+	lite_open,
+	lite_connect,
+	lite_user,
+	lite_user_name,
+	lite_new_game,
+	lite_load_games,
+	lite_load_game,
+	lite_load_players,
+	lite_load_seed,
+	lite_load_choices,
+	lite_load_checkpoint,
+	lite_load_messages,
+	lite_write
+};
@@ -0,0 +1,853 @@
+/*
+ * Race for the Galaxy AI
+ *
+ * Copyright (C) 2009-2015 Keldon Jones
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "rftg.h"
+#include "net.h"
+#include <errno.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/*
+ * Most configurations to train.
+ */
+#define MAX_TRAIN (MAX_EXPANSION * MAX_PLAYER * 2)
+
+/*
+ * Most steps in the learning rate schedule.
+ */
+#define MAX_FACTOR_STEP 32
+
+/*
+ * Most worker processes.
+ */
+#define MAX_WORKER 64
+
+/*
+ * A game configuration to train.
+ */
+typedef struct train_config
+{
+	/* Expansion level */
+	int expanded;
+
+	/* Number of players */
+	int num_players;
+
+	/* Advanced game */
+	int advanced;
+
+	/* Number of games to train in total */
+	int games;
+
+	/* Share of training time compared to other configurations */
+	double priority;
+
+	/* Number of games already trained */
+	int done;
+
+	/* Worker process training this configuration */
+	int worker;
+
+} train_config;
+
+/*
+ * Configurations to train.
+ */
+static train_config config[MAX_TRAIN];
+static int num_config;
+
+/*
+ * Learning rate schedule.
+ *
+ * Each step gives the factor used from the given number of games trained
+ * on.
+ */
+static int factor_start[MAX_FACTOR_STEP];
+static double factor_value[MAX_FACTOR_STEP];
+static int num_factor;
+
+/*
+ * Games played before choosing a configuration again.
+ */
+static int chunk = 100;
+
+/*
+ * Games played by a worker between checkpoints.
+ */
+static int checkpoint_games = 1000;
+
+/*
+ * Directory holding checkpoints.
+ */
+static char *checkpoint_dir = "checkpoint";
+
+/*
+ * Print messages?
+ */
+static int verbose = 0;
+
+/*
+ * Set when training should stop.
+ */
+static volatile sig_atomic_t stop_training;
+
+/*
+ * Print errors to standard error.
+ */
+void display_error(char *msg)
+{
+	/* Forward message */
+	fprintf(stderr, "%s", msg);
+}
+
+/*
+ * Print messages to standard output.
+ */
+void message_add(game *g, char *msg)
+{
+	/* Print if very verbose */
+	if (verbose > 1) printf("%s", msg);
+}
+
+/*
+ * Print messages to standard output.
+ */
+void message_add_formatted(game *g, char *msg, char *tag)
+{
+	/* Print without formatting */
+	message_add(g, msg);
+}
+
+/*
+ * Use simple random number generator.
+ */
+int game_rand(game *g)
+{
+	/* Call simple random number generator */
+	return simple_rand(&g->random_seed);
+}
+
+/*
+ * Stop training after the current game.
+ */
+static void handle_stop(int sig)
+{
+	/* Set flag */
+	stop_training = 1;
+}
+
+/*
+ * Add a configuration to train.
+ *
+ * Returns -1 if the configuration does not exist.
+ */
+static int add_config(int expanded, int num_players, int advanced, int games,
+                      double priority)
+{
+	train_config *c_ptr;
+
+	/* Check for bad configuration */
+	if (expanded < 0 || expanded >= MAX_EXPANSION || num_players < 2 ||
+	    num_players > exp_info[expanded].max_players ||
+	    (advanced && num_players != 2) || games < 0 || priority <= 0 ||
+	    num_config == MAX_TRAIN) return -1;
+
+	/* Get configuration pointer */
+	c_ptr = &config[num_config++];
+
+	/* Set configuration */
+	c_ptr->expanded = expanded;
+	c_ptr->num_players = num_players;
+	c_ptr->advanced = advanced;
+	c_ptr->games = games;
+	c_ptr->priority = priority;
+	c_ptr->done = 0;
+	c_ptr->worker = 0;
+
+	/* Success */
+	return 0;
+}
+
+/*
+ * Read the training schedule.
+ *
+ * Lines give a configuration to train, a step of the learning rate
+ * schedule, or a setting:
+ *
+ *   train <expansion> <players>[a] <games> <priority>
+ *   factor <games trained> <factor>
+ *   chunk <games>
+ *   checkpoint <games>
+ */
+static int read_schedule(char *fname)
+{
+	FILE *fff;
+	char buf[1024], players[80];
+	int line = 0, e, n, games;
+	double value;
+
+	/* Open schedule file */
+	fff = fopen(fname, "r");
+
+	/* Check for failure */
+	if (!fff)
+	{
+		/* Error */
+		perror(fname);
+		return -1;
+	}
+
+	/* Loop over lines */
+	while (fgets(buf, 1024, fff))
+	{
+		/* Count line */
+		line++;
+
+		/* Skip comments and blank lines */
+		if (buf[0] == '#' || buf[0] == '\n') continue;
+
+		/* Check for configuration */
+		if (sscanf(buf, "train %d %79s %d %lf", &e, players, &games,
+		           &value) == 4)
+		{
+			/* Add configuration */
+			if (add_config(e, atoi(players), strchr(players, 'a') != NULL,
+			               games, value) == 0) continue;
+		}
+
+		/* Check for learning rate step */
+		else if (sscanf(buf, "factor %d %lf", &n, &value) == 2)
+		{
+			/* Add step if room */
+			if (num_factor < MAX_FACTOR_STEP && n >= 0)
+			{
+				/* Set step */
+				factor_start[num_factor] = n;
+				factor_value[num_factor++] = value;
+				continue;
+			}
+		}
+
+		/* Check for chunk size */
+		else if (sscanf(buf, "chunk %d", &n) == 1 && n > 0)
+		{
+			/* Set chunk size */
+			chunk = n;
+			continue;
+		}
+
+		/* Check for checkpoint interval */
+		else if (sscanf(buf, "checkpoint %d", &n) == 1 && n > 0)
+		{
+			/* Set interval */
+			checkpoint_games = n;
+			continue;
+		}
+
+		/* Error */
+		fprintf(stderr, "%s:%d: bad schedule line\n", fname, line);
+		fclose(fff);
+		return -1;
+	}
+
+	/* Done */
+	fclose(fff);
+
+	/* Success */
+	return 0;
+}
+
+/*
+ * Fill in the parts of the schedule not given.
+ *
+ * By default every configuration is trained for 25000 games, with a higher
+ * learning rate for the first 10000.
+ */
+static void default_schedule(void)
+{
+	int e, n;
+
+	/* Check for no configurations given */
+	if (!num_config)
+	{
+		/* Loop over expansions */
+		for (e = 0; e < MAX_EXPANSION; e++)
+		{
+			/* Loop over numbers of players */
+			for (n = 2; n <= exp_info[e].max_players; n++)
+			{
+				/* Add configuration */
+				add_config(e, n, 0, 25000, 1.0);
+			}
+
+			/* Add advanced game */
+			add_config(e, 2, 1, 25000, 1.0);
+		}
+	}
+
+	/* Check for no learning rate schedule */
+	if (!num_factor)
+	{
+		/* Start with high learning rate */
+		factor_start[0] = 0;
+		factor_value[0] = 100.0;
+
+		/* Reduce learning rate later */
+		factor_start[1] = 10000;
+		factor_value[1] = 1.0;
+		num_factor = 2;
+	}
+}
+
+/*
+ * Return the learning rate factor after the given number of games.
+ */
+static double schedule_factor(int done)
+{
+	double factor = 1.0;
+	int i, best = -1;
+
+	/* Loop over steps */
+	for (i = 0; i < num_factor; i++)
+	{
+		/* Skip steps not reached yet */
+		if (factor_start[i] > done) continue;
+
+		/* Use latest step reached */
+		if (best < 0 || factor_start[i] >= factor_start[best])
+		{
+			/* Remember step */
+			best = i;
+			factor = factor_value[i];
+		}
+	}
+
+	/* Return factor */
+	return factor;
+}
+
+/*
+ * Create the name of the file holding a configuration's progress.
+ */
+static void progress_name(char *buf, train_config *c_ptr)
+{
+	/* Create filename */
+	sprintf(buf, "%s/rftg.games.%d.%d%s", checkpoint_dir, c_ptr->expanded,
+	        c_ptr->num_players, c_ptr->advanced ? "a" : "");
+}
+
+/*
+ * Read number of games already trained in every configuration.
+ */
+static void read_progress(void)
+{
+	FILE *fff;
+	char fname[1024];
+	int i;
+
+	/* Loop over configurations */
+	for (i = 0; i < num_config; i++)
+	{
+		/* Create filename */
+		progress_name(fname, &config[i]);
+
+		/* Open file */
+		fff = fopen(fname, "r");
+
+		/* Skip configurations not started */
+		if (!fff) continue;
+
+		/* Read games done */
+		if (fscanf(fff, "%d", &config[i].done) != 1) config[i].done = 0;
+
+		/* Done */
+		fclose(fff);
+	}
+}
+
+/*
+ * Write checkpoints of a worker's networks and progress.
+ */
+static void write_checkpoint(int worker)
+{
+	FILE *fff;
+	char fname[1024], tmp[1024 + 4];
+	int i;
+
+	/* Save networks */
+	if (ai_checkpoint() < 0)
+	{
+		/* Warn and keep old progress */
+		fprintf(stderr, "Worker %d: could not write checkpoint\n",
+		        worker);
+		return;
+	}
+
+	/* Loop over configurations */
+	for (i = 0; i < num_config; i++)
+	{
+		/* Skip other workers' configurations */
+		if (config[i].worker != worker) continue;
+
+		/* Create filename */
+		progress_name(fname, &config[i]);
+
+		/* Create temporary filename */
+		sprintf(tmp, "%s.tmp", fname);
+
+		/* Open file */
+		fff = fopen(tmp, "w");
+
+		/* Check for failure */
+		if (!fff)
+		{
+			/* Error */
+			perror(tmp);
+			continue;
+		}
+
+		/* Save games done */
+		fprintf(fff, "%d\n", config[i].done);
+
+		/* Check for failure to write */
+		if (fclose(fff))
+		{
+			/* Error */
+			perror(tmp);
+			continue;
+		}
+
+		/* Replace old progress */
+		replace_file(tmp, fname);
+	}
+}
+
+/*
+ * Spread configurations over workers.
+ *
+ * Configurations are handed out in order of priority, each to the worker
+ * with the least work so far.  A configuration is always trained by the
+ * same worker, so its networks exist in only one process.
+ */
+static void assign_workers(int num_workers)
+{
+	double load[MAX_WORKER], cost;
+	int order[MAX_TRAIN];
+	int i, j, k, w;
+
+	/* Clear worker loads */
+	for (w = 0; w < num_workers; w++) load[w] = 0.0;
+
+	/* Start with configurations in given order */
+	for (i = 0; i < num_config; i++) order[i] = i;
+
+	/* Sort configurations by priority */
+	for (i = 1; i < num_config; i++)
+	{
+		/* Get configuration to insert */
+		k = order[i];
+
+		/* Move lower priorities up */
+		for (j = i; j > 0 &&
+		     config[order[j - 1]].priority < config[k].priority; j--)
+		{
+			/* Move entry */
+			order[j] = order[j - 1];
+		}
+
+		/* Insert configuration */
+		order[j] = k;
+	}
+
+	/* Loop over configurations */
+	for (i = 0; i < num_config; i++)
+	{
+		/* Find least loaded worker */
+		for (w = j = 0; j < num_workers; j++)
+		{
+			/* Check for less load */
+			if (load[j] < load[w]) w = j;
+		}
+
+		/* Assign configuration */
+		config[order[i]].worker = w;
+
+		/* Estimate remaining work, as games take longer with players */
+		cost = config[order[i]].games - config[order[i]].done;
+		if (cost < 0) cost = 0;
+		cost *= config[order[i]].num_players;
+
+		/* Add to worker's load */
+		load[w] += cost;
+	}
+}
+
+/*
+ * Choose the worker's configuration to train next.
+ *
+ * The configuration furthest behind its share, given by its priority, is
+ * chosen.  Returns -1 if all are finished.
+ */
+static int next_config(int worker)
+{
+	double share, b_s = 0.0;
+	int i, best = -1;
+
+	/* Loop over configurations */
+	for (i = 0; i < num_config; i++)
+	{
+		/* Skip other workers' configurations */
+		if (config[i].worker != worker) continue;
+
+		/* Skip finished configurations */
+		if (config[i].done >= config[i].games) continue;
+
+		/* Compute training done relative to priority */
+		share = config[i].done / config[i].priority;
+
+		/* Check for furthest behind */
+		if (best < 0 || share < b_s)
+		{
+			/* Remember configuration */
+			best = i;
+			b_s = share;
+		}
+	}
+
+	/* Return best configuration */
+	return best;
+}
+
+/*
+ * Play a chunk of training games in one configuration.
+ *
+ * Returns number of games played.
+ */
+static int train_chunk(game *g, train_config *c_ptr)
+{
+	char *names[MAX_PLAYER];
+	double factor;
+	int i, n;
+
+	/* Get learning rate factor */
+	factor = schedule_factor(c_ptr->done);
+
+	/* Set game configuration */
+	g->num_players = c_ptr->num_players;
+	g->expanded = c_ptr->expanded;
+	g->advanced = c_ptr->advanced;
+	g->promo = 0;
+
+	/* Assume no options disabled */
+	g->goal_disabled = 0;
+	g->takeover_disabled = 0;
+
+	/* No campaign selected */
+	g->camp = NULL;
+
+	/* Loop over players */
+	for (i = 0; i < g->num_players; i++)
+	{
+		/* Set player interfaces to AI functions */
+		g->p[i].control = &ai_func;
+
+		/* Initialize AI, switching networks and learning rate */
+		g->p[i].control->init(g, i, factor);
+
+		/* Remember player name */
+		names[i] = g->p[i].name;
+	}
+
+	/* Play games */
+	for (n = 0; n < chunk && c_ptr->done < c_ptr->games; n++)
+	{
+		/* Check for stop requested */
+		if (stop_training) break;
+
+		/* Clear choice logs */
+		for (i = 0; i < g->num_players; i++)
+		{
+			/* Clear choice log size and position */
+			g->p[i].choice_size = 0;
+			g->p[i].choice_pos = 0;
+		}
+
+		/* Initialize game */
+		init_game(g);
+
+		/* Game is learning game */
+		g->session_id = -2;
+
+		/* Begin game */
+		begin_game(g);
+
+		/* Play game rounds until finished */
+		while (game_round(g));
+
+		/* Score game */
+		score_game(g);
+
+		/* Declare winner */
+		declare_winner(g);
+
+		/* Call player game over functions */
+		for (i = 0; i < g->num_players; i++)
+		{
+			/* Call game over function */
+			g->p[i].control->game_over(g, i);
+		}
+
+		/* Reset player names */
+		for (i = 0; i < g->num_players; i++)
+		{
+			/* Reset name */
+			g->p[i].name = names[i];
+		}
+
+		/* Count game */
+		c_ptr->done++;
+	}
+
+	/* Check for verbose */
+	if (verbose)
+	{
+		printf("Trained %d.%d%s: %d/%d games, factor %g\n",
+		       c_ptr->expanded, c_ptr->num_players,
+		       c_ptr->advanced ? "a" : "", c_ptr->done, c_ptr->games,
+		       factor);
+		fflush(stdout);
+	}
+
+	/* Return games played */
+	return n;
+}
+
+/*
+ * Train the worker's configurations until finished or stopped.
+ */
+static int run_worker(int worker, unsigned int seed)
+{
+	game my_game;
+	char buf[80];
+	int i, c, played = 0, since_checkpoint = 0;
+
+	/* Give each worker its own random number stream */
+	my_game.random_seed = seed + worker;
+
+	/* Resume from checkpoints */
+	ai_set_checkpoint_dir(checkpoint_dir, 0);
+
+	/* Loop over players */
+	for (i = 0; i < MAX_PLAYER; i++)
+	{
+		/* Create player name */
+		sprintf(buf, "Player %d", i);
+
+		/* Set player name */
+		my_game.p[i].name = strdup(buf);
+
+		/* Create choice log for player */
+		my_game.p[i].choice_log = new_choice_log();
+	}
+
+	/* Train until finished or stopped */
+	while (!stop_training && (c = next_config(worker)) >= 0)
+	{
+		/* Train configuration */
+		i = train_chunk(&my_game, &config[c]);
+
+		/* Count games */
+		played += i;
+		since_checkpoint += i;
+
+		/* Check for checkpoint due */
+		if (since_checkpoint >= checkpoint_games)
+		{
+			/* Write checkpoint */
+			write_checkpoint(worker);
+			since_checkpoint = 0;
+		}
+	}
+
+	/* Check for nothing trained */
+	if (!played) return 0;
+
+	/* Write final checkpoint */
+	write_checkpoint(worker);
+
+	/* Save networks of every configuration trained */
+	my_game.p[0].control->shutdown(&my_game, 0);
+
+	/* Done */
+	return 0;
+}
+
+/*
+ * Train networks of many configurations at once.
+ */
+int main(int argc, char *argv[])
+{
+	struct sigaction sa;
+	pid_t pid[MAX_WORKER];
+	unsigned int seed;
+	int i, w, status, num_workers = 1, left, result = 0;
+
+	/* Set random seed */
+	seed = time(NULL);
+
+	/* Read card database */
+	if (read_cards(NULL) < 0)
+	{
+		/* Exit */
+		exit(1);
+	}
+
+	/* Parse arguments */
+	for (i = 1; i < argc; i++)
+	{
+		/* Check for verbosity */
+		if (!strcmp(argv[i], "-v"))
+		{
+			/* Set verbose flag */
+			verbose++;
+		}
+
+		/* Check for schedule file */
+		else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+		{
+			/* Read schedule */
+			if (read_schedule(argv[++i]) < 0) exit(1);
+		}
+
+		/* Check for checkpoint directory */
+		else if (!strcmp(argv[i], "-c") && i + 1 < argc)
+		{
+			/* Set directory */
+			checkpoint_dir = argv[++i];
+		}
+
+		/* Check for random seed */
+		else if (!strcmp(argv[i], "-r") && i + 1 < argc)
+		{
+			/* Set random seed */
+			seed = atoi(argv[++i]);
+		}
+
+		/* Check for number of workers */
+		else if (!strcmp(argv[i], "-j") && i + 1 < argc)
+		{
+			/* Set number of worker processes */
+			num_workers = atoi(argv[++i]);
+
+			/* Keep number of workers in range */
+			if (num_workers < 1) num_workers = 1;
+			if (num_workers > MAX_WORKER) num_workers = MAX_WORKER;
+		}
+
+		/* Unknown option */
+		else
+		{
+			/* Print usage */
+			fprintf(stderr, "Usage: %s [-s schedule] [-c checkpoint-dir] "
+			                "[-j workers] [-r seed] [-v]\n", argv[0]);
+			exit(1);
+		}
+	}
+
+	/* Fill in defaults */
+	default_schedule();
+
+	/* Create checkpoint directory */
+	if (mkdir(checkpoint_dir, 0777) < 0 && errno != EEXIST)
+	{
+		/* Error */
+		perror(checkpoint_dir);
+		exit(1);
+	}
+
+	/* Read progress from earlier runs */
+	read_progress();
+
+	/* Spread configurations over workers */
+	assign_workers(num_workers);
+
+	/* Stop after current games when asked */
+	memset(&sa, 0, sizeof(struct sigaction));
+	sa.sa_handler = handle_stop;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	/* Flush output before creating workers */
+	fflush(stdout);
+
+	/* Start workers */
+	for (w = 0; w < num_workers; w++)
+	{
+		/* Create worker process */
+		pid[w] = fork();
+
+		/* Check for error */
+		if (pid[w] < 0)
+		{
+			/* Error */
+			perror("fork");
+			exit(1);
+		}
+
+		/* Check for worker */
+		if (!pid[w]) exit(run_worker(w, seed));
+	}
+
+	/* Wait for workers */
+	for (left = num_workers; left > 0; )
+	{
+		/* Wait for any worker */
+		if (wait(&status) < 0)
+		{
+			/* Check for interruption by stop request */
+			if (errno == EINTR)
+			{
+				/* Pass request on to workers */
+				for (w = 0; w < num_workers; w++)
+				{
+					/* Ask worker to stop */
+					kill(pid[w], SIGTERM);
+				}
+
+				/* Keep waiting */
+				continue;
+			}
+
+			/* Error */
+			break;
+		}
+
+		/* One less worker */
+		left--;
+
+		/* Check for failed worker */
+		if (!WIFEXITED(status) || WEXITSTATUS(status)) result = 1;
+	}
+
+	/* Done */
+	return result;
+}
@@ -0,0 +1,380 @@
+/*
+ * Race for the Galaxy AI
+ *
+ * Copyright (C) 2009-2015 Keldon Jones
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "net.h"
+
+/*
+ * Fraction of training passed back to each earlier input set.
+ *
+ * This matches the decay used when the AI trains during play.
+ */
+#define TD_LAMBDA 0.7
+
+/*
+ * Player's input sets within a game.
+ */
+static int *states;
+
+/*
+ * Network results for a player's input sets.
+ */
+static double *results;
+
+/*
+ * Weighted sum of training targets, and desired outputs.
+ */
+static double *target_sum, *desired;
+
+/*
+ * Learning rate factor.
+ */
+static double factor = 1.0;
+
+/*
+ * Copy an input set to the network and compute it.
+ */
+static void compute_input(net *learn, double *input)
+{
+	/* Copy inputs */
+	memcpy(learn->input_value, input,
+	       sizeof(double) * (learn->num_inputs + 1));
+
+	/* Compute network */
+	compute_net(learn);
+}
+
+/*
+ * Train the network on one player's input sets from a game.
+ *
+ * During play, the AI trains every earlier input set of a player towards
+ * the current result after each decision, with the amount of training
+ * reduced by TD_LAMBDA per step back in time, and towards the game outcome
+ * at the end.  Here, the targets an input set would have been trained on
+ * are summed up first, so that each input set is trained only once, with
+ * the combined amount towards their weighted average.
+ */
+static void train_player(net *learn, experience *x, int who)
+{
+	double *outcome, weight = 0.0;
+	int i, j, n = 0, last, outputs;
+
+	/* Get number of outputs */
+	outputs = learn->num_output;
+
+	/* Collect player's input sets */
+	for (i = 0; i < x->num_states; i++)
+	{
+		/* Add input set if created by player */
+		if (x->player[i] == who) states[n++] = i;
+	}
+
+	/* Check for no input sets */
+	if (!n) return;
+
+	/* Get game outcome for this player */
+	outcome = &x->outcome[who * outputs];
+
+	/* Last input set is the final game state */
+	last = n - 1;
+
+	/* Compute results of intermediate input sets */
+	for (i = 1; i < last; i++)
+	{
+		/* Compute network */
+		compute_input(learn, x->input[states[i]]);
+
+		/* Save results */
+		memcpy(&results[i * outputs], learn->win_prob,
+		       sizeof(double) * outputs);
+	}
+
+	/* Train final input set towards outcome */
+	compute_input(learn, x->input[states[last]]);
+	train_net(learn, 1.0, outcome);
+
+	/* Loop over earlier input sets (starting with most recent) */
+	for (i = last - 1; i >= 0; i--)
+	{
+		/* Check for input set just before final one */
+		if (i == last - 1)
+		{
+			/* Only outcome is passed back */
+			for (j = 0; j < outputs; j++)
+			{
+				/* Start target sum */
+				target_sum[j] = TD_LAMBDA * outcome[j];
+			}
+
+			/* Start total weight */
+			weight = TD_LAMBDA;
+		}
+		else
+		{
+			/* Add next result and reduce later targets */
+			for (j = 0; j < outputs; j++)
+			{
+				/* Update target sum */
+				target_sum[j] = results[(i + 1) * outputs + j] +
+				                TD_LAMBDA * target_sum[j];
+			}
+
+			/* Update total weight */
+			weight = 1.0 + TD_LAMBDA * weight;
+		}
+
+		/* Compute desired outputs */
+		for (j = 0; j < outputs; j++)
+		{
+			/* Average targets */
+			desired[j] = target_sum[j] / weight;
+		}
+
+		/* Train input set */
+		compute_input(learn, x->input[states[i]]);
+		train_net(learn, weight, desired);
+	}
+}
+
+/*
+ * Train the network on input sets with their own desired outputs.
+ */
+static void train_desired(net *learn, experience *x)
+{
+	/* Check for no input sets */
+	if (!x->num_states) return;
+
+	/* Train input sets together */
+	train_net_batch(learn, x->input, NULL, x->desired, x->num_states);
+}
+
+/*
+ * Train the network on the inputs of all players from a game.
+ */
+static void train_game(net *learn, experience *x)
+{
+	static int size;
+	int i;
+
+	/* Check for desired outputs given */
+	if (x->supervised)
+	{
+		/* Use learning rate of role prediction training */
+		learn->alpha = 0.0005 * factor;
+
+		/* Train input sets directly */
+		train_desired(learn, x);
+		return;
+	}
+
+	/* Use learning rate of eval training */
+	learn->alpha = 0.0001 * factor;
+
+	/* Check for more input sets than before */
+	if (x->num_states > size)
+	{
+		/* Remember size */
+		size = x->num_states;
+
+		/* Grow arrays */
+		states = (int *)realloc(states, sizeof(int) * size);
+		results = (double *)realloc(results, sizeof(double) * size *
+		                                     learn->num_output);
+	}
+
+	/* Loop over players */
+	for (i = 0; i < x->num_players; i++)
+	{
+		/* Train on player's input sets */
+		train_player(learn, x, i);
+	}
+}
+
+/*
+ * Train a network from experience files.
+ */
+int main(int argc, char *argv[])
+{
+	net learner;
+	experience x;
+	FILE *fff;
+	int input, hidden, output;
+	int i, j, result, pass, num_pass = 1, batch = 1, games, total = 0;
+	char buf[1024], *net_name;
+
+	/* Parse options */
+	for (i = 1; i < argc; i++)
+	{
+		/* Check for alpha factor */
+		if (!strcmp(argv[i], "-f"))
+		{
+			/* Set factor */
+			factor = atof(argv[++i]);
+		}
+
+		/* Check for minibatch size */
+		else if (!strcmp(argv[i], "-b"))
+		{
+			/* Set number of games per weight update */
+			batch = atoi(argv[++i]);
+
+			/* Use at least one game */
+			if (batch < 1) batch = 1;
+		}
+
+		/* Check for number of passes */
+		else if (!strcmp(argv[i], "-n"))
+		{
+			/* Set number of passes over experience */
+			num_pass = atoi(argv[++i]);
+		}
+
+		/* Stop at first non-option */
+		else break;
+	}
+
+	/* Check for network and experience files */
+	if (argc - i < 2)
+	{
+		/* Print usage */
+		fprintf(stderr, "Usage: %s [-f factor] [-b games] [-n passes] "
+		                "network experience...\n", argv[0]);
+		return 1;
+	}
+
+	/* Get network filename */
+	net_name = argv[i++];
+
+	/* Open network file */
+	fff = fopen(net_name, "r");
+
+	/* Check for failure */
+	if (!fff)
+	{
+		/* Error */
+		perror(net_name);
+		return 1;
+	}
+
+	/* Read network size */
+	if (!fgets(buf, 1024, fff) ||
+	    sscanf(buf, "%d %d %d", &input, &hidden, &output) != 3)
+	{
+		/* Error */
+		fprintf(stderr, "Bad network file %s\n", net_name);
+		return 1;
+	}
+
+	/* Done with file */
+	fclose(fff);
+
+	/* Create network */
+	make_learner(&learner, input, hidden, output);
+
+	/* Load weights */
+	if (load_net(&learner, net_name))
+	{
+		/* Error */
+		fprintf(stderr, "Bad network file %s\n", net_name);
+		return 1;
+	}
+
+	/* Create arrays for targets */
+	target_sum = (double *)malloc(sizeof(double) * output);
+	desired = (double *)malloc(sizeof(double) * output);
+
+	/* Start with no experience */
+	memset(&x, 0, sizeof(experience));
+
+	/* Loop over passes */
+	for (pass = 0; pass < num_pass; pass++)
+	{
+		/* Clear error counters */
+		learner.error = learner.num_error = 0;
+
+		/* No games trained yet */
+		games = 0;
+
+		/* Loop over experience files */
+		for (j = i; j < argc; j++)
+		{
+			/* Open experience file */
+			fff = fopen(argv[j], "rb");
+
+			/* Check for failure */
+			if (!fff)
+			{
+				/* Error */
+				perror(argv[j]);
+				return 1;
+			}
+
+			/* Read games */
+			while ((result = read_experience(fff, &x)) > 0)
+			{
+				/* Check for different network size */
+				if (x.num_inputs != input || x.num_output != output)
+				{
+					/* Error */
+					fprintf(stderr, "Experience in %s does not "
+					        "match network\n", argv[j]);
+					return 1;
+				}
+
+				/* Train on game */
+				train_game(&learner, &x);
+
+				/* Count game */
+				games++;
+				learner.num_training++;
+
+				/* Apply training at end of each minibatch */
+				if (games % batch == 0) apply_training(&learner);
+			}
+
+			/* Check for bad record */
+			if (result < 0)
+			{
+				/* Warn and skip rest of file */
+				fprintf(stderr, "Bad experience record in %s\n",
+				        argv[j]);
+			}
+
+			/* Done with file */
+			fclose(fff);
+		}
+
+		/* Apply training of last minibatch */
+		apply_training(&learner);
+
+		/* Count games */
+		total += games;
+
+		printf("Pass %d: %d games, error %f\n", pass + 1, games,
+		       learner.error / learner.num_error);
+	}
+
+	/* Save weights */
+	save_net(&learner, net_name);
+
+	printf("Trained on %d games\n", total);
+
+	/* Done */
+	return 0;
+}